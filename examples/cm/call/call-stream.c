@@ -159,6 +159,9 @@ static gboolean stream_request_receiving (TpBaseCallStream *base,
 static gboolean stream_set_sending (TpBaseCallStream *base,
     gboolean sending,
     GError **error);
+static GPtrArray *stream_add_local_candidates (TpBaseMediaCallStream *base,
+    const GPtrArray *candidates,
+    GError **error);
 
 static void
 finalize (GObject *object)
@@ -176,6 +179,8 @@ example_call_stream_class_init (ExampleCallStreamClass *klass)
 {
   GObjectClass *object_class = (GObjectClass *) klass;
   TpBaseCallStreamClass *stream_class = (TpBaseCallStreamClass *) klass;
+  TpBaseMediaCallStreamClass *media_class =
+      (TpBaseMediaCallStreamClass *) klass;
   GParamSpec *param_spec;
 
   g_type_class_add_private (klass, sizeof (ExampleCallStreamPrivate));
@@ -188,6 +193,8 @@ example_call_stream_class_init (ExampleCallStreamClass *klass)
   stream_class->request_receiving = stream_request_receiving;
   stream_class->set_sending = stream_set_sending;
 
+  media_class->add_local_candidates = stream_add_local_candidates;
+
   param_spec = g_param_spec_uint ("simulation-delay", "Simulation delay",
       "Delay between simulated network events",
       0, G_MAXUINT32, 1000,
@@ -459,6 +466,22 @@ stream_set_sending (TpBaseCallStream *base,
   return TRUE;
 }
 
+static GPtrArray *
+stream_add_local_candidates (TpBaseMediaCallStream *base,
+    const GPtrArray *candidates,
+    GError **error)
+{
+  GPtrArray *accepted = g_ptr_array_sized_new (candidates->len);
+  guint i;
+
+  /* A real connection manager would check the candidates, and send them to
+   * the peer; there's no peer here, so we just accept all of them. */
+  for (i = 0; i < candidates->len; i++)
+    g_ptr_array_add (accepted, g_ptr_array_index (candidates, i));
+
+  return accepted;
+}
+
 static gboolean
 stream_request_receiving (TpBaseCallStream *base,
     TpHandle contact,
@@ -22,9 +22,13 @@
 #ifndef __TP_ACCOUNT_CHANNEL_REQUEST_INTERNAL_H__
 #define __TP_ACCOUNT_CHANNEL_REQUEST_INTERNAL_H__
 
+#include <telepathy-glib/account-channel-request.h>
 #include <telepathy-glib/base-client.h>
 
 TpBaseClient * _tp_account_channel_request_get_client (
     TpAccountChannelRequest *self);
 
+TpAccountChannelRequest *_tp_account_channel_request_lookup_local (
+    const gchar *request_path);
+
 #endif
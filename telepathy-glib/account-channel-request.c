@@ -123,6 +123,12 @@ enum {
 
 static guint signals[N_SIGNALS] = { 0 };
 
+/* Requests made by this process which have not completed yet:
+ * borrowed ChannelRequest object path => borrowed TpAccountChannelRequest.
+ * If one of them is passed to a TpBaseClient in this process, it can use the
+ * requester's proxies rather than making and preparing its own. */
+static GHashTable *local_requests = NULL;
+
 typedef enum
 {
   ACTION_TYPE_FORGET,
@@ -173,6 +179,46 @@ tp_account_channel_request_init (TpAccountChannelRequest *self)
       TpAccountChannelRequestPrivate);
 }
 
+static void
+forget_local_request (TpAccountChannelRequest *self)
+{
+  const gchar *path;
+
+  if (local_requests == NULL || self->priv->chan_request == NULL)
+    return;
+
+  path = tp_proxy_get_object_path (self->priv->chan_request);
+
+  if (g_hash_table_lookup (local_requests, path) == self)
+    g_hash_table_remove (local_requests, path);
+}
+
+/*
+ * _tp_account_channel_request_lookup_local:
+ * @request_path: the object path of a ChannelRequest
+ *
+ * Returns: (transfer none): the #TpAccountChannelRequest in this process
+ *  which made the ChannelRequest at @request_path, if it has not completed
+ *  yet and does not use a legacy #TpClientChannelFactory, or %NULL
+ */
+TpAccountChannelRequest *
+_tp_account_channel_request_lookup_local (const gchar *request_path)
+{
+  TpAccountChannelRequest *self;
+
+  if (local_requests == NULL)
+    return NULL;
+
+  self = g_hash_table_lookup (local_requests, request_path);
+
+  /* Channels made by a legacy factory aren't in the account's factory's
+   * cache, so there's nothing to share */
+  if (self == NULL || self->priv->factory != NULL)
+    return NULL;
+
+  return self;
+}
+
 static void
 request_disconnect (TpAccountChannelRequest *self)
 {
@@ -199,6 +245,7 @@ tp_account_channel_request_dispose (GObject *object)
     G_OBJECT_CLASS (tp_account_channel_request_parent_class)->dispose;
 
   request_disconnect (self);
+  forget_local_request (self);
 
   if (self->priv->cancel_id != 0)
     g_cancellable_disconnect (self->priv->cancellable, self->priv->cancel_id);
@@ -674,6 +721,7 @@ complete_result (TpAccountChannelRequest *self)
   g_assert (self->priv->result != NULL);
 
   request_disconnect (self);
+  forget_local_request (self);
 
   g_simple_async_result_complete_in_idle (self->priv->result);
 
@@ -950,6 +998,12 @@ acr_request_cb (TpChannelDispatcher *cd,
   _tp_channel_request_set_channel_factory (self->priv->chan_request,
       self->priv->factory);
 
+  if (local_requests == NULL)
+    local_requests = g_hash_table_new (g_str_hash, g_str_equal);
+
+  g_hash_table_insert (local_requests,
+      (gchar *) tp_proxy_get_object_path (self->priv->chan_request), self);
+
   self->priv->invalidated_sig = g_signal_connect (self->priv->chan_request,
       "invalidated", G_CALLBACK (acr_channel_request_invalidated_cb), self);
 
@@ -398,6 +398,12 @@ _tp_account_invalidated_cb (TpAccount *self,
 {
   TpAccountPrivate *priv = self->priv;
 
+  /* A proxy that was merely unreferenced leaves its snapshot behind for the
+   * next one; otherwise the account is gone or unreachable */
+  if (!(domain == TP_DBUS_ERRORS && code == TP_DBUS_ERROR_PROXY_UNREFERENCED))
+    _tp_simple_client_factory_forget_snapshot (tp_proxy_get_factory (self),
+        tp_proxy_get_object_path (self));
+
   /* The connection will get disconnected as a result of account deletion,
    * but by then we will no longer be telling the API user about changes -
    * so claim the disconnection already happened (see fd.o#25149) */
@@ -1004,6 +1010,8 @@ _tp_account_properties_changed (TpAccount *proxy,
   if (!tp_proxy_is_prepared (self, TP_ACCOUNT_FEATURE_CORE))
     return;
 
+  _tp_simple_client_factory_update_snapshot (tp_proxy_get_factory (self),
+      tp_proxy_get_object_path (self), properties);
   _tp_account_update (self, properties);
 }
 
@@ -1023,6 +1031,7 @@ _tp_account_got_all_cb (TpProxy *proxy,
     GObject *weak_object)
 {
   TpAccount *self = TP_ACCOUNT (weak_object);
+  gboolean was_prepared;
 
   DEBUG ("Got whole set of properties for %s",
       tp_proxy_get_object_path (self));
@@ -1035,12 +1044,19 @@ _tp_account_got_all_cb (TpProxy *proxy,
       return;
     }
 
+  /* If we were made ready from a snapshot, this is the revalidation and
+   * anything that changed meanwhile is announced as a normal change */
+  was_prepared = tp_proxy_is_prepared (self, TP_ACCOUNT_FEATURE_CORE);
+
+  _tp_simple_client_factory_update_snapshot (tp_proxy_get_factory (self),
+      tp_proxy_get_object_path (self), properties);
   _tp_account_update (self, properties);
 
   /* We can't try connecting this signal earlier as tp_proxy_add_interfaces()
    * has to be called first if we support the Avatar interface. */
-  tp_cli_account_interface_avatar_connect_to_avatar_changed (self,
-      avatar_changed_cb, NULL, NULL, G_OBJECT (self), NULL);
+  if (!was_prepared)
+    tp_cli_account_interface_avatar_connect_to_avatar_changed (self,
+        avatar_changed_cb, NULL, NULL, G_OBJECT (self), NULL);
 }
 
 static void
@@ -1088,6 +1104,7 @@ _tp_account_constructed (GObject *object)
     ((GObjectClass *) tp_account_parent_class)->constructed;
   GError *error = NULL;
   TpProxySignalConnection *sc;
+  GHashTable *snapshot;
 
   if (chain_up != NULL)
     chain_up (object);
@@ -1122,6 +1139,23 @@ _tp_account_constructed (GObject *object)
   tp_cli_dbus_properties_connect_to_properties_changed (self,
       dbus_properties_changed_cb, NULL, NULL, object, NULL);
 
+  /* If an earlier proxy for this account saw its properties, become ready
+   * straight away from that snapshot; the GetAll below still runs, and
+   * corrects anything that changed while nobody was watching. */
+  snapshot = _tp_simple_client_factory_dup_snapshot (
+      tp_proxy_get_factory (self), tp_proxy_get_object_path (self));
+
+  if (snapshot != NULL)
+    {
+      DEBUG ("%s: preparing core from cached properties",
+          tp_proxy_get_object_path (self));
+
+      _tp_account_update (self, snapshot);
+      tp_cli_account_interface_avatar_connect_to_avatar_changed (self,
+          avatar_changed_cb, NULL, NULL, G_OBJECT (self), NULL);
+      g_hash_table_unref (snapshot);
+    }
+
   tp_cli_dbus_properties_call_get_all (self, -1, TP_IFACE_ACCOUNT,
       _tp_account_got_all_cb, NULL, NULL, G_OBJECT (self));
 }
@@ -27,6 +27,7 @@
 #include <telepathy-glib/account.h>
 #include <telepathy-glib/add-dispatch-operation-context.h>
 #include <telepathy-glib/channel-dispatch-operation.h>
+#include "telepathy-glib/prepare-pipeline-internal.h"
 
 G_BEGIN_DECLS
 
@@ -63,6 +64,7 @@ TpAddDispatchOperationContextState _tp_add_dispatch_operation_context_get_state
 
 void _tp_add_dispatch_operation_context_prepare_async (
     TpAddDispatchOperationContext *self,
+    TpPreparePipeline *pipeline,
     const GQuark *account_features,
     const GQuark *connection_features,
     const GQuark *channel_features,
@@ -466,7 +466,7 @@ cdo_prepare_cb (GObject *source,
   if (self->priv->result == NULL)
     goto out;
 
-  if (!tp_proxy_prepare_finish (source, result, &error))
+  if (!_tp_prepare_pipeline_prepare_finish (source, result, &error))
     {
       DEBUG ("Failed to prepare ChannelDispatchOperation: %s", error->message);
 
@@ -491,7 +491,7 @@ account_prepare_cb (GObject *source,
   if (self->priv->result == NULL)
     goto out;
 
-  if (!tp_proxy_prepare_finish (source, result, &error))
+  if (!_tp_prepare_pipeline_prepare_finish (source, result, &error))
     {
       DEBUG ("Failed to prepare account: %s", error->message);
       g_error_free (error);
@@ -515,7 +515,7 @@ conn_prepare_cb (GObject *source,
   if (self->priv->result == NULL)
     goto out;
 
-  if (!tp_proxy_prepare_finish (source, result, &error))
+  if (!_tp_prepare_pipeline_prepare_finish (source, result, &error))
     {
       DEBUG ("Failed to prepare connection: %s", error->message);
       g_error_free (error);
@@ -539,7 +539,7 @@ adoc_channel_prepare_cb (GObject *source,
   if (self->priv->result == NULL)
     goto out;
 
-  if (!tp_proxy_prepare_finish (source, result, &error))
+  if (!_tp_prepare_pipeline_prepare_finish (source, result, &error))
     {
       DEBUG ("Failed to prepare channel: %s", error->message);
 
@@ -555,6 +555,7 @@ out:
 
 static void
 context_prepare (TpAddDispatchOperationContext *self,
+    TpPreparePipeline *pipeline,
     const GQuark *account_features,
     const GQuark *connection_features,
     const GQuark *channel_features)
@@ -564,14 +565,14 @@ context_prepare (TpAddDispatchOperationContext *self,
 
   self->priv->num_pending = 3;
 
-  tp_proxy_prepare_async (self->account, account_features,
-      account_prepare_cb, g_object_ref (self));
+  _tp_prepare_pipeline_prepare_async (pipeline, self->account,
+      account_features, account_prepare_cb, g_object_ref (self));
 
-  tp_proxy_prepare_async (self->connection, connection_features,
-      conn_prepare_cb, g_object_ref (self));
+  _tp_prepare_pipeline_prepare_async (pipeline, self->connection,
+      connection_features, conn_prepare_cb, g_object_ref (self));
 
-  tp_proxy_prepare_async (self->dispatch_operation, cdo_features,
-      cdo_prepare_cb, g_object_ref (self));
+  _tp_prepare_pipeline_prepare_async (pipeline, self->dispatch_operation,
+      cdo_features, cdo_prepare_cb, g_object_ref (self));
 
   for (i = 0; i < self->channels->len; i++)
     {
@@ -579,14 +580,15 @@ context_prepare (TpAddDispatchOperationContext *self,
 
       self->priv->num_pending++;
 
-      tp_proxy_prepare_async (channel, channel_features,
-          adoc_channel_prepare_cb, g_object_ref (self));
+      _tp_prepare_pipeline_prepare_async (pipeline, channel,
+          channel_features, adoc_channel_prepare_cb, g_object_ref (self));
     }
 }
 
 void
 _tp_add_dispatch_operation_context_prepare_async (
     TpAddDispatchOperationContext *self,
+    TpPreparePipeline *pipeline,
     const GQuark *account_features,
     const GQuark *connection_features,
     const GQuark *channel_features,
@@ -601,7 +603,7 @@ _tp_add_dispatch_operation_context_prepare_async (
   self->priv->result = g_simple_async_result_new (G_OBJECT (self),
       callback, user_data, _tp_add_dispatch_operation_context_prepare_async);
 
-  context_prepare (self, account_features, connection_features,
+  context_prepare (self, pipeline, account_features, connection_features,
       channel_features);
 }
 
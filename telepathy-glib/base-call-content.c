@@ -169,6 +169,8 @@ struct _TpBaseCallContentPrivate
 
   /* GList or reffed TpBaseCallStream */
   GList *streams;
+  /* borrowed TpBaseCallStream => its link in streams */
+  GHashTable *stream_links;
 
   /* Borrowed */
   TpBaseCallChannel *channel;
@@ -200,6 +202,8 @@ tp_base_call_content_init (TpBaseCallContent *self)
 {
   self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
       TP_TYPE_BASE_CALL_CONTENT, TpBaseCallContentPrivate);
+
+  self->priv->stream_links = g_hash_table_new (NULL, NULL);
 }
 
 static void
@@ -224,6 +228,7 @@ tp_base_call_content_deinit_real (TpBaseCallContent *self)
 
   tp_dbus_daemon_unregister_object (bus, G_OBJECT (self));
 
+  g_hash_table_remove_all (self->priv->stream_links);
   tp_clear_pointer (&self->priv->streams, _tp_object_list_free);
 }
 
@@ -243,6 +248,7 @@ tp_base_call_content_dispose (GObject *object)
 
   g_assert (self->priv->deinit_has_run);
 
+  g_hash_table_remove_all (self->priv->stream_links);
   tp_clear_pointer (&self->priv->streams, _tp_object_list_free);
   g_object_notify (G_OBJECT (self), "streams");
   tp_clear_object (&self->priv->conn);
@@ -259,6 +265,7 @@ tp_base_call_content_finalize (GObject *object)
   /* free any data held directly by the object here */
   g_free (self->priv->object_path);
   g_free (self->priv->name);
+  g_hash_table_unref (self->priv->stream_links);
 
   G_OBJECT_CLASS (tp_base_call_content_parent_class)->finalize (object);
 }
@@ -673,12 +680,14 @@ tp_base_call_content_add_stream (TpBaseCallContent *self,
   g_return_if_fail (tp_base_call_stream_get_connection (stream) ==
       self->priv->conn);
   g_return_if_fail (self->priv->channel != NULL);
-  g_return_if_fail (g_list_find (self->priv->streams, stream) == NULL);
+  g_return_if_fail (!g_hash_table_contains (self->priv->stream_links, stream));
 
   _tp_base_call_stream_set_content (stream, self);
 
   self->priv->streams = g_list_prepend (self->priv->streams,
       g_object_ref (stream));
+  g_hash_table_insert (self->priv->stream_links, stream,
+      self->priv->streams);
   g_object_notify (G_OBJECT (self), "streams");
 
   paths = g_ptr_array_new_with_free_func ((GDestroyNotify) g_free);
@@ -698,9 +707,10 @@ _tp_base_call_content_remove_stream_internal (TpBaseCallContent *self,
   GList *l;
   GPtrArray *paths;
 
-  l = g_list_find (self->priv->streams, stream);
+  l = g_hash_table_lookup (self->priv->stream_links, stream);
   g_return_if_fail (l != NULL);
 
+  g_hash_table_remove (self->priv->stream_links, stream);
   self->priv->streams = g_list_delete_link (self->priv->streams, l);
   g_object_notify (G_OBJECT (self), "streams");
 
@@ -64,10 +64,18 @@ gboolean _tp_base_call_stream_set_sending (TpBaseCallStream *self,
     const gchar *message,
     GError **error);
 GHashTable *_tp_base_call_stream_get_remote_members (TpBaseCallStream *self);
+gboolean _tp_base_call_stream_has_remote_senders (TpBaseCallStream *self);
 
 /* Implemented in base-media-call-stream.c */
 void _tp_base_media_call_stream_set_remotely_held (TpBaseMediaCallStream *self,
     gboolean remotely_held);
+gboolean _tp_base_media_call_stream_has_connected_endpoint (
+    TpBaseMediaCallStream *self);
+void _tp_base_media_call_stream_endpoint_state_changed (
+    TpBaseMediaCallStream *self,
+    TpCallStreamEndpoint *endpoint,
+    TpStreamEndpointState old_state,
+    TpStreamEndpointState new_state);
 
 /* Implemented in base-call-channel.c */
 GHashTable *_tp_base_call_dup_member_identifiers (TpBaseConnection *conn,
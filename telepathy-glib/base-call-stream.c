@@ -143,6 +143,8 @@ struct _TpBaseCallStreamPrivate
 
   /* TpHandle -> TpSendingState */
   GHashTable *remote_members;
+  /* number of remote_members that are SENDING or PENDING_SEND */
+  guint n_remote_senders;
 
   TpSendingState local_sending_state;
 
@@ -578,6 +580,13 @@ tp_base_call_stream_update_local_sending_state (TpBaseCallStream *self,
   return TRUE;
 }
 
+static gboolean
+is_sending (TpSendingState state)
+{
+  return (state == TP_SENDING_STATE_SENDING ||
+      state == TP_SENDING_STATE_PENDING_SEND);
+}
+
 /**
  * tp_base_call_stream_get_remote_sending_state:
  * @self: a #TpBaseCallStream
@@ -659,6 +668,12 @@ tp_base_call_stream_update_remote_sending_state (TpBaseCallStream *self,
   DEBUG ("Updating remote member %d state: %d => %d for stream %s",
       contact, old_state, new_state, self->priv->object_path);
 
+  if (exists && is_sending (old_state))
+    self->priv->n_remote_senders--;
+
+  if (is_sending (new_state))
+    self->priv->n_remote_senders++;
+
   g_hash_table_insert (self->priv->remote_members,
       GUINT_TO_POINTER (contact),
       GUINT_TO_POINTER (new_state));
@@ -715,12 +730,18 @@ tp_base_call_stream_remove_member (TpBaseCallStream *self,
   GHashTable *empty_table;
   GArray *removed_array;
   GValueArray *reason_array;
+  gpointer old_state_p;
 
   g_return_val_if_fail (TP_IS_BASE_CALL_STREAM (self), FALSE);
 
-  if (!g_hash_table_remove (self->priv->remote_members,
-          GUINT_TO_POINTER (contact)))
+  if (!g_hash_table_lookup_extended (self->priv->remote_members,
+          GUINT_TO_POINTER (contact), NULL, &old_state_p))
     return FALSE;
+
+  if (is_sending (GPOINTER_TO_UINT (old_state_p)))
+    self->priv->n_remote_senders--;
+
+  g_hash_table_remove (self->priv->remote_members, GUINT_TO_POINTER (contact));
   g_object_notify (G_OBJECT (self), "remote-members");
 
   empty_table = g_hash_table_new (g_direct_hash, g_direct_equal);
@@ -930,3 +951,12 @@ _tp_base_call_stream_get_remote_members (TpBaseCallStream *self)
 
   return self->priv->remote_members;
 }
+
+/* Returns TRUE if any remote member is sending, or about to be */
+gboolean
+_tp_base_call_stream_has_remote_senders (TpBaseCallStream *self)
+{
+  g_return_val_if_fail (TP_IS_BASE_CALL_STREAM (self), FALSE);
+
+  return self->priv->n_remote_senders > 0;
+}
@@ -23,6 +23,7 @@
 #define __TP_BASE_CLIENT_INTERNAL_H__
 
 #include <telepathy-glib/base-client.h>
+#include <telepathy-glib/prepare-pipeline-internal.h>
 
 G_BEGIN_DECLS
 
@@ -32,6 +33,8 @@ void _tp_base_client_set_only_for_account (TpBaseClient *self,
 void _tp_base_client_now_handling_channels (TpBaseClient *self,
     GPtrArray *channels);
 
+TpPreparePipeline *_tp_base_client_get_prepare_pipeline (TpBaseClient *self);
+
 G_END_DECLS
 
 #endif
@@ -184,22 +184,26 @@
 #include <dbus/dbus.h>
 #include <dbus/dbus-glib-lowlevel.h>
 
+#include <telepathy-glib/account-channel-request-internal.h>
 #include <telepathy-glib/add-dispatch-operation-context-internal.h>
 #include <telepathy-glib/automatic-proxy-factory.h>
 #include <telepathy-glib/channel-dispatch-operation-internal.h>
 #include <telepathy-glib/channel-dispatcher.h>
 #include <telepathy-glib/channel-request.h>
 #include <telepathy-glib/channel.h>
+#include <telepathy-glib/channel-filter-index-internal.h>
 #include <telepathy-glib/dbus-internal.h>
 #include <telepathy-glib/gtypes.h>
 #include <telepathy-glib/handle-channels-context-internal.h>
 #include <telepathy-glib/interfaces.h>
 #include <telepathy-glib/observe-channels-context-internal.h>
+#include <telepathy-glib/prepare-pipeline-internal.h>
 #include <telepathy-glib/svc-client.h>
 #include <telepathy-glib/svc-generic.h>
 #include <telepathy-glib/util.h>
 
 #define DEBUG_FLAG TP_DEBUG_CLIENT
+#include "telepathy-glib/channel-internal.h"
 #include "telepathy-glib/connection-internal.h"
 #include "telepathy-glib/debug-internal.h"
 #include "telepathy-glib/deprecated-internal.h"
@@ -235,6 +239,7 @@ enum {
 enum {
   SIGNAL_REQUEST_ADDED,
   SIGNAL_REQUEST_REMOVED,
+  SIGNAL_OBSERVED_CHANNEL_PREPARED,
   N_SIGNALS
 };
 
@@ -269,6 +274,8 @@ struct _TpBaseClientPrivate
   GPtrArray *approver_filters;
   /* array of TP_HASH_TYPE_CHANNEL_CLASS */
   GPtrArray *handler_filters;
+  /* the same filters, for matching channels in-process */
+  TpChannelFilterIndex *handler_index;
   /* array of g_strdup(token), plus NULL included in length */
   GPtrArray *handler_caps;
 
@@ -292,6 +299,9 @@ struct _TpBaseClientPrivate
   TpBaseClientDelegatedChannelsCb delegated_channels_cb;
   gpointer delegated_channels_data;
   GDestroyNotify delegated_channels_destroy;
+
+  /* shared by all the dispatch contexts */
+  TpPreparePipeline *pipeline;
 };
 
 /*
@@ -532,6 +542,38 @@ tp_base_client_set_observer_delay_approvers (TpBaseClient *self,
     }
 }
 
+/**
+ * tp_base_client_set_max_concurrent_preparations:
+ * @self: a #TpBaseClient
+ * @max: the largest number of channels to prepare at the same time,
+ *  or 0 for no limit
+ *
+ * Limit how many channels @self prepares at once before passing them to
+ * #TpBaseClientClass.observe_channels,
+ * #TpBaseClientClass.add_dispatch_operation or
+ * #TpBaseClientClass.handle_channels. Once the limit is reached, further
+ * channels wait until an earlier one is ready. This avoids sending a
+ * connection manager a large number of introspection calls at once when
+ * many channels are dispatched together. Accounts and connections are
+ * always prepared straight away.
+ *
+ * Whatever the limit, if several of these callbacks are waiting for the
+ * same account, connection or channel to be prepared with the same
+ * features, it is only prepared once.
+ *
+ * The default is 0, meaning that all channels are prepared concurrently.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_base_client_set_max_concurrent_preparations (TpBaseClient *self,
+    guint max)
+{
+  g_return_if_fail (TP_IS_BASE_CLIENT (self));
+
+  _tp_prepare_pipeline_set_max_channels (self->priv->pipeline, max);
+}
+
 /**
  * tp_base_client_add_approver_filter:
  * @self: a #TpBaseClient
@@ -707,6 +749,7 @@ tp_base_client_take_handler_filter (TpBaseClient *self,
 
   self->priv->flags |= CLIENT_IS_HANDLER;
   g_ptr_array_add (self->priv->handler_filters, filter);
+  _tp_channel_filter_index_add (self->priv->handler_index, filter, NULL);
 }
 
 /**
@@ -978,17 +1021,17 @@ tp_base_client_register (TpBaseClient *self,
 
   if (clients == NULL)
     {
-      /* Map DBusConnection to the self->priv->my_chans hash table owned by
-       * the client using this DBusConnection.
+      /* Map DBusConnection to the handlers using this DBusConnection, so
+       * that we can find their my_chans hash tables and their filters.
 
-       * borrowed client path => borrowed (GHashTable *) */
+       * borrowed client path => borrowed (TpBaseClient *) */
       clients = g_hash_table_new (g_str_hash, g_str_equal);
 
       dbus_connection_set_data (self->priv->libdbus, clients_slot, clients,
           (DBusFreeFunction) g_hash_table_unref);
     }
 
-  g_hash_table_insert (clients, self->priv->object_path, self->priv->my_chans);
+  g_hash_table_insert (clients, self->priv->object_path, self);
 
   return TRUE;
 }
@@ -1051,9 +1094,9 @@ tp_base_client_get_handled_channels (TpBaseClient *self)
   g_hash_table_iter_init (&iter, clients);
   while (g_hash_table_iter_next (&iter, NULL, &value))
     {
-      GHashTable *chans = value;
+      TpBaseClient *client = value;
 
-      tp_g_hash_table_update (set, chans, NULL, NULL);
+      tp_g_hash_table_update (set, client->priv->my_chans, NULL, NULL);
     }
 
   result = g_hash_table_get_values (set);
@@ -1122,6 +1165,7 @@ tp_base_client_init (TpBaseClient *self)
       (GDestroyNotify) g_hash_table_unref);
   self->priv->handler_filters = g_ptr_array_new_with_free_func (
       (GDestroyNotify) g_hash_table_unref);
+  self->priv->handler_index = _tp_channel_filter_index_new ();
   self->priv->handler_caps = g_ptr_array_new_with_free_func (g_free);
   g_ptr_array_add (self->priv->handler_caps, NULL);
 
@@ -1131,6 +1175,8 @@ tp_base_client_init (TpBaseClient *self)
   self->priv->account_features = g_array_new (TRUE, FALSE, sizeof (GQuark));
   self->priv->connection_features = g_array_new (TRUE, FALSE, sizeof (GQuark));
   self->priv->channel_features = g_array_new (TRUE, FALSE, sizeof (GQuark));
+
+  self->priv->pipeline = _tp_prepare_pipeline_new ();
 }
 
 static void
@@ -1181,6 +1227,7 @@ tp_base_client_finalize (GObject *object)
   g_ptr_array_unref (self->priv->observer_filters);
   g_ptr_array_unref (self->priv->approver_filters);
   g_ptr_array_unref (self->priv->handler_filters);
+  _tp_channel_filter_index_unref (self->priv->handler_index);
   g_ptr_array_unref (self->priv->handler_caps);
 
   g_free (self->priv->bus_name);
@@ -1190,6 +1237,9 @@ tp_base_client_finalize (GObject *object)
   tp_clear_pointer (&self->priv->connection_features, g_array_unref);
   tp_clear_pointer (&self->priv->channel_features, g_array_unref);
 
+  /* in-flight preparations keep the pipeline alive until they finish */
+  _tp_prepare_pipeline_unref (self->priv->pipeline);
+
   if (finalize != NULL)
     finalize (object);
 }
@@ -1687,6 +1737,34 @@ tp_base_client_class_init (TpBaseClientClass *cls)
       G_TYPE_NONE, 3,
       TP_TYPE_CHANNEL_REQUEST, G_TYPE_STRING, G_TYPE_STRING);
 
+ /**
+   * TpBaseClient::observed-channel-prepared:
+   * @self: a #TpBaseClient
+   * @account: the #TpAccount with which the channel is associated,
+   *  prepared as for #TpBaseClientClass.observe_channels if possible
+   * @connection: the #TpConnection with which the channel is associated,
+   *  prepared as for #TpBaseClientClass.observe_channels if possible
+   * @channel: a #TpChannel being observed, with its features prepared
+   *
+   * Emitted for each channel passed to an Observer as soon as that channel
+   * is ready, without waiting for the other channels in the same call to
+   * ObserveChannels. #TpBaseClientClass.observe_channels is still called
+   * once all of them are ready, so Observers which only need to know about
+   * one channel at a time can start working on it earlier by connecting to
+   * this signal.
+   *
+   * If the channel cannot be prepared, this signal is not emitted for it.
+   *
+   * Since: 0.UNRELEASED
+   */
+  signals[SIGNAL_OBSERVED_CHANNEL_PREPARED] = g_signal_new (
+      "observed-channel-prepared", G_OBJECT_CLASS_TYPE (cls),
+      G_SIGNAL_RUN_LAST,
+      0,
+      NULL, NULL, NULL,
+      G_TYPE_NONE, 3,
+      TP_TYPE_ACCOUNT, TP_TYPE_CONNECTION, TP_TYPE_CHANNEL);
+
   cls->dbus_properties_class.interfaces = prop_ifaces;
   tp_dbus_properties_mixin_class_init (object_class,
       G_STRUCT_OFFSET (TpBaseClientClass, dbus_properties_class));
@@ -1704,6 +1782,17 @@ ptr_array_to_list (GPtrArray *arr)
   return g_list_reverse (result);
 }
 
+static void
+observe_channel_ready_cb (TpObserveChannelsContext *ctx,
+    TpChannel *channel,
+    gpointer user_data)
+{
+  TpBaseClient *self = user_data;
+
+  g_signal_emit (self, signals[SIGNAL_OBSERVED_CHANNEL_PREPARED], 0,
+      ctx->account, ctx->connection, channel);
+}
+
 static void
 context_prepare_cb (GObject *source,
     GAsyncResult *result,
@@ -1811,6 +1900,7 @@ dup_features_for_channel (TpBaseClient *self,
 
 static TpChannel *
 ensure_account_connection_channels (TpBaseClient *self,
+    TpSimpleClientFactory *factory,
     const gchar *account_path,
     const gchar *connection_path,
     const GPtrArray *channels_arr,
@@ -1830,11 +1920,16 @@ ensure_account_connection_channels (TpBaseClient *self,
   *connection = NULL;
   *channels = NULL;
 
-  *account = tp_base_client_dup_account (self, account_path, error);
+  if (factory == self->priv->factory)
+    *account = tp_base_client_dup_account (self, account_path, error);
+  else
+    *account = tp_simple_client_factory_ensure_account (factory,
+        account_path, NULL, error);
+
   if (*account == NULL)
     goto error;
 
-  *connection = tp_simple_client_factory_ensure_connection (self->priv->factory,
+  *connection = tp_simple_client_factory_ensure_connection (factory,
       connection_path, NULL, error);
   if (*connection == NULL)
     goto error;
@@ -1870,7 +1965,7 @@ ensure_account_connection_channels (TpBaseClient *self,
       else
         {
           channel = tp_simple_client_factory_ensure_channel (
-              self->priv->factory, *connection, chan_path, chan_props, error);
+              factory, *connection, chan_path, chan_props, error);
         }
 
       if (channel == NULL)
@@ -1935,8 +2030,9 @@ _tp_base_client_observe_channels (TpSvcClientObserver *iface,
       return;
     }
 
-  channel = ensure_account_connection_channels (self, account_path,
-      connection_path, channels_arr, &account, &connection, &channels, &error);
+  channel = ensure_account_connection_channels (self, self->priv->factory,
+      account_path, connection_path, channels_arr, &account, &connection,
+      &channels, &error);
   if (channel == NULL)
     goto out;
 
@@ -1987,7 +2083,10 @@ _tp_base_client_observe_channels (TpSvcClientObserver *iface,
   connection_features = dup_features_for_connection (self, connection);
   channel_features = dup_features_for_channel (self, channel);
 
-  _tp_observe_channels_context_prepare_async (ctx,
+  _tp_observe_channels_context_set_channel_ready_func (ctx,
+      observe_channel_ready_cb, self);
+
+  _tp_observe_channels_context_prepare_async (ctx, self->priv->pipeline,
       (GQuark *) account_features->data,
       (GQuark *) connection_features->data,
       (GQuark *) channel_features->data,
@@ -2132,8 +2231,9 @@ _tp_base_client_add_dispatch_operation (TpSvcClientApprover *iface,
       goto out;
     }
 
-  channel = ensure_account_connection_channels (self, account_path,
-      connection_path, channels_arr, &account, &connection, &channels, &error);
+  channel = ensure_account_connection_channels (self, self->priv->factory,
+      account_path, connection_path, channels_arr, &account, &connection,
+      &channels, &error);
   if (channel == NULL)
     goto out;
 
@@ -2161,7 +2261,7 @@ _tp_base_client_add_dispatch_operation (TpSvcClientApprover *iface,
   connection_features = dup_features_for_connection (self, connection);
   channel_features = dup_features_for_channel (self, channel);
 
-  _tp_add_dispatch_operation_context_prepare_async (ctx,
+  _tp_add_dispatch_operation_context_prepare_async (ctx, self->priv->pipeline,
       (GQuark *) account_features->data,
       (GQuark *) connection_features->data,
       (GQuark *) channel_features->data,
@@ -2273,12 +2373,48 @@ delegate_to_preferred_handler_delegate_cb (GObject *source,
   g_ptr_array_unref (delegated);
 }
 
+/* Returns the handler called @bus_name, if it shares our connection to the
+ * bus */
+static TpBaseClient *
+find_local_handler (TpBaseClient *self,
+    const gchar *bus_name)
+{
+  GHashTable *clients;
+  gchar *path;
+  TpBaseClient *client;
+
+  if (clients_slot == -1 || self->priv->libdbus == NULL)
+    return NULL;
+
+  clients = dbus_connection_get_data (self->priv->libdbus, clients_slot);
+  if (clients == NULL)
+    return NULL;
+
+  path = g_strdup_printf ("/%s", bus_name);
+  g_strdelimit (path, ".", '/');
+  client = g_hash_table_lookup (clients, path);
+  g_free (path);
+
+  return client;
+}
+
+/* Returns TRUE if a channel with these immutable properties matches any of
+ * @self's HandlerChannelFilter */
+static gboolean
+handler_filters_match (TpBaseClient *self,
+    GHashTable *properties)
+{
+  return _tp_channel_filter_index_match (self->priv->handler_index,
+      properties, NULL);
+}
+
 static gboolean
 delegate_channels_if_needed (TpBaseClient *self,
     TpHandleChannelsContext *ctx)
 {
   GList *requests, *l;
   const gchar *handler_to_delegate = NULL;
+  TpBaseClient *local_handler;
   gint64 user_action_time = 0;
   guint i;
   GList *chans = NULL;
@@ -2320,6 +2456,11 @@ delegate_channels_if_needed (TpBaseClient *self,
     /* We are already the one handling the channels */
     goto out;
 
+  /* If the preferred handler lives in this process we can see its filters;
+   * if it wouldn't take a channel, the channel dispatcher would give them
+   * to some other handler, which isn't what the request asked for */
+  local_handler = find_local_handler (self, handler_to_delegate);
+
   /* We are supposed to delegate the channels; check if we are handling
    * them */
   for (i = 0; i < ctx->channels->len; i++)
@@ -2335,6 +2476,16 @@ delegate_channels_if_needed (TpBaseClient *self,
           goto out;
         }
 
+      if (local_handler != NULL &&
+          !handler_filters_match (local_handler,
+            _tp_channel_get_immutable_properties (channel)))
+        {
+          DEBUG ("We have been asked to delegate channels to %s but it "
+              "doesn't handle channels like %s", handler_to_delegate,
+              tp_proxy_get_object_path (channel));
+          goto out;
+        }
+
       chans = g_list_prepend (chans, channel);
     }
 
@@ -2344,11 +2495,10 @@ delegate_channels_if_needed (TpBaseClient *self,
   tp_base_client_delegate_channels_async (self, chans, user_action_time,
       handler_to_delegate, delegate_to_preferred_handler_delegate_cb, self);
 
-  g_list_free (chans);
-
   tp_handle_channels_context_accept (ctx);
 
 out:
+  g_list_free (chans);
   g_list_free_full (requests, g_object_unref);
   return delegate;
 }
@@ -2419,6 +2569,65 @@ find_request_by_path (TpBaseClient *self,
   return NULL;
 }
 
+/* If we are asked to handle channels because of a request made by a
+ * TpAccountChannelRequest in this process, the requester already has
+ * proxies for the account and connection (and maybe the channel), probably
+ * prepared. Rather than making our own and preparing them all over again,
+ * use the requester's factory so that we get the same objects; but only if
+ * it would make the same kinds of objects as ours, since our subclass may
+ * rely on getting (say) a TpTextChannel. */
+static TpSimpleClientFactory *
+factory_for_requests (TpBaseClient *self,
+    const gchar *account_path,
+    const GPtrArray *requests_arr)
+{
+  guint i;
+
+  /* Both of these want channels made in their own way */
+  if (self->priv->channel_factory != NULL ||
+      self->priv->only_for_account != NULL)
+    return self->priv->factory;
+
+  for (i = 0; i < requests_arr->len; i++)
+    {
+      const gchar *req_path = g_ptr_array_index (requests_arr, i);
+      TpAccountChannelRequest *requester;
+      TpAccount *account;
+      TpSimpleClientFactory *factory;
+
+      requester = _tp_account_channel_request_lookup_local (req_path);
+      if (requester == NULL)
+        continue;
+
+      account = tp_account_channel_request_get_account (requester);
+      factory = tp_proxy_get_factory (account);
+
+      /* An account made without a factory isn't cached anywhere */
+      if (factory == NULL ||
+          tp_strdiff (tp_proxy_get_object_path (account), account_path) ||
+          tp_proxy_get_dbus_connection (account) !=
+            tp_proxy_get_dbus_connection (self->priv->dbus))
+        continue;
+
+      if (factory == self->priv->factory)
+        return factory;
+
+      if (!_tp_simple_client_factory_is_compatible (self->priv->factory,
+            factory))
+        {
+          DEBUG ("%s was requested in this process, but the requester's "
+              "factory differs from ours; not sharing its proxies", req_path);
+          continue;
+        }
+
+      DEBUG ("%s was requested in this process; using the requester's "
+          "proxies", req_path);
+      return factory;
+    }
+
+  return self->priv->factory;
+}
+
 static void
 _tp_base_client_handle_channels (TpSvcClientHandler *iface,
     const gchar *account_path,
@@ -2432,6 +2641,7 @@ _tp_base_client_handle_channels (TpSvcClientHandler *iface,
   TpBaseClient *self = TP_BASE_CLIENT (iface);
   TpHandleChannelsContext *ctx;
   TpBaseClientClass *cls = TP_BASE_CLIENT_GET_CLASS (self);
+  TpSimpleClientFactory *factory;
   GError *error = NULL;
   TpAccount *account = NULL;
   TpConnection *connection = NULL;
@@ -2460,8 +2670,11 @@ _tp_base_client_handle_channels (TpSvcClientHandler *iface,
       return;
     }
 
-  channel = ensure_account_connection_channels (self, account_path,
-      connection_path, channels_arr, &account, &connection, &channels, &error);
+  factory = factory_for_requests (self, account_path, requests_arr);
+
+  channel = ensure_account_connection_channels (self, factory,
+      account_path, connection_path, channels_arr, &account, &connection,
+      &channels, &error);
   if (channel == NULL)
     goto out;
 
@@ -2492,7 +2705,7 @@ _tp_base_client_handle_channels (TpSvcClientHandler *iface,
       else
         {
           request = _tp_simple_client_factory_ensure_channel_request (
-              self->priv->factory, req_path, props, &error);
+              factory, req_path, props, &error);
           if (request == NULL)
             {
               DEBUG ("Failed to create TpChannelRequest: %s", error->message);
@@ -2510,7 +2723,7 @@ _tp_base_client_handle_channels (TpSvcClientHandler *iface,
   connection_features = dup_features_for_connection (self, connection);
   channel_features = dup_features_for_channel (self, channel);
 
-  _tp_handle_channels_context_prepare_async (ctx,
+  _tp_handle_channels_context_prepare_async (ctx, self->priv->pipeline,
       (GQuark *) account_features->data,
       (GQuark *) connection_features->data,
       (GQuark *) channel_features->data,
@@ -3169,24 +3382,43 @@ gboolean
 tp_base_client_is_handling_channel (TpBaseClient *self,
     TpChannel *channel)
 {
-  GList *channels, *l;
-  gboolean found = FALSE;
+  const gchar *path;
+  GHashTable *clients;
+  GHashTableIter iter;
+  gpointer value;
 
   g_return_val_if_fail (TP_IS_BASE_CLIENT (self), FALSE);
   g_return_val_if_fail (self->priv->flags & CLIENT_IS_HANDLER, FALSE);
 
-  channels = tp_base_client_dup_handled_channels (self);
-  for (l = channels; l != NULL && !found; l = g_list_next (l))
+  if (clients_slot == -1 || self->priv->libdbus == NULL)
+    return FALSE;
+
+  clients = dbus_connection_get_data (self->priv->libdbus, clients_slot);
+  if (clients == NULL)
+    return FALSE;
+
+  /* Each handler sharing our unique name keeps its channels by path, so
+   * there's no need to build the whole set of handled channels */
+  path = tp_proxy_get_object_path (channel);
+
+  g_hash_table_iter_init (&iter, clients);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
     {
-      TpChannel *chan = l->data;
+      TpBaseClient *client = value;
 
-      if (!tp_strdiff (tp_proxy_get_object_path (channel),
-            tp_proxy_get_object_path (chan)))
-        found = TRUE;
+      if (g_hash_table_lookup (client->priv->my_chans, path) != NULL)
+        return TRUE;
     }
 
-  g_list_free_full (channels, g_object_unref);
-  return found;
+  return FALSE;
+}
+
+TpPreparePipeline *
+_tp_base_client_get_prepare_pipeline (TpBaseClient *self)
+{
+  g_return_val_if_fail (TP_IS_BASE_CLIENT (self), NULL);
+
+  return self->priv->pipeline;
 }
 
 void
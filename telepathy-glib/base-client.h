@@ -122,6 +122,10 @@ void tp_base_client_set_observer_recover (TpBaseClient *self,
 void tp_base_client_set_observer_delay_approvers (TpBaseClient *self,
     gboolean delay);
 
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_base_client_set_max_concurrent_preparations (TpBaseClient *self,
+    guint max);
+
 void tp_base_client_add_approver_filter (TpBaseClient *self,
     GHashTable *filter);
 void tp_base_client_take_approver_filter (TpBaseClient *self,
@@ -447,13 +447,8 @@ tp_base_connection_manager_get_property (GObject *object,
 
           while (g_hash_table_iter_next (&iter, &name, &protocol))
             {
-              GHashTable *props;
-
-              g_object_get (protocol,
-                  "immutable-properties", &props,
-                  NULL);
-
-              g_hash_table_insert (map, g_strdup (name), props);
+              g_hash_table_insert (map, g_strdup (name),
+                  _tp_base_protocol_dup_immutable_properties (protocol));
             }
 
           g_value_take_boxed (value, map);
@@ -271,23 +271,8 @@ tp_base_media_call_channel_is_connected (TpBaseCallChannel *self)
 
       for (; streams != NULL; streams = streams->next)
         {
-          GList *endpoints;
-          gboolean has_connected_endpoint = FALSE;
-
-          endpoints = tp_base_media_call_stream_get_endpoints (streams->data);
-          for (; endpoints != NULL; endpoints = endpoints->next)
-            {
-              TpStreamEndpointState state = tp_call_stream_endpoint_get_state (
-                  endpoints->data, TP_STREAM_COMPONENT_DATA);
-
-              if (state == TP_STREAM_ENDPOINT_STATE_PROVISIONALLY_CONNECTED ||
-                  state == TP_STREAM_ENDPOINT_STATE_FULLY_CONNECTED)
-                {
-                  has_connected_endpoint = TRUE;
-                  break;
-                }
-            }
-          if (!has_connected_endpoint)
+          if (!_tp_base_media_call_stream_has_connected_endpoint (
+                  streams->data))
             return FALSE;
         }
     }
@@ -378,26 +363,10 @@ update_hold_state (TpBaseMediaCallChannel *self)
            l2 != NULL; l2 = l2->next)
         {
           TpBaseMediaCallStream *stream = TP_BASE_MEDIA_CALL_STREAM (l2->data);
-          GHashTable *members = _tp_base_call_stream_get_remote_members (
-              TP_BASE_CALL_STREAM (stream));
           TpSendingState local = tp_base_call_stream_get_local_sending_state (
               TP_BASE_CALL_STREAM (stream));
-          GHashTableIter iter;
-          gpointer key, value;
-          gboolean wants_receive = FALSE;
-
-          g_hash_table_iter_init (&iter, members);
-          while (g_hash_table_iter_next (&iter, &key, &value))
-            {
-              TpSendingState member_state = GPOINTER_TO_INT (value);
-
-              if (member_state == TP_SENDING_STATE_PENDING_SEND ||
-                  member_state == TP_SENDING_STATE_SENDING)
-                {
-                  wants_receive = TRUE;
-                  break;
-                }
-            }
+          gboolean wants_receive = _tp_base_call_stream_has_remote_senders (
+              TP_BASE_CALL_STREAM (stream));
 
           tp_base_media_call_stream_update_receiving_state (stream);
           tp_base_media_call_stream_update_sending_state (stream);
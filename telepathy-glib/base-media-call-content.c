@@ -847,10 +847,6 @@ _tp_base_media_call_content_ready_to_accept (TpBaseMediaCallContent *self)
   for (item = tp_base_call_content_get_streams (bcc); item; item = item->next)
     {
       TpBaseMediaCallStream *stream = item->data;
-      GHashTable *members = _tp_base_call_stream_get_remote_members (
-          TP_BASE_CALL_STREAM (stream));
-      GHashTableIter iter;
-      gpointer key, value;
       TpStreamFlowState receiving_state =
           tp_base_media_call_stream_get_receiving_state (stream);
 
@@ -866,20 +862,14 @@ _tp_base_media_call_content_ready_to_accept (TpBaseMediaCallContent *self)
         }
       tp_base_media_call_stream_update_sending_state (stream);
 
-      g_hash_table_iter_init (&iter, members);
-      while (g_hash_table_iter_next (&iter, &key, &value))
+      if (_tp_base_call_stream_has_remote_senders (
+              TP_BASE_CALL_STREAM (stream)))
         {
-          TpSendingState member_state = GPOINTER_TO_INT (value);
-
-          if (member_state == TP_SENDING_STATE_PENDING_SEND ||
-              member_state == TP_SENDING_STATE_SENDING)
+          tp_base_media_call_stream_update_receiving_state (stream);
+          if (receiving_state != TP_STREAM_FLOW_STATE_STARTED)
             {
-              tp_base_media_call_stream_update_receiving_state (stream);
-              if (receiving_state != TP_STREAM_FLOW_STATE_STARTED)
-                {
-                  if (initial)
-                    ret = FALSE;
-                }
+              if (initial)
+                ret = FALSE;
             }
         }
     }
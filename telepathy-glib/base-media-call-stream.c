@@ -35,6 +35,13 @@
  * #TpBaseMediaCallStreamClass.add_local_candidates and
  * #TpBaseMediaCallStreamClass.finish_initial_candidates.
  *
+ * Streaming implementations usually add candidates one at a time, as they
+ * are gathered. By default, each AddCandidates call results in a
+ * LocalCandidatesAdded signal; connection managers for protocols that send
+ * candidates in batches anyway can set
+ * #TpBaseMediaCallStream:local-candidates-batch-interval to signal fewer,
+ * larger batches.
+ *
  * Since: 0.17.5
  */
 
@@ -186,7 +193,8 @@ enum
   PROP_RELAY_INFO,
   PROP_HAS_SERVER_INFO,
   PROP_ENDPOINTS,
-  PROP_ICE_RESTART_PENDING
+  PROP_ICE_RESTART_PENDING,
+  PROP_LOCAL_CANDIDATES_BATCH_INTERVAL
 };
 
 /* private structure */
@@ -197,6 +205,13 @@ struct _TpBaseMediaCallStreamPrivate
   TpStreamTransportType transport;
   /* GPtrArray of owned GValueArray (dbus struct) */
   GPtrArray *local_candidates;
+  /* the first n_signalled_candidates of local_candidates have been in a
+   * LocalCandidatesAdded signal; the rest are waiting for the next batch */
+  guint n_signalled_candidates;
+  /* milliseconds, or 0 or G_MAXUINT */
+  guint candidates_batch_interval;
+  guint flush_candidates_id;
+  gboolean initial_candidates_finished;
   gchar *username;
   gchar *password;
   /* GPtrArray of owned GValueArray (dbus struct) */
@@ -204,8 +219,13 @@ struct _TpBaseMediaCallStreamPrivate
   /* GPtrArray of reffed GHashTable (asv) */
   GPtrArray *relay_info;
   gboolean has_server_info;
-  /* GList of reffed TpCallStreamEndpoint */
-  GList *endpoints;
+  /* reffed TpCallStreamEndpoint, in the order they were added */
+  GQueue endpoints;
+  /* borrowed TpCallStreamEndpoint => its link in endpoints */
+  GHashTable *endpoint_links;
+  /* number of endpoints whose data component is (provisionally)
+   * connected */
+  guint n_connected_endpoints;
   gboolean ice_restart_pending;
   /* Intset of TpHandle that have requested to receive */
   TpIntset *receiving_requests;
@@ -219,6 +239,8 @@ struct _TpBaseMediaCallStreamPrivate
 
 static GPtrArray *tp_base_media_call_stream_get_interfaces (
     TpBaseCallStream *bcs);
+static void flush_local_candidates (TpBaseMediaCallStream *self);
+static void queue_local_candidates (TpBaseMediaCallStream *self);
 static gboolean tp_base_media_call_stream_request_receiving (
     TpBaseCallStream *bcs,
     TpHandle contact,
@@ -236,6 +258,8 @@ tp_base_media_call_stream_init (TpBaseMediaCallStream *self)
 
   self->priv->local_candidates = g_ptr_array_new_with_free_func (
       (GDestroyNotify) tp_value_array_free);
+  g_queue_init (&self->priv->endpoints);
+  self->priv->endpoint_links = g_hash_table_new (NULL, NULL);
   self->priv->username = g_strdup ("");
   self->priv->password = g_strdup ("");
   self->priv->receiving_requests = tp_intset_new ();
@@ -255,7 +279,17 @@ tp_base_media_call_stream_dispose (GObject *object)
 {
   TpBaseMediaCallStream *self = TP_BASE_MEDIA_CALL_STREAM (object);
 
-  tp_clear_pointer (&self->priv->endpoints, _tp_object_list_free);
+  if (self->priv->flush_candidates_id != 0)
+    {
+      g_source_remove (self->priv->flush_candidates_id);
+      self->priv->flush_candidates_id = 0;
+    }
+
+  g_hash_table_remove_all (self->priv->endpoint_links);
+  self->priv->n_connected_endpoints = 0;
+
+  while (!g_queue_is_empty (&self->priv->endpoints))
+    g_object_unref (g_queue_pop_head (&self->priv->endpoints));
 
   if (G_OBJECT_CLASS (tp_base_media_call_stream_parent_class)->dispose)
     G_OBJECT_CLASS (tp_base_media_call_stream_parent_class)->dispose (object);
@@ -272,6 +306,7 @@ tp_base_media_call_stream_finalize (GObject *object)
   tp_clear_pointer (&self->priv->username, g_free);
   tp_clear_pointer (&self->priv->password, g_free);
   tp_clear_pointer (&self->priv->receiving_requests, tp_intset_destroy);
+  tp_clear_pointer (&self->priv->endpoint_links, g_hash_table_unref);
 
   G_OBJECT_CLASS (tp_base_media_call_stream_parent_class)->finalize (object);
 }
@@ -296,6 +331,9 @@ tp_base_media_call_stream_get_property (GObject *object,
         g_value_set_uint (value, self->priv->transport);
         break;
       case PROP_LOCAL_CANDIDATES:
+        /* this includes any candidates that haven't been signalled yet;
+         * stream_media_props_getter() signals them before D-Bus clients
+         * can see them */
         g_value_set_boxed (value, self->priv->local_candidates);
         break;
       case PROP_LOCAL_CREDENTIALS:
@@ -327,10 +365,10 @@ tp_base_media_call_stream_get_property (GObject *object,
         break;
       case PROP_ENDPOINTS:
         {
-          GPtrArray *arr = g_ptr_array_sized_new (1);
+          GPtrArray *arr = g_ptr_array_sized_new (self->priv->endpoints.length);
           GList *l;
 
-          for (l = self->priv->endpoints; l != NULL; l = g_list_next (l))
+          for (l = self->priv->endpoints.head; l != NULL; l = g_list_next (l))
             {
               TpCallStreamEndpoint *e = l->data;
 
@@ -344,6 +382,9 @@ tp_base_media_call_stream_get_property (GObject *object,
       case PROP_ICE_RESTART_PENDING:
         g_value_set_boolean (value, self->priv->ice_restart_pending);
         break;
+      case PROP_LOCAL_CANDIDATES_BATCH_INTERVAL:
+        g_value_set_uint (value, self->priv->candidates_batch_interval);
+        break;
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
         break;
@@ -363,12 +404,49 @@ tp_base_media_call_stream_set_property (GObject *object,
       case PROP_TRANSPORT:
         self->priv->transport = g_value_get_uint (value);
         break;
+      case PROP_LOCAL_CANDIDATES_BATCH_INTERVAL:
+        {
+          guint interval = g_value_get_uint (value);
+
+          if (interval == self->priv->candidates_batch_interval)
+            break;
+
+          self->priv->candidates_batch_interval = interval;
+
+          /* reschedule anything we were holding back for the new interval */
+          if (self->priv->flush_candidates_id != 0)
+            {
+              g_source_remove (self->priv->flush_candidates_id);
+              self->priv->flush_candidates_id = 0;
+            }
+
+          if (self->priv->n_signalled_candidates <
+              self->priv->local_candidates->len)
+            queue_local_candidates (self);
+        }
+        break;
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
         break;
     }
 }
 
+static void
+stream_media_props_getter (GObject *object,
+    GQuark iface,
+    GQuark name,
+    GValue *value,
+    gpointer getter_data)
+{
+  /* don't let D-Bus clients see candidates that haven't been signalled
+   * yet, or they'd see them twice */
+  if (name == g_quark_from_static_string ("LocalCandidates"))
+    flush_local_candidates (TP_BASE_MEDIA_CALL_STREAM (object));
+
+  tp_dbus_properties_mixin_getter_gobject_properties (object, iface, name,
+      value, getter_data);
+}
+
 static void
 tp_base_media_call_stream_class_init (TpBaseMediaCallStreamClass *klass)
 {
@@ -550,9 +628,35 @@ tp_base_media_call_stream_class_init (TpBaseMediaCallStreamClass *klass)
   g_object_class_install_property (object_class, PROP_ICE_RESTART_PENDING,
       param_spec);
 
+  /**
+   * TpBaseMediaCallStream:local-candidates-batch-interval:
+   *
+   * How long to accumulate local candidates added with AddCandidates
+   * before announcing them in a LocalCandidatesAdded signal, in
+   * milliseconds. If 0 (the default), each AddCandidates call is signalled
+   * separately. If %G_MAXUINT, candidates are only signalled when
+   * FinishInitialCandidates is called; after that, each AddCandidates call
+   * is signalled separately until SetCredentials starts a new round of
+   * candidate gathering.
+   *
+   * Whatever the interval, any candidates being held back are signalled
+   * when FinishInitialCandidates is called, and before the LocalCandidates
+   * D-Bus property is read. Changing the interval reschedules any
+   * candidates being held back to be signalled after the new interval.
+   *
+   * Since: 0.UNRELEASED
+   */
+  param_spec = g_param_spec_uint ("local-candidates-batch-interval",
+      "Local candidates batch interval",
+      "Milliseconds to accumulate local candidates before signalling them",
+      0, G_MAXUINT, 0,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class,
+      PROP_LOCAL_CANDIDATES_BATCH_INTERVAL, param_spec);
+
   tp_dbus_properties_mixin_implement_interface (object_class,
       TP_IFACE_QUARK_CALL_STREAM_INTERFACE_MEDIA,
-      tp_dbus_properties_mixin_getter_gobject_properties,
+      stream_media_props_getter,
       NULL,
       stream_media_props);
 }
@@ -699,6 +803,13 @@ tp_base_media_call_stream_set_relay_info (TpBaseMediaCallStream *self,
   maybe_got_server_info (self);
 }
 
+static gboolean
+is_connected (TpStreamEndpointState state)
+{
+  return (state == TP_STREAM_ENDPOINT_STATE_PROVISIONALLY_CONNECTED ||
+      state == TP_STREAM_ENDPOINT_STATE_FULLY_CONNECTED);
+}
+
 /**
  * tp_base_media_call_stream_add_endpoint:
  * @self: a #TpBaseMediaCallStream
@@ -719,6 +830,8 @@ tp_base_media_call_stream_add_endpoint (TpBaseMediaCallStream *self,
 
   g_return_if_fail (TP_IS_BASE_MEDIA_CALL_STREAM (self));
   g_return_if_fail (TP_IS_CALL_STREAM_ENDPOINT (endpoint));
+  g_return_if_fail (!g_hash_table_contains (self->priv->endpoint_links,
+        endpoint));
 
   _tp_call_stream_endpoint_set_stream (endpoint, self);
 
@@ -726,8 +839,13 @@ tp_base_media_call_stream_add_endpoint (TpBaseMediaCallStream *self,
   DEBUG ("Add endpoint %s to stream %s", object_path,
       tp_base_call_stream_get_object_path ((TpBaseCallStream *) self));
 
-  self->priv->endpoints = g_list_append (self->priv->endpoints,
-      g_object_ref (endpoint));
+  g_queue_push_tail (&self->priv->endpoints, g_object_ref (endpoint));
+  g_hash_table_insert (self->priv->endpoint_links, endpoint,
+      self->priv->endpoints.tail);
+
+  if (is_connected (tp_call_stream_endpoint_get_state (endpoint,
+          TP_STREAM_COMPONENT_DATA)))
+    self->priv->n_connected_endpoints++;
 
   added = g_ptr_array_new ();
   removed = g_ptr_array_new ();
@@ -758,17 +876,24 @@ tp_base_media_call_stream_remove_endpoint (TpBaseMediaCallStream *self,
   const gchar *object_path;
   GPtrArray *added;
   GPtrArray *removed;
+  GList *link;
 
   g_return_if_fail (TP_IS_BASE_MEDIA_CALL_STREAM (self));
   g_return_if_fail (TP_IS_CALL_STREAM_ENDPOINT (endpoint));
-  g_return_if_fail (g_list_find (self->priv->endpoints, endpoint) != NULL);
+
+  link = g_hash_table_lookup (self->priv->endpoint_links, endpoint);
+  g_return_if_fail (link != NULL);
 
   object_path = tp_call_stream_endpoint_get_object_path (endpoint);
   DEBUG ("Remove endpoint %s from stream %s", object_path,
       tp_base_call_stream_get_object_path ((TpBaseCallStream *) self));
 
-  self->priv->endpoints = g_list_remove (self->priv->endpoints,
-      endpoint);
+  g_hash_table_remove (self->priv->endpoint_links, endpoint);
+  g_queue_delete_link (&self->priv->endpoints, link);
+
+  if (is_connected (tp_call_stream_endpoint_get_state (endpoint,
+          TP_STREAM_COMPONENT_DATA)))
+    self->priv->n_connected_endpoints--;
 
   added = g_ptr_array_new ();
   removed = g_ptr_array_new ();
@@ -797,7 +922,37 @@ tp_base_media_call_stream_get_endpoints (TpBaseMediaCallStream *self)
 {
   g_return_val_if_fail (TP_IS_BASE_MEDIA_CALL_STREAM (self), NULL);
 
-  return self->priv->endpoints;
+  return self->priv->endpoints.head;
+}
+
+gboolean
+_tp_base_media_call_stream_has_connected_endpoint (
+    TpBaseMediaCallStream *self)
+{
+  g_return_val_if_fail (TP_IS_BASE_MEDIA_CALL_STREAM (self), FALSE);
+
+  return self->priv->n_connected_endpoints > 0;
+}
+
+/* Called by @endpoint when the state of its data component changes */
+void
+_tp_base_media_call_stream_endpoint_state_changed (
+    TpBaseMediaCallStream *self,
+    TpCallStreamEndpoint *endpoint,
+    TpStreamEndpointState old_state,
+    TpStreamEndpointState new_state)
+{
+  g_return_if_fail (TP_IS_BASE_MEDIA_CALL_STREAM (self));
+
+  /* it might have been removed from us already */
+  if (!g_hash_table_contains (self->priv->endpoint_links, endpoint))
+    return;
+
+  if (is_connected (old_state))
+    self->priv->n_connected_endpoints--;
+
+  if (is_connected (new_state))
+    self->priv->n_connected_endpoints++;
 }
 
 static const char *
@@ -1003,9 +1158,6 @@ void
 tp_base_media_call_stream_update_receiving_state (TpBaseMediaCallStream *self)
 {
   TpBaseCallStream *bcs = TP_BASE_CALL_STREAM (self);
-  GHashTable *remote_members = _tp_base_call_stream_get_remote_members (bcs);
-  GHashTableIter iter;
-  gpointer key, value;
   gboolean remote_sending = FALSE;
   TpBaseCallChannel *channel = _tp_base_call_stream_get_channel (bcs);
 
@@ -1023,26 +1175,7 @@ tp_base_media_call_stream_update_receiving_state (TpBaseMediaCallStream *self)
         goto done;
     }
 
-  g_hash_table_iter_init (&iter, remote_members);
-  while (g_hash_table_iter_next (&iter, &key, &value))
-    {
-      TpSendingState state = GPOINTER_TO_UINT (value);
-
-      switch (state)
-        {
-        case TP_SENDING_STATE_SENDING:
-        case TP_SENDING_STATE_PENDING_SEND:
-          remote_sending = TRUE;
-          break;
-        case TP_SENDING_STATE_PENDING_STOP_SENDING:
-        case TP_SENDING_STATE_NONE:
-          break;
-        default:
-          g_assert_not_reached ();
-        }
-      if (remote_sending)
-        break;
-    }
+  remote_sending = _tp_base_call_stream_has_remote_senders (bcs);
 
 done:
 
@@ -1076,7 +1209,8 @@ tp_base_media_call_stream_get_receiving_state (TpBaseMediaCallStream *self)
  *
  * <!-- -->
  *
- * Returns: the value of #TpBaseMediaCallStream:local-candidates as a #GtrArray
+ * Returns: the value of #TpBaseMediaCallStream:local-candidates as a #GtrArray,
+ *  including any candidates that have not been signalled yet
  * Since: 0.17.5
  */
 GPtrArray *
@@ -1390,9 +1524,19 @@ tp_base_media_call_stream_set_credentials (TpSvcCallStreamInterfaceMedia *iface,
   self->priv->username = g_strdup (username);
   self->priv->password = g_strdup (password);
 
+  /* candidates for the old credentials that are still waiting to be
+   * signalled are just dropped */
+  if (self->priv->flush_candidates_id != 0)
+    {
+      g_source_remove (self->priv->flush_candidates_id);
+      self->priv->flush_candidates_id = 0;
+    }
+
   tp_clear_pointer (&self->priv->local_candidates, g_ptr_array_unref);
   self->priv->local_candidates = g_ptr_array_new_with_free_func (
       (GDestroyNotify) tp_value_array_free);
+  self->priv->n_signalled_candidates = 0;
+  self->priv->initial_candidates_finished = FALSE;
 
   g_object_notify (G_OBJECT (self), "local-candidates");
   g_object_notify (G_OBJECT (self), "local-credentials");
@@ -1403,6 +1547,71 @@ tp_base_media_call_stream_set_credentials (TpSvcCallStreamInterfaceMedia *iface,
   tp_svc_call_stream_interface_media_return_from_set_credentials (context);
 }
 
+static void
+flush_local_candidates (TpBaseMediaCallStream *self)
+{
+  GPtrArray *batch;
+  guint i;
+
+  if (self->priv->flush_candidates_id != 0)
+    {
+      g_source_remove (self->priv->flush_candidates_id);
+      self->priv->flush_candidates_id = 0;
+    }
+
+  if (self->priv->n_signalled_candidates == self->priv->local_candidates->len)
+    return;
+
+  /* borrowed from local_candidates */
+  batch = g_ptr_array_sized_new (self->priv->local_candidates->len -
+      self->priv->n_signalled_candidates);
+
+  for (i = self->priv->n_signalled_candidates;
+       i < self->priv->local_candidates->len;
+       i++)
+    g_ptr_array_add (batch, g_ptr_array_index (self->priv->local_candidates,
+          i));
+
+  self->priv->n_signalled_candidates = self->priv->local_candidates->len;
+
+  DEBUG ("Signalling %u local candidates on stream %s", batch->len,
+      tp_base_call_stream_get_object_path ((TpBaseCallStream *) self));
+
+  tp_svc_call_stream_interface_media_emit_local_candidates_added (self,
+      batch);
+  g_ptr_array_unref (batch);
+}
+
+static gboolean
+flush_local_candidates_cb (gpointer user_data)
+{
+  TpBaseMediaCallStream *self = user_data;
+
+  self->priv->flush_candidates_id = 0;
+  flush_local_candidates (self);
+  return FALSE;
+}
+
+static void
+queue_local_candidates (TpBaseMediaCallStream *self)
+{
+  guint interval = self->priv->candidates_batch_interval;
+
+  if (interval == 0 ||
+      (interval == G_MAXUINT && self->priv->initial_candidates_finished))
+    {
+      flush_local_candidates (self);
+    }
+  else if (interval != G_MAXUINT && self->priv->flush_candidates_id == 0)
+    {
+      self->priv->flush_candidates_id = g_timeout_add (interval,
+          flush_local_candidates_cb, self);
+    }
+
+  /* else either a flush is already scheduled, or we're waiting for
+   * FinishInitialCandidates */
+}
+
 static void
 tp_base_media_call_stream_add_candidates (TpSvcCallStreamInterfaceMedia *iface,
     const GPtrArray *candidates,
@@ -1445,8 +1654,7 @@ tp_base_media_call_stream_add_candidates (TpSvcCallStreamInterfaceMedia *iface,
       G_GNUC_END_IGNORE_DEPRECATIONS
     }
 
-  tp_svc_call_stream_interface_media_emit_local_candidates_added (self,
-      accepted_candidates);
+  queue_local_candidates (self);
   tp_svc_call_stream_interface_media_return_from_add_candidates (context);
 
   g_ptr_array_unref (accepted_candidates);
@@ -1470,6 +1678,9 @@ tp_base_media_call_stream_finish_initial_candidates (
         return;
       }
 
+  self->priv->initial_candidates_finished = TRUE;
+  flush_local_candidates (self);
+
   tp_svc_call_stream_interface_media_return_from_finish_initial_candidates (
       context);
 }
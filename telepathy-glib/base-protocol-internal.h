@@ -28,6 +28,8 @@ G_BEGIN_DECLS
 
 GValueArray *_tp_cm_param_spec_to_dbus (const TpCMParamSpec *paramspec);
 
+GHashTable *_tp_base_protocol_dup_immutable_properties (TpBaseProtocol *self);
+
 G_END_DECLS
 
 #endif
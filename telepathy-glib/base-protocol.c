@@ -599,6 +599,16 @@ typedef struct
   guint max_bytes;
 } AvatarSpecs;
 
+/* A TpCMParamSpec, checked and with its default value worked out in
+ * advance, so that RequestConnection and IdentifyAccount don't have to do
+ * that every time */
+typedef struct {
+    const TpCMParamSpec *spec;
+    /* owned, or NULL if the parameter has no default, or if its type is
+     * one we don't handle (in which case we fail lazily, as before) */
+    GValue *default_value;
+} CompiledParam;
+
 struct _TpBaseProtocolPrivate
 {
   gchar *name;
@@ -610,6 +620,20 @@ struct _TpBaseProtocolPrivate
   gchar *english_name;
   gchar *vcard_field;
   AvatarSpecs avatar_specs;
+
+  /* The result of tp_base_protocol_get_parameters() that compiled_params
+   * was built from, or NULL if it hasn't been built yet. We can't build it
+   * during construction, because _TpLegacyProtocol only knows its
+   * parameters after that. */
+  const TpCMParamSpec *compiled_from;
+  /* CompiledParam, in the same order as compiled_from */
+  GArray *compiled_params;
+  /* borrowed parameter name => borrowed CompiledParam */
+  GHashTable *params_by_name;
+
+  /* owned, or NULL if not built yet; Protocol properties are immutable, so
+   * this can be reused for the lifetime of the object */
+  GHashTable *immutable_properties;
 };
 
 enum
@@ -761,39 +785,12 @@ tp_base_protocol_get_name (TpBaseProtocol *self)
   return self->priv->name;
 }
 
-/**
- * tp_base_protocol_get_immutable_properties:
- * @self: a Protocol
- *
- * Return a basic set of immutable properties for this Protocol object,
- * by using tp_dbus_properties_mixin_make_properties_hash().
- *
- * Additional keys and values can be inserted into the returned hash table;
- * if this is done, the inserted keys and values will be freed when the
- * hash table is destroyed. The keys must be allocated with g_strdup() or
- * equivalent, and the values must be slice-allocated (for instance with
- * tp_g_value_slice_new_string() or a similar function).
- *
- * Note that in particular, tp_asv_set_string() and similar functions should
- * not be used with this hash table.
- *
- * Returns: a hash table mapping (gchar *) fully-qualified property names to
- *          GValues, which must be freed by the caller (at which point its
- *          contents will also be freed).
- *
- * Since: 0.11.11
- */
-
-GHashTable *
-tp_base_protocol_get_immutable_properties (TpBaseProtocol *self)
+static GHashTable *
+tp_base_protocol_build_immutable_properties (TpBaseProtocol *self)
 {
-  TpBaseProtocolClass *cls;
+  TpBaseProtocolClass *cls = TP_BASE_PROTOCOL_GET_CLASS (self);
   GHashTable *table;
 
-  g_return_val_if_fail (TP_IS_BASE_PROTOCOL (self), NULL);
-
-  cls = TP_BASE_PROTOCOL_GET_CLASS (self);
-
   table = tp_dbus_properties_mixin_make_properties_hash ((GObject *) self,
       TP_IFACE_PROTOCOL, "Parameters",
       NULL);
@@ -841,6 +838,72 @@ tp_base_protocol_get_immutable_properties (TpBaseProtocol *self)
   return table;
 }
 
+/*
+ * _tp_base_protocol_dup_immutable_properties:
+ * @self: a Protocol
+ *
+ * The same as tp_base_protocol_get_immutable_properties(), but the result
+ * is shared, and must not be modified. It is only built once per Protocol,
+ * so this is cheap.
+ *
+ * Returns: (transfer full): a hash table mapping (gchar *) fully-qualified
+ *  property names to GValues
+ */
+GHashTable *
+_tp_base_protocol_dup_immutable_properties (TpBaseProtocol *self)
+{
+  g_return_val_if_fail (TP_IS_BASE_PROTOCOL (self), NULL);
+
+  if (self->priv->immutable_properties == NULL)
+    self->priv->immutable_properties =
+      tp_base_protocol_build_immutable_properties (self);
+
+  return g_hash_table_ref (self->priv->immutable_properties);
+}
+
+/**
+ * tp_base_protocol_get_immutable_properties:
+ * @self: a Protocol
+ *
+ * Return a basic set of immutable properties for this Protocol object,
+ * by using tp_dbus_properties_mixin_make_properties_hash().
+ *
+ * Additional keys and values can be inserted into the returned hash table;
+ * if this is done, the inserted keys and values will be freed when the
+ * hash table is destroyed. The keys must be allocated with g_strdup() or
+ * equivalent, and the values must be slice-allocated (for instance with
+ * tp_g_value_slice_new_string() or a similar function).
+ *
+ * Note that in particular, tp_asv_set_string() and similar functions should
+ * not be used with this hash table.
+ *
+ * Returns: a hash table mapping (gchar *) fully-qualified property names to
+ *          GValues, which must be freed by the caller (at which point its
+ *          contents will also be freed).
+ *
+ * Since: 0.11.11
+ */
+
+GHashTable *
+tp_base_protocol_get_immutable_properties (TpBaseProtocol *self)
+{
+  GHashTable *shared;
+  GHashTable *table;
+
+  g_return_val_if_fail (TP_IS_BASE_PROTOCOL (self), NULL);
+
+  /* the caller is allowed to add to the result, so give them a copy of
+   * the cached table rather than the table itself */
+  shared = _tp_base_protocol_dup_immutable_properties (self);
+  table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) tp_g_value_slice_free);
+  tp_g_hash_table_update (table, shared, (GBoxedCopyFunc) g_strdup,
+      (GBoxedCopyFunc) tp_g_value_slice_dup);
+  g_hash_table_unref (shared);
+
+  return table;
+}
+
 static void
 tp_base_protocol_get_property (GObject *object,
     guint property_id,
@@ -908,6 +971,10 @@ tp_base_protocol_finalize (GObject *object)
     g_boxed_free (TP_ARRAY_TYPE_REQUESTABLE_CHANNEL_CLASS_LIST,
         self->priv->requestable_channel_classes);
 
+  tp_clear_pointer (&self->priv->compiled_params, g_array_unref);
+  tp_clear_pointer (&self->priv->params_by_name, g_hash_table_unref);
+  tp_clear_pointer (&self->priv->immutable_properties, g_hash_table_unref);
+
   if (finalize != NULL)
     finalize (object);
 }
@@ -1348,66 +1415,131 @@ tp_base_protocol_get_parameters (TpBaseProtocol *self)
   return cls->get_parameters (self);
 }
 
-static gboolean
-_tp_cm_param_spec_check_all_allowed (const TpCMParamSpec *parameters,
-    GHashTable *asv,
-    GError **error)
+static void
+compiled_param_clear (gpointer p)
 {
-  GHashTable *tmp = g_hash_table_new (g_str_hash, g_str_equal);
+  CompiledParam *param = p;
+
+  tp_clear_pointer (&param->default_value, tp_g_value_slice_free);
+}
+
+/* Build compiled_params and params_by_name, if we haven't already. */
+static void
+tp_base_protocol_compile_parameters (TpBaseProtocol *self)
+{
+  const TpCMParamSpec *parameters = tp_base_protocol_get_parameters (self);
   const TpCMParamSpec *iter;
-  gboolean ret = TRUE;
 
-  tp_g_hash_table_update (tmp, asv, NULL, NULL);
+  if (parameters == self->priv->compiled_from)
+    return;
 
-  for (iter = parameters; iter->name != NULL; iter++)
-    {
-      g_hash_table_remove (tmp, iter->name);
-    }
+  /* get_parameters() is documented to return something that lives as long
+   * as @self, so this can only happen if it's a different, equivalent
+   * array each time; recompiling is the best we can do */
+  tp_clear_pointer (&self->priv->compiled_params, g_array_unref);
+  tp_clear_pointer (&self->priv->params_by_name, g_hash_table_unref);
 
-  if (g_hash_table_size (tmp) != 0)
+  self->priv->compiled_params = g_array_new (FALSE, FALSE,
+      sizeof (CompiledParam));
+  g_array_set_clear_func (self->priv->compiled_params, compiled_param_clear);
+  self->priv->params_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (iter = parameters; iter->name != NULL; iter++)
     {
-      gchar *error_txt;
-      GString *error_str = g_string_new ("unknown parameters provided:");
-      GHashTableIter h_iter;
-      gpointer k;
+      CompiledParam param;
+      gboolean supported = TRUE;
 
-      g_hash_table_iter_init (&h_iter, tmp);
+      param.spec = iter;
+      param.default_value = NULL;
 
-      while (g_hash_table_iter_next (&h_iter, &k, NULL))
+      /* Only precompute defaults for types we know how to handle. An
+       * unhandled type is only fatal if a client actually supplies that
+       * parameter (or needs its default), so don't complain about it here:
+       * requests that don't use it must keep working. */
+      switch (iter->dtype[0])
         {
-          g_string_append_c (error_str, ' ');
-          g_string_append (error_str, k);
+        case DBUS_TYPE_BOOLEAN:
+        case DBUS_TYPE_OBJECT_PATH:
+        case DBUS_TYPE_STRING:
+        case DBUS_TYPE_INT16:
+        case DBUS_TYPE_INT32:
+        case DBUS_TYPE_BYTE:
+        case DBUS_TYPE_UINT16:
+        case DBUS_TYPE_UINT32:
+        case DBUS_TYPE_INT64:
+        case DBUS_TYPE_UINT64:
+        case DBUS_TYPE_DOUBLE:
+          break;
+
+        /* param_default_value() only knows "as" and "ay" */
+        case DBUS_TYPE_ARRAY:
+          supported = (iter->dtype[1] == DBUS_TYPE_STRING ||
+              iter->dtype[1] == DBUS_TYPE_BYTE);
+          break;
+
+        default:
+          supported = FALSE;
         }
 
-      error_txt = g_string_free (error_str, FALSE);
+      if (supported &&
+          (iter->flags & TP_CONN_MGR_PARAM_FLAG_HAS_DEFAULT) != 0)
+        param.default_value = param_default_value (iter);
 
-      DEBUG ("%s", error_txt);
-      g_set_error (error, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
-          "%s", error_txt);
-      g_free (error_txt);
-      ret = FALSE;
+      g_array_append_val (self->priv->compiled_params, param);
     }
 
-  g_hash_table_unref (tmp);
+  /* now that the array won't be reallocated, index it */
+  for (iter = parameters; iter->name != NULL; iter++)
+    g_hash_table_insert (self->priv->params_by_name, (gchar *) iter->name,
+        &g_array_index (self->priv->compiled_params, CompiledParam,
+          iter - parameters));
 
-  return ret;
+  self->priv->compiled_from = parameters;
 }
 
-static GValue *
-_tp_cm_param_spec_coerce (const TpCMParamSpec *param_spec,
+static gboolean
+_tp_cm_param_spec_check_all_allowed (TpBaseProtocol *self,
     GHashTable *asv,
     GError **error)
 {
-  const gchar *name = param_spec->name;
-  const GValue *value = tp_asv_lookup (asv, name);
+  GString *error_str = NULL;
+  GHashTableIter h_iter;
+  gpointer k;
+
+  g_hash_table_iter_init (&h_iter, asv);
+
+  while (g_hash_table_iter_next (&h_iter, &k, NULL))
+    {
+      if (g_hash_table_lookup (self->priv->params_by_name, k) != NULL)
+        continue;
+
+      if (error_str == NULL)
+        error_str = g_string_new ("unknown parameters provided:");
+
+      g_string_append_c (error_str, ' ');
+      g_string_append (error_str, k);
+    }
 
-  if (tp_asv_lookup (asv, name) == NULL)
+  if (error_str != NULL)
     {
+      DEBUG ("%s", error_str->str);
       g_set_error (error, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
-          "%s not found in parameters", name);
-      return NULL;
+          "%s", error_str->str);
+      g_string_free (error_str, TRUE);
+      return FALSE;
     }
 
+  return TRUE;
+}
+
+static GValue *
+_tp_cm_param_spec_coerce (const TpCMParamSpec *param_spec,
+    const GValue *value,
+    GHashTable *asv,
+    GError **error)
+{
+  const gchar *name = param_spec->name;
+
   switch (param_spec->dtype[0])
     {
     case DBUS_TYPE_BOOLEAN:
@@ -1572,12 +1704,13 @@ tp_base_protocol_sanitize_parameters (TpBaseProtocol *self,
   guint i;
   guint mandatory_flag;
 
-  parameters = tp_base_protocol_get_parameters (self);
+  tp_base_protocol_compile_parameters (self);
+  parameters = self->priv->compiled_from;
 
   combined = g_hash_table_new_full (g_str_hash, g_str_equal,
       g_free, (GDestroyNotify) tp_g_value_slice_free);
 
-  if (!_tp_cm_param_spec_check_all_allowed (parameters, asv, error))
+  if (!_tp_cm_param_spec_check_all_allowed (self, asv, error))
     goto except;
 
   if (tp_asv_get_boolean (asv, "register", NULL))
@@ -1592,12 +1725,13 @@ tp_base_protocol_sanitize_parameters (TpBaseProtocol *self,
   for (i = 0; parameters[i].name != NULL; i++)
     {
       const gchar *name = parameters[i].name;
+      const GValue *value = tp_asv_lookup (asv, name);
 
-      if (tp_asv_lookup (asv, name) != NULL)
+      if (value != NULL)
         {
           /* coerce to the expected type */
-          GValue *coerced = _tp_cm_param_spec_coerce (parameters + i, asv,
-              error);
+          GValue *coerced = _tp_cm_param_spec_coerce (parameters + i, value,
+              asv, error);
 
           if (coerced == NULL)
             goto except;
@@ -1654,7 +1788,14 @@ tp_base_protocol_sanitize_parameters (TpBaseProtocol *self,
         }
       else if ((parameters[i].flags & TP_CONN_MGR_PARAM_FLAG_HAS_DEFAULT) != 0)
         {
-          GValue *value = param_default_value (parameters + i);
+          CompiledParam *param = &g_array_index (self->priv->compiled_params,
+              CompiledParam, i);
+          GValue *value;
+
+          if (param->default_value != NULL)
+            value = tp_g_value_slice_dup (param->default_value);
+          else
+            value = param_default_value (parameters + i);
 
           g_hash_table_insert (combined, g_strdup (name), value);
         }
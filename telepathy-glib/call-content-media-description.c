@@ -29,6 +29,11 @@
  * This class is used to negociate the media description used with a remote
  * contact. To be used with #TpBaseMediaCallContent implementations.
  *
+ * When renegotiating, tp_call_content_media_description_new_from() can be
+ * used to start from a copy of a previous media description: the codecs,
+ * SSRCs, RTP header extensions and RTCP feedback messages are shared between
+ * the two until one of them is modified.
+ *
  * Since: 0.17.5
  */
 
@@ -111,6 +116,52 @@ enum
   PROP_ENABLE_METRICS,
 };
 
+typedef struct {
+    guint identifier;
+    gchar *name;
+    guint clock_rate;
+    guint channels;
+    gboolean updated;
+    /* owned string => owned string */
+    GHashTable *parameters;
+} Codec;
+
+typedef struct {
+    guint id;
+    TpMediaStreamDirection direction;
+    gchar *uri;
+    gchar *parameters;
+} HeaderExtension;
+
+typedef struct {
+    gchar *type;
+    gchar *subtype;
+    gchar *parameters;
+} FeedbackMessage;
+
+typedef struct {
+    guint rtcp_minimum_interval;
+    /* FeedbackMessage */
+    GArray *messages;
+} FeedbackProperties;
+
+/* The potentially large parts of a media description. These are shared
+ * between media descriptions made with
+ * tp_call_content_media_description_new_from(), and copied by whichever
+ * one is modified first; they are only turned into their D-Bus
+ * representations when someone asks for them. */
+typedef struct {
+    gint ref_count;
+    /* Codec */
+    GArray *codecs;
+    /* TpHandle => owned GArray<uint>; this is also the D-Bus representation */
+    GHashTable *ssrcs;
+    /* HeaderExtension */
+    GArray *header_extensions;
+    /* codec identifier => owned FeedbackProperties */
+    GHashTable *feedback_messages;
+} MediaTables;
+
 /* private structure */
 struct _TpCallContentMediaDescriptionPrivate
 {
@@ -121,15 +172,13 @@ struct _TpCallContentMediaDescriptionPrivate
   GPtrArray *interfaces;
   gboolean further_negotiation_required;
   gboolean has_remote_information;
-  /* GPtrArray of owned GValueArray */
-  GPtrArray *codecs;
   TpHandle remote_contact;
-  /* TpHandle -> reffed GArray<uint> */
-  GHashTable *ssrcs;
+  /* owned, possibly shared with other media descriptions */
+  MediaTables *tables;
+  /* the result of _tp_call_content_media_description_dup_properties(),
+   * or NULL if we have been modified since it was last called */
+  GHashTable *properties;
 
-  /* GPtrArray of owned GValueArray (dbus-struct) */
-  GPtrArray *header_extensions;
-  GHashTable *feedback_messages;
   gboolean does_avpf;
   guint loss_rle_max_size;
   guint duplicate_rle_max_size;
@@ -144,6 +193,284 @@ struct _TpCallContentMediaDescriptionPrivate
   guint handler_id;
 };
 
+static void
+codec_clear (gpointer p)
+{
+  Codec *codec = p;
+
+  g_free (codec->name);
+  g_hash_table_unref (codec->parameters);
+}
+
+static void
+header_extension_clear (gpointer p)
+{
+  HeaderExtension *ext = p;
+
+  g_free (ext->uri);
+  g_free (ext->parameters);
+}
+
+static void
+feedback_message_clear (gpointer p)
+{
+  FeedbackMessage *message = p;
+
+  g_free (message->type);
+  g_free (message->subtype);
+  g_free (message->parameters);
+}
+
+static FeedbackProperties *
+feedback_properties_new (guint rtcp_minimum_interval)
+{
+  FeedbackProperties *props = g_slice_new (FeedbackProperties);
+
+  props->rtcp_minimum_interval = rtcp_minimum_interval;
+  props->messages = g_array_new (FALSE, FALSE, sizeof (FeedbackMessage));
+  g_array_set_clear_func (props->messages, feedback_message_clear);
+  return props;
+}
+
+static void
+feedback_properties_free (gpointer p)
+{
+  FeedbackProperties *props = p;
+
+  g_array_unref (props->messages);
+  g_slice_free (FeedbackProperties, props);
+}
+
+static GHashTable *
+string_map_copy (GHashTable *source)
+{
+  GHashTable *copy = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, g_free);
+
+  if (source != NULL)
+    tp_g_hash_table_update (copy, source, (GBoxedCopyFunc) g_strdup,
+        (GBoxedCopyFunc) g_strdup);
+
+  return copy;
+}
+
+static MediaTables *
+media_tables_new (void)
+{
+  MediaTables *tables = g_slice_new0 (MediaTables);
+
+  tables->ref_count = 1;
+
+  tables->codecs = g_array_new (FALSE, FALSE, sizeof (Codec));
+  g_array_set_clear_func (tables->codecs, codec_clear);
+
+  tables->ssrcs = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) g_array_unref);
+
+  tables->header_extensions = g_array_new (FALSE, FALSE,
+      sizeof (HeaderExtension));
+  g_array_set_clear_func (tables->header_extensions, header_extension_clear);
+
+  tables->feedback_messages = g_hash_table_new_full (NULL, NULL, NULL,
+      feedback_properties_free);
+
+  return tables;
+}
+
+static MediaTables *
+media_tables_copy (MediaTables *source)
+{
+  MediaTables *tables = media_tables_new ();
+  GHashTableIter iter;
+  gpointer k, v;
+  guint i;
+
+  for (i = 0; i < source->codecs->len; i++)
+    {
+      Codec codec = g_array_index (source->codecs, Codec, i);
+
+      codec.name = g_strdup (codec.name);
+      codec.parameters = string_map_copy (codec.parameters);
+      g_array_append_val (tables->codecs, codec);
+    }
+
+  g_hash_table_iter_init (&iter, source->ssrcs);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      GArray *array = v;
+      GArray *copy = g_array_sized_new (FALSE, FALSE, sizeof (guint),
+          array->len);
+
+      g_array_append_vals (copy, array->data, array->len);
+      g_hash_table_insert (tables->ssrcs, k, copy);
+    }
+
+  for (i = 0; i < source->header_extensions->len; i++)
+    {
+      HeaderExtension ext = g_array_index (source->header_extensions,
+          HeaderExtension, i);
+
+      ext.uri = g_strdup (ext.uri);
+      ext.parameters = g_strdup (ext.parameters);
+      g_array_append_val (tables->header_extensions, ext);
+    }
+
+  g_hash_table_iter_init (&iter, source->feedback_messages);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      FeedbackProperties *props = v;
+      FeedbackProperties *copy = feedback_properties_new (
+          props->rtcp_minimum_interval);
+
+      for (i = 0; i < props->messages->len; i++)
+        {
+          FeedbackMessage message = g_array_index (props->messages,
+              FeedbackMessage, i);
+
+          message.type = g_strdup (message.type);
+          message.subtype = g_strdup (message.subtype);
+          message.parameters = g_strdup (message.parameters);
+          g_array_append_val (copy->messages, message);
+        }
+
+      g_hash_table_insert (tables->feedback_messages, k, copy);
+    }
+
+  return tables;
+}
+
+static MediaTables *
+media_tables_ref (MediaTables *tables)
+{
+  g_atomic_int_inc (&tables->ref_count);
+  return tables;
+}
+
+static void
+media_tables_unref (MediaTables *tables)
+{
+  if (!g_atomic_int_dec_and_test (&tables->ref_count))
+    return;
+
+  g_array_unref (tables->codecs);
+  g_hash_table_unref (tables->ssrcs);
+  g_array_unref (tables->header_extensions);
+  g_hash_table_unref (tables->feedback_messages);
+  g_slice_free (MediaTables, tables);
+}
+
+static GPtrArray *
+media_tables_dup_dbus_codecs (MediaTables *tables)
+{
+  GPtrArray *codecs = g_ptr_array_new_full (tables->codecs->len,
+      (GDestroyNotify) tp_value_array_free);
+  guint i;
+
+  for (i = 0; i < tables->codecs->len; i++)
+    {
+      Codec *codec = &g_array_index (tables->codecs, Codec, i);
+
+      g_ptr_array_add (codecs, tp_value_array_build (6,
+          G_TYPE_UINT, codec->identifier,
+          G_TYPE_STRING, codec->name,
+          G_TYPE_UINT, codec->clock_rate,
+          G_TYPE_UINT, codec->channels,
+          G_TYPE_BOOLEAN, codec->updated,
+          TP_HASH_TYPE_STRING_STRING_MAP, codec->parameters,
+          G_TYPE_INVALID));
+    }
+
+  return codecs;
+}
+
+static GPtrArray *
+media_tables_dup_dbus_header_extensions (MediaTables *tables)
+{
+  GPtrArray *header_extensions = g_ptr_array_new_full (
+      tables->header_extensions->len, (GDestroyNotify) tp_value_array_free);
+  guint i;
+
+  for (i = 0; i < tables->header_extensions->len; i++)
+    {
+      HeaderExtension *ext = &g_array_index (tables->header_extensions,
+          HeaderExtension, i);
+
+      g_ptr_array_add (header_extensions, tp_value_array_build (4,
+          G_TYPE_UINT, ext->id,
+          G_TYPE_UINT, ext->direction,
+          G_TYPE_STRING, ext->uri,
+          G_TYPE_STRING, ext->parameters,
+          G_TYPE_INVALID));
+    }
+
+  return header_extensions;
+}
+
+static GHashTable *
+media_tables_dup_dbus_feedback_messages (MediaTables *tables)
+{
+  GHashTable *feedback_messages = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) tp_value_array_free);
+  GHashTableIter iter;
+  gpointer k, v;
+  guint i;
+
+  g_hash_table_iter_init (&iter, tables->feedback_messages);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      FeedbackProperties *props = v;
+      GPtrArray *messages = g_ptr_array_new_full (props->messages->len,
+          (GDestroyNotify) tp_value_array_free);
+
+      for (i = 0; i < props->messages->len; i++)
+        {
+          FeedbackMessage *message = &g_array_index (props->messages,
+              FeedbackMessage, i);
+
+          g_ptr_array_add (messages, tp_value_array_build (3,
+              G_TYPE_STRING, message->type,
+              G_TYPE_STRING, message->subtype,
+              G_TYPE_STRING, message->parameters,
+              G_TYPE_INVALID));
+        }
+
+      g_hash_table_insert (feedback_messages, k, tp_value_array_build (2,
+          G_TYPE_UINT, props->rtcp_minimum_interval,
+          TP_ARRAY_TYPE_RTCP_FEEDBACK_MESSAGE_LIST, messages,
+          G_TYPE_INVALID));
+      g_ptr_array_unref (messages);
+    }
+
+  return feedback_messages;
+}
+
+/* Called before changing anything that appears in the D-Bus properties */
+static void
+invalidate_properties (TpCallContentMediaDescription *self)
+{
+  tp_clear_pointer (&self->priv->properties, g_hash_table_unref);
+}
+
+/* Called before changing self->priv->tables */
+static MediaTables *
+ensure_tables_writable (TpCallContentMediaDescription *self)
+{
+  invalidate_properties (self);
+
+  if (g_atomic_int_get (&self->priv->tables->ref_count) > 1)
+    {
+      MediaTables *copy = media_tables_copy (self->priv->tables);
+
+      media_tables_unref (self->priv->tables);
+      self->priv->tables = copy;
+    }
+
+  return self->priv->tables;
+}
+
 static void
 tp_call_content_media_description_init (TpCallContentMediaDescription *self)
 {
@@ -154,15 +481,7 @@ tp_call_content_media_description_init (TpCallContentMediaDescription *self)
   self->priv->interfaces = g_ptr_array_new ();
   g_ptr_array_add (self->priv->interfaces, NULL);
 
-  self->priv->ssrcs = g_hash_table_new_full (NULL, NULL, NULL,
-      (GDestroyNotify) g_array_unref);
-  self->priv->codecs = g_ptr_array_new_with_free_func (
-      (GDestroyNotify) tp_value_array_free);
-
-  self->priv->header_extensions = g_ptr_array_new_with_free_func (
-      (GDestroyNotify) tp_value_array_free);
-  self->priv->feedback_messages = g_hash_table_new_full (NULL, NULL, NULL,
-      (GDestroyNotify) tp_value_array_free);
+  self->priv->tables = media_tables_new ();
 }
 
 static void
@@ -172,13 +491,10 @@ tp_call_content_media_description_dispose (GObject *object)
 
   g_assert (self->priv->result == NULL);
 
-  tp_clear_pointer (&self->priv->codecs, g_ptr_array_unref);
-  tp_clear_pointer (&self->priv->ssrcs, g_hash_table_unref);
+  tp_clear_pointer (&self->priv->tables, media_tables_unref);
+  tp_clear_pointer (&self->priv->properties, g_hash_table_unref);
   g_clear_object (&self->priv->dbus_daemon);
 
-  tp_clear_pointer (&self->priv->header_extensions, g_ptr_array_unref);
-  tp_clear_pointer (&self->priv->feedback_messages, g_hash_table_unref);
-
   /* release any references held by the object here */
   if (G_OBJECT_CLASS (tp_call_content_media_description_parent_class)->dispose)
     G_OBJECT_CLASS (tp_call_content_media_description_parent_class)->dispose (
@@ -223,19 +539,22 @@ tp_call_content_media_description_get_property (GObject *object,
         g_value_set_boolean (value, self->priv->has_remote_information);
         break;
       case PROP_CODECS:
-        g_value_set_boxed (value, self->priv->codecs);
+        g_value_take_boxed (value,
+            media_tables_dup_dbus_codecs (self->priv->tables));
         break;
       case PROP_REMOTE_CONTACT:
         g_value_set_uint (value, self->priv->remote_contact);
         break;
       case PROP_SSRCS:
-        g_value_set_boxed (value, self->priv->ssrcs);
+        g_value_set_boxed (value, self->priv->tables->ssrcs);
         break;
       case PROP_HEADER_EXTENSIONS:
-        g_value_set_boxed (value, self->priv->header_extensions);
+        g_value_take_boxed (value,
+            media_tables_dup_dbus_header_extensions (self->priv->tables));
         break;
       case PROP_FEEDBACK_MESSAGES:
-        g_value_set_boxed (value, self->priv->feedback_messages);
+        g_value_take_boxed (value,
+            media_tables_dup_dbus_feedback_messages (self->priv->tables));
         break;
       case PROP_DOES_AVPF:
         g_value_set_boolean (value, self->priv->does_avpf);
@@ -286,12 +605,15 @@ tp_call_content_media_description_set_property (GObject *object,
         self->priv->dbus_daemon = g_value_dup_object (value);
         break;
       case PROP_FURTHER_NEGOTIATION_REQUIRED:
+        invalidate_properties (self);
         self->priv->further_negotiation_required = g_value_get_boolean (value);
         break;
       case PROP_HAS_REMOTE_INFORMATION:
+        invalidate_properties (self);
         self->priv->has_remote_information = g_value_get_boolean (value);
         break;
       case PROP_REMOTE_CONTACT:
+        invalidate_properties (self);
         self->priv->remote_contact = g_value_get_uint (value);
         break;
       default:
@@ -685,6 +1007,68 @@ tp_call_content_media_description_new (TpDBusDaemon *dbus_daemon,
       NULL);
 }
 
+/**
+ * tp_call_content_media_description_new_from:
+ * @other: a #TpCallContentMediaDescription
+ * @object_path: value of #TpCallContentMediaDescription:object-path property
+ * @has_remote_information: value of
+ *  #TpCallContentMediaDescription:has_remote_information property
+ * @further_negotiation_required: value of
+ *  #TpCallContentMediaDescription:further_negotiation_required property
+ *
+ * Create a new #TpCallContentMediaDescription object for the same remote
+ * contact as @other, with the same codecs, SSRCs, RTP header extensions,
+ * RTCP feedback and RTCP extended reports settings, and interfaces.
+ *
+ * This is intended for renegotiation: rather than adding everything again,
+ * a connection manager can start from the previous media description and
+ * change what has changed. The two media descriptions share their codecs and
+ * other lists until one of them is modified, so this is cheap even if
+ * @other describes many codecs.
+ *
+ * Returns: a new #TpCallContentMediaDescription.
+ * Since: 0.UNRELEASED
+ */
+TpCallContentMediaDescription *
+tp_call_content_media_description_new_from (
+    TpCallContentMediaDescription *other,
+    const gchar *object_path,
+    gboolean has_remote_information,
+    gboolean further_negotiation_required)
+{
+  TpCallContentMediaDescription *self;
+  guint i;
+
+  g_return_val_if_fail (TP_IS_CALL_CONTENT_MEDIA_DESCRIPTION (other), NULL);
+  g_return_val_if_fail (g_variant_is_object_path (object_path), NULL);
+
+  self = tp_call_content_media_description_new (other->priv->dbus_daemon,
+      object_path, other->priv->remote_contact, has_remote_information,
+      further_negotiation_required);
+
+  media_tables_unref (self->priv->tables);
+  self->priv->tables = media_tables_ref (other->priv->tables);
+
+  /* the interfaces are static strings */
+  g_ptr_array_set_size (self->priv->interfaces, 0);
+
+  for (i = 0; i < other->priv->interfaces->len; i++)
+    g_ptr_array_add (self->priv->interfaces,
+        g_ptr_array_index (other->priv->interfaces, i));
+
+  self->priv->does_avpf = other->priv->does_avpf;
+  self->priv->loss_rle_max_size = other->priv->loss_rle_max_size;
+  self->priv->duplicate_rle_max_size = other->priv->duplicate_rle_max_size;
+  self->priv->packet_receipt_times_max_size =
+      other->priv->packet_receipt_times_max_size;
+  self->priv->dlrr_max_size = other->priv->dlrr_max_size;
+  self->priv->rtt_mode = other->priv->rtt_mode;
+  self->priv->statistics_flags = other->priv->statistics_flags;
+  self->priv->enable_metrics = other->priv->enable_metrics;
+
+  return self;
+}
+
 /**
  * tp_call_content_media_description_get_object_path:
  * @self: a #TpCallContentMediaDescription
@@ -743,22 +1127,30 @@ tp_call_content_media_description_add_ssrc (TpCallContentMediaDescription *self,
 
   g_return_if_fail (TP_IS_CALL_CONTENT_MEDIA_DESCRIPTION (self));
 
-  array = g_hash_table_lookup (self->priv->ssrcs,
+  array = g_hash_table_lookup (self->priv->tables->ssrcs,
+      GUINT_TO_POINTER (contact));
+
+  if (array != NULL)
+    {
+      for (i = 0; i < array->len; i++)
+        {
+          if (g_array_index (array, guint, i) == ssrc)
+            return;
+        }
+    }
+
+  /* look it up again: it might have been copied */
+  array = g_hash_table_lookup (ensure_tables_writable (self)->ssrcs,
       GUINT_TO_POINTER (contact));
 
   if (array == NULL)
     {
       array = g_array_new (FALSE, FALSE, sizeof (guint));
-      g_hash_table_insert (self->priv->ssrcs,
+      g_hash_table_insert (self->priv->tables->ssrcs,
           GUINT_TO_POINTER (contact),
           array);
     }
 
-  for (i = 0; i < array->len; i++)
-    {
-      if (g_array_index (array, guint, i) == ssrc)
-        return;
-    }
   g_array_append_val (array, ssrc);
 }
 
@@ -787,19 +1179,18 @@ tp_call_content_media_description_append_codec (
     gboolean updated,
     GHashTable *parameters)
 {
+  Codec codec;
+
   g_return_if_fail (TP_IS_CALL_CONTENT_MEDIA_DESCRIPTION (self));
 
-  if (parameters == NULL)
-    parameters = g_hash_table_new (g_str_hash, g_str_equal);
-
-  g_ptr_array_add (self->priv->codecs, tp_value_array_build (6,
-      G_TYPE_UINT, identifier,
-      G_TYPE_STRING, name,
-      G_TYPE_UINT, clock_rate,
-      G_TYPE_UINT, channels,
-      G_TYPE_BOOLEAN, updated,
-      TP_HASH_TYPE_STRING_STRING_MAP, parameters,
-      G_TYPE_INVALID));
+  codec.identifier = identifier;
+  codec.name = g_strdup (name);
+  codec.clock_rate = clock_rate;
+  codec.channels = channels;
+  codec.updated = updated;
+  codec.parameters = string_map_copy (parameters);
+
+  g_array_append_val (ensure_tables_writable (self)->codecs, codec);
 }
 
 static void
@@ -809,6 +1200,8 @@ add_interface (TpCallContentMediaDescription *self,
   if (tp_g_ptr_array_contains (self->priv->interfaces, (gchar *) interface))
     return;
 
+  invalidate_properties (self);
+
   /* Remove terminating NULL, add interface, then add the NULL back */
   g_ptr_array_remove_index_fast (self->priv->interfaces,
       self->priv->interfaces->len - 1);
@@ -897,41 +1290,35 @@ tp_call_content_media_description_add_rtp_header_extension (
     const gchar *uri,
     const gchar *parameters)
 {
+  HeaderExtension ext;
+
   g_return_if_fail (TP_IS_CALL_CONTENT_MEDIA_DESCRIPTION (self));
 
-  g_ptr_array_add (self->priv->header_extensions, tp_value_array_build (4,
-      G_TYPE_UINT, id,
-      G_TYPE_UINT, direction,
-      G_TYPE_STRING, uri,
-      G_TYPE_STRING, parameters,
-      G_TYPE_INVALID));
+  ext.id = id;
+  ext.direction = direction;
+  ext.uri = g_strdup (uri);
+  ext.parameters = g_strdup (parameters);
+
+  g_array_append_val (ensure_tables_writable (self)->header_extensions, ext);
 
   tp_call_content_media_description_add_rtp_header_extensions_interface (self);
 }
 
-static GValueArray *
+static FeedbackProperties *
 ensure_rtcp_feedback_properties (TpCallContentMediaDescription *self,
     guint codec_identifier)
 {
-  GValueArray *properties;
-  GPtrArray *messages_array;
+  MediaTables *tables = ensure_tables_writable (self);
+  FeedbackProperties *properties;
 
-  properties = g_hash_table_lookup (self->priv->feedback_messages,
+  properties = g_hash_table_lookup (tables->feedback_messages,
       GUINT_TO_POINTER (codec_identifier));
 
   if (properties == NULL)
     {
-      messages_array = g_ptr_array_new_with_free_func (
-          (GDestroyNotify) tp_value_array_free);
-      properties = tp_value_array_build (2,
-          G_TYPE_UINT, G_MAXUINT,
-          G_TYPE_PTR_ARRAY, messages_array,
-          G_TYPE_INVALID);
-
-      g_hash_table_insert (self->priv->feedback_messages,
+      properties = feedback_properties_new (G_MAXUINT);
+      g_hash_table_insert (tables->feedback_messages,
           GUINT_TO_POINTER (codec_identifier), properties);
-
-      g_ptr_array_unref (messages_array);
     }
 
   return properties;
@@ -968,23 +1355,17 @@ tp_call_content_media_description_add_rtcp_feedback_message (
     const gchar *subtype,
     const gchar *parameters)
 {
-  GValueArray *properties;
-  GValue *value;
-  GPtrArray *messages_array;
+  FeedbackProperties *properties;
+  FeedbackMessage message;
 
   g_return_if_fail (TP_IS_CALL_CONTENT_MEDIA_DESCRIPTION (self));
 
   properties = ensure_rtcp_feedback_properties (self, codec_identifier);
-  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  value = g_value_array_get_nth (properties, 1);
-  G_GNUC_END_IGNORE_DEPRECATIONS
-  messages_array = g_value_get_boxed (value);
 
-  g_ptr_array_add (messages_array, tp_value_array_build (3,
-      G_TYPE_STRING, type,
-      G_TYPE_STRING, subtype,
-      G_TYPE_STRING, parameters,
-      G_TYPE_INVALID));
+  message.type = g_strdup (type);
+  message.subtype = g_strdup (subtype);
+  message.parameters = g_strdup (parameters);
+  g_array_append_val (properties->messages, message);
 
   tp_call_content_media_description_add_rtcp_feedback_interface (self);
 }
@@ -1018,16 +1399,12 @@ tp_call_content_media_description_set_rtcp_feedback_minimum_interval (
     guint codec_identifier,
     guint rtcp_minimum_interval)
 {
-  GValueArray *properties;
-  GValue *value;
+  FeedbackProperties *properties;
 
   g_return_if_fail (TP_IS_CALL_CONTENT_MEDIA_DESCRIPTION (self));
 
   properties = ensure_rtcp_feedback_properties (self, codec_identifier);
-  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  value = g_value_array_get_nth (properties, 0);
-  G_GNUC_END_IGNORE_DEPRECATIONS
-  g_value_set_uint (value, rtcp_minimum_interval);
+  properties->rtcp_minimum_interval = rtcp_minimum_interval;
 
   tp_call_content_media_description_add_rtcp_feedback_interface (self);
 }
@@ -1160,26 +1537,47 @@ _tp_call_content_media_description_offer_finish (
       g_hash_table_ref, properties);
 }
 
+/*
+ * _tp_call_content_media_description_dup_properties:
+ * @self: a media description
+ *
+ * Returns: (transfer full): the D-Bus properties of @self, which must not
+ *  be modified. This is the same hash table each time, until @self is
+ *  modified, so it can be used in several offers and signals without being
+ *  copied.
+ */
 GHashTable *
 _tp_call_content_media_description_dup_properties (
     TpCallContentMediaDescription *self)
 {
   g_return_val_if_fail (TP_IS_CALL_CONTENT_MEDIA_DESCRIPTION (self), NULL);
 
-  return tp_asv_new (
-      TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_INTERFACES,
-          G_TYPE_STRV, self->priv->interfaces->pdata,
-      TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_FURTHER_NEGOTIATION_REQUIRED,
-          G_TYPE_BOOLEAN, self->priv->further_negotiation_required,
-      TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_HAS_REMOTE_INFORMATION,
-          G_TYPE_BOOLEAN, self->priv->has_remote_information,
-      TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_CODECS,
-          TP_ARRAY_TYPE_CODEC_LIST, self->priv->codecs,
-      TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_REMOTE_CONTACT,
-          G_TYPE_UINT, self->priv->remote_contact,
-      TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_SSRCS,
-          TP_HASH_TYPE_CONTACT_SSRCS_MAP, self->priv->ssrcs,
-      NULL);
+  if (self->priv->properties == NULL)
+    {
+      GHashTable *properties = tp_asv_new (
+          TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_INTERFACES,
+              G_TYPE_STRV, self->priv->interfaces->pdata,
+          TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_FURTHER_NEGOTIATION_REQUIRED,
+              G_TYPE_BOOLEAN, self->priv->further_negotiation_required,
+          TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_HAS_REMOTE_INFORMATION,
+              G_TYPE_BOOLEAN, self->priv->has_remote_information,
+          TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_REMOTE_CONTACT,
+              G_TYPE_UINT, self->priv->remote_contact,
+          TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_SSRCS,
+              TP_HASH_TYPE_CONTACT_SSRCS_MAP, self->priv->tables->ssrcs,
+          NULL);
+
+      /* build the codec list straight into the hash table, rather than
+       * building it and then having tp_asv_new() copy it */
+      tp_asv_take_boxed (properties,
+          TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_CODECS,
+          TP_ARRAY_TYPE_CODEC_LIST,
+          media_tables_dup_dbus_codecs (self->priv->tables));
+
+      self->priv->properties = properties;
+    }
+
+  return g_hash_table_ref (self->priv->properties);
 }
 
 static void
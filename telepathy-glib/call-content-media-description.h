@@ -85,6 +85,13 @@ TpCallContentMediaDescription *tp_call_content_media_description_new (
     gboolean has_remote_information,
     gboolean further_negotiation_required);
 
+_TP_AVAILABLE_IN_UNRELEASED
+TpCallContentMediaDescription *tp_call_content_media_description_new_from (
+    TpCallContentMediaDescription *other,
+    const gchar *object_path,
+    gboolean has_remote_information,
+    gboolean further_negotiation_required);
+
 _TP_AVAILABLE_IN_0_18
 const gchar *tp_call_content_media_description_get_object_path (
     TpCallContentMediaDescription *self);
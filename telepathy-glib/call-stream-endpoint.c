@@ -825,6 +825,7 @@ call_stream_endpoint_set_endpoint_state (TpSvcCallStreamEndpoint *iface,
     DBusGMethodInvocation *context)
 {
   TpCallStreamEndpoint *self = TP_CALL_STREAM_ENDPOINT (iface);
+  TpStreamEndpointState old_state;
 
   if (component >= TP_NUM_STREAM_COMPONENTS)
     {
@@ -847,6 +848,8 @@ call_stream_endpoint_set_endpoint_state (TpSvcCallStreamEndpoint *iface,
   DEBUG ("State changed to %d for component %d for endpoint %s",
       state, component, self->priv->object_path);
 
+  old_state = tp_call_stream_endpoint_get_state (self, component);
+
   g_hash_table_insert (self->priv->endpoint_state,
       GUINT_TO_POINTER (component),
       GUINT_TO_POINTER (state));
@@ -860,6 +863,9 @@ call_stream_endpoint_set_endpoint_state (TpSvcCallStreamEndpoint *iface,
       TpBaseCallChannel *chan = _tp_base_call_stream_get_channel (
           TP_BASE_CALL_STREAM (self->priv->stream));
 
+      _tp_base_media_call_stream_endpoint_state_changed (self->priv->stream,
+          self, old_state, state);
+
       if (chan && TP_IS_BASE_MEDIA_CALL_CHANNEL (chan))
         _tp_base_media_call_channel_endpoint_state_changed (
             TP_BASE_MEDIA_CALL_CHANNEL (chan));
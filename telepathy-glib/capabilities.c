@@ -21,6 +21,7 @@
 
 #include "telepathy-glib/capabilities.h"
 #include "telepathy-glib/capabilities-internal.h"
+#include "telepathy-glib/channel-filter-index-internal.h"
 
 #include <telepathy-glib/dbus.h>
 #include <telepathy-glib/dbus-internal.h>
@@ -76,6 +77,8 @@ struct _TpCapabilitiesPrivate {
     GPtrArray *classes;
     gboolean contact_specific;
     GVariant *classes_variant;
+    /* lazily-built index of classes' fixed properties => GValueArray */
+    TpChannelFilterIndex *index;
 };
 
 /**
@@ -141,6 +144,7 @@ tp_capabilities_dispose (GObject *object)
     }
 
   tp_clear_pointer (&self->priv->classes_variant, g_variant_unref);
+  tp_clear_pointer (&self->priv->index, _tp_channel_filter_index_unref);
 
   ((GObjectClass *) tp_capabilities_parent_class)->dispose (object);
 }
@@ -309,40 +313,62 @@ _tp_capabilities_new (const GPtrArray *classes,
   return self;
 }
 
+/* Returns the classes whose fixed properties have exactly the given
+ * ChannelType and TargetHandleType (or no TargetHandleType, if
+ * @has_handle_type is FALSE), in order, or NULL. Contacts' capabilities are
+ * asked about a lot (for instance, to decide which actions to offer for each
+ * contact in a roster) and can contain many classes, so this avoids going
+ * through all of them every time. */
+static const GPtrArray *
+lookup_classes (TpCapabilities *self,
+    const gchar *chan_type,
+    gboolean has_handle_type,
+    TpHandleType handle_type)
+{
+  if (self->priv->index == NULL)
+    {
+      guint i;
+
+      self->priv->index = _tp_channel_filter_index_new ();
+
+      for (i = 0; i < self->priv->classes->len; i++)
+        {
+          GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
+          GHashTable *fixed;
+
+          tp_value_array_unpack (arr, 1, &fixed);
+          _tp_channel_filter_index_add (self->priv->index, fixed, arr);
+        }
+    }
+
+  return _tp_channel_filter_index_lookup_exact (self->priv->index,
+      chan_type, has_handle_type, handle_type);
+}
+
 static gboolean
 supports_simple_channel (TpCapabilities *self,
     const gchar *expected_chan_type,
     TpHandleType expected_handle_type)
 {
+  const GPtrArray *classes;
   guint i;
 
   g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
 
-  for (i = 0; i < self->priv->classes->len; i++)
+  classes = lookup_classes (self, expected_chan_type, TRUE,
+      expected_handle_type);
+
+  for (i = 0; classes != NULL && i < classes->len; i++)
     {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
+      GValueArray *arr = g_ptr_array_index (classes, i);
       GHashTable *fixed;
       const gchar * const *allowed;
-      const gchar *chan_type;
-      TpHandleType handle_type;
-      gboolean valid;
 
       tp_value_array_unpack (arr, 2,
           &fixed,
           &allowed);
 
-      if (g_hash_table_size (fixed) != 2)
-        continue;
-
-      chan_type = tp_asv_get_string (fixed, TP_PROP_CHANNEL_CHANNEL_TYPE);
-      handle_type = tp_asv_get_uint32 (fixed,
-          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
-
-      if (!valid)
-        continue;
-
-      if (!tp_strdiff (chan_type, expected_chan_type) &&
-          handle_type == expected_handle_type)
+      if (g_hash_table_size (fixed) == 2)
         return TRUE;
     }
 
@@ -428,38 +454,25 @@ tp_capabilities_supports_text_chatrooms (TpCapabilities *self)
 gboolean
 tp_capabilities_supports_sms (TpCapabilities *self)
 {
+  const GPtrArray *classes;
   guint i;
 
   g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
 
-  for (i = 0; i < self->priv->classes->len; i++)
+  classes = lookup_classes (self, TP_IFACE_CHANNEL_TYPE_TEXT, TRUE,
+      TP_HANDLE_TYPE_CONTACT);
+
+  for (i = 0; classes != NULL && i < classes->len; i++)
     {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
+      GValueArray *arr = g_ptr_array_index (classes, i);
       GHashTable *fixed;
       const gchar * const *allowed;
-      const gchar *chan_type;
-      TpHandleType handle_type;
-      gboolean valid;
       guint nb_fixed_props;
 
       tp_value_array_unpack (arr, 2,
           &fixed,
           &allowed);
 
-      handle_type = tp_asv_get_uint32 (fixed,
-          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
-
-      if (!valid)
-        continue;
-
-      if (handle_type != TP_HANDLE_TYPE_CONTACT)
-        continue;
-
-      chan_type = tp_asv_get_string (fixed, TP_PROP_CHANNEL_CHANNEL_TYPE);
-
-      if (tp_strdiff (chan_type, TP_IFACE_CHANNEL_TYPE_TEXT))
-        continue;
-
       /* SMSChannel be either in fixed or allowed properties */
       if (tp_asv_get_boolean (fixed, TP_PROP_CHANNEL_INTERFACE_SMS_SMS_CHANNEL,
             NULL))
@@ -491,33 +504,25 @@ supports_call_full (TpCapabilities *self,
     gboolean expected_initial_audio,
     gboolean expected_initial_video)
 {
+  const GPtrArray *classes;
   guint i;
 
   g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
 
-  for (i = 0; i < self->priv->classes->len; i++)
+  classes = lookup_classes (self, TP_IFACE_CHANNEL_TYPE_CALL, TRUE,
+      expected_handle_type);
+
+  for (i = 0; classes != NULL && i < classes->len; i++)
     {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
+      GValueArray *arr = g_ptr_array_index (classes, i);
       GHashTable *fixed_prop;
       const gchar * const *allowed_prop;
-      const gchar *chan_type;
-      TpHandleType handle_type;
-      gboolean valid;
       guint nb_fixed_props = 2;
 
       tp_value_array_unpack (arr, 2,
           &fixed_prop,
           &allowed_prop);
 
-      chan_type = tp_asv_get_string (fixed_prop, TP_PROP_CHANNEL_CHANNEL_TYPE);
-      if (tp_strdiff (chan_type, TP_IFACE_CHANNEL_TYPE_CALL))
-        continue;
-
-      handle_type = tp_asv_get_uint32 (fixed_prop,
-          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
-      if (!valid || handle_type != expected_handle_type)
-        continue;
-
       if (expected_initial_audio)
         {
           /* We want audio, INITIAL_AUDIO must be in either fixed or allowed */
@@ -626,36 +631,23 @@ static gboolean
 supports_file_transfer (TpCapabilities *self,
     FTCapFlags flags)
 {
+  const GPtrArray *classes;
   guint i;
 
   g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
 
-  for (i = 0; i < self->priv->classes->len; i++)
+  classes = lookup_classes (self, TP_IFACE_CHANNEL_TYPE_FILE_TRANSFER, TRUE,
+      TP_HANDLE_TYPE_CONTACT);
+
+  for (i = 0; classes != NULL && i < classes->len; i++)
     {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
+      GValueArray *arr = g_ptr_array_index (classes, i);
       GHashTable *fixed;
-      const gchar *chan_type;
-      TpHandleType handle_type;
-      gboolean valid;
       guint n_fixed = 2;
       const gchar * const *allowed;
 
       tp_value_array_unpack (arr, 2, &fixed, &allowed);
 
-      chan_type = tp_asv_get_string (fixed, TP_PROP_CHANNEL_CHANNEL_TYPE);
-
-      if (tp_strdiff (chan_type, TP_IFACE_CHANNEL_TYPE_FILE_TRANSFER))
-        continue;
-
-      handle_type = tp_asv_get_uint32 (fixed,
-          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
-
-      if (!valid)
-        continue;
-
-      if (handle_type != TP_HANDLE_TYPE_CONTACT)
-        continue;
-
       /* ContentType, Filename, Size are mandatory. In principle we could check
        * that the CM allows them, but not allowing them would be ridiculous,
        * so we don't.
@@ -803,35 +795,27 @@ tp_capabilities_supports_tubes_common (TpCapabilities *self,
     const gchar *service_prop,
     const gchar *expected_service)
 {
+  const GPtrArray *classes;
   guint i;
 
   g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
   g_return_val_if_fail (expected_handle_type == TP_HANDLE_TYPE_CONTACT ||
       expected_handle_type == TP_HANDLE_TYPE_ROOM, FALSE);
 
-  for (i = 0; i < self->priv->classes->len; i++)
+  classes = lookup_classes (self, expected_channel_type, TRUE,
+      expected_handle_type);
+
+  for (i = 0; classes != NULL && i < classes->len; i++)
     {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
+      GValueArray *arr = g_ptr_array_index (classes, i);
       GHashTable *fixed;
       const gchar * const *allowed;
-      const gchar *chan_type;
-      TpHandleType handle_type;
-      gboolean valid;
       guint nb_fixed_props = 2;
 
       tp_value_array_unpack (arr, 2,
           &fixed,
           &allowed);
 
-      chan_type = tp_asv_get_string (fixed, TP_PROP_CHANNEL_CHANNEL_TYPE);
-      if (tp_strdiff (chan_type, expected_channel_type))
-        continue;
-
-      handle_type = tp_asv_get_uint32 (fixed,
-          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
-      if (!valid || handle_type != expected_handle_type)
-        continue;
-
       if (expected_service != NULL && self->priv->contact_specific)
         {
           const gchar *service;
@@ -939,6 +923,7 @@ tp_capabilities_supports_contact_search (TpCapabilities *self,
     gboolean *with_server)
 {
   gboolean ret = FALSE;
+  const GPtrArray *classes;
   guint i, j;
 
   g_return_val_if_fail (TP_IS_CAPABILITIES (self), FALSE);
@@ -949,25 +934,23 @@ tp_capabilities_supports_contact_search (TpCapabilities *self,
   if (with_server)
     *with_server = FALSE;
 
-  for (i = 0; i < self->priv->classes->len; i++)
+  /* ContactSearch channel should have ChannelType and TargetHandleType=NONE
+   * but CM implementations are wrong and omitted TargetHandleType,
+   * so it's set in stone now.  */
+  classes = lookup_classes (self, TP_IFACE_CHANNEL_TYPE_CONTACT_SEARCH, FALSE,
+      0);
+
+  for (i = 0; classes != NULL && i < classes->len; i++)
     {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
+      GValueArray *arr = g_ptr_array_index (classes, i);
       GHashTable *fixed;
-      const gchar *chan_type;
       const gchar **allowed_properties;
 
       tp_value_array_unpack (arr, 2, &fixed, &allowed_properties);
 
-      /* ContactSearch channel should have ChannelType and TargetHandleType=NONE
-       * but CM implementations are wrong and omitted TargetHandleType,
-       * so it's set in stone now.  */
       if (g_hash_table_size (fixed) != 1)
         continue;
 
-      chan_type = tp_asv_get_string (fixed, TP_PROP_CHANNEL_CHANNEL_TYPE);
-      if (tp_strdiff (chan_type, TP_IFACE_CHANNEL_TYPE_CONTACT_SEARCH))
-        continue;
-
       ret = TRUE;
 
       for (j = 0; allowed_properties[j] != NULL; j++)
@@ -1046,31 +1029,23 @@ tp_capabilities_supports_room_list (TpCapabilities *self,
 {
   gboolean result = FALSE;
   gboolean server = FALSE;
+  const GPtrArray *classes;
   guint i;
 
-  for (i = 0; i < self->priv->classes->len; i++)
+  classes = lookup_classes (self, TP_IFACE_CHANNEL_TYPE_ROOM_LIST, TRUE,
+      TP_HANDLE_TYPE_NONE);
+
+  for (i = 0; classes != NULL && i < classes->len; i++)
     {
-      GValueArray *arr = g_ptr_array_index (self->priv->classes, i);
+      GValueArray *arr = g_ptr_array_index (classes, i);
       GHashTable *fixed;
-      const gchar *chan_type;
       const gchar **allowed_properties;
-      TpHandleType handle_type;
-      gboolean valid;
 
       tp_value_array_unpack (arr, 2, &fixed, &allowed_properties);
 
       if (g_hash_table_size (fixed) != 2)
         continue;
 
-      chan_type = tp_asv_get_string (fixed, TP_PROP_CHANNEL_CHANNEL_TYPE);
-      if (tp_strdiff (chan_type, TP_IFACE_CHANNEL_TYPE_ROOM_LIST))
-        continue;
-
-      handle_type = tp_asv_get_uint32 (fixed,
-          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
-      if (!valid || handle_type != TP_HANDLE_TYPE_NONE)
-        continue;
-
       result = TRUE;
 
       server = tp_strv_contains (allowed_properties,
@@ -673,6 +673,22 @@ prepare_core_async (TpProxy *proxy,
   result = g_simple_async_result_new ((GObject *) proxy, callback, user_data,
       prepare_core_async);
 
+  /* An approver or handler is given the immutable properties and the
+   * channels in the same method call that told it about us; the only
+   * mutable property, Channels, is kept up to date by ChannelLost, so
+   * there's nothing more GetAll could tell us. */
+  if (self->priv->connection != NULL
+      && self->priv->account != NULL
+      && self->priv->possible_handlers != NULL
+      && self->priv->channels != NULL)
+    {
+      DEBUG ("%s: already have all properties",
+          tp_proxy_get_object_path (self));
+      g_simple_async_result_complete_in_idle (result);
+      g_object_unref (result);
+      return;
+    }
+
   tp_cli_dbus_properties_call_get_all (self, -1,
       TP_IFACE_CHANNEL_DISPATCH_OPERATION,
       get_dispatch_operation_prop_cb,
@@ -0,0 +1,442 @@
+/*
+ * channel-filter-index.c - matching channels against many filters
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "telepathy-glib/channel-filter-index-internal.h"
+
+#include <dbus/dbus-glib.h>
+
+#include <telepathy-glib/dbus.h>
+#include <telepathy-glib/interfaces.h>
+#include <telepathy-glib/util.h>
+
+/* Channel classes (a{sv} of fixed properties, as used for client filters and
+ * requestable channel classes) almost always contain ChannelType and
+ * TargetHandleType, and a channel can only match classes which agree with it
+ * on both. So rather than comparing a channel with every filter in turn, the
+ * filters are kept in buckets keyed by those two properties; a filter which
+ * doesn't specify one of them, or gives it an unexpected type, goes in a
+ * bucket which is a wildcard for that property. Matching a channel then
+ * looks at no more than four buckets, and only compares it with the filters
+ * in those.
+ *
+ * Within a bucket, filters are kept in the order they were added, and
+ * _tp_channel_filter_index_match() returns the earliest filter that matches,
+ * just as a linear search would. */
+
+struct _TpChannelFilterIndex
+{
+  gsize refcount;
+
+  /* owned Entry, in the order they were added */
+  GPtrArray *entries;
+  /* owned Key => owned Bucket */
+  GHashTable *buckets;
+};
+
+typedef struct
+{
+  /* NULL if any channel type matches */
+  gchar *channel_type;
+  /* FALSE if any handle type matches */
+  gboolean has_handle_type;
+  guint handle_type;
+} Key;
+
+typedef struct
+{
+  GHashTable *filter;
+  gpointer data;
+  guint serial;
+} Entry;
+
+typedef struct
+{
+  /* borrowed Entry */
+  GPtrArray *entries;
+  /* the same entries' data, for _tp_channel_filter_index_lookup_exact() */
+  GPtrArray *data;
+} Bucket;
+
+static guint
+key_hash (gconstpointer p)
+{
+  const Key *key = p;
+  guint hash = 0;
+
+  if (key->channel_type != NULL)
+    hash = g_str_hash (key->channel_type);
+
+  if (key->has_handle_type)
+    hash ^= (key->handle_type + 1) * 31;
+
+  return hash;
+}
+
+static gboolean
+key_equal (gconstpointer a,
+    gconstpointer b)
+{
+  const Key *ka = a;
+  const Key *kb = b;
+
+  return !tp_strdiff (ka->channel_type, kb->channel_type)
+      && ka->has_handle_type == kb->has_handle_type
+      && (!ka->has_handle_type || ka->handle_type == kb->handle_type);
+}
+
+static void
+key_free (gpointer p)
+{
+  Key *key = p;
+
+  g_free (key->channel_type);
+  g_slice_free (Key, key);
+}
+
+static void
+bucket_free (gpointer p)
+{
+  Bucket *bucket = p;
+
+  g_ptr_array_unref (bucket->entries);
+  g_ptr_array_unref (bucket->data);
+  g_slice_free (Bucket, bucket);
+}
+
+static void
+entry_free (gpointer p)
+{
+  Entry *entry = p;
+
+  g_hash_table_unref (entry->filter);
+  g_slice_free (Entry, entry);
+}
+
+TpChannelFilterIndex *
+_tp_channel_filter_index_new (void)
+{
+  TpChannelFilterIndex *self = g_slice_new0 (TpChannelFilterIndex);
+
+  self->refcount = 1;
+  self->entries = g_ptr_array_new_with_free_func (entry_free);
+  self->buckets = g_hash_table_new_full (key_hash, key_equal, key_free,
+      bucket_free);
+
+  return self;
+}
+
+TpChannelFilterIndex *
+_tp_channel_filter_index_ref (TpChannelFilterIndex *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+
+  self->refcount++;
+  return self;
+}
+
+void
+_tp_channel_filter_index_unref (TpChannelFilterIndex *self)
+{
+  g_return_if_fail (self != NULL);
+
+  if (--self->refcount > 0)
+    return;
+
+  g_hash_table_unref (self->buckets);
+  g_ptr_array_unref (self->entries);
+  g_slice_free (TpChannelFilterIndex, self);
+}
+
+static void
+key_init (Key *key,
+    GHashTable *properties)
+{
+  /* borrowed from @properties: only for lookups */
+  key->channel_type = (gchar *) tp_asv_get_string (properties,
+      TP_PROP_CHANNEL_CHANNEL_TYPE);
+  key->handle_type = tp_asv_get_uint32 (properties,
+      TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &key->has_handle_type);
+}
+
+/*
+ * _tp_channel_filter_index_add:
+ * @self: an index
+ * @filter: (transfer none): a channel class, mapping D-Bus property names
+ *  to #GValue; it must not be modified while it is in @self
+ * @data: data to associate with @filter
+ *
+ * Add @filter to @self. A channel matches @filter if every property
+ * in @filter is present in the channel's properties with the same value.
+ */
+void
+_tp_channel_filter_index_add (TpChannelFilterIndex *self,
+    GHashTable *filter,
+    gpointer data)
+{
+  Entry *entry;
+  Key key;
+  Bucket *bucket;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (filter != NULL);
+
+  entry = g_slice_new0 (Entry);
+  entry->filter = g_hash_table_ref (filter);
+  entry->data = data;
+  entry->serial = self->entries->len;
+  g_ptr_array_add (self->entries, entry);
+
+  key_init (&key, filter);
+  bucket = g_hash_table_lookup (self->buckets, &key);
+
+  if (bucket == NULL)
+    {
+      Key *owned = g_slice_new0 (Key);
+
+      owned->channel_type = g_strdup (key.channel_type);
+      owned->has_handle_type = key.has_handle_type;
+      owned->handle_type = key.handle_type;
+
+      bucket = g_slice_new0 (Bucket);
+      bucket->entries = g_ptr_array_new ();
+      bucket->data = g_ptr_array_new ();
+      g_hash_table_insert (self->buckets, owned, bucket);
+    }
+
+  g_ptr_array_add (bucket->entries, entry);
+  g_ptr_array_add (bucket->data, data);
+}
+
+guint
+_tp_channel_filter_index_get_size (TpChannelFilterIndex *self)
+{
+  g_return_val_if_fail (self != NULL, 0);
+
+  return self->entries->len;
+}
+
+static gboolean
+is_integer_type (GType type)
+{
+  switch (type)
+    {
+      case G_TYPE_UCHAR:
+      case G_TYPE_INT:
+      case G_TYPE_UINT:
+      case G_TYPE_INT64:
+      case G_TYPE_UINT64:
+        return TRUE;
+
+      default:
+        return FALSE;
+    }
+}
+
+/* As with D-Bus, integers of different types match if their values are
+ * equal */
+static gboolean
+property_matches (GHashTable *filter,
+    GHashTable *properties,
+    const gchar *name,
+    const GValue *wanted)
+{
+  const GValue *value = g_hash_table_lookup (properties, name);
+  GType type;
+
+  if (value == NULL)
+    return FALSE;
+
+  type = G_VALUE_TYPE (wanted);
+
+  if (is_integer_type (type) && is_integer_type (G_VALUE_TYPE (value)))
+    {
+      gboolean valid_a, valid_b;
+      gint64 i_a, i_b;
+      guint64 u_a, u_b;
+
+      i_a = tp_asv_get_int64 (filter, name, &valid_a);
+      i_b = tp_asv_get_int64 (properties, name, &valid_b);
+
+      if (valid_a && valid_b)
+        return i_a == i_b;
+
+      u_a = tp_asv_get_uint64 (filter, name, &valid_a);
+      u_b = tp_asv_get_uint64 (properties, name, &valid_b);
+
+      return valid_a && valid_b && u_a == u_b;
+    }
+
+  if (type != G_VALUE_TYPE (value))
+    return FALSE;
+
+  if (type == G_TYPE_STRING)
+    return !tp_strdiff (g_value_get_string (wanted),
+        g_value_get_string (value));
+
+  if (type == DBUS_TYPE_G_OBJECT_PATH)
+    return !tp_strdiff (g_value_get_boxed (wanted), g_value_get_boxed (value));
+
+  if (type == G_TYPE_BOOLEAN)
+    return !g_value_get_boolean (wanted) == !g_value_get_boolean (value);
+
+  if (type == G_TYPE_DOUBLE)
+    return g_value_get_double (wanted) == g_value_get_double (value);
+
+  /* Channel classes only contain basic types, so anything else is not
+   * going to match */
+  return FALSE;
+}
+
+static gboolean
+filter_matches (GHashTable *filter,
+    GHashTable *properties)
+{
+  GHashTableIter iter;
+  gpointer name, wanted;
+
+  g_hash_table_iter_init (&iter, filter);
+
+  while (g_hash_table_iter_next (&iter, &name, &wanted))
+    {
+      if (!property_matches (filter, properties, name, wanted))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static Entry *
+bucket_match (TpChannelFilterIndex *self,
+    const Key *key,
+    GHashTable *properties,
+    Entry *best)
+{
+  Bucket *bucket = g_hash_table_lookup (self->buckets, key);
+  guint i;
+
+  if (bucket == NULL)
+    return best;
+
+  for (i = 0; i < bucket->entries->len; i++)
+    {
+      Entry *entry = g_ptr_array_index (bucket->entries, i);
+
+      /* entries are in order, so nothing further on can beat @best */
+      if (best != NULL && entry->serial > best->serial)
+        break;
+
+      if (filter_matches (entry->filter, properties))
+        return entry;
+    }
+
+  return best;
+}
+
+/*
+ * _tp_channel_filter_index_match:
+ * @self: an index
+ * @properties: a channel's immutable properties, mapping D-Bus property
+ *  names to #GValue
+ * @data: (out) (allow-none): if not %NULL, used to return the data
+ *  associated with the first filter (in the order they were added) which
+ *  matches @properties
+ *
+ * Returns: %TRUE if any filter in @self matches @properties
+ */
+gboolean
+_tp_channel_filter_index_match (TpChannelFilterIndex *self,
+    GHashTable *properties,
+    gpointer *data)
+{
+  Key channel, key;
+  Entry *best = NULL;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (properties != NULL, FALSE);
+
+  key_init (&channel, properties);
+
+  /* Filters specifying both */
+  key = channel;
+  if (key.channel_type != NULL && key.has_handle_type)
+    best = bucket_match (self, &key, properties, best);
+
+  /* Filters specifying the channel type but not the handle type */
+  key.has_handle_type = FALSE;
+  if (key.channel_type != NULL)
+    best = bucket_match (self, &key, properties, best);
+
+  /* Filters specifying the handle type but not the channel type */
+  key = channel;
+  key.channel_type = NULL;
+  if (key.has_handle_type)
+    best = bucket_match (self, &key, properties, best);
+
+  /* Filters specifying neither */
+  key.has_handle_type = FALSE;
+  best = bucket_match (self, &key, properties, best);
+
+  if (best == NULL)
+    return FALSE;
+
+  if (data != NULL)
+    *data = best->data;
+
+  return TRUE;
+}
+
+/*
+ * _tp_channel_filter_index_lookup_exact:
+ * @self: an index
+ * @channel_type: (allow-none): a channel type, or %NULL for filters with no
+ *  ChannelType
+ * @has_handle_type: %FALSE for filters with no TargetHandleType
+ * @handle_type: a handle type, if @has_handle_type is %TRUE
+ *
+ * Unlike _tp_channel_filter_index_match(), filters which don't mention the
+ * channel type or handle type are not considered to match any value. This is
+ * what TpCapabilities wants when looking for a particular requestable
+ * channel class.
+ *
+ * Returns: (transfer none) (allow-none): the data associated with each filter
+ *  whose ChannelType and TargetHandleType are exactly as given, in the order
+ *  they were added, or %NULL if there are none. It is only valid until
+ *  more filters are added.
+ */
+const GPtrArray *
+_tp_channel_filter_index_lookup_exact (TpChannelFilterIndex *self,
+    const gchar *channel_type,
+    gboolean has_handle_type,
+    guint handle_type)
+{
+  Key key = { (gchar *) channel_type, has_handle_type, handle_type };
+  Bucket *bucket;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  bucket = g_hash_table_lookup (self->buckets, &key);
+
+  if (bucket == NULL)
+    return NULL;
+
+  return bucket->data;
+}
@@ -50,8 +50,17 @@ struct _TpChannelPrivate {
     TpHandleType handle_type;
     TpHandle handle;
     gchar *identifier;
+    /* The rest of the well-known immutable properties, parsed once from
+     * channel_properties (or wherever else we learn them) so that the
+     * accessors don't need to look them up every time */
+    TpHandle initiator_handle;
+    gchar *initiator_identifier;
+    gboolean requested;
     /* owned string (iface + "." + prop) => slice-allocated GValue */
     GHashTable *channel_properties;
+    /* channel_properties as a vardict, or NULL if it has changed since the
+     * last time anyone asked for one */
+    GVariant *channel_properties_variant;
 
     /* Set until introspection discovers which to use; both NULL after one has
      * been disconnected.
@@ -107,6 +116,9 @@ struct _TpChannelPrivate {
     unsigned exists:1;
     /* GetGroupFlags has returned */
     unsigned have_group_flags:1;
+    /* initiator_handle and requested have been set */
+    unsigned have_initiator_handle:1;
+    unsigned have_requested:1;
 
     TpChannelPasswordFlags password_flags;
 };
@@ -495,7 +495,13 @@ tp_channel_dup_immutable_properties (TpChannel *self)
 {
   g_return_val_if_fail (TP_IS_CHANNEL (self), NULL);
 
-  return _tp_asv_to_vardict (self->priv->channel_properties);
+  /* channels rarely change once they've been prepared, so keep the variant
+   * around for the next caller */
+  if (self->priv->channel_properties_variant == NULL)
+    self->priv->channel_properties_variant = _tp_asv_to_vardict (
+        self->priv->channel_properties);
+
+  return g_variant_ref (self->priv->channel_properties_variant);
 }
 
 static void
@@ -599,6 +605,18 @@ tp_channel_get_chat_state (TpChannel *self,
 }
 
 
+static void
+_tp_channel_set_immutable_property (TpChannel *self,
+    const gchar *name,
+    GValue *value)
+{
+  g_hash_table_insert (self->priv->channel_properties, g_strdup (name),
+      value);
+  tp_clear_pointer (&self->priv->channel_properties_variant,
+      g_variant_unref);
+}
+
+
 /* These functions, maybe_set_whatever, ignore attempts to set a null value.
  * This means we can indiscriminately set everything from every source
  * (channel-properties, other construct-time properties, GetAll fast path,
@@ -616,8 +634,8 @@ _tp_channel_maybe_set_channel_type (TpChannel *self,
     return;
 
   self->priv->channel_type = q;
-  g_hash_table_insert (self->priv->channel_properties,
-      g_strdup (TP_PROP_CHANNEL_CHANNEL_TYPE),
+  _tp_channel_set_immutable_property (self,
+      TP_PROP_CHANNEL_CHANNEL_TYPE,
       tp_g_value_slice_new_static_string (g_quark_to_string (q)));
 
   tp_proxy_add_interface_by_id ((TpProxy *) self,
@@ -633,8 +651,8 @@ _tp_channel_maybe_set_handle (TpChannel *self,
   if (valid)
     {
       self->priv->handle = handle;
-      g_hash_table_insert (self->priv->channel_properties,
-          g_strdup (TP_PROP_CHANNEL_TARGET_HANDLE),
+      _tp_channel_set_immutable_property (self,
+          TP_PROP_CHANNEL_TARGET_HANDLE,
           tp_g_value_slice_new_uint (handle));
     }
 }
@@ -648,8 +666,8 @@ _tp_channel_maybe_set_handle_type (TpChannel *self,
   if (valid)
     {
       self->priv->handle_type = handle_type;
-      g_hash_table_insert (self->priv->channel_properties,
-          g_strdup (TP_PROP_CHANNEL_TARGET_HANDLE_TYPE),
+      _tp_channel_set_immutable_property (self,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE,
           tp_g_value_slice_new_uint (handle_type));
     }
 }
@@ -662,12 +680,56 @@ _tp_channel_maybe_set_identifier (TpChannel *self,
   if (identifier != NULL && self->priv->identifier == NULL)
     {
       self->priv->identifier = g_strdup (identifier);
-      g_hash_table_insert (self->priv->channel_properties,
-          g_strdup (TP_PROP_CHANNEL_TARGET_ID),
+      _tp_channel_set_immutable_property (self,
+          TP_PROP_CHANNEL_TARGET_ID,
           tp_g_value_slice_new_string (identifier));
     }
 }
 
+static void
+_tp_channel_maybe_set_initiator_handle (TpChannel *self,
+    TpHandle handle,
+    gboolean valid)
+{
+  if (valid)
+    {
+      self->priv->initiator_handle = handle;
+      self->priv->have_initiator_handle = TRUE;
+      _tp_channel_set_immutable_property (self,
+          TP_PROP_CHANNEL_INITIATOR_HANDLE,
+          tp_g_value_slice_new_uint (handle));
+    }
+}
+
+static void
+_tp_channel_maybe_set_initiator_identifier (TpChannel *self,
+    const gchar *identifier)
+{
+  if (identifier != NULL)
+    {
+      g_free (self->priv->initiator_identifier);
+      self->priv->initiator_identifier = g_strdup (identifier);
+      _tp_channel_set_immutable_property (self,
+          TP_PROP_CHANNEL_INITIATOR_ID,
+          tp_g_value_slice_new_string (identifier));
+    }
+}
+
+static void
+_tp_channel_maybe_set_requested (TpChannel *self,
+    gboolean requested,
+    gboolean valid)
+{
+  if (valid)
+    {
+      self->priv->requested = requested;
+      self->priv->have_requested = TRUE;
+      _tp_channel_set_immutable_property (self,
+          TP_PROP_CHANNEL_REQUESTED,
+          tp_g_value_slice_new_boolean (requested));
+    }
+}
+
 static void
 _tp_channel_maybe_set_interfaces (TpChannel *self,
                                   const gchar **interfaces)
@@ -677,8 +739,8 @@ _tp_channel_maybe_set_interfaces (TpChannel *self,
 
   tp_proxy_add_interfaces ((TpProxy *) self, interfaces);
 
-  g_hash_table_insert (self->priv->channel_properties,
-      g_strdup (TP_PROP_CHANNEL_INTERFACES),
+  _tp_channel_set_immutable_property (self,
+      TP_PROP_CHANNEL_INTERFACES,
       tp_g_value_slice_new_boxed (G_TYPE_STRV, interfaces));
 }
 
@@ -720,6 +782,7 @@ tp_channel_set_property (GObject *object,
           if (asv != NULL)
             {
               guint u;
+              gboolean b;
 
               /* no need to emit GObject::notify for any of these since this
                * can only happen at construct time, before anyone has
@@ -728,6 +791,8 @@ tp_channel_set_property (GObject *object,
               tp_g_hash_table_update (self->priv->channel_properties,
                   asv, (GBoxedCopyFunc) g_strdup,
                   (GBoxedCopyFunc) tp_g_value_slice_dup);
+              tp_clear_pointer (&self->priv->channel_properties_variant,
+                  g_variant_unref);
 
               u = tp_asv_get_uint32 (self->priv->channel_properties,
                   TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, &valid);
@@ -749,6 +814,18 @@ tp_channel_set_property (GObject *object,
                   tp_asv_get_boxed (self->priv->channel_properties,
                       TP_PROP_CHANNEL_INTERFACES,
                       G_TYPE_STRV));
+
+              u = tp_asv_get_uint32 (self->priv->channel_properties,
+                  TP_PROP_CHANNEL_INITIATOR_HANDLE, &valid);
+              _tp_channel_maybe_set_initiator_handle (self, u, valid);
+
+              _tp_channel_maybe_set_initiator_identifier (self,
+                  tp_asv_get_string (self->priv->channel_properties,
+                      TP_PROP_CHANNEL_INITIATOR_ID));
+
+              b = tp_asv_get_boolean (self->priv->channel_properties,
+                  TP_PROP_CHANNEL_REQUESTED, &valid);
+              _tp_channel_maybe_set_requested (self, b, valid);
             }
         }
       break;
@@ -999,12 +1076,12 @@ tp_channel_got_handle_cb (TpChannel *self,
       self->priv->handle_type = handle_type;
       self->priv->handle = handle;
 
-      g_hash_table_insert (self->priv->channel_properties,
-          g_strdup (TP_PROP_CHANNEL_TARGET_HANDLE_TYPE),
+      _tp_channel_set_immutable_property (self,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE,
           tp_g_value_slice_new_uint (handle_type));
 
-      g_hash_table_insert (self->priv->channel_properties,
-          g_strdup (TP_PROP_CHANNEL_TARGET_HANDLE),
+      _tp_channel_set_immutable_property (self,
+          TP_PROP_CHANNEL_TARGET_HANDLE,
           tp_g_value_slice_new_uint (handle));
 
       g_object_notify ((GObject *) self, "handle-type");
@@ -1119,7 +1196,6 @@ _tp_channel_got_properties (TpProxy *proxy,
     {
       gboolean valid;
       guint u;
-      const gchar *s;
       gboolean b;
 
       DEBUG ("Received %u channel properties", g_hash_table_size (asv));
@@ -1141,31 +1217,13 @@ _tp_channel_got_properties (TpProxy *proxy,
           tp_asv_get_string (asv, "TargetID"));
 
       u = tp_asv_get_uint32 (asv, "InitiatorHandle", &valid);
+      _tp_channel_maybe_set_initiator_handle (self, u, valid);
 
-      if (valid)
-        {
-          g_hash_table_insert (self->priv->channel_properties,
-              g_strdup (TP_PROP_CHANNEL_INITIATOR_HANDLE),
-              tp_g_value_slice_new_uint (u));
-        }
-
-      s = tp_asv_get_string (asv, "InitiatorID");
-
-      if (s != NULL)
-        {
-          g_hash_table_insert (self->priv->channel_properties,
-              g_strdup (TP_PROP_CHANNEL_INITIATOR_ID),
-              tp_g_value_slice_new_string (s));
-        }
+      _tp_channel_maybe_set_initiator_identifier (self,
+          tp_asv_get_string (asv, "InitiatorID"));
 
       b = tp_asv_get_boolean (asv, "Requested", &valid);
-
-      if (valid)
-        {
-          g_hash_table_insert (self->priv->channel_properties,
-              g_strdup (TP_PROP_CHANNEL_REQUESTED),
-              tp_g_value_slice_new_boolean (b));
-        }
+      _tp_channel_maybe_set_requested (self, b, valid);
 
       g_object_notify ((GObject *) self, "channel-type");
       g_object_notify ((GObject *) self, "interfaces");
@@ -1187,43 +1245,32 @@ _tp_channel_got_properties (TpProxy *proxy,
 }
 
 
-static void
-_tp_channel_get_properties (TpChannel *self)
+/* Returns TRUE if we already know every Channel property that GetAll
+ * would tell us (except perhaps Interfaces) */
+static gboolean
+_tp_channel_have_core_properties (TpChannel *self)
 {
-  /* skip it if we already have all the details we want */
-  if (self->priv->handle_type != TP_UNKNOWN_HANDLE_TYPE
+  return (self->priv->handle_type != TP_UNKNOWN_HANDLE_TYPE
       && (self->priv->handle != 0 ||
           self->priv->handle_type == TP_HANDLE_TYPE_NONE)
       && self->priv->channel_type != 0
-      /* currently we always re-fetch the interfaces later, so don't check:
-      && tp_asv_get_boxed (self->priv->channel_properties,
-        TP_PROP_CHANNEL_INTERFACES, G_TYPE_STRV) != NULL
-       */
-      && tp_asv_get_string (self->priv->channel_properties,
-        TP_PROP_CHANNEL_TARGET_ID) != NULL
-      && tp_asv_get_string (self->priv->channel_properties,
-        TP_PROP_CHANNEL_INITIATOR_ID) != NULL
-      )
-    {
-      gboolean valid;
-
-      tp_asv_get_uint32 (self->priv->channel_properties,
-          TP_PROP_CHANNEL_INITIATOR_HANDLE, &valid);
-
-      if (!valid)
-        goto missing;
-
-      tp_asv_get_boolean (self->priv->channel_properties,
-          TP_PROP_CHANNEL_REQUESTED, &valid);
-
-      if (!valid)
-        goto missing;
+      && self->priv->identifier != NULL
+      && self->priv->initiator_identifier != NULL
+      && self->priv->have_initiator_handle
+      && self->priv->have_requested);
+}
 
+static void
+_tp_channel_get_properties (TpChannel *self)
+{
+  /* skip it if we already have all the details we want; currently we always
+   * re-fetch the interfaces later if we need to, so they aren't checked */
+  if (_tp_channel_have_core_properties (self))
+    {
       _tp_channel_continue_introspection (self);
       return;
     }
 
-missing:
   tp_cli_dbus_properties_call_get_all (self, -1,
       TP_IFACE_CHANNEL, _tp_channel_got_properties, NULL, NULL, NULL);
 }
@@ -1356,6 +1403,20 @@ tp_channel_constructor (GType type,
           : "(null)",
       self->priv->handle, self->priv->handle_type);
 
+  /* A factory is only handed immutable properties that came from the
+   * channel's connection or from the channel dispatcher (NewChannels,
+   * ObserveChannels, HandleChannels, AddDispatchOperation...), so if they
+   * are complete, they are as good as a successful GetAll: there's no need
+   * to ask the channel again, or to check that it exists. */
+  if (tp_proxy_get_factory (self) != NULL
+      && _tp_channel_have_core_properties (self)
+      && tp_asv_lookup (self->priv->channel_properties,
+          TP_PROP_CHANNEL_INTERFACES) != NULL)
+    {
+      DEBUG ("%p: immutable properties are complete", self);
+      self->priv->exists = TRUE;
+    }
+
   self->priv->introspect_needed = g_queue_new ();
 
   /* this does nothing if connection already has CORE prepared */
@@ -1384,10 +1445,11 @@ tp_channel_constructor (GType type,
 
   /* This makes a call unless (a) we already know the Interfaces by now, and
    * (b) priv->exists is TRUE (i.e. either GetAll, GetHandle or GetChannelType
-   * has succeeded).
+   * has succeeded, or a factory gave us a complete set of properties).
    *
-   * This means the channel never becomes ready until we re-enter the
-   * main loop, and we always verify that the channel does actually exist. */
+   * This means that unless a factory vouched for the channel, it never
+   * becomes ready until we re-enter the main loop, and we always verify that
+   * the channel does actually exist. */
   g_queue_push_tail (self->priv->introspect_needed,
       _tp_channel_get_interfaces);
 
@@ -1464,9 +1526,11 @@ tp_channel_finalize (GObject *object)
   tp_clear_pointer (&self->priv->introspect_needed, g_queue_free);
   tp_clear_pointer (&self->priv->chat_states, g_hash_table_unref);
   tp_clear_pointer (&self->priv->channel_properties, g_hash_table_unref);
+  tp_clear_pointer (&self->priv->channel_properties_variant, g_variant_unref);
   tp_clear_pointer (&self->priv->contacts_queue, g_queue_free);
 
   g_free (self->priv->identifier);
+  g_free (self->priv->initiator_identifier);
 
   ((GObjectClass *) tp_channel_parent_class)->finalize (object);
 }
@@ -2421,8 +2485,9 @@ tp_channel_init_known_interfaces (void)
 gboolean
 tp_channel_get_requested (TpChannel *self)
 {
-  return tp_asv_get_boolean (self->priv->channel_properties,
-      TP_PROP_CHANNEL_REQUESTED, NULL);
+  g_return_val_if_fail (TP_IS_CHANNEL (self), FALSE);
+
+  return self->priv->requested;
 }
 
 /**
@@ -2439,8 +2504,9 @@ tp_channel_get_requested (TpChannel *self)
 TpHandle
 tp_channel_get_initiator_handle (TpChannel *self)
 {
-  return tp_asv_get_uint32 (self->priv->channel_properties,
-      TP_PROP_CHANNEL_INITIATOR_HANDLE, NULL);
+  g_return_val_if_fail (TP_IS_CHANNEL (self), 0);
+
+  return self->priv->initiator_handle;
 }
 
 /**
@@ -2457,12 +2523,10 @@ tp_channel_get_initiator_handle (TpChannel *self)
 const gchar *
 tp_channel_get_initiator_identifier (TpChannel *self)
 {
-  const gchar *id;
-
-  id = tp_asv_get_string (self->priv->channel_properties,
-      TP_PROP_CHANNEL_INITIATOR_ID);
+  g_return_val_if_fail (TP_IS_CHANNEL (self), NULL);
 
-  return id != NULL ? id : "";
+  return self->priv->initiator_identifier != NULL ?
+      self->priv->initiator_identifier : "";
 }
 
 /* tp_cli callbacks can potentially be called in a re-entrant way,
@@ -36,6 +36,7 @@
 
 #define DEBUG_FLAG TP_DEBUG_MANAGER
 #include "telepathy-glib/debug-internal.h"
+#include "telepathy-glib/manager-file-cache-internal.h"
 #include "telepathy-glib/protocol-internal.h"
 #include "telepathy-glib/util-internal.h"
 
@@ -252,11 +253,16 @@ struct _TpConnectionManagerPrivate {
      * is TRUE */
     GPtrArray *protocol_structs;
 
-    /* If we're waiting for a GetParameters, then GPtrArray of g_strdup'd
+    /* If we've just called ListProtocols, then GPtrArray of g_strdup'd
      * gchar * representing protocols we haven't yet introspected.
      * Otherwise NULL */
     GPtrArray *pending_protocols;
 
+    /* If we're waiting for GetParameters, which we call for all the
+     * protocols at once, then dup'd protocol name => TpProxyPendingCall for
+     * the ones that haven't replied yet. Otherwise NULL */
+    GHashTable *parameters_calls;
+
     /* dup'd name => referenced TpProtocol
      *
      * If we're waiting for a GetParameters, protocols we found so far for
@@ -270,9 +276,13 @@ struct _TpConnectionManagerPrivate {
     /* things we introspected so far */
     IntrospectionStep introspection_step;
 
-    /* the method call currently pending, or NULL if none. */
+    /* the method call currently pending, or NULL if none (or if we're
+     * waiting for parameters_calls) */
     TpProxyPendingCall *introspection_call;
 
+    /* g_get_monotonic_time() when we were constructed, for debug output */
+    gint64 construct_time;
+
     /* FALSE if initial name-owner (if any) hasn't been found yet */
     gboolean name_known;
     /* TRUE if someone asked us to activate but we're putting it off until
@@ -474,11 +484,20 @@ tp_connection_manager_ready_or_failed (TpConnectionManager *self,
 
   if (error == NULL)
     {
+      DEBUG ("%s: ready after %" G_GINT64_FORMAT " ms, info source %s",
+          self->name,
+          (g_get_monotonic_time () - self->priv->construct_time) / 1000,
+          _tp_enum_to_nick_nonnull (TP_TYPE_CM_INFO_SOURCE,
+              self->info_source));
       _tp_proxy_set_feature_prepared ((TpProxy *) self,
           TP_CONNECTION_MANAGER_FEATURE_CORE, TRUE);
     }
   else
     {
+      DEBUG ("%s: failed after %" G_GINT64_FORMAT " ms: %s",
+          self->name,
+          (g_get_monotonic_time () - self->priv->construct_time) / 1000,
+          error->message);
       _tp_proxy_set_features_failed ((TpProxy *) self, error);
     }
 }
@@ -595,8 +614,8 @@ tp_connection_manager_got_parameters (TpConnectionManager *self,
   GHashTable *immutables;
 
   g_assert (self->priv->introspection_step == INTROSPECT_GETTING_PARAMETERS);
-  g_assert (self->priv->introspection_call != NULL);
-  self->priv->introspection_call = NULL;
+  g_assert (self->priv->parameters_calls != NULL);
+  g_hash_table_remove (self->priv->parameters_calls, protocol);
 
   if (error != NULL)
     {
@@ -625,7 +644,16 @@ tp_connection_manager_got_parameters (TpConnectionManager *self,
       g_strdup (protocol), proto_object);
 
 out:
-  tp_connection_manager_continue_introspection (self);
+  if (g_hash_table_size (self->priv->parameters_calls) == 0)
+    {
+      tp_clear_pointer (&self->priv->parameters_calls, g_hash_table_unref);
+      tp_connection_manager_continue_introspection (self);
+    }
+  else
+    {
+      DEBUG ("%s: still waiting for %u GetParameters() replies",
+          self->name, g_hash_table_size (self->priv->parameters_calls));
+    }
 }
 
 static void tp_connection_manager_ready_or_failed (TpConnectionManager *self,
@@ -644,6 +672,21 @@ tp_connection_manager_reset_introspection (TpConnectionManager *self)
       self->priv->introspection_call = NULL;
     }
 
+  if (self->priv->parameters_calls != NULL)
+    {
+      GHashTable *calls = self->priv->parameters_calls;
+      GHashTableIter iter;
+      gpointer call;
+
+      self->priv->parameters_calls = NULL;
+      g_hash_table_iter_init (&iter, calls);
+
+      while (g_hash_table_iter_next (&iter, NULL, &call))
+        tp_proxy_pending_call_cancel (call);
+
+      g_hash_table_unref (calls);
+    }
+
   if (self->priv->found_protocols != NULL)
     {
       g_hash_table_unref (self->priv->found_protocols);
@@ -791,13 +834,13 @@ static void tp_connection_manager_got_protocols (TpConnectionManager *self,
 static void
 tp_connection_manager_continue_introspection (TpConnectionManager *self)
 {
-  gchar *next_protocol;
-
   DEBUG ("%s", self->name);
 
   if (self->priv->introspection_step == INTROSPECT_IDLE)
     {
-      DEBUG ("%s: calling GetAll on CM", self->name);
+      DEBUG ("%s: calling GetAll on CM, %" G_GINT64_FORMAT " ms after "
+          "construction", self->name,
+          (g_get_monotonic_time () - self->priv->construct_time) / 1000);
       self->priv->introspection_step = INTROSPECT_GETTING_PROPERTIES;
       self->priv->introspection_call = tp_cli_dbus_properties_call_get_all (
           self, -1, TP_IFACE_CONNECTION_MANAGER,
@@ -848,15 +891,32 @@ tp_connection_manager_continue_introspection (TpConnectionManager *self)
     }
   else
     {
-      next_protocol = g_ptr_array_remove_index_fast (
-          self->priv->pending_protocols, 0);
+      guint i;
+
+      /* Ask about all the protocols at once, rather than waiting for a
+       * round trip per protocol. The replies all arrive in idle callbacks,
+       * so none of them can come in before we've recorded its call. */
       self->priv->introspection_step = INTROSPECT_GETTING_PARAMETERS;
-      DEBUG ("%s/%s: calling legacy ListProtocols",
-          self->name, next_protocol);
-      self->priv->introspection_call =
-          tp_cli_connection_manager_call_get_parameters (self, -1,
-              next_protocol, tp_connection_manager_got_parameters,
-              next_protocol, g_free, NULL);
+      g_assert (self->priv->parameters_calls == NULL);
+      self->priv->parameters_calls = g_hash_table_new_full (g_str_hash,
+          g_str_equal, g_free, NULL);
+
+      for (i = 0; i < self->priv->pending_protocols->len; i++)
+        {
+          gchar *next_protocol = g_ptr_array_index (
+              self->priv->pending_protocols, i);
+
+          DEBUG ("%s/%s: calling legacy GetParameters",
+              self->name, next_protocol);
+
+          /* steals @next_protocol */
+          g_hash_table_insert (self->priv->parameters_calls, next_protocol,
+              tp_cli_connection_manager_call_get_parameters (self, -1,
+                  next_protocol, tp_connection_manager_got_parameters,
+                  g_strdup (next_protocol), g_free, NULL));
+        }
+
+      g_ptr_array_set_size (self->priv->pending_protocols, 0);
     }
 }
 
@@ -1040,39 +1100,36 @@ tp_connection_manager_name_owner_changed_cb (TpDBusDaemon *bus,
   g_object_unref (self);
 }
 
-static gboolean
-tp_connection_manager_read_file (TpDBusDaemon *dbus_daemon,
-    const gchar *cm_name,
+/* Returns a map from protocol name to immutable properties */
+static GHashTable *
+tp_connection_manager_parse_file (const gchar *cm_name,
     const gchar *filename,
-    GHashTable **protocols_out,
     GStrv *interfaces_out,
     GError **error)
 {
   GKeyFile *file;
   gchar **groups = NULL;
   gchar **group;
-  TpProtocol *proto_object;
-  GHashTable *protocols = NULL;
-  GStrv interfaces = NULL;
+  GHashTable *protocols;
 
   file = g_key_file_new ();
 
   if (!g_key_file_load_from_file (file, filename, G_KEY_FILE_NONE, error))
-    return FALSE;
+    {
+      g_key_file_free (file);
+      return NULL;
+    }
 
   /* if missing, it's not an error, so ignore @error */
-  interfaces = g_key_file_get_string_list (file, "ConnectionManager",
+  *interfaces_out = g_key_file_get_string_list (file, "ConnectionManager",
       "Interfaces", NULL, NULL);
 
   protocols = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
-      g_object_unref);
+      (GDestroyNotify) g_hash_table_unref);
 
   groups = g_key_file_get_groups (file, NULL);
 
-  if (groups == NULL)
-    goto success;
-
-  for (group = groups; *group != NULL; group++)
+  for (group = groups; group != NULL && *group != NULL; group++)
     {
       gchar *name;
       GHashTable *immutables;
@@ -1083,19 +1140,64 @@ tp_connection_manager_read_file (TpDBusDaemon *dbus_daemon,
       if (immutables == NULL)
         continue;
 
-      proto_object = tp_protocol_new (dbus_daemon, cm_name, name,
-          immutables, NULL);
-      g_assert (proto_object != NULL);
-
-      /* steals @name */
-      g_hash_table_insert (protocols, name, proto_object);
-
-      g_hash_table_unref (immutables);
+      /* steals @name and @immutables */
+      g_hash_table_insert (protocols, name, immutables);
     }
 
-success:
   g_strfreev (groups);
   g_key_file_free (file);
+  return protocols;
+}
+
+static gboolean
+tp_connection_manager_read_file (TpDBusDaemon *dbus_daemon,
+    const gchar *cm_name,
+    const gchar *filename,
+    GHashTable **protocols_out,
+    GStrv *interfaces_out,
+    GError **error)
+{
+  TpManagerFileStamp stamp;
+  gboolean have_stamp;
+  GHashTable *immutables_by_name = NULL;
+  GHashTable *protocols;
+  GStrv interfaces = NULL;
+  GHashTableIter iter;
+  gpointer k, v;
+
+  have_stamp = _tp_manager_file_stamp (filename, &stamp);
+
+  if (!have_stamp ||
+      !_tp_manager_file_cache_lookup (cm_name, filename, &stamp,
+        &immutables_by_name, &interfaces))
+    {
+      immutables_by_name = tp_connection_manager_parse_file (cm_name,
+          filename, &interfaces, error);
+
+      if (immutables_by_name == NULL)
+        return FALSE;
+
+      if (have_stamp)
+        _tp_manager_file_cache_store (cm_name, filename, &stamp,
+            immutables_by_name, (const gchar * const *) interfaces);
+    }
+
+  protocols = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      g_object_unref);
+
+  g_hash_table_iter_init (&iter, immutables_by_name);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      TpProtocol *proto_object;
+
+      proto_object = tp_protocol_new (dbus_daemon, cm_name, k, v, NULL);
+      g_assert (proto_object != NULL);
+
+      g_hash_table_insert (protocols, g_strdup (k), proto_object);
+    }
+
+  g_hash_table_unref (immutables_by_name);
 
   if (protocols_out != NULL)
     *protocols_out = protocols;
@@ -1241,6 +1343,8 @@ tp_connection_manager_constructor (GType type,
   g_return_val_if_fail (object_path != NULL, NULL);
   g_return_val_if_fail (bus_name != NULL, NULL);
 
+  self->priv->construct_time = g_get_monotonic_time ();
+
   /* Watch my D-Bus name */
   tp_dbus_daemon_watch_name_owner (as_proxy->dbus_daemon,
       as_proxy->bus_name, tp_connection_manager_name_owner_changed_cb, self,
@@ -1324,6 +1428,8 @@ tp_connection_manager_finalize (GObject *object)
       g_ptr_array_unref (self->priv->pending_protocols);
     }
 
+  tp_clear_pointer (&self->priv->parameters_calls, g_hash_table_unref);
+
   G_OBJECT_CLASS (tp_connection_manager_parent_class)->finalize (object);
 }
 
@@ -1752,6 +1858,11 @@ typedef struct
   size_t base_len;
   gsize refcount;
   gsize cms_to_ready;
+  /* borrowed CMs from arr that will have to be introspected over D-Bus,
+   * and haven't been started yet */
+  GQueue to_introspect;
+  /* how many CMs from arr are being introspected over D-Bus right now */
+  guint introspecting;
   unsigned getting_names:1;
   unsigned had_weak_object:1;
 } _ListContext;
@@ -1813,6 +1924,41 @@ all_cms_prepared (_ListContext *list_context)
   list_context->callback = NULL;
 }
 
+/* How many CMs we introspect over D-Bus at a time while listing them.
+ * CMs with a .manager file become ready from that (or its cache) without
+ * talking to the CM, so they are all started at once; the rest have to be
+ * introspected, and maybe activated for that, and doing dozens of those at
+ * once doesn't make any of them ready sooner. */
+#define MAX_CONCURRENT_CM_INTROSPECTIONS 4
+
+static void tp_list_connection_managers_cm_prepared (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data);
+static void tp_list_connection_managers_cm_introspected (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data);
+
+static gboolean
+list_context_cm_needs_introspection (TpConnectionManager *cm)
+{
+  return (cm->always_introspect ||
+      cm->priv->manager_file == NULL ||
+      cm->priv->manager_file[0] == '\0');
+}
+
+static void
+list_context_introspect_next (_ListContext *list_context)
+{
+  TpConnectionManager *cm = g_queue_pop_head (&list_context->to_introspect);
+
+  g_assert (cm != NULL);
+  list_context->introspecting++;
+
+  DEBUG ("  preparing %s by introspection", cm->name);
+  tp_proxy_prepare_async (cm, NULL,
+      tp_list_connection_managers_cm_introspected, list_context);
+}
+
 static void
 tp_list_connection_managers_cm_prepared (GObject *source,
     GAsyncResult *result,
@@ -1850,6 +1996,23 @@ tp_list_connection_managers_cm_prepared (GObject *source,
   list_context_unref (list_context);
 }
 
+static void
+tp_list_connection_managers_cm_introspected (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  _ListContext *list_context = user_data;
+
+  g_assert (list_context->introspecting > 0);
+  list_context->introspecting--;
+
+  /* start the next one before we (maybe) drop the last ref */
+  if (!g_queue_is_empty (&list_context->to_introspect))
+    list_context_introspect_next (list_context);
+
+  tp_list_connection_managers_cm_prepared (source, result, user_data);
+}
+
 static void
 tp_list_connection_managers_got_names (TpDBusDaemon *bus_daemon,
                                        const gchar * const *names,
@@ -1924,14 +2087,27 @@ tp_list_connection_managers_got_names (TpDBusDaemon *bus_daemon,
           return;
         }
 
-      for (i = 0; i < list_context->cms_to_ready; i++)
+      for (i = 0; i < list_context->arr->len; i++)
         {
           TpConnectionManager *cm = g_ptr_array_index (list_context->arr, i);
 
-          DEBUG ("  preparing %s", cm->name);
-          tp_proxy_prepare_async (cm, NULL,
-              tp_list_connection_managers_cm_prepared, list_context);
+          if (list_context_cm_needs_introspection (cm))
+            {
+              g_queue_push_tail (&list_context->to_introspect, cm);
+            }
+          else
+            {
+              DEBUG ("  preparing %s from %s", cm->name,
+                  cm->priv->manager_file);
+              tp_proxy_prepare_async (cm, NULL,
+                  tp_list_connection_managers_cm_prepared, list_context);
+            }
         }
+
+      /* the rest are started as these finish */
+      while (list_context->introspecting < MAX_CONCURRENT_CM_INTROSPECTIONS &&
+          !g_queue_is_empty (&list_context->to_introspect))
+        list_context_introspect_next (list_context);
     }
   else
     {
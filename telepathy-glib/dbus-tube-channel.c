@@ -79,6 +79,9 @@
  * Since: 0.18.0
  */
 
+/* memfd_create(2) and file sealing are GNU extensions */
+#define _GNU_SOURCE
+
 #include "config.h"
 
 #include "telepathy-glib/dbus-tube-channel.h"
@@ -102,6 +105,26 @@
 #include <stdio.h>
 #include <glib/gstdio.h>
 
+#ifdef HAVE_GIO_UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include <gio/gunixfdlist.h>
+#endif
+
+#if defined(HAVE_GIO_UNIX) && defined(HAVE_MEMFD_CREATE)
+# define USE_MEMFD 1
+#endif
+
+/* Payloads smaller than this are cheaper to copy into the message than to
+ * pass out-of-band: creating, sealing and mapping a file costs a handful of
+ * syscalls on each side. */
+#define PAYLOAD_MEMFD_THRESHOLD (64 * 1024)
+
 G_DEFINE_TYPE (TpDBusTubeChannel, tp_dbus_tube_channel, TP_TYPE_CHANNEL)
 
 struct _TpDBusTubeChannelPrivate
@@ -111,6 +134,7 @@ struct _TpDBusTubeChannelPrivate
 
   GSimpleAsyncResult *result;
   gchar *address;
+  guint socket_buffer_size;
 };
 
 enum
@@ -190,7 +214,7 @@ dbus_connection_new_cb (GObject *source,
   GDBusConnection *conn;
   GError *error = NULL;
 
-  conn = g_dbus_connection_new_for_address_finish (result, &error);
+  conn = g_dbus_connection_new_finish (result, &error);
   if (conn == NULL)
     {
       DEBUG ("Failed to create GDBusConnection: %s", error->message);
@@ -205,6 +229,61 @@ dbus_connection_new_cb (GObject *source,
   complete_operation (self);
 }
 
+static void
+set_socket_buffer_size (GSocket *socket_,
+    guint size)
+{
+#ifdef HAVE_GIO_UNIX
+  gint value = MIN (size, G_MAXINT);
+  GError *error = NULL;
+
+  /* The kernel is free to round or cap these; failing to set them only
+   * costs us some throughput, so don't fail the tube over it */
+  if (!g_socket_set_option (socket_, SOL_SOCKET, SO_SNDBUF, value, &error))
+    {
+      DEBUG ("Failed to set SO_SNDBUF to %d: %s", value, error->message);
+      g_clear_error (&error);
+    }
+
+  if (!g_socket_set_option (socket_, SOL_SOCKET, SO_RCVBUF, value, &error))
+    {
+      DEBUG ("Failed to set SO_RCVBUF to %d: %s", value, error->message);
+      g_clear_error (&error);
+    }
+#endif
+}
+
+static void
+address_get_stream_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  TpDBusTubeChannel *self = user_data;
+  GIOStream *stream;
+  GError *error = NULL;
+
+  stream = g_dbus_address_get_stream_finish (result, NULL, &error);
+  if (stream == NULL)
+    {
+      DEBUG ("Failed to connect to %s: %s", self->priv->address,
+          error->message);
+      g_simple_async_result_take_error (self->priv->result, error);
+      complete_operation (self);
+      return;
+    }
+
+  if (self->priv->socket_buffer_size != 0 &&
+      G_IS_SOCKET_CONNECTION (stream))
+    set_socket_buffer_size (
+        g_socket_connection_get_socket (G_SOCKET_CONNECTION (stream)),
+        self->priv->socket_buffer_size);
+
+  g_dbus_connection_new (stream, NULL,
+      G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT, NULL,
+      NULL, dbus_connection_new_cb, self);
+  g_object_unref (stream);
+}
+
 static void
 check_tube_open (TpDBusTubeChannel *self)
 {
@@ -220,9 +299,10 @@ check_tube_open (TpDBusTubeChannel *self)
   DEBUG ("Tube %s opened: %s", tp_proxy_get_object_path (self),
       self->priv->address);
 
-  g_dbus_connection_new_for_address (self->priv->address,
-      G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT, NULL,
-      NULL, dbus_connection_new_cb, self);
+  /* Connect by hand rather than with g_dbus_connection_new_for_address() so
+   * that we can tune the socket before GDBus starts using it */
+  g_dbus_address_get_stream (self->priv->address, NULL,
+      address_get_stream_cb, self);
 }
 
 static void
@@ -821,3 +901,323 @@ tp_dbus_tube_channel_accept_finish (TpDBusTubeChannel *self,
   _tp_implement_finish_return_copy_pointer (self,
       tp_dbus_tube_channel_accept_async, g_object_ref)
 }
+
+/**
+ * tp_dbus_tube_channel_set_socket_buffer_size:
+ * @self: a #TpDBusTubeChannel
+ * @size: the size in bytes to request for the socket's send and receive
+ *  buffers, or 0 to use the operating system's default
+ *
+ * Tune the socket underlying the #GDBusConnection returned by
+ * tp_dbus_tube_channel_offer_finish() or tp_dbus_tube_channel_accept_finish().
+ * This must be called before offering or accepting the tube.
+ *
+ * #GDBusConnection writes queued messages from its worker thread as fast as
+ * the socket will take them, so a larger buffer lets a burst of messages
+ * through in fewer wake-ups on each side of the tube, at the cost of some
+ * memory. The operating system may round or cap @size.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_dbus_tube_channel_set_socket_buffer_size (TpDBusTubeChannel *self,
+    guint size)
+{
+  g_return_if_fail (TP_IS_DBUS_TUBE_CHANNEL (self));
+  g_return_if_fail (self->priv->result == NULL);
+  g_return_if_fail (self->priv->address == NULL);
+
+  self->priv->socket_buffer_size = size;
+}
+
+#ifdef USE_MEMFD
+static gint
+append_sealed_memfd (GBytes *bytes,
+    GUnixFDList *fd_list)
+{
+  const gchar *data;
+  gsize size, written = 0;
+  gint fd, handle = -1;
+  GError *error = NULL;
+
+  data = g_bytes_get_data (bytes, &size);
+
+  fd = memfd_create ("tp-dbus-tube-payload", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0)
+    {
+      DEBUG ("memfd_create() failed: %s", g_strerror (errno));
+      return -1;
+    }
+
+  while (written < size)
+    {
+      gssize ret = write (fd, data + written, size - written);
+
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          DEBUG ("Failed to fill memfd: %s", g_strerror (errno));
+          goto out;
+        }
+
+      written += ret;
+    }
+
+#ifdef F_ADD_SEALS
+  /* The receiver will only map the file if it can't change under its feet */
+  if (fcntl (fd, F_ADD_SEALS,
+        F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+    DEBUG ("Failed to seal memfd: %s", g_strerror (errno));
+#endif
+
+  handle = g_unix_fd_list_append (fd_list, fd, &error);
+  if (handle < 0)
+    {
+      DEBUG ("Failed to append memfd to fd list: %s", error->message);
+      g_error_free (error);
+    }
+
+out:
+  close (fd);
+  return handle;
+}
+#endif
+
+/**
+ * tp_dbus_tube_payload_new:
+ * @connection: the #GDBusConnection of a D-Bus tube
+ * @bytes: the data to send
+ * @same_host: %TRUE if the process reading from the other end of
+ *  @connection's socket is the final recipient of the payload
+ * @fd_list: (allow-none): the #GUnixFDList which will be sent along with the
+ *  message carrying the payload, or %NULL
+ *
+ * Wrap @bytes in a #GVariant of type "v" suitable for sending over
+ * @connection, to be unpacked on the other side with
+ * tp_dbus_tube_payload_dup_bytes().
+ *
+ * By default, the payload is copied into the variant as a byte array.
+ *
+ * A connection manager normally relays a tube to a contact elsewhere, and
+ * cannot forward file descriptors, so passing them would break the tube.
+ * If the caller knows that is not the case, for instance because the
+ * connection manager consumes the messages itself, it can set @same_host.
+ * Large payloads are then written once to a sealed memory file which is
+ * attached to @fd_list, and the variant only holds its handle; the receiver
+ * maps the file rather than copying the data through the D-Bus tube. This
+ * also requires @fd_list not to be %NULL, @connection to be able to pass
+ * file descriptors and the operating system to support memfd_create();
+ * otherwise the payload is copied after all.
+ *
+ * Returns: (transfer none): a new floating #GVariant of type "v"
+ *
+ * Since: 0.UNRELEASED
+ */
+GVariant *
+tp_dbus_tube_payload_new (GDBusConnection *connection,
+    GBytes *bytes,
+    gboolean same_host,
+    GUnixFDList *fd_list)
+{
+  g_return_val_if_fail (G_IS_DBUS_CONNECTION (connection), NULL);
+  g_return_val_if_fail (bytes != NULL, NULL);
+
+#ifdef USE_MEMFD
+  if (same_host && fd_list != NULL &&
+      g_bytes_get_size (bytes) >= PAYLOAD_MEMFD_THRESHOLD &&
+      (g_dbus_connection_get_capabilities (connection) &
+       G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING) != 0)
+    {
+      gint handle = append_sealed_memfd (bytes, fd_list);
+
+      if (handle >= 0)
+        return g_variant_new_variant (g_variant_new_handle (handle));
+    }
+#endif
+
+  return g_variant_new_variant (g_variant_new_from_bytes (
+        G_VARIANT_TYPE_BYTESTRING, bytes, TRUE));
+}
+
+#ifdef HAVE_GIO_UNIX
+typedef struct {
+    gpointer data;
+    gsize size;
+} MappedPayload;
+
+static void
+mapped_payload_free (gpointer p)
+{
+  MappedPayload *mapped = p;
+
+  munmap (mapped->data, mapped->size);
+  g_slice_free (MappedPayload, mapped);
+}
+
+static GBytes *
+read_fd_contents (gint fd,
+    gsize size,
+    GError **error)
+{
+  gchar *data = g_malloc (size);
+  gsize done = 0;
+
+  while (done < size)
+    {
+      gssize ret = pread (fd, data + done, size - done, done);
+
+      if (ret < 0)
+        {
+          gint errsv = errno;
+
+          if (errsv == EINTR)
+            continue;
+
+          g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+              "Failed to read D-Bus tube payload: %s", g_strerror (errsv));
+          g_free (data);
+          return NULL;
+        }
+
+      if (ret == 0)
+        break;
+
+      done += ret;
+    }
+
+  return g_bytes_new_take (data, done);
+}
+
+static GBytes *
+dup_fd_payload (gint32 handle,
+    GUnixFDList *fd_list,
+    GError **error)
+{
+  GBytes *ret = NULL;
+  struct stat st;
+  gint fd;
+#ifdef F_GET_SEALS
+  gint seals;
+#endif
+
+  if (fd_list == NULL || handle < 0 ||
+      handle >= g_unix_fd_list_get_length (fd_list))
+    {
+      g_set_error (error, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
+          "D-Bus tube payload refers to file descriptor %d, which was not "
+          "received", handle);
+      return NULL;
+    }
+
+  fd = g_unix_fd_list_get (fd_list, handle, error);
+  if (fd < 0)
+    return NULL;
+
+  if (fstat (fd, &st) < 0)
+    {
+      gint errsv = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+          "Failed to stat D-Bus tube payload: %s", g_strerror (errsv));
+      goto out;
+    }
+
+  if (st.st_size == 0)
+    {
+      ret = g_bytes_new (NULL, 0);
+      goto out;
+    }
+
+#ifdef F_GET_SEALS
+  /* Only map the file if the sender can't truncate it, which would get us
+   * SIGBUS, or modify it after the fact. */
+  seals = fcntl (fd, F_GET_SEALS);
+
+  if (seals >= 0 &&
+      (seals & (F_SEAL_SHRINK | F_SEAL_WRITE)) ==
+      (F_SEAL_SHRINK | F_SEAL_WRITE))
+    {
+      gpointer data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (data != MAP_FAILED)
+        {
+          MappedPayload *mapped = g_slice_new (MappedPayload);
+
+          mapped->data = data;
+          mapped->size = st.st_size;
+          ret = g_bytes_new_with_free_func (data, st.st_size,
+              mapped_payload_free, mapped);
+          goto out;
+        }
+
+      DEBUG ("Failed to map D-Bus tube payload: %s", g_strerror (errno));
+    }
+#endif
+
+  ret = read_fd_contents (fd, st.st_size, error);
+
+out:
+  close (fd);
+  return ret;
+}
+#endif
+
+/**
+ * tp_dbus_tube_payload_dup_bytes:
+ * @payload: a #GVariant of type "v" created by tp_dbus_tube_payload_new()
+ * @fd_list: (allow-none): the #GUnixFDList received along with the message
+ *  carrying @payload, as returned by g_dbus_message_get_unix_fd_list(), or
+ *  %NULL
+ * @error: a #GError to fill
+ *
+ * Unpack a payload sent with tp_dbus_tube_payload_new(). If the payload was
+ * passed as a sealed memory file, the returned #GBytes maps that file
+ * directly; otherwise it refers to the data inside @payload.
+ *
+ * Returns: (transfer full): the payload's contents, or %NULL if @payload is
+ *  malformed or refers to a file descriptor which can't be read
+ *
+ * Since: 0.UNRELEASED
+ */
+GBytes *
+tp_dbus_tube_payload_dup_bytes (GVariant *payload,
+    GUnixFDList *fd_list,
+    GError **error)
+{
+  GVariant *inner;
+  GBytes *ret = NULL;
+
+  g_return_val_if_fail (payload != NULL, NULL);
+
+  if (!g_variant_is_of_type (payload, G_VARIANT_TYPE_VARIANT))
+    {
+      g_set_error (error, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
+          "D-Bus tube payload must be of type 'v', not '%s'",
+          g_variant_get_type_string (payload));
+      return NULL;
+    }
+
+  inner = g_variant_get_variant (payload);
+
+  if (g_variant_is_of_type (inner, G_VARIANT_TYPE_BYTESTRING))
+    {
+      ret = g_variant_get_data_as_bytes (inner);
+    }
+#ifdef HAVE_GIO_UNIX
+  else if (g_variant_is_of_type (inner, G_VARIANT_TYPE_HANDLE))
+    {
+      ret = dup_fd_payload (g_variant_get_handle (inner), fd_list, error);
+    }
+#endif
+  else
+    {
+      g_set_error (error, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
+          "Unsupported D-Bus tube payload of type '%s'",
+          g_variant_get_type_string (inner));
+    }
+
+  g_variant_unref (inner);
+  return ret;
+}
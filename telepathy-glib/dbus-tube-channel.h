@@ -97,6 +97,23 @@ GDBusConnection * tp_dbus_tube_channel_accept_finish (TpDBusTubeChannel *self,
     GAsyncResult *result,
     GError **error) G_GNUC_WARN_UNUSED_RESULT;
 
+/* Tuning and large payloads */
+
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_dbus_tube_channel_set_socket_buffer_size (TpDBusTubeChannel *self,
+    guint size);
+
+_TP_AVAILABLE_IN_UNRELEASED
+GVariant *tp_dbus_tube_payload_new (GDBusConnection *connection,
+    GBytes *bytes,
+    gboolean same_host,
+    GUnixFDList *fd_list);
+
+_TP_AVAILABLE_IN_UNRELEASED
+GBytes *tp_dbus_tube_payload_dup_bytes (GVariant *payload,
+    GUnixFDList *fd_list,
+    GError **error) G_GNUC_WARN_UNUSED_RESULT;
+
 G_END_DECLS
 
 #endif
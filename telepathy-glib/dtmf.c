@@ -176,18 +176,36 @@ _tp_dtmf_char_classify (gchar c)
  * The #TpDTMFPlayer::finished signal indicates that the current sequence
  * of tones has finished.
  *
+ * All the #TpDTMFPlayer<!-- -->s in a process share a single timer, which
+ * is attached to the global default #GMainContext (as g_timeout_add() would
+ * be), whatever the thread-default main context was when
+ * tp_dtmf_player_play() was called. Each tone, gap and pause is timed from
+ * when the previous one was due to end, rather than from when the main loop
+ * got round to ending it, so main loop latency does not accumulate over a
+ * sequence; tp_dtmf_player_get_event_time() gives the time at which the
+ * event being signalled was due.
+ *
  * Since: 0.13.3
  */
 
 G_DEFINE_TYPE (TpDTMFPlayer, tp_dtmf_player, G_TYPE_OBJECT)
 
+typedef struct _Scheduler Scheduler;
+
 struct _TpDTMFPlayerPrivate
 {
   /* owned, or NULL */
   gchar *dialstring;
   /* a pointer into dialstring, or NULL */
   const gchar *dialstring_remaining;
-  guint timer_id;
+  /* the (only) scheduler, or NULL if we're not playing */
+  Scheduler *scheduler;
+  /* our position in scheduler->players, or NULL if we're not waiting */
+  GSequenceIter *scheduled;
+  /* monotonic time at which the next event is due, if scheduled */
+  gint64 deadline;
+  /* monotonic time at which the current event was due */
+  gint64 event_time;
   guint tone_ms;
   guint gap_ms;
   guint pause_ms;
@@ -200,6 +218,231 @@ static guint sig_id_stopped_tone;
 static guint sig_id_finished;
 static guint sig_id_tones_deferred;
 
+/* Exists while any TpDTMFPlayer is playing: a single GSource in the default
+ * main context whose ready time is the earliest deadline of any of them.
+ * This avoids having a timeout per player in a gateway with many calls. */
+struct _Scheduler {
+    GSource source;
+    /* borrowed TpDTMFPlayer, sorted by deadline */
+    GSequence *players;
+    /* number of players using this scheduler, whether or not they are
+     * waiting for a deadline */
+    guint n_players;
+    gboolean dispatching;
+};
+
+/* borrowed, or NULL if no player is playing */
+static Scheduler *the_scheduler = NULL;
+G_LOCK_DEFINE_STATIC (the_scheduler);
+
+static void tp_dtmf_player_step (TpDTMFPlayer *self);
+
+static gint
+compare_deadlines (gconstpointer a,
+    gconstpointer b,
+    gpointer user_data G_GNUC_UNUSED)
+{
+  const TpDTMFPlayer *pa = a;
+  const TpDTMFPlayer *pb = b;
+
+  if (pa->priv->deadline < pb->priv->deadline)
+    return -1;
+
+  if (pa->priv->deadline > pb->priv->deadline)
+    return 1;
+
+  return 0;
+}
+
+static void
+scheduler_update_ready_time (Scheduler *scheduler)
+{
+  GSequenceIter *first = g_sequence_get_begin_iter (scheduler->players);
+
+  if (g_sequence_iter_is_end (first))
+    {
+      g_source_set_ready_time ((GSource *) scheduler, -1);
+    }
+  else
+    {
+      TpDTMFPlayer *player = g_sequence_get (first);
+
+      g_source_set_ready_time ((GSource *) scheduler, player->priv->deadline);
+    }
+}
+
+static gboolean
+scheduler_dispatch (GSource *source,
+    GSourceFunc callback G_GNUC_UNUSED,
+    gpointer user_data G_GNUC_UNUSED)
+{
+  Scheduler *scheduler = (Scheduler *) source;
+  gint64 now = g_source_get_time (source);
+
+  G_LOCK (the_scheduler);
+  scheduler->dispatching = TRUE;
+  G_UNLOCK (the_scheduler);
+
+  /* Players can be cancelled, or start playing, as a side-effect of
+   * signals emitted by other players, so look at the head again each
+   * time. Anything newly scheduled is in the future, so this terminates. */
+  while (!g_sequence_iter_is_end (g_sequence_get_begin_iter (
+          scheduler->players)))
+    {
+      GSequenceIter *first = g_sequence_get_begin_iter (scheduler->players);
+      TpDTMFPlayer *player = g_sequence_get (first);
+
+      if (player->priv->deadline > now)
+        break;
+
+      g_sequence_remove (first);
+      player->priv->scheduled = NULL;
+
+      /* The event happens when it was due, not now: that's what stops
+       * latency accumulating over a sequence. */
+      player->priv->event_time = player->priv->deadline;
+
+      g_object_ref (player);
+      tp_dtmf_player_step (player);
+      g_object_unref (player);
+    }
+
+  G_LOCK (the_scheduler);
+  scheduler->dispatching = FALSE;
+
+  if (scheduler->n_players == 0)
+    {
+      the_scheduler = NULL;
+      G_UNLOCK (the_scheduler);
+
+      /* GLib holds a ref while we're dispatching */
+      g_source_destroy (source);
+      g_source_unref (source);
+      return FALSE;
+    }
+
+  G_UNLOCK (the_scheduler);
+
+  scheduler_update_ready_time (scheduler);
+  return TRUE;
+}
+
+static void
+scheduler_finalize (GSource *source)
+{
+  Scheduler *scheduler = (Scheduler *) source;
+
+  g_assert (g_sequence_iter_is_end (g_sequence_get_begin_iter (
+          scheduler->players)));
+  g_sequence_free (scheduler->players);
+}
+
+static GSourceFuncs scheduler_funcs = {
+    NULL, /* prepare: we only use the ready time */
+    NULL, /* check: likewise */
+    scheduler_dispatch,
+    scheduler_finalize
+};
+
+/* Called when @self starts playing */
+static void
+tp_dtmf_player_join_scheduler (TpDTMFPlayer *self)
+{
+  Scheduler *scheduler;
+
+  g_assert (self->priv->scheduler == NULL);
+
+  G_LOCK (the_scheduler);
+
+  if (the_scheduler == NULL)
+    {
+      the_scheduler = (Scheduler *) g_source_new (&scheduler_funcs,
+          sizeof (Scheduler));
+      the_scheduler->players = g_sequence_new (NULL);
+      g_source_set_priority ((GSource *) the_scheduler, G_PRIORITY_DEFAULT);
+      g_source_set_ready_time ((GSource *) the_scheduler, -1);
+      /* the global default context, like g_timeout_add() */
+      g_source_attach ((GSource *) the_scheduler, NULL);
+    }
+
+  /* count ourselves before letting go of the lock, so that another
+   * player leaving can't destroy the scheduler under our feet */
+  scheduler = the_scheduler;
+  scheduler->n_players++;
+  G_UNLOCK (the_scheduler);
+
+  self->priv->scheduler = scheduler;
+}
+
+static void
+tp_dtmf_player_unschedule (TpDTMFPlayer *self)
+{
+  if (self->priv->scheduled == NULL)
+    return;
+
+  g_sequence_remove (self->priv->scheduled);
+  self->priv->scheduled = NULL;
+
+  if (!self->priv->scheduler->dispatching)
+    scheduler_update_ready_time (self->priv->scheduler);
+}
+
+/* Called when @self stops playing */
+static void
+tp_dtmf_player_leave_scheduler (TpDTMFPlayer *self)
+{
+  Scheduler *scheduler = self->priv->scheduler;
+  gboolean last;
+
+  if (scheduler == NULL)
+    return;
+
+  tp_dtmf_player_unschedule (self);
+  self->priv->scheduler = NULL;
+
+  G_LOCK (the_scheduler);
+  g_assert (scheduler->n_players > 0);
+
+  /* if we're dispatching, scheduler_dispatch() cleans up */
+  last = (--scheduler->n_players == 0 && !scheduler->dispatching);
+
+  if (last)
+    the_scheduler = NULL;
+
+  G_UNLOCK (the_scheduler);
+
+  if (last)
+    {
+      g_source_destroy ((GSource *) scheduler);
+      g_source_unref ((GSource *) scheduler);
+    }
+}
+
+/* Arrange for tp_dtmf_player_step() to be called @ms milliseconds after
+ * the current event */
+static void
+tp_dtmf_player_schedule (TpDTMFPlayer *self,
+    guint ms)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  g_assert (self->priv->scheduler != NULL);
+  g_assert (self->priv->scheduled == NULL);
+
+  self->priv->deadline = self->priv->event_time + (gint64) ms * 1000;
+
+  /* If we're so far behind that even the next event is overdue, start
+   * again from now, rather than cutting tones short to catch up. */
+  if (self->priv->deadline < now)
+    self->priv->deadline = now + (gint64) ms * 1000;
+
+  self->priv->scheduled = g_sequence_insert_sorted (
+      self->priv->scheduler->players, self, compare_deadlines, NULL);
+
+  if (!self->priv->scheduler->dispatching)
+    scheduler_update_ready_time (self->priv->scheduler);
+}
+
 static void
 tp_dtmf_player_emit_started_tone (TpDTMFPlayer *self,
     TpDTMFEvent tone)
@@ -250,27 +493,28 @@ tp_dtmf_player_cancel (TpDTMFPlayer *self)
 {
   g_return_if_fail (TP_IS_DTMF_PLAYER (self));
 
-  if (self->priv->timer_id != 0)
+  if (self->priv->scheduled != NULL)
     {
+      tp_dtmf_player_unschedule (self);
+
+      /* the tone is cut short now, not when it was due to end */
+      self->priv->event_time = g_get_monotonic_time ();
       tp_dtmf_player_maybe_emit_stopped_tone (self);
       tp_dtmf_player_emit_finished (self, TRUE);
-
-      g_source_remove (self->priv->timer_id);
-      self->priv->timer_id = 0;
     }
 
+  tp_dtmf_player_leave_scheduler (self);
   tp_clear_pointer (&self->priv->dialstring, g_free);
 }
 
-static gboolean
-tp_dtmf_player_timer_cb (gpointer data)
+/* Called at the end of each tone, gap or pause, with event_time set to
+ * when it was due to end */
+static void
+tp_dtmf_player_step (TpDTMFPlayer *self)
 {
-  TpDTMFPlayer *self = data;
   gboolean was_playing = self->priv->playing_tone;
   gboolean was_paused = self->priv->paused;
 
-  self->priv->timer_id = 0;
-
   tp_dtmf_player_maybe_emit_stopped_tone (self);
 
   if ((was_playing || was_paused) &&
@@ -285,7 +529,7 @@ tp_dtmf_player_timer_cb (gpointer data)
       /* die of natural causes */
       tp_dtmf_player_emit_finished (self, FALSE);
       tp_dtmf_player_cancel (self);
-      return FALSE;
+      return;
     }
 
   switch (_tp_dtmf_char_classify (*self->priv->dialstring_remaining))
@@ -294,8 +538,7 @@ tp_dtmf_player_timer_cb (gpointer data)
         if (was_playing)
           {
             /* Play a gap (short silence) before the next tone */
-            self->priv->timer_id = g_timeout_add (self->priv->gap_ms,
-                tp_dtmf_player_timer_cb, self);
+            tp_dtmf_player_schedule (self, self->priv->gap_ms);
           }
         else
           {
@@ -303,8 +546,10 @@ tp_dtmf_player_timer_cb (gpointer data)
              * Play the tone straight away. */
             tp_dtmf_player_emit_started_tone (self,
                 _tp_dtmf_char_to_event (*self->priv->dialstring_remaining));
-            self->priv->timer_id = g_timeout_add (self->priv->tone_ms,
-                tp_dtmf_player_timer_cb, self);
+
+            /* the signal handler might have cancelled us */
+            if (self->priv->scheduler != NULL)
+              tp_dtmf_player_schedule (self, self->priv->tone_ms);
           }
         break;
 
@@ -312,8 +557,7 @@ tp_dtmf_player_timer_cb (gpointer data)
         /* Pause, typically for 3 seconds. We don't need to have a gap
          * first. */
         self->priv->paused = TRUE;
-        self->priv->timer_id = g_timeout_add (self->priv->pause_ms,
-            tp_dtmf_player_timer_cb, self);
+        tp_dtmf_player_schedule (self, self->priv->pause_ms);
         break;
 
       case DTMF_CHAR_CLASS_WAIT_FOR_USER:
@@ -332,8 +576,6 @@ tp_dtmf_player_timer_cb (gpointer data)
       default:
         g_assert_not_reached ();
     }
-
-  return FALSE;
 }
 
 /**
@@ -391,7 +633,7 @@ tp_dtmf_player_play (TpDTMFPlayer *self,
       return FALSE;
     }
 
-  g_assert (self->priv->timer_id == 0);
+  g_assert (self->priv->scheduler == NULL);
 
   for (i = 0; tones[i] != '\0'; i++)
     {
@@ -410,10 +652,13 @@ tp_dtmf_player_play (TpDTMFPlayer *self,
   self->priv->gap_ms = gap_ms;
   self->priv->pause_ms = pause_ms;
 
+  tp_dtmf_player_join_scheduler (self);
+
   /* start off the process: conceptually, this is the end of the zero-length
    * gap before the first tone */
   self->priv->playing_tone = FALSE;
-  tp_dtmf_player_timer_cb (self);
+  self->priv->event_time = g_get_monotonic_time ();
+  tp_dtmf_player_step (self);
   return TRUE;
 }
 
@@ -435,6 +680,35 @@ tp_dtmf_player_is_active (TpDTMFPlayer *self)
   return (self->priv->dialstring != NULL);
 }
 
+/**
+ * tp_dtmf_player_get_event_time:
+ * @self: a DTMF interpreter
+ *
+ * Return the time at which the event currently being signalled was due,
+ * in the same timebase as g_get_monotonic_time(). In handlers for
+ * #TpDTMFPlayer::started-tone, #TpDTMFPlayer::stopped-tone and
+ * #TpDTMFPlayer::finished, this is when the tone started or stopped as far
+ * as the dial string's timing is concerned, which may be slightly earlier
+ * than the current time if the main loop was busy; connection managers
+ * that timestamp DTMF events on the wire should use it.
+ *
+ * If the sequence was cancelled with tp_dtmf_player_cancel(), the time of
+ * the resulting #TpDTMFPlayer::stopped-tone and #TpDTMFPlayer::finished
+ * signals is the time of cancellation.
+ *
+ * Returns: a monotonic time in microseconds, or 0 if @self has never
+ *  played anything
+ *
+ * Since: 0.UNRELEASED
+ */
+gint64
+tp_dtmf_player_get_event_time (TpDTMFPlayer *self)
+{
+  g_return_val_if_fail (TP_IS_DTMF_PLAYER (self), 0);
+
+  return self->priv->event_time;
+}
+
 #define MY_PARENT_CLASS (tp_dtmf_player_parent_class)
 
 static void
@@ -446,7 +720,6 @@ tp_dtmf_player_init (TpDTMFPlayer *self)
   self->priv->dialstring = NULL;
   self->priv->dialstring_remaining = NULL;
   self->priv->playing_tone = FALSE;
-  self->priv->timer_id = 0;
 }
 
 static void
@@ -25,6 +25,7 @@
 #define __TP_DTMF_H__
 
 #include <glib-object.h>
+#include <telepathy-glib/defs.h>
 #include <telepathy-glib/enums.h>
 
 gchar tp_dtmf_event_to_char (TpDTMFEvent event);
@@ -73,4 +74,7 @@ gboolean tp_dtmf_player_is_active (TpDTMFPlayer *self);
 
 void tp_dtmf_player_cancel (TpDTMFPlayer *self);
 
+_TP_AVAILABLE_IN_UNRELEASED
+gint64 tp_dtmf_player_get_event_time (TpDTMFPlayer *self);
+
 #endif
@@ -72,7 +72,9 @@
  * tp_file_transfer_channel_provide_file_async() should be called.
  *
  * When an incoming File Transfer channel appears, one should call
- * tp_file_transfer_channel_accept_file_async().
+ * tp_file_transfer_channel_accept_file_async(), or
+ * tp_file_transfer_channel_resume_file_async() to continue a previously
+ * interrupted transfer of the same file.
  *
  * To cancel or reject a pending or ongoing file transfer, one should
  * close the channel using tp_channel_close_async().
@@ -102,6 +104,7 @@
 #include <telepathy-glib/gnio-util.h>
 #include <telepathy-glib/gtypes.h>
 #include <telepathy-glib/interfaces.h>
+#include <telepathy-glib/progress-throttle.h>
 #include <telepathy-glib/proxy-subclass.h>
 #include <telepathy-glib/proxy-internal.h>
 #include <telepathy-glib/util-internal.h>
@@ -111,6 +114,7 @@
 #include "telepathy-glib/automatic-client-factory-internal.h"
 #include "telepathy-glib/channel-internal.h"
 #include "telepathy-glib/debug-internal.h"
+#include "telepathy-glib/splice-internal.h"
 
 #include <stdio.h>
 #include <glib.h>
@@ -154,7 +158,9 @@ struct _TpFileTransferChannelPrivate
     GSocketAddress *remote_address;
     /* The value passed to Accept; this shouldn't be stored in
      * initial_offset as they can easily be different. */
-    guint requested_offset;
+    guint64 requested_offset;
+    /* Owns out_stream's fd when resuming a partial file */
+    GFileIOStream *resume_stream;
 
     TpSocketAddressType socket_type;
     TpSocketAccessControl access_control;
@@ -162,6 +168,10 @@ struct _TpFileTransferChannelPrivate
 
     GSimpleAsyncResult *result;
     GCancellable *cancellable;
+
+    /* Rate-limits notify::transferred-bytes, or NULL to notify for every
+     * TransferredBytesChanged signal */
+    TpProgressThrottle *progress;
 };
 
 enum /* properties */
@@ -217,12 +227,14 @@ splice_stream_ready_cb (GObject *output,
 {
   TpFileTransferChannel *self = user_data;
   GError *error = NULL;
+  gssize bytes;
 
-  g_output_stream_splice_finish (G_OUTPUT_STREAM (output), result,
-      &error);
+  bytes = _tp_splice_finish (G_OUTPUT_STREAM (output), result, &error);
 
   if (error != NULL && !g_cancellable_is_cancelled (self->priv->cancellable))
     DEBUG ("splice operation failed: %s", error->message);
+  else if (error == NULL)
+    DEBUG ("spliced %" G_GSSIZE_FORMAT " bytes", bytes);
   g_clear_error (&error);
 
   g_io_stream_close_async (self->priv->stream, G_PRIORITY_DEFAULT,
@@ -231,50 +243,59 @@ splice_stream_ready_cb (GObject *output,
   g_object_unref (self);
 }
 
+/* Something went wrong locally once the accept or provide operation had
+ * already finished, so there's no operation left to fail: stop the
+ * transfer by closing the channel, and report @error by invalidating it.
+ * Takes ownership of @error. */
 static void
-client_socket_connected (TpFileTransferChannel *self)
+transfer_failed (TpFileTransferChannel *self,
+    GError *error)
 {
-  GSocketConnection *conn;
-  GError *error = NULL;
+  DEBUG ("Transfer failed: %s", error->message);
 
-  conn = g_socket_connection_factory_create_connection (
-      self->priv->client_socket);
-  if (conn == NULL)
-    {
-      DEBUG ("Failed to create client connection");
-      return;
-    }
-
-  DEBUG ("File transfer socket connected");
+  if (self->priv->in_stream != NULL)
+    g_input_stream_close (self->priv->in_stream, NULL, NULL);
 
-#ifdef HAVE_GIO_UNIX
-  if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_CREDENTIALS)
-    {
-      guchar byte;
+  if (self->priv->resume_stream != NULL)
+    g_io_stream_close (G_IO_STREAM (self->priv->resume_stream), NULL, NULL);
+  else if (self->priv->out_stream != NULL)
+    g_output_stream_close (self->priv->out_stream, NULL, NULL);
 
-      byte = g_value_get_uchar (self->priv->access_control_param);
+  g_io_stream_close_async (self->priv->stream, G_PRIORITY_DEFAULT,
+      NULL, stream_close_cb, g_object_ref (self));
 
-      /* FIXME: we should an async version of this API (bgo #629503) */
-      if (!tp_unix_connection_send_credentials_with_byte (
-              conn, byte, NULL, &error))
-        {
-          DEBUG ("Failed to send credentials: %s", error->message);
-          g_object_unref (conn);
-          g_clear_error (&error);
-          return;
-        }
-    }
-#endif
+  tp_channel_close_async (TP_CHANNEL (self), NULL, NULL);
+  tp_proxy_invalidate ((TpProxy *) self, error);
+  g_error_free (error);
+}
 
-  self->priv->stream = G_IO_STREAM (conn);
+static void
+start_splicing (TpFileTransferChannel *self)
+{
+  GError *error = NULL;
 
   if (tp_channel_get_requested (TP_CHANNEL (self)))
     {
       GOutputStream *stream;
 
-      stream = g_io_stream_get_output_stream (G_IO_STREAM (conn));
+      /* The CM tells us where the receiver wants the data to start */
+      if (self->priv->initial_offset > 0)
+        {
+          DEBUG ("Sending file from offset %" G_GUINT64_FORMAT,
+              (guint64) self->priv->initial_offset);
+
+          if (!g_seekable_seek (G_SEEKABLE (self->priv->in_stream),
+                  self->priv->initial_offset, G_SEEK_SET, NULL, &error))
+            {
+              g_prefix_error (&error, "Failed to seek to initial offset: ");
+              transfer_failed (self, error);
+              return;
+            }
+        }
+
+      stream = g_io_stream_get_output_stream (self->priv->stream);
 
-      g_output_stream_splice_async (stream, self->priv->in_stream,
+      _tp_splice_async (stream, self->priv->in_stream,
           G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
           G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
           G_PRIORITY_DEFAULT, self->priv->cancellable,
@@ -284,9 +305,29 @@ client_socket_connected (TpFileTransferChannel *self)
     {
       GInputStream *stream;
 
-      stream = g_io_stream_get_input_stream (G_IO_STREAM (conn));
+      /* When resuming, the CM may not have accepted the offset we asked
+       * for, so throw away anything past the one it announced. */
+      if (self->priv->resume_stream != NULL)
+        {
+          GSeekable *seekable = G_SEEKABLE (self->priv->out_stream);
+
+          DEBUG ("Resuming file at offset %" G_GUINT64_FORMAT,
+              (guint64) self->priv->initial_offset);
+
+          if (!g_seekable_truncate (seekable, self->priv->initial_offset,
+                  NULL, &error) ||
+              !g_seekable_seek (seekable, self->priv->initial_offset,
+                  G_SEEK_SET, NULL, &error))
+            {
+              g_prefix_error (&error, "Failed to resume at initial offset: ");
+              transfer_failed (self, error);
+              return;
+            }
+        }
+
+      stream = g_io_stream_get_input_stream (self->priv->stream);
 
-      g_output_stream_splice_async (self->priv->out_stream, stream,
+      _tp_splice_async (self->priv->out_stream, stream,
           G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
           G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
           G_PRIORITY_DEFAULT, self->priv->cancellable,
@@ -294,6 +335,63 @@ client_socket_connected (TpFileTransferChannel *self)
     }
 }
 
+#ifdef HAVE_GIO_UNIX
+static void
+send_credentials_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  TpFileTransferChannel *self = user_data;
+  GError *error = NULL;
+
+  if (!tp_unix_connection_send_credentials_with_byte_finish (
+          G_SOCKET_CONNECTION (source), result, &error))
+    {
+      DEBUG ("Failed to send credentials: %s", error->message);
+      g_clear_error (&error);
+      goto out;
+    }
+
+  start_splicing (self);
+
+out:
+  g_object_unref (self);
+}
+#endif
+
+static void
+client_socket_connected (TpFileTransferChannel *self)
+{
+  GSocketConnection *conn;
+
+  conn = g_socket_connection_factory_create_connection (
+      self->priv->client_socket);
+  if (conn == NULL)
+    {
+      DEBUG ("Failed to create client connection");
+      return;
+    }
+
+  DEBUG ("File transfer socket connected");
+
+  self->priv->stream = G_IO_STREAM (conn);
+
+#ifdef HAVE_GIO_UNIX
+  if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_CREDENTIALS)
+    {
+      guchar byte;
+
+      byte = g_value_get_uchar (self->priv->access_control_param);
+
+      tp_unix_connection_send_credentials_with_byte_async (conn, byte,
+          self->priv->cancellable, send_credentials_cb, g_object_ref (self));
+      return;
+    }
+#endif
+
+  start_splicing (self);
+}
+
 static gboolean
 client_socket_cb (GSocket *socket,
     GIOCondition condition,
@@ -350,6 +448,13 @@ tp_file_transfer_channel_state_changed_cb (TpChannel *proxy,
       start_transfer (self);
     }
 
+  /* Make sure the final byte count is notified before the state, so
+   * nobody is left with a stale progress bar */
+  if (self->priv->progress != NULL &&
+      (state == TP_FILE_TRANSFER_STATE_COMPLETED ||
+       state == TP_FILE_TRANSFER_STATE_CANCELLED))
+    tp_progress_throttle_flush (self->priv->progress);
+
   g_object_notify (G_OBJECT (self), "state");
 }
 
@@ -374,6 +479,19 @@ tp_file_transfer_channel_transferred_bytes_changed_cb (TpChannel *proxy,
   TpFileTransferChannel *self = (TpFileTransferChannel *) proxy;
 
   self->priv->transferred_bytes = count;
+
+  if (self->priv->progress != NULL)
+    tp_progress_throttle_update (self->priv->progress, count);
+  else
+    g_object_notify (G_OBJECT (self), "transferred-bytes");
+}
+
+static void
+transferred_bytes_report_cb (guint64 value,
+    gpointer user_data)
+{
+  TpFileTransferChannel *self = user_data;
+
   g_object_notify (G_OBJECT (self), "transferred-bytes");
 }
 
@@ -738,6 +856,8 @@ tp_file_transfer_channel_dispose (GObject *obj)
 
   tp_clear_pointer (&self->priv->access_control_param, tp_g_value_slice_free);
   tp_clear_object (&self->priv->client_socket);
+  tp_clear_object (&self->priv->resume_stream);
+  tp_clear_pointer (&self->priv->progress, tp_progress_throttle_destroy);
 
   G_OBJECT_CLASS (tp_file_transfer_channel_parent_class)->dispose (obj);
 }
@@ -1196,11 +1316,17 @@ set_address_and_access_control (TpFileTransferChannel *self)
   switch (self->priv->access_control)
     {
       case TP_SOCKET_ACCESS_CONTROL_LOCALHOST:
-      case TP_SOCKET_ACCESS_CONTROL_CREDENTIALS:
         /* Dummy value */
         self->priv->access_control_param = tp_g_value_slice_new_uint (0);
         break;
 
+      case TP_SOCKET_ACCESS_CONTROL_CREDENTIALS:
+        /* ProvideFile and AcceptFile take a byte here, which we send
+         * along with our credentials; the upper bound is exclusive */
+        self->priv->access_control_param = tp_g_value_slice_new_byte (
+            g_random_int_range (0, G_MAXUINT8 + 1));
+        break;
+
       case TP_SOCKET_ACCESS_CONTROL_PORT:
         {
           GSocketAddress *addr;
@@ -1259,6 +1385,31 @@ file_transfer_set_uri_cb (TpProxy *proxy,
       G_OBJECT (self));
 }
 
+/* Takes ownership of @out_stream */
+static void
+accept_with_output_stream (TpFileTransferChannel *self,
+    GFile *file,
+    GOutputStream *out_stream)
+{
+  gchar *uri;
+  GValue *value;
+
+  self->priv->out_stream = out_stream;
+
+  g_clear_object (&self->priv->file);
+  self->priv->file = g_object_ref (file);
+
+  /* Try setting FileTransfer.URI before accepting the file */
+  uri = g_file_get_uri (file);
+  value = tp_g_value_slice_new_take_string (uri);
+
+  tp_cli_dbus_properties_call_set (self, -1,
+      TP_IFACE_CHANNEL_TYPE_FILE_TRANSFER, "URI", value,
+      file_transfer_set_uri_cb, NULL, NULL, G_OBJECT (self));
+
+  tp_g_value_slice_free (value);
+}
+
 static void
 file_replace_async_cb (GObject *source,
     GAsyncResult *result,
@@ -1267,9 +1418,7 @@ file_replace_async_cb (GObject *source,
   TpFileTransferChannel *self = user_data;
   GFile *file = G_FILE (source);
   GFileOutputStream *out_stream;
-  gchar *uri;
   GError *error = NULL;
-  GValue *value;
 
   out_stream = g_file_replace_finish (file, result, &error);
 
@@ -1280,20 +1429,42 @@ file_replace_async_cb (GObject *source,
       return;
     }
 
-  self->priv->out_stream = G_OUTPUT_STREAM (out_stream);
+  accept_with_output_stream (self, file, G_OUTPUT_STREAM (out_stream));
+}
 
-  g_clear_object (&self->priv->file);
-  self->priv->file = g_object_ref (file);
+static gboolean
+check_can_accept (TpFileTransferChannel *self,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  if (self->priv->access_control_param != NULL)
+    {
+      g_simple_async_report_error_in_idle (G_OBJECT (self), callback,
+          user_data, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
+          "Can't accept already accepted transfer");
 
-  /* Try setting FileTransfer.URI before accepting the file */
-  uri = g_file_get_uri (file);
-  value = tp_g_value_slice_new_take_string (uri);
+      return FALSE;
+    }
 
-  tp_cli_dbus_properties_call_set (self, -1,
-      TP_IFACE_CHANNEL_TYPE_FILE_TRANSFER, "URI", value,
-      file_transfer_set_uri_cb, NULL, NULL, G_OBJECT (self));
+  if (self->priv->state != TP_FILE_TRANSFER_STATE_PENDING)
+    {
+      g_simple_async_report_error_in_idle (G_OBJECT (self), callback,
+          user_data, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
+          "Can't accept a transfer that isn't pending");
 
-  tp_g_value_slice_free (value);
+      return FALSE;
+    }
+
+  if (tp_channel_get_requested (TP_CHANNEL (self)))
+    {
+      g_simple_async_report_error_in_idle (G_OBJECT (self), callback,
+          user_data, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
+          "Can't accept outgoing transfer");
+
+      return FALSE;
+    }
+
+  return TRUE;
 }
 
 /**
@@ -1322,60 +1493,187 @@ tp_file_transfer_channel_accept_file_async (TpFileTransferChannel *self,
   g_return_if_fail (TP_IS_FILE_TRANSFER_CHANNEL (self));
   g_return_if_fail (G_IS_FILE (file));
 
-  if (self->priv->access_control_param != NULL)
-    {
-      g_simple_async_report_error_in_idle (G_OBJECT (self), callback,
-          user_data, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
-          "Can't accept already accepted transfer");
+  if (!check_can_accept (self, callback, user_data))
+    return;
+
+  self->priv->result = g_simple_async_result_new (G_OBJECT (self), callback,
+      user_data, tp_file_transfer_channel_accept_file_async);
+
+  self->priv->requested_offset = offset;
+
+  g_file_replace_async (file, NULL, FALSE, G_FILE_CREATE_NONE,
+      G_PRIORITY_DEFAULT, NULL, file_replace_async_cb, self);
+}
 
+/**
+ * tp_file_transfer_channel_accept_file_finish:
+ * @self: a #TpFileTransferChannel
+ * @result: a #GAsyncResult
+ * @error: a #GError to fill
+ *
+ * Finishes a call to tp_file_transfer_channel_accept_file_async().
+ *
+ * Returns: %TRUE if the accept operation was a success, or %FALSE
+ *
+ * Since: 0.17.1
+ */
+gboolean
+tp_file_transfer_channel_accept_file_finish (TpFileTransferChannel *self,
+    GAsyncResult *result,
+    GError **error)
+{
+  _tp_implement_finish_void (self, tp_file_transfer_channel_accept_file_async)
+}
+
+static void
+file_open_readwrite_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  TpFileTransferChannel *self = user_data;
+  GFile *file = G_FILE (source);
+  GError *error = NULL;
+
+  self->priv->resume_stream = g_file_open_readwrite_finish (file, result,
+      &error);
+
+  if (error != NULL)
+    {
+      DEBUG ("Failed to open partial file: %s", error->message);
+      operation_failed (self, error);
       return;
     }
 
-  if (self->priv->state != TP_FILE_TRANSFER_STATE_PENDING)
+  accept_with_output_stream (self, file, g_object_ref (
+        g_io_stream_get_output_stream (
+          G_IO_STREAM (self->priv->resume_stream))));
+}
+
+static void
+partial_file_query_info_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  TpFileTransferChannel *self = user_data;
+  GFile *file = G_FILE (source);
+  GFileInfo *info;
+  GError *error = NULL;
+  guint64 partial_size = 0;
+
+  info = g_file_query_info_finish (file, result, &error);
+
+  if (info == NULL)
     {
-      g_simple_async_report_error_in_idle (G_OBJECT (self), callback,
-          user_data, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
-          "Can't accept a transfer that isn't pending");
+      DEBUG ("No partial file to resume: %s", error->message);
+      g_clear_error (&error);
+    }
+  else if (g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR)
+    {
+      DEBUG ("Not resuming into something that isn't a regular file");
+    }
+  else
+    {
+      partial_size = g_file_info_get_size (info);
 
-      return;
+      /* If it's as big as the whole file or bigger, it's not a partial
+       * download of this file; start again. Size is G_MAXUINT64 if
+       * unknown, which can't be the case here. */
+      if (partial_size >= self->priv->size)
+        {
+          DEBUG ("Existing file is too big (%" G_GUINT64_FORMAT " >= %"
+              G_GUINT64_FORMAT "), not resuming", partial_size,
+              self->priv->size);
+          partial_size = 0;
+        }
     }
 
-  if (tp_channel_get_requested (TP_CHANNEL (self)))
-    {
-      g_simple_async_report_error_in_idle (G_OBJECT (self), callback,
-          user_data, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
-          "Can't accept outgoing transfer");
+  tp_clear_object (&info);
 
+  if (partial_size == 0)
+    {
+      self->priv->requested_offset = 0;
+      g_file_replace_async (file, NULL, FALSE, G_FILE_CREATE_NONE,
+          G_PRIORITY_DEFAULT, NULL, file_replace_async_cb, self);
       return;
     }
 
-  self->priv->result = g_simple_async_result_new (G_OBJECT (self), callback,
-      user_data, tp_file_transfer_channel_accept_file_async);
+  DEBUG ("Resuming from offset %" G_GUINT64_FORMAT, partial_size);
 
-  self->priv->requested_offset = offset;
+  /* Not g_file_append_to_async(): we may have to truncate if the CM
+   * doesn't accept the offset we request, and splice() refuses to write
+   * to O_APPEND files anyway */
+  self->priv->requested_offset = partial_size;
+  g_file_open_readwrite_async (file, G_PRIORITY_DEFAULT, NULL,
+      file_open_readwrite_cb, self);
+}
 
-  g_file_replace_async (file, NULL, FALSE, G_FILE_CREATE_NONE,
-      G_PRIORITY_DEFAULT, NULL, file_replace_async_cb, self);
+/**
+ * tp_file_transfer_channel_resume_file_async:
+ * @self: a #TpFileTransferChannel
+ * @file: a #GFile where the file should be saved, possibly already
+ *  containing the beginning of the file from an interrupted transfer
+ * @callback: a callback to call when the transfer has been accepted
+ * @user_data: data to pass to @callback
+ *
+ * Accept an incoming file transfer in the
+ * %TP_FILE_TRANSFER_STATE_PENDING state, like
+ * tp_file_transfer_channel_accept_file_async(), but keep what has
+ * already been received in @file by a previous, interrupted transfer of
+ * the same file.
+ *
+ * If @file is a regular file smaller than #TpFileTransferChannel:size,
+ * its size is requested as the transfer's offset and the remainder of the
+ * file is appended to it; otherwise, @file is replaced and the whole file
+ * is transferred. The connection manager, or the sender, may decide to
+ * start the transfer at an earlier offset than the one requested (see
+ * #TpFileTransferChannel:initial-offset), in which case @file is
+ * truncated to that offset when the transfer starts.
+ *
+ * Once the accept has been processed, @callback will be called. You can
+ * then call tp_file_transfer_channel_resume_file_finish() to get the result
+ * of the operation.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_file_transfer_channel_resume_file_async (TpFileTransferChannel *self,
+    GFile *file,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  g_return_if_fail (TP_IS_FILE_TRANSFER_CHANNEL (self));
+  g_return_if_fail (G_IS_FILE (file));
+
+  if (!check_can_accept (self, callback, user_data))
+    return;
+
+  self->priv->result = g_simple_async_result_new (G_OBJECT (self), callback,
+      user_data, tp_file_transfer_channel_resume_file_async);
+
+  g_file_query_info_async (file,
+      G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE,
+      G_FILE_QUERY_INFO_NONE, G_PRIORITY_DEFAULT, NULL,
+      partial_file_query_info_cb, self);
 }
 
 /**
- * tp_file_transfer_channel_accept_file_finish:
+ * tp_file_transfer_channel_resume_file_finish:
  * @self: a #TpFileTransferChannel
  * @result: a #GAsyncResult
  * @error: a #GError to fill
  *
- * Finishes a call to tp_file_transfer_channel_accept_file_async().
+ * Finishes a call to tp_file_transfer_channel_resume_file_async().
  *
  * Returns: %TRUE if the accept operation was a success, or %FALSE
  *
- * Since: 0.17.1
+ * Since: 0.UNRELEASED
  */
 gboolean
-tp_file_transfer_channel_accept_file_finish (TpFileTransferChannel *self,
+tp_file_transfer_channel_resume_file_finish (TpFileTransferChannel *self,
     GAsyncResult *result,
     GError **error)
 {
-  _tp_implement_finish_void (self, tp_file_transfer_channel_accept_file_async)
+  _tp_implement_finish_void (self, tp_file_transfer_channel_resume_file_async)
 }
 
 static void
@@ -1682,3 +1980,53 @@ tp_file_transfer_channel_get_metadata (TpFileTransferChannel *self)
 
   return self->priv->metadata;
 }
+
+/**
+ * tp_file_transfer_channel_set_progress_thresholds:
+ * @self: a #TpFileTransferChannel
+ * @interval_ms: the minimum time between two notifications, in milliseconds
+ * @min_bytes: the minimum number of bytes transferred between two
+ *  notifications
+ *
+ * Rate-limit notifications of #TpFileTransferChannel:transferred-bytes.
+ * By default it is notified every time the connection manager reports
+ * progress, which some do for every chunk of data they copy.
+ *
+ * Once this is called, a notification is only emitted when at least
+ * @interval_ms have passed since the previous one and at least @min_bytes
+ * have been transferred since; once enough bytes have been transferred,
+ * progress held back by the interval is notified when it expires. The
+ * final byte count is always notified before #TpFileTransferChannel:state
+ * changes to %TP_FILE_TRANSFER_STATE_COMPLETED or
+ * %TP_FILE_TRANSFER_STATE_CANCELLED.
+ * tp_file_transfer_channel_get_transferred_bytes() always returns the
+ * latest value. Passing 0 for both thresholds restores the default.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_file_transfer_channel_set_progress_thresholds (TpFileTransferChannel *self,
+    guint interval_ms,
+    guint64 min_bytes)
+{
+  g_return_if_fail (TP_IS_FILE_TRANSFER_CHANNEL (self));
+
+  if (interval_ms == 0 && min_bytes == 0)
+    {
+      /* Don't lose progress we were holding back */
+      if (self->priv->progress != NULL)
+        tp_progress_throttle_flush (self->priv->progress);
+
+      tp_clear_pointer (&self->priv->progress, tp_progress_throttle_destroy);
+    }
+  else if (self->priv->progress != NULL)
+    {
+      tp_progress_throttle_set_thresholds (self->priv->progress, interval_ms,
+          min_bytes);
+    }
+  else
+    {
+      self->priv->progress = tp_progress_throttle_new (interval_ms, min_bytes,
+          transferred_bytes_report_cb, self);
+    }
+}
@@ -432,22 +432,159 @@ tp_unix_connection_send_credentials_with_byte (GSocketConnection *connection,
 #endif
 }
 
+typedef struct
+{
+  GCredentials *creds;
+  guchar byte;
+} ReceiveCredentialsWithByteData;
+
+#ifdef HAVE_GIO_UNIX
+static ReceiveCredentialsWithByteData *
+receive_credentials_with_byte_data_new (GCredentials *creds,
+    guchar byte)
+{
+  ReceiveCredentialsWithByteData *data;
+
+  data = g_slice_new0 (ReceiveCredentialsWithByteData);
+  data->creds = g_object_ref (creds);
+  data->byte = byte;
+
+  return data;
+}
+
 static void
-send_credentials_with_byte_async_thread (GSimpleAsyncResult *res,
-    GObject *object,
-    GCancellable *cancellable)
+receive_credentials_with_byte_data_free (ReceiveCredentialsWithByteData *data)
 {
+  g_object_unref (data->creds);
+  g_slice_free (ReceiveCredentialsWithByteData, data);
+}
+
+/* The async variants used to run the blocking calls above in a thread of
+ * their own, which meant one thread per file transfer or tube connection.
+ * Exchanging a single byte never needs more than one non-blocking attempt
+ * once the socket is ready, so we just try, and if the socket would block
+ * we wait for it in the caller's main context and try again. */
+typedef struct
+{
+  GSimpleAsyncResult *result;
+  GSocketConnection *connection;
+  GCancellable *cancellable;
+  gboolean sending;
   guchar byte;
+} CredentialsExchange;
+
+static CredentialsExchange *
+credentials_exchange_new (GSocketConnection *connection,
+    gboolean sending,
+    guchar byte,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback,
+    gpointer user_data,
+    gpointer source_tag)
+{
+  CredentialsExchange *exchange = g_slice_new0 (CredentialsExchange);
+
+  exchange->result = g_simple_async_result_new (G_OBJECT (connection),
+      callback, user_data, source_tag);
+  exchange->connection = g_object_ref (connection);
+
+  if (cancellable != NULL)
+    exchange->cancellable = g_object_ref (cancellable);
+
+  exchange->sending = sending;
+  exchange->byte = byte;
+  return exchange;
+}
+
+static void
+credentials_exchange_free (CredentialsExchange *exchange)
+{
+  g_object_unref (exchange->result);
+  g_object_unref (exchange->connection);
+  tp_clear_object (&exchange->cancellable);
+  g_slice_free (CredentialsExchange, exchange);
+}
+
+/* Returns TRUE if the exchange has been completed (successfully or not),
+ * FALSE if the socket isn't ready yet. */
+static gboolean
+credentials_exchange_try (CredentialsExchange *exchange,
+    gboolean in_idle)
+{
+  GSocket *sock = g_socket_connection_get_socket (exchange->connection);
+  gboolean was_blocking = g_socket_get_blocking (sock);
+  GCredentials *creds = NULL;
   GError *error = NULL;
 
-  byte = GPOINTER_TO_UINT (g_simple_async_result_get_op_res_gpointer (res));
+  g_socket_set_blocking (sock, FALSE);
+
+  if (exchange->sending)
+    _tp_unix_connection_send_credentials_with_byte (
+        G_UNIX_CONNECTION (exchange->connection), exchange->byte,
+        exchange->cancellable, &error);
+  else
+    creds = _tp_unix_connection_receive_credentials_with_byte (
+        G_UNIX_CONNECTION (exchange->connection), &exchange->byte,
+        exchange->cancellable, &error);
+
+  g_socket_set_blocking (sock, was_blocking);
+
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+    {
+      g_error_free (error);
+      return FALSE;
+    }
+
+  if (error != NULL)
+    {
+      g_simple_async_result_take_error (exchange->result, error);
+    }
+  else if (creds != NULL)
+    {
+      g_simple_async_result_set_op_res_gpointer (exchange->result,
+          receive_credentials_with_byte_data_new (creds, exchange->byte),
+          (GDestroyNotify) receive_credentials_with_byte_data_free);
+      g_object_unref (creds);
+    }
+
+  if (in_idle)
+    g_simple_async_result_complete_in_idle (exchange->result);
+  else
+    g_simple_async_result_complete (exchange->result);
+
+  return TRUE;
+}
+
+static gboolean
+credentials_exchange_ready_cb (GSocket *sock,
+    GIOCondition condition,
+    gpointer user_data)
+{
+  /* Also called if the cancellable is triggered, in which case the attempt
+   * fails with G_IO_ERROR_CANCELLED and we're done. */
+  return !credentials_exchange_try (user_data, FALSE);
+}
+
+static void
+credentials_exchange_start (CredentialsExchange *exchange)
+{
+  GSource *source;
 
-  if (!tp_unix_connection_send_credentials_with_byte (
-          (GSocketConnection *) object, byte, cancellable, &error))
+  if (credentials_exchange_try (exchange, TRUE))
     {
-      g_simple_async_result_take_error (res, error);
+      credentials_exchange_free (exchange);
+      return;
     }
+
+  source = g_socket_create_source (
+      g_socket_connection_get_socket (exchange->connection),
+      exchange->sending ? G_IO_OUT : G_IO_IN, exchange->cancellable);
+  g_source_set_callback (source, (GSourceFunc) credentials_exchange_ready_cb,
+      exchange, (GDestroyNotify) credentials_exchange_free);
+  g_source_attach (source, g_main_context_get_thread_default ());
+  g_source_unref (source);
 }
+#endif
 
 /**
  * tp_unix_connection_send_credentials_with_byte_async:
@@ -476,19 +613,15 @@ tp_unix_connection_send_credentials_with_byte_async (
     GAsyncReadyCallback callback,
     gpointer user_data)
 {
-  GSimpleAsyncResult *res;
-
-  res = g_simple_async_result_new (G_OBJECT (connection), callback, user_data,
-      tp_unix_connection_send_credentials_with_byte_async);
-
-  /* Extra casting to guint to work around GNOME#661546 for GLib < 2.32 */
-  g_simple_async_result_set_op_res_gpointer (res,
-      GUINT_TO_POINTER ((guint) byte), NULL);
-
-  g_simple_async_result_run_in_thread (res,
-      send_credentials_with_byte_async_thread, G_PRIORITY_DEFAULT, cancellable);
-
-  g_object_unref (res);
+#ifdef HAVE_GIO_UNIX
+  credentials_exchange_start (credentials_exchange_new (connection, TRUE, byte,
+        cancellable, callback, user_data,
+        tp_unix_connection_send_credentials_with_byte_async));
+#else
+  g_simple_async_report_error_in_idle (G_OBJECT (connection), callback,
+      user_data, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+      "Unix sockets not supported");
+#endif
 }
 
 /**
@@ -725,56 +858,6 @@ tp_unix_connection_receive_credentials_with_byte (GSocketConnection *connection,
 #endif
 }
 
-typedef struct
-{
-  GCredentials *creds;
-  guchar byte;
-} ReceiveCredentialsWithByteData;
-
-static ReceiveCredentialsWithByteData *
-receive_credentials_with_byte_data_new (GCredentials *creds,
-    guchar byte)
-{
-  ReceiveCredentialsWithByteData *data;
-
-  data = g_slice_new0 (ReceiveCredentialsWithByteData);
-  data->creds = g_object_ref (creds);
-  data->byte = byte;
-
-  return data;
-}
-
-static void
-receive_credentials_with_byte_data_free (ReceiveCredentialsWithByteData *data)
-{
-  g_object_unref (data->creds);
-  g_slice_free (ReceiveCredentialsWithByteData, data);
-}
-
-static void
-receive_credentials_with_byte_async_thread (GSimpleAsyncResult *res,
-    GObject *object,
-    GCancellable *cancellable)
-{
-  guchar byte;
-  GCredentials *creds;
-  GError *error = NULL;
-
-  creds = tp_unix_connection_receive_credentials_with_byte (
-      (GSocketConnection *) object, &byte, cancellable, &error);
-  if (creds == NULL)
-    {
-      g_simple_async_result_take_error (res, error);
-      return;
-    }
-
-  g_simple_async_result_set_op_res_gpointer (res,
-      receive_credentials_with_byte_data_new (creds, byte),
-      (GDestroyNotify) receive_credentials_with_byte_data_free);
-
-  g_object_unref (creds);
-}
-
 /**
  * tp_unix_connection_receive_credentials_with_byte_async:
  * @connection: A #GUnixConnection.
@@ -800,16 +883,15 @@ tp_unix_connection_receive_credentials_with_byte_async (
     GAsyncReadyCallback callback,
     gpointer user_data)
 {
-  GSimpleAsyncResult *res;
-
-  res = g_simple_async_result_new (G_OBJECT (connection), callback, user_data,
-      tp_unix_connection_receive_credentials_with_byte_async);
-
-  g_simple_async_result_run_in_thread (res,
-      receive_credentials_with_byte_async_thread, G_PRIORITY_DEFAULT,
-      cancellable);
-
-  g_object_unref (res);
+#ifdef HAVE_GIO_UNIX
+  credentials_exchange_start (credentials_exchange_new (connection, FALSE, 0,
+        cancellable, callback, user_data,
+        tp_unix_connection_receive_credentials_with_byte_async));
+#else
+  g_simple_async_report_error_in_idle (G_OBJECT (connection), callback,
+      user_data, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+      "Unix sockets not supported");
+#endif
 }
 
 /**
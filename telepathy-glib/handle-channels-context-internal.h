@@ -26,6 +26,7 @@
 
 #include <telepathy-glib/account.h>
 #include <telepathy-glib/handle-channels-context.h>
+#include "telepathy-glib/prepare-pipeline-internal.h"
 
 G_BEGIN_DECLS
 
@@ -66,6 +67,7 @@ TpHandleChannelsContextState _tp_handle_channels_context_get_state
 
 void _tp_handle_channels_context_prepare_async (
     TpHandleChannelsContext *self,
+    TpPreparePipeline *pipeline,
     const GQuark *account_features,
     const GQuark *connection_features,
     const GQuark *channel_features,
@@ -568,7 +568,7 @@ account_prepare_cb (GObject *source,
   if (self->priv->result == NULL)
     goto out;
 
-  if (!tp_proxy_prepare_finish (source, result, &error))
+  if (!_tp_prepare_pipeline_prepare_finish (source, result, &error))
     {
       DEBUG ("Failed to prepare account: %s", error->message);
       g_error_free (error);
@@ -592,7 +592,7 @@ conn_prepare_cb (GObject *source,
   if (self->priv->result == NULL)
     goto out;
 
-  if (!tp_proxy_prepare_finish (source, result, &error))
+  if (!_tp_prepare_pipeline_prepare_finish (source, result, &error))
     {
       DEBUG ("Failed to prepare connection: %s", error->message);
       g_error_free (error);
@@ -616,7 +616,7 @@ hcc_channel_prepare_cb (GObject *source,
   if (self->priv->result == NULL)
     goto out;
 
-  if (!tp_proxy_prepare_finish (source, result, &error))
+  if (!_tp_prepare_pipeline_prepare_finish (source, result, &error))
     {
       DEBUG ("Failed to prepare channel: %s", error->message);
 
@@ -632,6 +632,7 @@ out:
 
 static void
 context_prepare (TpHandleChannelsContext *self,
+    TpPreparePipeline *pipeline,
     const GQuark *account_features,
     const GQuark *connection_features,
     const GQuark *channel_features)
@@ -640,11 +641,11 @@ context_prepare (TpHandleChannelsContext *self,
 
   self->priv->num_pending = 2;
 
-  tp_proxy_prepare_async (self->account, account_features,
-      account_prepare_cb, g_object_ref (self));
+  _tp_prepare_pipeline_prepare_async (pipeline, self->account,
+      account_features, account_prepare_cb, g_object_ref (self));
 
-  tp_proxy_prepare_async (self->connection, connection_features,
-      conn_prepare_cb, g_object_ref (self));
+  _tp_prepare_pipeline_prepare_async (pipeline, self->connection,
+      connection_features, conn_prepare_cb, g_object_ref (self));
 
   for (i = 0; i < self->channels->len; i++)
     {
@@ -652,14 +653,15 @@ context_prepare (TpHandleChannelsContext *self,
 
       self->priv->num_pending++;
 
-      tp_proxy_prepare_async (channel, channel_features,
-          hcc_channel_prepare_cb, g_object_ref (self));
+      _tp_prepare_pipeline_prepare_async (pipeline, channel,
+          channel_features, hcc_channel_prepare_cb, g_object_ref (self));
     }
 }
 
 void
 _tp_handle_channels_context_prepare_async (
     TpHandleChannelsContext *self,
+    TpPreparePipeline *pipeline,
     const GQuark *account_features,
     const GQuark *connection_features,
     const GQuark *channel_features,
@@ -674,7 +676,7 @@ _tp_handle_channels_context_prepare_async (
   self->priv->result = g_simple_async_result_new (G_OBJECT (self),
       callback, user_data, _tp_handle_channels_context_prepare_async);
 
-  context_prepare (self, account_features, connection_features,
+  context_prepare (self, pipeline, account_features, connection_features,
       channel_features);
 }
 
@@ -0,0 +1,43 @@
+/*<private_header>*/
+/*
+ * interface-set-internal.h - shared, immutable sets of D-Bus interfaces
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __TP_INTERFACE_SET_INTERNAL_H__
+#define __TP_INTERFACE_SET_INTERNAL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TpInterfaceSet TpInterfaceSet;
+
+TpInterfaceSet *_tp_interface_set_empty (void);
+
+TpInterfaceSet *_tp_interface_set_add (TpInterfaceSet *self,
+    GQuark iface);
+
+gboolean _tp_interface_set_contains (TpInterfaceSet *self,
+    GQuark iface);
+
+GArray *_tp_interface_set_dup_quarks (TpInterfaceSet *self);
+
+G_END_DECLS
+
+#endif /* __TP_INTERFACE_SET_INTERNAL_H__ */
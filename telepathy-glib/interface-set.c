@@ -0,0 +1,347 @@
+/*
+ * interface-set.c - shared, immutable sets of D-Bus interfaces
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "telepathy-glib/interface-set-internal.h"
+
+#include <string.h>
+
+/* Every proxy of a given kind tends to have exactly the same interfaces as
+ * all the others: an Observer can easily have thousands of Text channels,
+ * all with the same three or four interfaces. So rather than each proxy
+ * keeping its own list, each distinct set of interfaces is represented
+ * once, as a bitset, and proxies just point to the one they have.
+ *
+ * Each interface that is ever added to a set is given a small bit number,
+ * the first time it's seen. Sets are interned, and never freed: there are
+ * only ever a few dozen distinct combinations of interfaces in a process.
+ * Adding an interface to a set gives another interned set; each set
+ * remembers the results, so that building up the same combination again
+ * (as every new proxy of the same kind does) is cheap.
+ *
+ * The bit numbers are looked up in a two-level table indexed by GQuark, so
+ * that _tp_interface_set_contains() doesn't need to take a lock. Chunks of
+ * the table never move once they have been published. */
+
+#define CHUNK_BITS 8
+#define CHUNK_SIZE (1 << CHUNK_BITS)
+#define N_CHUNKS 4096
+
+#define BITS_PER_WORD 32
+
+struct _TpInterfaceSet
+{
+  guint hash;
+  /* (struct Transition): this set plus one interface; protected by the
+   * lock */
+  GArray *transitions;
+  guint n_words;
+  /* n_words of them; the last one is non-zero, so that equal sets have the
+   * same n_words */
+  guint32 words[1];
+};
+
+typedef struct
+{
+  GQuark iface;
+  TpInterfaceSet *result;
+} Transition;
+
+G_LOCK_DEFINE_STATIC (interface_sets);
+
+/* GQuark => 1 + bit number, or 0 if it has no bit yet. Each chunk is
+ * CHUNK_SIZE gints; read with g_atomic_*, written with the lock held. */
+static gint *quark_to_bit[N_CHUNKS];
+/* Quarks too big for quark_to_bit (there shouldn't be any in practice):
+ * GQuark => GUINT_TO_POINTER (1 + bit number); protected by the lock */
+static GHashTable *big_quarks = NULL;
+/* bit number => GQuark; protected by the lock */
+static GArray *bit_to_quark = NULL;
+/* TpInterfaceSet => itself; protected by the lock */
+static GHashTable *interned = NULL;
+
+static guint
+set_hash (gconstpointer p)
+{
+  const TpInterfaceSet *set = p;
+
+  return set->hash;
+}
+
+static gboolean
+set_equal (gconstpointer a,
+    gconstpointer b)
+{
+  const TpInterfaceSet *sa = a;
+  const TpInterfaceSet *sb = b;
+
+  return sa->n_words == sb->n_words &&
+      memcmp (sa->words, sb->words, sa->n_words * sizeof (guint32)) == 0;
+}
+
+static TpInterfaceSet *
+set_new (const guint32 *words,
+    guint n_words)
+{
+  TpInterfaceSet *set = g_malloc0 (G_STRUCT_OFFSET (TpInterfaceSet, words) +
+      MAX (n_words, 1) * sizeof (guint32));
+  guint i;
+
+  set->n_words = n_words;
+
+  if (n_words > 0)
+    memcpy (set->words, words, n_words * sizeof (guint32));
+
+  set->hash = n_words;
+
+  for (i = 0; i < n_words; i++)
+    set->hash = (set->hash * 33) ^ words[i];
+
+  return set;
+}
+
+/* Must be called with the lock held. @set is consumed. */
+static TpInterfaceSet *
+intern_locked (TpInterfaceSet *set)
+{
+  TpInterfaceSet *existing;
+
+  if (interned == NULL)
+    interned = g_hash_table_new (set_hash, set_equal);
+
+  existing = g_hash_table_lookup (interned, set);
+
+  if (existing != NULL)
+    {
+      g_free (set);
+      return existing;
+    }
+
+  set->transitions = g_array_new (FALSE, FALSE, sizeof (Transition));
+  g_hash_table_add (interned, set);
+  return set;
+}
+
+/* Returns 1 + the bit number for @iface, or 0 if it doesn't have one. */
+static guint
+lookup_bit (GQuark iface)
+{
+  gint *chunk;
+  guint bit;
+
+  if (G_UNLIKELY (iface >= N_CHUNKS * CHUNK_SIZE))
+    {
+      G_LOCK (interface_sets);
+      bit = (big_quarks == NULL) ? 0 :
+          GPOINTER_TO_UINT (g_hash_table_lookup (big_quarks,
+                GUINT_TO_POINTER (iface)));
+      G_UNLOCK (interface_sets);
+      return bit;
+    }
+
+  chunk = g_atomic_pointer_get (&quark_to_bit[iface >> CHUNK_BITS]);
+
+  if (chunk == NULL)
+    return 0;
+
+  return g_atomic_int_get (&chunk[iface & (CHUNK_SIZE - 1)]);
+}
+
+/* Must be called with the lock held. Returns the bit number for @iface
+ * (not 1 + it), giving it one if necessary. */
+static guint
+ensure_bit_locked (GQuark iface)
+{
+  guint bit;
+  gint *chunk;
+
+  if (bit_to_quark == NULL)
+    bit_to_quark = g_array_new (FALSE, FALSE, sizeof (GQuark));
+
+  if (G_UNLIKELY (iface >= N_CHUNKS * CHUNK_SIZE))
+    {
+      if (big_quarks == NULL)
+        big_quarks = g_hash_table_new (NULL, NULL);
+
+      bit = GPOINTER_TO_UINT (g_hash_table_lookup (big_quarks,
+            GUINT_TO_POINTER (iface)));
+
+      if (bit == 0)
+        {
+          g_array_append_val (bit_to_quark, iface);
+          bit = bit_to_quark->len;
+          g_hash_table_insert (big_quarks, GUINT_TO_POINTER (iface),
+              GUINT_TO_POINTER (bit));
+        }
+
+      return bit - 1;
+    }
+
+  chunk = quark_to_bit[iface >> CHUNK_BITS];
+
+  if (chunk == NULL)
+    {
+      chunk = g_new0 (gint, CHUNK_SIZE);
+      g_atomic_pointer_set (&quark_to_bit[iface >> CHUNK_BITS], chunk);
+    }
+
+  bit = chunk[iface & (CHUNK_SIZE - 1)];
+
+  if (bit == 0)
+    {
+      g_array_append_val (bit_to_quark, iface);
+      bit = bit_to_quark->len;
+      g_atomic_int_set (&chunk[iface & (CHUNK_SIZE - 1)], bit);
+    }
+
+  return bit - 1;
+}
+
+/*
+ * _tp_interface_set_empty:
+ *
+ * Returns: (transfer none): the set with no interfaces in it
+ */
+TpInterfaceSet *
+_tp_interface_set_empty (void)
+{
+  static TpInterfaceSet *empty = NULL;
+
+  if (g_once_init_enter (&empty))
+    {
+      TpInterfaceSet *set;
+
+      G_LOCK (interface_sets);
+      set = intern_locked (set_new (NULL, 0));
+      G_UNLOCK (interface_sets);
+
+      g_once_init_leave (&empty, set);
+    }
+
+  return empty;
+}
+
+/*
+ * _tp_interface_set_contains:
+ * @self: a set
+ * @iface: an interface
+ *
+ * Returns: %TRUE if @iface is in @self
+ */
+gboolean
+_tp_interface_set_contains (TpInterfaceSet *self,
+    GQuark iface)
+{
+  guint bit = lookup_bit (iface);
+
+  if (bit == 0)
+    return FALSE;
+
+  bit--;
+
+  return (bit / BITS_PER_WORD < self->n_words &&
+      (self->words[bit / BITS_PER_WORD] & (1U << (bit % BITS_PER_WORD))) != 0);
+}
+
+/*
+ * _tp_interface_set_add:
+ * @self: a set
+ * @iface: an interface
+ *
+ * Returns: (transfer none): the set containing everything in @self, and
+ *  @iface; this is @self if it already contains @iface
+ */
+TpInterfaceSet *
+_tp_interface_set_add (TpInterfaceSet *self,
+    GQuark iface)
+{
+  TpInterfaceSet *result = NULL;
+  guint32 *words;
+  guint bit, n_words, i;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (iface != 0, self);
+
+  if (_tp_interface_set_contains (self, iface))
+    return self;
+
+  G_LOCK (interface_sets);
+
+  for (i = 0; i < self->transitions->len; i++)
+    {
+      Transition *t = &g_array_index (self->transitions, Transition, i);
+
+      if (t->iface == iface)
+        {
+          result = t->result;
+          break;
+        }
+    }
+
+  if (result == NULL)
+    {
+      Transition t;
+
+      bit = ensure_bit_locked (iface);
+      n_words = MAX (self->n_words, bit / BITS_PER_WORD + 1);
+
+      words = g_new0 (guint32, n_words);
+      memcpy (words, self->words, self->n_words * sizeof (guint32));
+      words[bit / BITS_PER_WORD] |= 1U << (bit % BITS_PER_WORD);
+
+      result = intern_locked (set_new (words, n_words));
+      g_free (words);
+
+      t.iface = iface;
+      t.result = result;
+      g_array_append_val (self->transitions, t);
+    }
+
+  G_UNLOCK (interface_sets);
+
+  return result;
+}
+
+/*
+ * _tp_interface_set_dup_quarks:
+ * @self: a set
+ *
+ * Returns: (transfer full): a new array of the GQuarks for the interfaces
+ *  in @self, in the order they were first seen by this process
+ */
+GArray *
+_tp_interface_set_dup_quarks (TpInterfaceSet *self)
+{
+  GArray *quarks = g_array_new (FALSE, FALSE, sizeof (GQuark));
+  guint i;
+
+  G_LOCK (interface_sets);
+
+  for (i = 0; i < self->n_words * BITS_PER_WORD; i++)
+    {
+      if ((self->words[i / BITS_PER_WORD] & (1U << (i % BITS_PER_WORD))) != 0)
+        g_array_append_val (quarks, g_array_index (bit_to_quark, GQuark, i));
+    }
+
+  G_UNLOCK (interface_sets);
+
+  return quarks;
+}
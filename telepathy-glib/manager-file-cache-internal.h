@@ -0,0 +1,55 @@
+/*<private_header>*/
+/*
+ * manager-file-cache-internal.h - cache of parsed .manager files
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __TP_MANAGER_FILE_CACHE_INTERNAL_H__
+#define __TP_MANAGER_FILE_CACHE_INTERNAL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+    guint64 mtime;
+    /* 0 where the platform doesn't have sub-second mtimes */
+    guint64 mtime_nsec;
+    guint64 ctime;
+    guint64 inode;
+    guint64 size;
+} TpManagerFileStamp;
+
+gboolean _tp_manager_file_stamp (const gchar *filename,
+    TpManagerFileStamp *stamp);
+
+gboolean _tp_manager_file_cache_lookup (const gchar *cm_name,
+    const gchar *filename,
+    const TpManagerFileStamp *stamp,
+    GHashTable **protocols_out,
+    GStrv *interfaces_out);
+
+void _tp_manager_file_cache_store (const gchar *cm_name,
+    const gchar *filename,
+    const TpManagerFileStamp *stamp,
+    GHashTable *protocols,
+    const gchar * const *interfaces);
+
+G_END_DECLS
+
+#endif /* __TP_MANAGER_FILE_CACHE_INTERNAL_H__ */
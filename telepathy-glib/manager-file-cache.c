@@ -0,0 +1,269 @@
+/*
+ * manager-file-cache.c - cache of parsed .manager files
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "telepathy-glib/manager-file-cache-internal.h"
+
+#include <glib/gstdio.h>
+
+#include <telepathy-glib/connection-manager.h>
+#include <telepathy-glib/util.h>
+
+#define DEBUG_FLAG TP_DEBUG_MANAGER
+#include "telepathy-glib/debug-internal.h"
+#include "telepathy-glib/variant-util-internal.h"
+
+/* Parsing a .manager file means building every protocol's parameter
+ * specs, requestable channel classes and presence statuses out of a
+ * GKeyFile, and clients that list connection managers do that for every
+ * CM installed, every time they start. So once we've parsed one, we save
+ * the result in $XDG_CACHE_HOME/telepathy/managers/<cm>.cache, as a
+ * serialized GVariant of type CACHE_TYPE: the format version, the
+ * .manager file it came from, that file's stamp (see TpManagerFileStamp),
+ * the protocols' immutable properties (name => a{sv}), and the CM's
+ * interfaces.
+ *
+ * Next time, we map the cache file into memory and use it directly if the
+ * .manager file still has the same name and stamp. The mtime alone, in
+ * whole seconds, isn't enough: a package manager or a test can easily
+ * rewrite a file with something of the same size within a second. So we
+ * also use the sub-second part of the mtime where there is one, and the
+ * ctime and inode number, which change when a file is replaced by
+ * renaming another over it.
+ *
+ * GVariant's serialization is in host byte order; a cache written by a
+ * host with the other byte order will fail the version check, and be
+ * rewritten. Data that doesn't even have the right type is treated by
+ * GVariant as the default value, which also fails that check. */
+
+#define CACHE_VERSION 2
+#define CACHE_TYPE "(ust(ttttt)a{sa{sv}}as)"
+
+static gchar *
+cache_filename (const gchar *cm_name)
+{
+  gchar *basename = g_strdup_printf ("%s.cache", cm_name);
+  gchar *filename = g_build_filename (g_get_user_cache_dir (), "telepathy",
+      "managers", basename, NULL);
+
+  g_free (basename);
+  return filename;
+}
+
+/*
+ * _tp_manager_file_stamp:
+ * @filename: a .manager file
+ * @stamp: (out): used to return the file's mtime, ctime, inode and size
+ *
+ * Returns: %TRUE if @filename could be stat()ed
+ */
+gboolean
+_tp_manager_file_stamp (const gchar *filename,
+    TpManagerFileStamp *stamp)
+{
+  GStatBuf buf;
+
+  if (g_stat (filename, &buf) != 0)
+    return FALSE;
+
+  stamp->mtime = buf.st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+  stamp->mtime_nsec = buf.st_mtim.tv_nsec;
+#else
+  stamp->mtime_nsec = 0;
+#endif
+  stamp->ctime = buf.st_ctime;
+  stamp->inode = buf.st_ino;
+  stamp->size = buf.st_size;
+  return TRUE;
+}
+
+/*
+ * _tp_manager_file_cache_lookup:
+ * @cm_name: the connection manager's name
+ * @filename: the .manager file that would otherwise be parsed
+ * @stamp: @filename's stamp, from _tp_manager_file_stamp()
+ * @protocols_out: (out) (transfer full): used to return a map from
+ *  protocol name to the protocol's immutable properties
+ * @interfaces_out: (out) (transfer full): used to return the CM's interfaces
+ *
+ * Returns: %TRUE if there was an up-to-date cache of @filename
+ */
+gboolean
+_tp_manager_file_cache_lookup (const gchar *cm_name,
+    const gchar *filename,
+    const TpManagerFileStamp *stamp,
+    GHashTable **protocols_out,
+    GStrv *interfaces_out)
+{
+  gchar *path = cache_filename (cm_name);
+  GMappedFile *mapped;
+  GBytes *bytes;
+  GVariant *variant;
+  GVariant *protocols_variant;
+  GVariantIter iter;
+  GHashTable *protocols = NULL;
+  GStrv interfaces = NULL;
+  GError *error = NULL;
+  guint32 version;
+  const gchar *source;
+  TpManagerFileStamp cached;
+  gchar *name;
+  GVariant *immutables;
+  gboolean ret = FALSE;
+
+  mapped = g_mapped_file_new (path, FALSE, &error);
+
+  if (mapped == NULL)
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        DEBUG ("%s: unable to map %s: %s", cm_name, path, error->message);
+
+      g_error_free (error);
+      g_free (path);
+      return FALSE;
+    }
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  g_mapped_file_unref (mapped);
+
+  variant = g_variant_ref_sink (g_variant_new_from_bytes (
+        G_VARIANT_TYPE (CACHE_TYPE), bytes, FALSE));
+  g_bytes_unref (bytes);
+
+  g_variant_get (variant, "(u&s(ttttt)@a{sa{sv}}^as)", &version, &source,
+      &cached.mtime, &cached.mtime_nsec, &cached.ctime, &cached.inode,
+      &cached.size, &protocols_variant, &interfaces);
+
+  if (version != CACHE_VERSION || tp_strdiff (source, filename) ||
+      cached.mtime != stamp->mtime ||
+      cached.mtime_nsec != stamp->mtime_nsec ||
+      cached.ctime != stamp->ctime ||
+      cached.inode != stamp->inode ||
+      cached.size != stamp->size)
+    {
+      DEBUG ("%s: %s is out of date", cm_name, path);
+      goto out;
+    }
+
+  protocols = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) g_hash_table_unref);
+
+  g_variant_iter_init (&iter, protocols_variant);
+
+  while (g_variant_iter_next (&iter, "{s@a{sv}}", &name, &immutables))
+    {
+      if (!tp_connection_manager_check_valid_protocol_name (name, NULL))
+        {
+          DEBUG ("%s: %s has an invalid protocol name '%s'", cm_name, path,
+              name);
+          g_free (name);
+          g_variant_unref (immutables);
+          tp_clear_pointer (&protocols, g_hash_table_unref);
+          goto out;
+        }
+
+      /* steals @name */
+      g_hash_table_insert (protocols, name,
+          _tp_asv_from_vardict (immutables));
+      g_variant_unref (immutables);
+    }
+
+  DEBUG ("%s: using %s", cm_name, path);
+  ret = TRUE;
+
+  *protocols_out = protocols;
+  protocols = NULL;
+  *interfaces_out = interfaces;
+  interfaces = NULL;
+
+out:
+  g_strfreev (interfaces);
+  g_variant_unref (protocols_variant);
+  g_variant_unref (variant);
+  g_free (path);
+  return ret;
+}
+
+/*
+ * _tp_manager_file_cache_store:
+ * @cm_name: the connection manager's name
+ * @filename: the .manager file that was parsed
+ * @stamp: @filename's stamp, from _tp_manager_file_stamp() before it was
+ *  parsed
+ * @protocols: map from protocol name to the protocol's immutable properties
+ * @interfaces: (allow-none): the CM's interfaces
+ *
+ * Save the result of parsing @filename, so that
+ * _tp_manager_file_cache_lookup() can use it next time. Failure is not
+ * an error: we just parse @filename again next time.
+ */
+void
+_tp_manager_file_cache_store (const gchar *cm_name,
+    const gchar *filename,
+    const TpManagerFileStamp *stamp,
+    GHashTable *protocols,
+    const gchar * const *interfaces)
+{
+  static const gchar * const no_interfaces[] = { NULL };
+  gchar *path = cache_filename (cm_name);
+  gchar *dir = g_path_get_dirname (path);
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  gpointer k, v;
+  GVariant *variant;
+  GError *error = NULL;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sa{sv}}"));
+  g_hash_table_iter_init (&iter, protocols);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    {
+      GVariant *immutables = _tp_asv_to_vardict (v);
+
+      g_variant_builder_add (&builder, "{s@a{sv}}", k, immutables);
+      g_variant_unref (immutables);
+    }
+
+  variant = g_variant_ref_sink (g_variant_new ("(us(ttttt)a{sa{sv}}^as)",
+        CACHE_VERSION, filename, stamp->mtime, stamp->mtime_nsec,
+        stamp->ctime, stamp->inode, stamp->size, &builder,
+        interfaces != NULL ? interfaces : no_interfaces));
+
+  if (g_mkdir_with_parents (dir, 0700) != 0)
+    {
+      DEBUG ("%s: unable to create %s", cm_name, dir);
+    }
+  else if (!g_file_set_contents (path, g_variant_get_data (variant),
+        g_variant_get_size (variant), &error))
+    {
+      DEBUG ("%s: unable to write %s: %s", cm_name, path, error->message);
+      g_error_free (error);
+    }
+  else
+    {
+      DEBUG ("%s: saved %s", cm_name, path);
+    }
+
+  g_variant_unref (variant);
+  g_free (dir);
+  g_free (path);
+}
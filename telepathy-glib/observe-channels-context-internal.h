@@ -27,6 +27,7 @@
 #include <telepathy-glib/account.h>
 #include <telepathy-glib/channel-dispatch-operation.h>
 #include <telepathy-glib/observe-channels-context.h>
+#include "telepathy-glib/prepare-pipeline-internal.h"
 
 G_BEGIN_DECLS
 
@@ -66,7 +67,18 @@ TpObserveChannelsContext * _tp_observe_channels_context_new (
 TpObserveChannelsContextState _tp_observe_channels_context_get_state (
     TpObserveChannelsContext *self);
 
+typedef void (*TpObserveChannelsContextChannelReadyCb) (
+    TpObserveChannelsContext *self,
+    TpChannel *channel,
+    gpointer user_data);
+
+void _tp_observe_channels_context_set_channel_ready_func (
+    TpObserveChannelsContext *self,
+    TpObserveChannelsContextChannelReadyCb func,
+    gpointer user_data);
+
 void _tp_observe_channels_context_prepare_async (TpObserveChannelsContext *self,
+    TpPreparePipeline *pipeline,
     const GQuark *account_features,
     const GQuark *connection_features,
     const GQuark *channel_features,
@@ -86,6 +86,15 @@ struct _TpObserveChannelsContextPrivate
   /* Number of calls we are waiting they return. Once they have all returned
    * the context is considered as prepared */
   guint num_pending;
+
+  /* If set, called for each channel as soon as it, the account and the
+   * connection are prepared, without waiting for the other channels */
+  TpObserveChannelsContextChannelReadyCb channel_ready;
+  gpointer channel_ready_data;
+  gboolean account_done;
+  gboolean connection_done;
+  /* borrowed TpChannel, prepared but not passed to channel_ready yet */
+  GPtrArray *ready_channels;
 };
 
 static void
@@ -95,6 +104,7 @@ tp_observe_channels_context_init (TpObserveChannelsContext *self)
       TP_TYPE_OBSERVE_CHANNELS_CONTEXT, TpObserveChannelsContextPrivate);
 
   self->priv->state = TP_OBSERVE_CHANNELS_CONTEXT_STATE_NONE;
+  self->priv->ready_channels = g_ptr_array_new ();
 }
 
 static void
@@ -160,6 +170,8 @@ tp_observe_channels_context_dispose (GObject *object)
       self->priv->result = NULL;
     }
 
+  tp_clear_pointer (&self->priv->ready_channels, g_ptr_array_unref);
+
   if (dispose != NULL)
     dispose (object);
 }
@@ -530,6 +542,24 @@ context_check_prepare (TpObserveChannelsContext *self)
   self->priv->result = NULL;
 }
 
+static void
+context_announce_ready_channels (TpObserveChannelsContext *self)
+{
+  guint i;
+
+  if (self->priv->channel_ready == NULL
+      || !self->priv->account_done
+      || !self->priv->connection_done)
+    return;
+
+  for (i = 0; i < self->priv->ready_channels->len; i++)
+    self->priv->channel_ready (self,
+        g_ptr_array_index (self->priv->ready_channels, i),
+        self->priv->channel_ready_data);
+
+  g_ptr_array_set_size (self->priv->ready_channels, 0);
+}
+
 static void
 cdo_prepare_cb (GObject *source,
     GAsyncResult *result,
@@ -541,7 +571,7 @@ cdo_prepare_cb (GObject *source,
   if (self->priv->result == NULL)
     goto out;
 
-  if (!tp_proxy_prepare_finish (source, result, &error))
+  if (!_tp_prepare_pipeline_prepare_finish (source, result, &error))
     {
       DEBUG ("Failed to prepare ChannelDispatchOperation: %s", error->message);
 
@@ -566,12 +596,15 @@ account_prepare_cb (GObject *source,
   if (self->priv->result == NULL)
     goto out;
 
-  if (!tp_proxy_prepare_finish (source, result, &error))
+  if (!_tp_prepare_pipeline_prepare_finish (source, result, &error))
     {
       DEBUG ("Failed to prepare account: %s", error->message);
       g_error_free (error);
     }
 
+  self->priv->account_done = TRUE;
+  context_announce_ready_channels (self);
+
   self->priv->num_pending--;
   context_check_prepare (self);
 
@@ -590,12 +623,15 @@ conn_prepare_cb (GObject *source,
   if (self->priv->result == NULL)
     goto out;
 
-  if (!tp_proxy_prepare_finish (source, result, &error))
+  if (!_tp_prepare_pipeline_prepare_finish (source, result, &error))
     {
       DEBUG ("Failed to prepare connection: %s", error->message);
       g_error_free (error);
     }
 
+  self->priv->connection_done = TRUE;
+  context_announce_ready_channels (self);
+
   self->priv->num_pending--;
   context_check_prepare (self);
 
@@ -614,11 +650,16 @@ occ_channel_prepare_cb (GObject *source,
   if (self->priv->result == NULL)
     goto out;
 
-  if (!tp_proxy_prepare_finish (source, result, &error))
+  if (!_tp_prepare_pipeline_prepare_finish (source, result, &error))
     {
       DEBUG ("Failed to prepare channel: %s", error->message);
       g_error_free (error);
     }
+  else
+    {
+      g_ptr_array_add (self->priv->ready_channels, source);
+      context_announce_ready_channels (self);
+    }
 
   self->priv->num_pending--;
   context_check_prepare (self);
@@ -629,6 +670,7 @@ out:
 
 static void
 context_prepare (TpObserveChannelsContext *self,
+    TpPreparePipeline *pipeline,
     const GQuark *account_features,
     const GQuark *connection_features,
     const GQuark *channel_features)
@@ -638,17 +680,17 @@ context_prepare (TpObserveChannelsContext *self,
 
   self->priv->num_pending = 2;
 
-  tp_proxy_prepare_async (self->account, account_features,
-      account_prepare_cb, g_object_ref (self));
+  _tp_prepare_pipeline_prepare_async (pipeline, self->account,
+      account_features, account_prepare_cb, g_object_ref (self));
 
-  tp_proxy_prepare_async (self->connection, connection_features,
-      conn_prepare_cb, g_object_ref (self));
+  _tp_prepare_pipeline_prepare_async (pipeline, self->connection,
+      connection_features, conn_prepare_cb, g_object_ref (self));
 
   if (self->dispatch_operation != NULL)
     {
       self->priv->num_pending++;
-      tp_proxy_prepare_async (self->dispatch_operation, cdo_features,
-          cdo_prepare_cb, g_object_ref (self));
+      _tp_prepare_pipeline_prepare_async (pipeline, self->dispatch_operation,
+          cdo_features, cdo_prepare_cb, g_object_ref (self));
     }
 
   for (i = 0; i < self->channels->len; i++)
@@ -657,13 +699,14 @@ context_prepare (TpObserveChannelsContext *self,
 
       self->priv->num_pending++;
 
-      tp_proxy_prepare_async (channel, channel_features,
-          occ_channel_prepare_cb, g_object_ref (self));
+      _tp_prepare_pipeline_prepare_async (pipeline, channel,
+          channel_features, occ_channel_prepare_cb, g_object_ref (self));
     }
 }
 
 void
 _tp_observe_channels_context_prepare_async (TpObserveChannelsContext *self,
+    TpPreparePipeline *pipeline,
     const GQuark *account_features,
     const GQuark *connection_features,
     const GQuark *channel_features,
@@ -678,10 +721,32 @@ _tp_observe_channels_context_prepare_async (TpObserveChannelsContext *self,
   self->priv->result = g_simple_async_result_new (G_OBJECT (self),
       callback, user_data, _tp_observe_channels_context_prepare_async);
 
-  context_prepare (self, account_features, connection_features,
+  context_prepare (self, pipeline, account_features, connection_features,
       channel_features);
 }
 
+/*
+ * _tp_observe_channels_context_set_channel_ready_func:
+ * @self: a context
+ * @func: called for each channel of @self that is successfully prepared,
+ *  as soon as the account and connection have also been prepared
+ * @user_data: data for @func
+ *
+ * Must be called before _tp_observe_channels_context_prepare_async().
+ */
+void
+_tp_observe_channels_context_set_channel_ready_func (
+    TpObserveChannelsContext *self,
+    TpObserveChannelsContextChannelReadyCb func,
+    gpointer user_data)
+{
+  g_return_if_fail (TP_IS_OBSERVE_CHANNELS_CONTEXT (self));
+  g_return_if_fail (self->priv->result == NULL);
+
+  self->priv->channel_ready = func;
+  self->priv->channel_ready_data = user_data;
+}
+
 gboolean
 _tp_observe_channels_context_prepare_finish (
     TpObserveChannelsContext *self,
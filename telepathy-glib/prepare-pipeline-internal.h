@@ -0,0 +1,57 @@
+/*<private_header>*/
+/*
+ * prepare-pipeline-internal.h - shared proxy preparation for TpBaseClient
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __TP_PREPARE_PIPELINE_INTERNAL_H__
+#define __TP_PREPARE_PIPELINE_INTERNAL_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TpPreparePipeline TpPreparePipeline;
+
+TpPreparePipeline *_tp_prepare_pipeline_new (void);
+
+TpPreparePipeline *_tp_prepare_pipeline_ref (TpPreparePipeline *self);
+void _tp_prepare_pipeline_unref (TpPreparePipeline *self);
+
+void _tp_prepare_pipeline_set_max_channels (TpPreparePipeline *self,
+    guint max_channels);
+
+void _tp_prepare_pipeline_get_stats (TpPreparePipeline *self,
+    guint *coalesced,
+    guint *queued,
+    guint *peak_running_channels);
+
+void _tp_prepare_pipeline_prepare_async (TpPreparePipeline *self,
+    gpointer proxy,
+    const GQuark *features,
+    GAsyncReadyCallback callback,
+    gpointer user_data);
+
+gboolean _tp_prepare_pipeline_prepare_finish (gpointer proxy,
+    GAsyncResult *result,
+    GError **error);
+
+G_END_DECLS
+
+#endif /* __TP_PREPARE_PIPELINE_INTERNAL_H__ */
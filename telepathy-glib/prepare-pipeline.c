@@ -0,0 +1,338 @@
+/*
+ * prepare-pipeline.c - shared proxy preparation for TpBaseClient
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "telepathy-glib/prepare-pipeline-internal.h"
+
+#include <telepathy-glib/channel.h>
+#include <telepathy-glib/proxy.h>
+#include <telepathy-glib/util.h>
+
+#define DEBUG_FLAG TP_DEBUG_CLIENT
+#include "telepathy-glib/debug-internal.h"
+#include "telepathy-glib/util-internal.h"
+
+/* When a client is told about a burst of channels, every dispatch context
+ * asks for the same account and connection to be prepared, usually with
+ * the same features. Rather than each of them making its own
+ * tp_proxy_prepare_async() call and waiting for it separately, the contexts
+ * share one pipeline per TpBaseClient: identical requests (same proxy, same
+ * features) that are in flight at the same time are served by a single
+ * call, and the number of channels being prepared at once can be limited,
+ * so that a burst doesn't flood the connection managers with introspection
+ * calls. Accounts, connections and dispatch operations are never held back,
+ * since every context is waiting for them. */
+
+struct _TpPreparePipeline
+{
+  gsize refcount;
+
+  /* owned key (see make_key()) => owned Request */
+  GHashTable *in_flight;
+  /* Requests for channels waiting for a slot, borrowed from in_flight */
+  GQueue queued;
+  /* 0 means no limit */
+  guint max_channels;
+  guint running_channels;
+
+  /* for debugging and the tests */
+  guint coalesced;
+  guint ever_queued;
+  guint peak_running_channels;
+};
+
+typedef struct
+{
+  TpPreparePipeline *pipeline;
+  gchar *key;
+  TpProxy *proxy;
+  GArray *features;
+  gboolean is_channel;
+  /* owned GSimpleAsyncResult */
+  GList *waiters;
+} Request;
+
+TpPreparePipeline *
+_tp_prepare_pipeline_new (void)
+{
+  TpPreparePipeline *self = g_slice_new0 (TpPreparePipeline);
+
+  self->refcount = 1;
+  self->in_flight = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, NULL);
+  g_queue_init (&self->queued);
+
+  return self;
+}
+
+TpPreparePipeline *
+_tp_prepare_pipeline_ref (TpPreparePipeline *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+
+  self->refcount++;
+  return self;
+}
+
+void
+_tp_prepare_pipeline_unref (TpPreparePipeline *self)
+{
+  g_return_if_fail (self != NULL);
+
+  if (--self->refcount > 0)
+    return;
+
+  /* every in-flight request holds a ref */
+  g_assert (g_hash_table_size (self->in_flight) == 0);
+  g_assert (g_queue_is_empty (&self->queued));
+
+  DEBUG ("%p: %u preparations shared, %u channels queued, at most %u "
+      "channels at once", self, self->coalesced, self->ever_queued,
+      self->peak_running_channels);
+
+  g_hash_table_unref (self->in_flight);
+  g_slice_free (TpPreparePipeline, self);
+}
+
+static gint
+compare_quarks (gconstpointer a,
+    gconstpointer b)
+{
+  GQuark qa = *(const GQuark *) a;
+  GQuark qb = *(const GQuark *) b;
+
+  return (qa > qb) - (qa < qb);
+}
+
+/* @features is sorted, so that the same set gives the same key */
+static gchar *
+make_key (gpointer proxy,
+    GArray *features)
+{
+  GString *key = g_string_new (NULL);
+  guint i;
+
+  g_string_append_printf (key, "%p", proxy);
+
+  for (i = 0; i < features->len; i++)
+    g_string_append_printf (key, ":%u", g_array_index (features, GQuark, i));
+
+  return g_string_free (key, FALSE);
+}
+
+static void request_start (Request *request);
+
+static void
+request_prepared_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Request *request = user_data;
+  TpPreparePipeline *self = request->pipeline;
+  GError *error = NULL;
+  GList *l;
+
+  tp_proxy_prepare_finish (source, result, &error);
+
+  /* Forget about this request before telling anyone, so that if they ask
+   * for more, it starts afresh */
+  g_hash_table_remove (self->in_flight, request->key);
+
+  if (request->is_channel)
+    {
+      Request *next;
+
+      self->running_channels--;
+
+      next = g_queue_pop_head (&self->queued);
+
+      if (next != NULL)
+        request_start (next);
+    }
+
+  request->waiters = g_list_reverse (request->waiters);
+
+  for (l = request->waiters; l != NULL; l = l->next)
+    {
+      GSimpleAsyncResult *waiter = l->data;
+
+      if (error != NULL)
+        g_simple_async_result_set_from_error (waiter, error);
+
+      g_simple_async_result_complete (waiter);
+    }
+
+  g_list_free_full (request->waiters, g_object_unref);
+  g_clear_error (&error);
+  g_object_unref (request->proxy);
+  g_array_unref (request->features);
+  /* the key was freed by the hash table */
+  g_slice_free (Request, request);
+
+  _tp_prepare_pipeline_unref (self);
+}
+
+static void
+request_start (Request *request)
+{
+  TpPreparePipeline *self = request->pipeline;
+
+  if (request->is_channel)
+    {
+      self->running_channels++;
+      self->peak_running_channels = MAX (self->peak_running_channels,
+          self->running_channels);
+    }
+
+  tp_proxy_prepare_async (request->proxy,
+      (const GQuark *) request->features->data, request_prepared_cb, request);
+}
+
+/*
+ * _tp_prepare_pipeline_prepare_async:
+ * @self: a pipeline
+ * @proxy: a #TpProxy
+ * @features: (allow-none): features to prepare, as for
+ *  tp_proxy_prepare_async()
+ * @callback: called when @features have been prepared, or have failed;
+ *  its source object is @proxy
+ * @user_data: data for @callback
+ *
+ * Like tp_proxy_prepare_async(), but if the same @features are already
+ * being prepared on @proxy through @self, wait for that instead. If @proxy
+ * is a channel, the preparation might be queued until fewer channels are
+ * being prepared.
+ */
+void
+_tp_prepare_pipeline_prepare_async (TpPreparePipeline *self,
+    gpointer proxy,
+    const GQuark *features,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  GSimpleAsyncResult *waiter;
+  GArray *sorted;
+  gchar *key;
+  Request *request;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (TP_IS_PROXY (proxy));
+
+  waiter = g_simple_async_result_new (proxy, callback, user_data,
+      _tp_prepare_pipeline_prepare_async);
+
+  sorted = _tp_quark_array_copy (features);
+  g_array_sort (sorted, compare_quarks);
+  key = make_key (proxy, sorted);
+
+  request = g_hash_table_lookup (self->in_flight, key);
+
+  if (request != NULL)
+    {
+      self->coalesced++;
+      request->waiters = g_list_prepend (request->waiters, waiter);
+      g_array_unref (sorted);
+      g_free (key);
+      return;
+    }
+
+  request = g_slice_new0 (Request);
+  request->pipeline = _tp_prepare_pipeline_ref (self);
+  request->key = key;
+  request->proxy = g_object_ref (proxy);
+  request->features = sorted;
+  request->is_channel = TP_IS_CHANNEL (proxy);
+  request->waiters = g_list_prepend (NULL, waiter);
+
+  g_hash_table_insert (self->in_flight, key, request);
+
+  if (request->is_channel && self->max_channels > 0
+      && self->running_channels >= self->max_channels)
+    {
+      DEBUG ("%p: %u channels already being prepared, queueing %s", self,
+          self->running_channels, tp_proxy_get_object_path (proxy));
+      g_queue_push_tail (&self->queued, request);
+      self->ever_queued++;
+      return;
+    }
+
+  request_start (request);
+}
+
+gboolean
+_tp_prepare_pipeline_prepare_finish (gpointer proxy,
+    GAsyncResult *result,
+    GError **error)
+{
+  _tp_implement_finish_void (proxy, _tp_prepare_pipeline_prepare_async);
+}
+
+/*
+ * _tp_prepare_pipeline_set_max_channels:
+ * @self: a pipeline
+ * @max_channels: the largest number of channels to prepare at the same
+ *  time, or 0 for no limit
+ *
+ * If the limit is raised, queued channels start straight away.
+ */
+void
+_tp_prepare_pipeline_set_max_channels (TpPreparePipeline *self,
+    guint max_channels)
+{
+  g_return_if_fail (self != NULL);
+
+  self->max_channels = max_channels;
+
+  while (!g_queue_is_empty (&self->queued)
+      && (self->max_channels == 0
+        || self->running_channels < self->max_channels))
+    request_start (g_queue_pop_head (&self->queued));
+}
+
+/*
+ * _tp_prepare_pipeline_get_stats:
+ * @self: a pipeline
+ * @coalesced: (out) (allow-none): the number of times a preparation was
+ *  shared with one already in flight
+ * @queued: (out) (allow-none): the number of channels that had to wait
+ *  for a slot
+ * @peak_running_channels: (out) (allow-none): the largest number of
+ *  channels that were being prepared at the same time
+ *
+ * Only for debugging and regression tests.
+ */
+void
+_tp_prepare_pipeline_get_stats (TpPreparePipeline *self,
+    guint *coalesced,
+    guint *queued,
+    guint *peak_running_channels)
+{
+  g_return_if_fail (self != NULL);
+
+  if (coalesced != NULL)
+    *coalesced = self->coalesced;
+
+  if (queued != NULL)
+    *queued = self->ever_queued;
+
+  if (peak_running_channels != NULL)
+    *peak_running_channels = self->peak_running_channels;
+}
@@ -0,0 +1,339 @@
+/*
+ * progress-throttle.c - rate-limited progress reporting
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * SECTION:progress-throttle
+ * @title: TpProgressThrottle
+ * @short_description: rate-limited progress reporting
+ *
+ * A #TpProgressThrottle sits between something which makes progress in
+ * many small steps, such as a file transfer copying data one chunk at a
+ * time, and whoever reports that progress, such as a connection manager
+ * emitting the TransferredBytesChanged D-Bus signal.
+ *
+ * Each new value is passed to tp_progress_throttle_update(). It is reported
+ * straight away if at least the throttle's interval has passed since the
+ * previous report and the value has moved on by at least its minimum step.
+ * Otherwise it is held back: once the value has moved on far enough, the
+ * latest one is reported when the interval has passed, but smaller steps
+ * are held until later progress makes up the difference. Fast transfers are
+ * therefore reported at a fixed rate no matter how small their chunks,
+ * while slow ones are still reported at every step. Call
+ * tp_progress_throttle_flush() when the operation completes, so that the
+ * final value is always reported exactly.
+ *
+ * Connection managers can use tp_progress_throttle_new_for_file_transfer()
+ * to rate-limit TransferredBytesChanged on their file transfer channels:
+ *
+ * |[
+ * // when the channel is created
+ * self->priv->progress = tp_progress_throttle_new_for_file_transfer (
+ *     TP_SVC_CHANNEL_TYPE_FILE_TRANSFER (self), 250, 0);
+ *
+ * // whenever some data has been copied
+ * self->priv->transferred_bytes += count;
+ * tp_progress_throttle_update (self->priv->progress,
+ *     self->priv->transferred_bytes);
+ *
+ * // when the transfer completes
+ * tp_progress_throttle_flush (self->priv->progress);
+ * // ... then emit FileTransferStateChanged
+ *
+ * // in dispose
+ * tp_clear_pointer (&self->priv->progress, tp_progress_throttle_destroy);
+ * ]|
+ *
+ * Since: 0.UNRELEASED
+ */
+
+/**
+ * TpProgressThrottleFunc:
+ * @value: the progress to report
+ * @user_data: the user data passed to tp_progress_throttle_new()
+ *
+ * Signature of the function called by a #TpProgressThrottle when some
+ * progress should be reported.
+ *
+ * Since: 0.UNRELEASED
+ */
+
+#include "config.h"
+
+#include <telepathy-glib/progress-throttle.h>
+
+/**
+ * TpProgressThrottle:
+ *
+ * Structure representing a progress throttle. All fields are private.
+ *
+ * Since: 0.UNRELEASED
+ */
+struct _TpProgressThrottle
+{
+  gint64 interval;
+  guint64 min_step;
+  TpProgressThrottleFunc func;
+  gpointer user_data;
+
+  /* for tp_progress_throttle_new_for_file_transfer(); weak */
+  GObject *channel;
+
+  gboolean reported_any;
+  guint64 reported;
+  gint64 reported_time;
+
+  gboolean has_pending;
+  guint64 pending;
+  guint timeout_id;
+};
+
+/**
+ * tp_progress_throttle_new:
+ * @interval_ms: the minimum time between two reports, in milliseconds
+ * @min_step: the minimum progress between two reports, other than the
+ *  final one
+ * @func: the function to call to report progress
+ * @user_data: data to pass to @func
+ *
+ * Create a new progress throttle. If both @interval_ms and @min_step are 0,
+ * every value passed to tp_progress_throttle_update() is reported
+ * immediately.
+ *
+ * Returns: a new #TpProgressThrottle, to be freed with
+ *  tp_progress_throttle_destroy()
+ *
+ * Since: 0.UNRELEASED
+ */
+TpProgressThrottle *
+tp_progress_throttle_new (guint interval_ms,
+    guint64 min_step,
+    TpProgressThrottleFunc func,
+    gpointer user_data)
+{
+  TpProgressThrottle *self;
+
+  g_return_val_if_fail (func != NULL, NULL);
+
+  self = g_slice_new0 (TpProgressThrottle);
+  self->interval = (gint64) interval_ms * 1000;
+  self->min_step = min_step;
+  self->func = func;
+  self->user_data = user_data;
+
+  return self;
+}
+
+static void
+emit_transferred_bytes_changed (guint64 value,
+    gpointer user_data)
+{
+  TpProgressThrottle *self = user_data;
+
+  /* the channel is gone, so there's nobody to tell */
+  if (self->channel == NULL)
+    return;
+
+  tp_svc_channel_type_file_transfer_emit_transferred_bytes_changed (
+      self->channel, value);
+}
+
+/**
+ * tp_progress_throttle_new_for_file_transfer:
+ * @channel: a service-side file transfer channel
+ * @interval_ms: the minimum time between two signals, in milliseconds
+ * @min_step: the minimum number of bytes transferred between two signals,
+ *  other than the final one
+ *
+ * Create a new progress throttle which emits TransferredBytesChanged on
+ * @channel. The throttle does not keep a reference to @channel; if @channel
+ * is finalized first, the throttle stops reporting progress.
+ *
+ * Returns: a new #TpProgressThrottle, to be freed with
+ *  tp_progress_throttle_destroy()
+ *
+ * Since: 0.UNRELEASED
+ */
+TpProgressThrottle *
+tp_progress_throttle_new_for_file_transfer (
+    TpSvcChannelTypeFileTransfer *channel,
+    guint interval_ms,
+    guint64 min_step)
+{
+  TpProgressThrottle *self;
+
+  g_return_val_if_fail (TP_IS_SVC_CHANNEL_TYPE_FILE_TRANSFER (channel), NULL);
+
+  self = tp_progress_throttle_new (interval_ms, min_step,
+      emit_transferred_bytes_changed, NULL);
+  self->user_data = self;
+  self->channel = (GObject *) channel;
+  g_object_add_weak_pointer (self->channel, (gpointer *) &self->channel);
+
+  return self;
+}
+
+/**
+ * tp_progress_throttle_destroy:
+ * @self: a #TpProgressThrottle
+ *
+ * Free a #TpProgressThrottle. Any progress which has not been reported yet
+ * is discarded; call tp_progress_throttle_flush() first if it matters.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_progress_throttle_destroy (TpProgressThrottle *self)
+{
+  g_return_if_fail (self != NULL);
+
+  if (self->timeout_id != 0)
+    g_source_remove (self->timeout_id);
+
+  if (self->channel != NULL)
+    g_object_remove_weak_pointer (self->channel, (gpointer *) &self->channel);
+
+  g_slice_free (TpProgressThrottle, self);
+}
+
+/**
+ * tp_progress_throttle_set_thresholds:
+ * @self: a #TpProgressThrottle
+ * @interval_ms: the minimum time between two reports, in milliseconds
+ * @min_step: the minimum progress between two reports, other than the
+ *  final one
+ *
+ * Change the thresholds passed to tp_progress_throttle_new(). They apply
+ * from the next call to tp_progress_throttle_update().
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_progress_throttle_set_thresholds (TpProgressThrottle *self,
+    guint interval_ms,
+    guint64 min_step)
+{
+  g_return_if_fail (self != NULL);
+
+  self->interval = (gint64) interval_ms * 1000;
+  self->min_step = min_step;
+}
+
+static void
+report (TpProgressThrottle *self,
+    gint64 now)
+{
+  self->reported_any = TRUE;
+  self->reported = self->pending;
+  self->reported_time = now;
+  self->has_pending = FALSE;
+
+  self->func (self->reported, self->user_data);
+}
+
+static gboolean
+step_reached (TpProgressThrottle *self)
+{
+  /* Going backwards means the operation was restarted, which is worth
+   * reporting straight away. */
+  return (!self->reported_any ||
+      self->pending < self->reported ||
+      self->pending - self->reported >= self->min_step);
+}
+
+static gboolean
+interval_elapsed_cb (gpointer user_data)
+{
+  TpProgressThrottle *self = user_data;
+
+  self->timeout_id = 0;
+
+  if (self->has_pending && step_reached (self))
+    report (self, g_get_monotonic_time ());
+
+  return FALSE;
+}
+
+/**
+ * tp_progress_throttle_update:
+ * @self: a #TpProgressThrottle
+ * @value: the current progress
+ *
+ * Record some progress, reporting it now or later depending on the
+ * throttle's thresholds.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_progress_throttle_update (TpProgressThrottle *self,
+    guint64 value)
+{
+  gint64 now, elapsed;
+
+  g_return_if_fail (self != NULL);
+
+  self->pending = value;
+  self->has_pending = TRUE;
+
+  /* The latest value will be considered when the timeout fires */
+  if (self->timeout_id != 0)
+    return;
+
+  /* Too small a step: hold it back until there's more progress, or until
+   * the operation is flushed */
+  if (!step_reached (self))
+    return;
+
+  now = g_get_monotonic_time ();
+  elapsed = now - self->reported_time;
+
+  if (!self->reported_any || elapsed >= self->interval)
+    report (self, now);
+  else
+    self->timeout_id = g_timeout_add (
+        (self->interval - elapsed + 999) / 1000, interval_elapsed_cb, self);
+}
+
+/**
+ * tp_progress_throttle_flush:
+ * @self: a #TpProgressThrottle
+ *
+ * Report the latest value passed to tp_progress_throttle_update() now, if
+ * it has not already been reported, regardless of the thresholds. This
+ * should be called when the operation is finished, successfully or not.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_progress_throttle_flush (TpProgressThrottle *self)
+{
+  g_return_if_fail (self != NULL);
+
+  if (self->timeout_id != 0)
+    {
+      g_source_remove (self->timeout_id);
+      self->timeout_id = 0;
+    }
+
+  if (self->has_pending &&
+      (!self->reported_any || self->pending != self->reported))
+    report (self, g_get_monotonic_time ());
+  else
+    self->has_pending = FALSE;
+}
@@ -0,0 +1,69 @@
+/*
+ * progress-throttle.h - rate-limited progress reporting
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#if defined (TP_DISABLE_SINGLE_INCLUDE) && !defined (_TP_IN_META_HEADER) && !defined (_TP_COMPILATION)
+#error "Only <telepathy-glib/telepathy-glib.h> and <telepathy-glib/telepathy-glib-dbus.h> can be included directly."
+#endif
+
+#ifndef __TP_PROGRESS_THROTTLE_H__
+#define __TP_PROGRESS_THROTTLE_H__
+
+#include <glib.h>
+
+#include <telepathy-glib/defs.h>
+#include <telepathy-glib/svc-channel.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TpProgressThrottle TpProgressThrottle;
+
+typedef void (*TpProgressThrottleFunc) (guint64 value,
+    gpointer user_data);
+
+_TP_AVAILABLE_IN_UNRELEASED
+TpProgressThrottle *tp_progress_throttle_new (guint interval_ms,
+    guint64 min_step,
+    TpProgressThrottleFunc func,
+    gpointer user_data) G_GNUC_WARN_UNUSED_RESULT;
+
+_TP_AVAILABLE_IN_UNRELEASED
+TpProgressThrottle *tp_progress_throttle_new_for_file_transfer (
+    TpSvcChannelTypeFileTransfer *channel,
+    guint interval_ms,
+    guint64 min_step) G_GNUC_WARN_UNUSED_RESULT;
+
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_progress_throttle_destroy (TpProgressThrottle *self);
+
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_progress_throttle_set_thresholds (TpProgressThrottle *self,
+    guint interval_ms,
+    guint64 min_step);
+
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_progress_throttle_update (TpProgressThrottle *self,
+    guint64 value);
+
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_progress_throttle_flush (TpProgressThrottle *self);
+
+G_END_DECLS
+
+#endif
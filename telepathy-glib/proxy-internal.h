@@ -35,6 +35,9 @@ void _tp_proxy_set_feature_prepared (TpProxy *self,
     gboolean succeeded);
 void _tp_proxy_set_features_failed (TpProxy *self,
     const GError *error);
+gint64 _tp_proxy_get_feature_prepare_time (TpProxy *self,
+    GQuark feature);
+gconstpointer _tp_proxy_get_feature_graph (TpProxy *self);
 
 void _tp_proxy_will_announce_connected_async (TpProxy *self,
     GAsyncReadyCallback callback,
@@ -47,4 +50,10 @@ gboolean _tp_proxy_will_announce_connected_finish (TpProxy *self,
 void _tp_proxy_ensure_factory (gpointer self,
     TpSimpleClientFactory *factory);
 
+gboolean _tp_proxy_check_interface_by_id (TpProxy *self,
+    GQuark iface,
+    GError **error);
+
+void _tp_proxy_name_owner_lost (TpProxy *self);
+
 #endif
@@ -20,6 +20,10 @@
 #include "config.h"
 
 #include "telepathy-glib/proxy-subclass.h"
+#include "telepathy-glib/proxy-internal.h"
+
+#include <dbus/dbus.h>
+#include <dbus/dbus-glib-lowlevel.h>
 
 #define DEBUG_FLAG TP_DEBUG_PROXY
 #include "telepathy-glib/debug-internal.h"
@@ -40,6 +44,7 @@
  */
 
 typedef struct _TpProxySignalInvocation TpProxySignalInvocation;
+typedef struct _ObjectWatch ObjectWatch;
 
 struct _TpProxySignalInvocation {
     TpProxySignalConnection *sc;
@@ -59,8 +64,16 @@ struct _TpProxySignalConnection {
      * + 1 per callback being invoked (possibly nested!) right now */
     TpProxy *proxy;
 
+    /* Exactly one of these is non-NULL while we're connected: the
+     * DBusGProxy that will call collect_args, or the ObjectWatch that will
+     * give us the arguments directly */
     DBusGProxy *iface_proxy;
+    ObjectWatch *watch;
+
+    GQuark iface;
     gchar *member;
+    /* G_TYPE_INVALID-terminated */
+    GType *expected_types;
     GCallback collect_args;
     TpProxyInvokeFunc invoke_callback;
     GCallback callback;
@@ -75,11 +88,701 @@ struct _TpProxySignalConnection {
 static void _tp_proxy_signal_connection_dgproxy_destroy (DBusGProxy *,
     TpProxySignalConnection *);
 
+/* Proxies for objects on unique names (channels, connections and so on)
+ * don't use a DBusGProxy per interface for their signals, since each of
+ * those has its own match rule and its own dispatching. Instead, each such
+ * proxy has a single ObjectWatch with a single match rule for all signals
+ * from its object, and the SignalRouter for its DBusConnection dispatches
+ * signals to the right TpProxySignalConnection by path, sender, interface
+ * and member.
+ *
+ * Without a DBusGProxy, nothing would invalidate the proxy when its unique
+ * name goes away, so the SignalRouter also watches NameOwnerChanged for
+ * each unique name it has ObjectWatches for, with one match rule per name
+ * however many objects it has, and does what the DBusGProxy's "destroy"
+ * handler would have.
+ *
+ * We can't do this for objects on well-known names, because signals come
+ * from the unique name, and we'd have to track the owner ourselves;
+ * dbus-glib already does that. */
+
+typedef struct {
+    /* object path => GSList of borrowed ObjectWatch */
+    GHashTable *watches_by_path;
+    /* unique name => GSList of borrowed ObjectWatch */
+    GHashTable *watches_by_sender;
+} SignalRouter;
+
+struct _ObjectWatch {
+    /* borrowed: the watch is qdata on the proxy, so can't outlive it */
+    TpProxy *proxy;
+    /* reffed, to keep the SignalRouter alive */
+    DBusConnection *libdbus;
+    SignalRouter *router;
+    gchar *sender;
+    gchar *path;
+    /* "interface.member" => GPtrArray of borrowed TpProxySignalConnection,
+     * in the order they were connected */
+    GHashTable *connections;
+};
+
+static dbus_int32_t router_slot = -1;
+
+static GQuark
+object_watch_quark (void)
+{
+  static GQuark q = 0;
+
+  if (G_UNLIKELY (q == 0))
+    q = g_quark_from_static_string ("tp-proxy-signal-object-watch");
+
+  return q;
+}
+
+static gchar *
+object_watch_dup_match_rule (ObjectWatch *watch)
+{
+  return g_strdup_printf ("type='signal',sender='%s',path='%s'",
+      watch->sender, watch->path);
+}
+
+/* One per sender, shared by all its ObjectWatches */
+static gchar *
+dup_owner_match_rule (const gchar *sender)
+{
+  return g_strdup_printf ("type='signal',sender='" DBUS_SERVICE_DBUS "',"
+      "path='" DBUS_PATH_DBUS "',interface='" DBUS_INTERFACE_DBUS "',"
+      "member='NameOwnerChanged',arg0='%s'", sender);
+}
+
+/* Returns TRUE if @watch is the first one for @key */
+static gboolean
+watches_table_add (GHashTable *table,
+    const gchar *key,
+    ObjectWatch *watch)
+{
+  GSList *watches = g_hash_table_lookup (table, key);
+
+  g_hash_table_insert (table, g_strdup (key),
+      g_slist_prepend (watches, watch));
+
+  return (watches == NULL);
+}
+
+/* Returns TRUE if @watch was the last one for @key */
+static gboolean
+watches_table_remove (GHashTable *table,
+    const gchar *key,
+    ObjectWatch *watch)
+{
+  GSList *watches = g_hash_table_lookup (table, key);
+
+  watches = g_slist_remove (watches, watch);
+
+  if (watches == NULL)
+    {
+      g_hash_table_remove (table, key);
+      return TRUE;
+    }
+
+  g_hash_table_insert (table, g_strdup (key), watches);
+  return FALSE;
+}
+
+static gchar *
+signal_key (const gchar *iface,
+    const gchar *member)
+{
+  /* member names can't contain '.', so this is unambiguous */
+  return g_strdup_printf ("%s.%s", iface, member);
+}
+
+/* Returns a new floating variant, or NULL if @iter points to something
+ * we can't represent (a Unix fd) */
+static GVariant *
+variant_from_message_iter (DBusMessageIter *iter)
+{
+  switch (dbus_message_iter_get_arg_type (iter))
+    {
+      case DBUS_TYPE_BYTE:
+        {
+          guchar v;
+
+          dbus_message_iter_get_basic (iter, &v);
+          return g_variant_new_byte (v);
+        }
+
+      case DBUS_TYPE_BOOLEAN:
+        {
+          dbus_bool_t v;
+
+          dbus_message_iter_get_basic (iter, &v);
+          return g_variant_new_boolean (v);
+        }
+
+      case DBUS_TYPE_INT16:
+        {
+          dbus_int16_t v;
+
+          dbus_message_iter_get_basic (iter, &v);
+          return g_variant_new_int16 (v);
+        }
+
+      case DBUS_TYPE_UINT16:
+        {
+          dbus_uint16_t v;
+
+          dbus_message_iter_get_basic (iter, &v);
+          return g_variant_new_uint16 (v);
+        }
+
+      case DBUS_TYPE_INT32:
+        {
+          dbus_int32_t v;
+
+          dbus_message_iter_get_basic (iter, &v);
+          return g_variant_new_int32 (v);
+        }
+
+      case DBUS_TYPE_UINT32:
+        {
+          dbus_uint32_t v;
+
+          dbus_message_iter_get_basic (iter, &v);
+          return g_variant_new_uint32 (v);
+        }
+
+      case DBUS_TYPE_INT64:
+        {
+          dbus_int64_t v;
+
+          dbus_message_iter_get_basic (iter, &v);
+          return g_variant_new_int64 (v);
+        }
+
+      case DBUS_TYPE_UINT64:
+        {
+          dbus_uint64_t v;
+
+          dbus_message_iter_get_basic (iter, &v);
+          return g_variant_new_uint64 (v);
+        }
+
+      case DBUS_TYPE_DOUBLE:
+        {
+          double v;
+
+          dbus_message_iter_get_basic (iter, &v);
+          return g_variant_new_double (v);
+        }
+
+      /* libdbus has already validated these */
+      case DBUS_TYPE_STRING:
+        {
+          const gchar *v;
+
+          dbus_message_iter_get_basic (iter, &v);
+          return g_variant_new_string (v);
+        }
+
+      case DBUS_TYPE_OBJECT_PATH:
+        {
+          const gchar *v;
+
+          dbus_message_iter_get_basic (iter, &v);
+          return g_variant_new_object_path (v);
+        }
+
+      case DBUS_TYPE_SIGNATURE:
+        {
+          const gchar *v;
+
+          dbus_message_iter_get_basic (iter, &v);
+          return g_variant_new_signature (v);
+        }
+
+      case DBUS_TYPE_VARIANT:
+        {
+          DBusMessageIter sub;
+          GVariant *child;
+
+          dbus_message_iter_recurse (iter, &sub);
+          child = variant_from_message_iter (&sub);
+
+          if (child == NULL)
+            return NULL;
+
+          return g_variant_new_variant (child);
+        }
+
+      case DBUS_TYPE_ARRAY:
+      case DBUS_TYPE_STRUCT:
+      case DBUS_TYPE_DICT_ENTRY:
+        {
+          /* D-Bus signatures are valid GVariant type strings */
+          gchar *signature = dbus_message_iter_get_signature (iter);
+          GVariantBuilder builder;
+          DBusMessageIter sub;
+
+          g_variant_builder_init (&builder, G_VARIANT_TYPE (signature));
+          dbus_free (signature);
+
+          dbus_message_iter_recurse (iter, &sub);
+
+          while (dbus_message_iter_get_arg_type (&sub) != DBUS_TYPE_INVALID)
+            {
+              GVariant *child = variant_from_message_iter (&sub);
+
+              if (child == NULL)
+                {
+                  g_variant_builder_clear (&builder);
+                  return NULL;
+                }
+
+              g_variant_builder_add_value (&builder, child);
+              dbus_message_iter_next (&sub);
+            }
+
+          return g_variant_builder_end (&builder);
+        }
+
+      default:
+        return NULL;
+    }
+}
+
+/* Returns a GPtrArray of reffed GVariant, one per argument, or NULL */
+static GPtrArray *
+variants_from_message (DBusMessage *message)
+{
+  GPtrArray *args = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) g_variant_unref);
+  DBusMessageIter iter;
+
+  dbus_message_iter_init (message, &iter);
+
+  while (dbus_message_iter_get_arg_type (&iter) != DBUS_TYPE_INVALID)
+    {
+      GVariant *arg = variant_from_message_iter (&iter);
+
+      if (arg == NULL)
+        {
+          g_ptr_array_unref (args);
+          return NULL;
+        }
+
+      g_ptr_array_add (args, g_variant_ref_sink (arg));
+      dbus_message_iter_next (&iter);
+    }
+
+  return args;
+}
+
+/* Returns the arguments in the form the collect_args callback would have
+ * produced them, or NULL if they're not what @sc expects */
+static GValueArray *
+value_array_from_variants (TpProxySignalConnection *sc,
+    GPtrArray *variants)
+{
+  GValueArray *args;
+  guint i;
+
+  for (i = 0; sc->expected_types[i] != G_TYPE_INVALID; i++)
+    ;
+
+  if (i != variants->len)
+    return NULL;
+
+  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  args = g_value_array_new (variants->len);
+
+  for (i = 0; i < variants->len; i++)
+    {
+      GValue value = G_VALUE_INIT;
+
+      dbus_g_value_parse_g_variant (g_ptr_array_index (variants, i), &value);
+
+      if (G_VALUE_TYPE (&value) != sc->expected_types[i])
+        {
+          g_value_unset (&value);
+          g_value_array_free (args);
+          return NULL;
+        }
+
+      g_value_array_append (args, &value);
+      g_value_unset (&value);
+    }
+  G_GNUC_END_IGNORE_DEPRECATIONS
+
+  return args;
+}
+
+static void
+signal_router_name_owner_changed (SignalRouter *router,
+    DBusMessage *message)
+{
+  const gchar *name, *old_owner, *new_owner;
+  GSList *watches;
+  GPtrArray *lost;
+  guint i;
+
+  if (!dbus_message_get_args (message, NULL,
+        DBUS_TYPE_STRING, &name,
+        DBUS_TYPE_STRING, &old_owner,
+        DBUS_TYPE_STRING, &new_owner,
+        DBUS_TYPE_INVALID))
+    return;
+
+  /* a unique name never gets a new owner, it just goes away */
+  if (new_owner[0] != '\0')
+    return;
+
+  watches = g_hash_table_lookup (router->watches_by_sender, name);
+
+  if (watches == NULL)
+    return;
+
+  /* invalidating a proxy eventually destroys its watch, so don't do it
+   * while we're iterating over them */
+  lost = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (; watches != NULL; watches = watches->next)
+    {
+      ObjectWatch *watch = watches->data;
+
+      g_ptr_array_add (lost, g_object_ref (watch->proxy));
+    }
+
+  for (i = 0; i < lost->len; i++)
+    {
+      DEBUG ("%s lost its owner, invalidating %p", name,
+          g_ptr_array_index (lost, i));
+      _tp_proxy_name_owner_lost (g_ptr_array_index (lost, i));
+    }
+
+  g_ptr_array_unref (lost);
+}
+
+static DBusHandlerResult
+signal_router_filter (DBusConnection *libdbus,
+    DBusMessage *message,
+    void *user_data)
+{
+  SignalRouter *router = user_data;
+  const gchar *path, *sender, *iface, *member;
+  GSList *watches;
+  gchar *key;
+  GPtrArray *variants = NULL;
+
+  if (dbus_message_get_type (message) != DBUS_MESSAGE_TYPE_SIGNAL)
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  if (dbus_message_is_signal (message, DBUS_INTERFACE_DBUS,
+        "NameOwnerChanged") &&
+      !tp_strdiff (dbus_message_get_sender (message), DBUS_SERVICE_DBUS))
+    {
+      signal_router_name_owner_changed (router, message);
+      /* TpDBusDaemon and dbus-glib want to see this too */
+      return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+  path = dbus_message_get_path (message);
+  sender = dbus_message_get_sender (message);
+  iface = dbus_message_get_interface (message);
+  member = dbus_message_get_member (message);
+
+  if (path == NULL || sender == NULL || iface == NULL || member == NULL)
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  watches = g_hash_table_lookup (router->watches_by_path, path);
+
+  if (watches == NULL)
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  key = signal_key (iface, member);
+
+  for (; watches != NULL; watches = watches->next)
+    {
+      ObjectWatch *watch = watches->data;
+      GPtrArray *connections;
+      guint i;
+
+      if (tp_strdiff (watch->sender, sender))
+        continue;
+
+      connections = g_hash_table_lookup (watch->connections, key);
+
+      if (connections == NULL)
+        continue;
+
+      if (variants == NULL)
+        {
+          variants = variants_from_message (message);
+
+          if (variants == NULL)
+            {
+              DEBUG ("ignoring %s from %s%s: can't represent its arguments",
+                  key, sender, path);
+              break;
+            }
+        }
+
+      /* Nothing here calls back into user code: the callbacks are run
+       * from idles queued by take_results */
+      for (i = 0; i < connections->len; i++)
+        {
+          TpProxySignalConnection *sc = g_ptr_array_index (connections, i);
+          GValueArray *args = NULL;
+
+          /* signals with no arguments get NULL, as with collect_none() */
+          if (sc->expected_types[0] == G_TYPE_INVALID && variants->len == 0)
+            {
+              tp_proxy_signal_connection_v0_take_results (sc, NULL);
+              continue;
+            }
+
+          args = value_array_from_variants (sc, variants);
+
+          if (args == NULL)
+            {
+              DEBUG ("ignoring %s from %s%s: unexpected arguments", key,
+                  sender, path);
+              continue;
+            }
+
+          tp_proxy_signal_connection_v0_take_results (sc, args);
+        }
+    }
+
+  if (variants != NULL)
+    g_ptr_array_unref (variants);
+
+  g_free (key);
+
+  /* dbus-glib might have DBusGProxies for the same object (for method
+   * calls), so let it see the message too */
+  return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+static void
+signal_router_free (gpointer p)
+{
+  SignalRouter *router = p;
+
+  g_hash_table_unref (router->watches_by_path);
+  g_hash_table_unref (router->watches_by_sender);
+  g_slice_free (SignalRouter, router);
+}
+
+static SignalRouter *
+signal_router_get (DBusConnection *libdbus)
+{
+  SignalRouter *router;
+
+  /* never released: it's one slot per process */
+  if (router_slot == -1 && !dbus_connection_allocate_data_slot (&router_slot))
+    ERROR ("Out of memory");
+
+  router = dbus_connection_get_data (libdbus, router_slot);
+
+  if (router == NULL)
+    {
+      router = g_slice_new0 (SignalRouter);
+      router->watches_by_path = g_hash_table_new_full (g_str_hash,
+          g_str_equal, g_free, NULL);
+      router->watches_by_sender = g_hash_table_new_full (g_str_hash,
+          g_str_equal, g_free, NULL);
+
+      if (!dbus_connection_set_data (libdbus, router_slot, router,
+            signal_router_free))
+        ERROR ("Out of memory");
+
+      /* we add this filter at most once per DBusConnection, and it goes
+       * away with the DBusConnection */
+      if (!dbus_connection_add_filter (libdbus, signal_router_filter,
+            router, NULL))
+        ERROR ("Out of memory");
+    }
+
+  return router;
+}
+
+static gboolean tp_proxy_signal_connection_unref (TpProxySignalConnection *);
+
+static void
+object_watch_destroy (gpointer p)
+{
+  ObjectWatch *watch = p;
+  GHashTableIter iter;
+  gpointer v;
+  gchar *rule;
+  GPtrArray *dropped = g_ptr_array_new ();
+  gboolean last_for_sender;
+  guint i;
+
+  watches_table_remove (watch->router->watches_by_path, watch->path, watch);
+  last_for_sender = watches_table_remove (watch->router->watches_by_sender,
+      watch->sender, watch);
+
+  rule = object_watch_dup_match_rule (watch);
+  DEBUG ("Removing match rule %s", rule);
+  dbus_bus_remove_match (watch->libdbus, rule, NULL);
+  g_free (rule);
+
+  if (last_for_sender)
+    {
+      rule = dup_owner_match_rule (watch->sender);
+      DEBUG ("Removing match rule %s", rule);
+      dbus_bus_remove_match (watch->libdbus, rule, NULL);
+      g_free (rule);
+    }
+
+  /* anything still connected won't get any more signals */
+  g_hash_table_iter_init (&iter, watch->connections);
+
+  while (g_hash_table_iter_next (&iter, NULL, &v))
+    {
+      GPtrArray *connections = v;
+
+      for (i = 0; i < connections->len; i++)
+        {
+          TpProxySignalConnection *sc = g_ptr_array_index (connections, i);
+
+          g_assert (sc->watch == watch);
+          sc->watch = NULL;
+          g_ptr_array_add (dropped, sc);
+        }
+    }
+
+  g_hash_table_unref (watch->connections);
+  dbus_connection_unref (watch->libdbus);
+  g_free (watch->sender);
+  g_free (watch->path);
+  g_slice_free (ObjectWatch, watch);
+
+  /* Release the ref that each connection had because we had it, as
+   * dbus-glib would when dropping the closure. This can call user code
+   * (the destroy notifications), so do it after we've gone away. */
+  for (i = 0; i < dropped->len; i++)
+    tp_proxy_signal_connection_unref (g_ptr_array_index (dropped, i));
+
+  g_ptr_array_unref (dropped);
+}
+
+static void
+object_watch_proxy_invalidated (TpProxy *proxy,
+    guint domain,
+    gint code,
+    const gchar *message,
+    gpointer unused)
+{
+  /* destroys the ObjectWatch */
+  g_object_set_qdata ((GObject *) proxy, object_watch_quark (), NULL);
+}
+
+static ObjectWatch *
+object_watch_ensure (TpProxy *proxy)
+{
+  ObjectWatch *watch = g_object_get_qdata ((GObject *) proxy,
+      object_watch_quark ());
+  gboolean first_for_sender;
+  gchar *rule;
+
+  if (watch != NULL)
+    return watch;
+
+  watch = g_slice_new0 (ObjectWatch);
+  watch->proxy = proxy;
+  watch->libdbus = dbus_connection_ref (
+      dbus_g_connection_get_connection (proxy->dbus_connection));
+  watch->router = signal_router_get (watch->libdbus);
+  watch->sender = g_strdup (proxy->bus_name);
+  watch->path = g_strdup (proxy->object_path);
+  watch->connections = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, (GDestroyNotify) g_ptr_array_unref);
+
+  watches_table_add (watch->router->watches_by_path, watch->path, watch);
+  first_for_sender = watches_table_add (watch->router->watches_by_sender,
+      watch->sender, watch);
+
+  /* Assume the match additions will succeed, as in TpDBusDaemon */
+  rule = object_watch_dup_match_rule (watch);
+  DEBUG ("Adding match rule %s", rule);
+  dbus_bus_add_match (watch->libdbus, rule, NULL);
+  g_free (rule);
+
+  /* Every object on a sender goes away with it, so they can all share one
+   * rule for its NameOwnerChanged */
+  if (first_for_sender)
+    {
+      rule = dup_owner_match_rule (watch->sender);
+      DEBUG ("Adding match rule %s", rule);
+      dbus_bus_add_match (watch->libdbus, rule, NULL);
+      g_free (rule);
+    }
+
+  g_object_set_qdata_full ((GObject *) proxy, object_watch_quark (), watch,
+      object_watch_destroy);
+  g_signal_connect (proxy, "invalidated",
+      G_CALLBACK (object_watch_proxy_invalidated), NULL);
+
+  return watch;
+}
+
+static void
+object_watch_add (ObjectWatch *watch,
+    TpProxySignalConnection *sc)
+{
+  gchar *key = signal_key (g_quark_to_string (sc->iface), sc->member);
+  GPtrArray *connections = g_hash_table_lookup (watch->connections, key);
+
+  if (connections == NULL)
+    {
+      connections = g_ptr_array_new ();
+      /* steals @key */
+      g_hash_table_insert (watch->connections, key, connections);
+    }
+  else
+    {
+      g_free (key);
+    }
+
+  g_ptr_array_add (connections, sc);
+  sc->watch = watch;
+}
+
+static void
+object_watch_remove (ObjectWatch *watch,
+    TpProxySignalConnection *sc)
+{
+  gchar *key = signal_key (g_quark_to_string (sc->iface), sc->member);
+  GPtrArray *connections = g_hash_table_lookup (watch->connections, key);
+
+  g_assert (sc->watch == watch);
+  sc->watch = NULL;
+
+  if (connections != NULL)
+    {
+      g_ptr_array_remove (connections, sc);
+
+      if (connections->len == 0)
+        g_hash_table_remove (watch->connections, key);
+    }
+
+  g_free (key);
+
+  /* the equivalent of tp_proxy_signal_connection_dropped() */
+  tp_proxy_signal_connection_unref (sc);
+}
+
 static void
 tp_proxy_signal_connection_disconnect_dbus_glib (TpProxySignalConnection *sc)
 {
   DBusGProxy *iface_proxy = sc->iface_proxy;
 
+  if (sc->watch != NULL)
+    object_watch_remove (sc->watch, sc);
+
   /* ignore if already done */
   if (iface_proxy == NULL)
     return;
@@ -175,6 +878,7 @@ tp_proxy_signal_connection_unref (TpProxySignalConnection *sc)
   sc->user_data = NULL;
 
   g_free (sc->member);
+  g_free (sc->expected_types);
 
   /* We can't inline this here, because of fd.o #14750. If our signal
    * connection gets destroyed by side-effects of something else losing a
@@ -371,15 +1075,30 @@ tp_proxy_signal_connection_v0_new (TpProxy *self,
                                    GError **error)
 {
   TpProxySignalConnection *sc;
-  DBusGProxy *iface_proxy = tp_proxy_get_interface_by_id (self,
-      iface, error);
+  DBusGProxy *iface_proxy = NULL;
+  guint n_types;
 
-  if (iface_proxy == NULL)
+  if (self->bus_name[0] == ':')
     {
-      if (destroy != NULL)
-        destroy (user_data);
+      if (!_tp_proxy_check_interface_by_id (self, iface, error))
+        {
+          if (destroy != NULL)
+            destroy (user_data);
 
-      return NULL;
+          return NULL;
+        }
+    }
+  else
+    {
+      iface_proxy = tp_proxy_get_interface_by_id (self, iface, error);
+
+      if (iface_proxy == NULL)
+        {
+          if (destroy != NULL)
+            destroy (user_data);
+
+          return NULL;
+        }
     }
 
   if (expected_types[0] == G_TYPE_INVALID)
@@ -398,10 +1117,15 @@ tp_proxy_signal_connection_v0_new (TpProxy *self,
       self, g_quark_to_string (iface), member, collect_args,
       invoke_callback, callback, user_data, destroy, weak_object, sc);
 
+  for (n_types = 0; expected_types[n_types] != G_TYPE_INVALID; n_types++)
+    ;
+
   sc->refcount = 1;
   sc->proxy = self;
-  sc->iface_proxy = g_object_ref (iface_proxy);
+  sc->iface = iface;
   sc->member = g_strdup (member);
+  sc->expected_types = g_memdup (expected_types,
+      (n_types + 1) * sizeof (GType));
   sc->collect_args = collect_args;
   sc->invoke_callback = invoke_callback;
   sc->callback = callback;
@@ -416,6 +1140,16 @@ tp_proxy_signal_connection_v0_new (TpProxy *self,
   g_signal_connect (self, "invalidated",
       G_CALLBACK (tp_proxy_signal_connection_proxy_invalidated), sc);
 
+  if (iface_proxy == NULL)
+    {
+      /* the ObjectWatch has the initial ref, which it releases when @sc is
+       * removed from it or it goes away */
+      object_watch_add (object_watch_ensure (self), sc);
+      return sc;
+    }
+
+  sc->iface_proxy = g_object_ref (iface_proxy);
+
   g_signal_connect (iface_proxy, "destroy",
       G_CALLBACK (_tp_proxy_signal_connection_dgproxy_destroy), sc);
 
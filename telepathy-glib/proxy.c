@@ -24,6 +24,8 @@
 #include "telepathy-glib/proxy-subclass.h"
 #include "telepathy-glib/proxy-internal.h"
 
+#include "telepathy-glib/interface-set-internal.h"
+
 #include <string.h>
 
 #include <telepathy-glib/interfaces.h>
@@ -343,59 +345,73 @@ typedef enum {
     FEATURE_STATE_READY
 } FeatureState;
 
+typedef struct {
+    FeatureState state;
+    /* TpProxyPrepareRequests counting this feature in their n_pending,
+     * until it reaches a final state */
+    GSList *waiting;
+    /* When prepare_async was last called, or 0 if it isn't running */
+    gint64 prepare_started;
+    /* How long the last call to prepare_async took, in microseconds, or -1
+     * if it has never finished */
+    gint64 prepare_time;
+    /* How many of the features this one depends on are not in a final
+     * state; it can only be started when this is 0 */
+    guint n_unfinished_depends;
+    /* %TRUE if it is in priv->startable */
+    gboolean startable;
+} FeatureData;
+
+/* Every feature of a TpProxy subclass, including those of its ancestors,
+ * gathered once per subclass when its first instance is constructed, so
+ * looking a feature up doesn't mean walking the class hierarchy. */
+typedef struct {
+    guint n_features;
+    const TpProxyFeature **features;
+    /* GQuark => 1 + its index in features */
+    GHashTable *index;
+    /* n_features GArrays of guint, indexed like features, or %NULL: the
+     * indices of the features which depend on each feature */
+    GArray **dependents;
+} FeatureGraph;
+
 typedef struct {
     GSimpleAsyncResult *result;
+    /* The features that were asked for */
     GArray *features;
+    /* How many of them had not finished preparing, successfully or not,
+     * when the request was made and still haven't; the request is complete
+     * when this counts down to 0 */
+    guint n_pending;
     gboolean core;
+    /* borrowed, our link in priv->prepare_requests */
+    GList *link;
 } TpProxyPrepareRequest;
 
-static TpProxyPrepareRequest *
-tp_proxy_prepare_request_new (GSimpleAsyncResult *result,
-    const GQuark *features)
-{
-  TpProxyPrepareRequest *req = g_slice_new0 (TpProxyPrepareRequest);
-
-  if (result != NULL)
-    req->result = g_object_ref (result);
-
-  req->features = _tp_quark_array_copy (features);
-  g_assert (req->features != NULL);
-  return req;
-}
-
-static void
-tp_proxy_prepare_request_finish (TpProxyPrepareRequest *req,
-    const GError *error)
-{
-  DEBUG ("%p", req);
-
-  if (req->result != NULL)
-    {
-      if (error != NULL)
-        g_simple_async_result_set_from_error (req->result, error);
-
-      g_simple_async_result_complete_in_idle (req->result);
-      g_object_unref (req->result);
-    }
-
-  g_array_unref (req->features);
-  g_slice_free (TpProxyPrepareRequest, req);
-}
-
 struct _TpProxyPrivate {
-    /* GQuark for interface => either a ref'd DBusGProxy *,
-     * or the TpProxy itself used as a dummy value to indicate that
-     * the DBusGProxy has not been needed yet */
+    /* The interfaces we have, shared with every other proxy that has the
+     * same ones; borrowed, since interned sets are never freed */
+    TpInterfaceSet *interface_set;
+    /* GQuark for interface => ref'd DBusGProxy *, for those interfaces in
+     * interface_set whose DBusGProxy has been needed */
     GData *interfaces;
 
-    /* feature => FeatureState */
-    GData *features;
+    /* Shared by all instances of our class */
+    FeatureGraph *graph;
+    /* graph->n_features structs, indexed like graph->features */
+    FeatureData *feature_data;
 
     /* Queue of TpProxyPrepareRequest. The first requests are the core one,
      * sorted from the most upper super class to the subclass core features.
      * This is needed to guarantee than subclass features are not prepared
      * until the super class features have been prepared. */
     GQueue *prepare_requests;
+    /* The non-core TpProxyPrepareRequests in prepare_requests which aren't
+     * waiting for any more features, in the order they became so; borrowed */
+    GQueue *ready;
+    /* GQuarks of the WANTED features whose dependencies have all finished,
+     * which might be startable now */
+    GQueue *startable;
 
     GSimpleAsyncResult *will_announce_connected_result;
     /* Number of pending calls blocking will_announce_connected_result to be
@@ -481,23 +497,15 @@ tp_proxy_get_interface_by_id (TpProxy *self,
 {
   gpointer dgproxy;
 
-  if (self->invalidated != NULL)
-    {
-      g_set_error (error, self->invalidated->domain, self->invalidated->code,
-          "%s", self->invalidated->message);
-      return NULL;
-    }
-
-  if (!tp_dbus_check_valid_interface_name (g_quark_to_string (iface),
-        error))
-      return NULL;
+  if (!_tp_proxy_check_interface_by_id (self, iface, error))
+    return NULL;
 
   dgproxy = g_datalist_id_get_data (&self->priv->interfaces, iface);
 
-  if (dgproxy == self)
+  if (dgproxy == NULL)
     {
-      /* dummy value - we've never actually needed the interface, so we
-       * didn't create it, to avoid binding to all the signals */
+      /* we've never actually needed the interface, so we didn't create it,
+       * to avoid binding to all the signals */
 
       dgproxy = dbus_g_proxy_new_for_name (self->dbus_connection,
           self->bus_name, self->object_path, g_quark_to_string (iface));
@@ -514,16 +522,47 @@ tp_proxy_get_interface_by_id (TpProxy *self,
           (guint) iface, dgproxy);
     }
 
-  if (dgproxy != NULL)
+  return dgproxy;
+}
+
+/*
+ * _tp_proxy_check_interface_by_id:
+ * @self: the TpProxy
+ * @iface: quark representing the interface required
+ * @error: used to raise an error in the #TP_DBUS_ERRORS domain if @iface
+ *         is invalid, @self has been invalidated or @self does not implement
+ *         @iface
+ *
+ * The same as tp_proxy_get_interface_by_id(), but without creating the
+ * #DBusGProxy if it doesn't exist yet.
+ *
+ * Returns: %TRUE if @self can be used with @iface
+ */
+gboolean
+_tp_proxy_check_interface_by_id (TpProxy *self,
+    GQuark iface,
+    GError **error)
+{
+  if (self->invalidated != NULL)
     {
-      return dgproxy;
+      g_set_error (error, self->invalidated->domain, self->invalidated->code,
+          "%s", self->invalidated->message);
+      return FALSE;
     }
 
-  g_set_error (error, TP_DBUS_ERRORS, TP_DBUS_ERROR_NO_INTERFACE,
-      "Object %s does not have interface %s",
-      self->object_path, g_quark_to_string (iface));
+  if (!tp_dbus_check_valid_interface_name (g_quark_to_string (iface),
+        error))
+      return FALSE;
 
-  return NULL;
+  if (!_tp_interface_set_contains (self->priv->interface_set, iface))
+    {
+      g_set_error (error, TP_DBUS_ERRORS, TP_DBUS_ERROR_NO_INTERFACE,
+          "Object %s does not have interface %s",
+          self->object_path, g_quark_to_string (iface));
+      return FALSE;
+    }
+
+  return TRUE;
 }
 
 /**
@@ -547,8 +586,7 @@ tp_proxy_has_interface_by_id (gpointer self,
 
   g_return_val_if_fail (TP_IS_PROXY (self), FALSE);
 
-  return (g_datalist_id_get_data (&proxy->priv->interfaces, iface)
-      != NULL);
+  return _tp_interface_set_contains (proxy->priv->interface_set, iface);
 }
 
 /**
@@ -580,17 +618,16 @@ tp_proxy_has_interface (gpointer self,
   g_return_val_if_fail (TP_IS_PROXY (self), FALSE);
 
   return (q != 0 &&
-    g_datalist_id_get_data (&proxy->priv->interfaces, q) != NULL);
+    _tp_interface_set_contains (proxy->priv->interface_set, q));
 }
 
 static void
 tp_proxy_lose_interface (GQuark unused,
-                         gpointer dgproxy_or_self,
+                         gpointer dgproxy,
                          gpointer self)
 {
-  if (dgproxy_or_self != self)
-    g_signal_handlers_disconnect_by_func (dgproxy_or_self,
-        G_CALLBACK (tp_proxy_iface_destroyed_cb), self);
+  g_signal_handlers_disconnect_by_func (dgproxy,
+      G_CALLBACK (tp_proxy_iface_destroyed_cb), self);
 }
 
 static void
@@ -600,6 +637,7 @@ tp_proxy_lose_interfaces (TpProxy *self)
       tp_proxy_lose_interface, self);
 
   g_datalist_clear (&self->priv->interfaces);
+  self->priv->interface_set = _tp_interface_set_empty ();
 }
 
 static void tp_proxy_poll_features (TpProxy *self, const GError *error);
@@ -610,6 +648,12 @@ tp_proxy_emit_invalidated (gpointer p)
 {
   TpProxy *self = TP_PROXY (p);
 
+  /* Let the factory forget about us before anyone else hears about it, so
+   * that if they ask it for a proxy for the same object, they won't get
+   * this one back */
+  if (self->priv->factory != NULL)
+    _tp_simple_client_factory_proxy_invalidated (self->priv->factory, self);
+
   g_signal_emit (self, signals[SIGNAL_INVALIDATED], 0,
       self->invalidated->domain, self->invalidated->code,
       self->invalidated->message);
@@ -658,9 +702,16 @@ tp_proxy_invalidate (TpProxy *self, const GError *error)
     }
 }
 
-static void
-tp_proxy_iface_destroyed_cb (DBusGProxy *dgproxy,
-                             TpProxy *self)
+/*
+ * _tp_proxy_name_owner_lost:
+ * @self: a proxy whose bus name has just lost its owner
+ *
+ * Invalidate @self with %TP_DBUS_ERROR_NAME_OWNER_LOST, as if one of its
+ * #DBusGProxy objects had been destroyed. This is safe to call from a
+ * libdbus filter.
+ */
+void
+_tp_proxy_name_owner_lost (TpProxy *self)
 {
   /* We can't call any API on the proxy now. Because the proxies are all
    * for the same bus name, we can assume that all of them are equally
@@ -682,6 +733,13 @@ tp_proxy_iface_destroyed_cb (DBusGProxy *dgproxy,
     }
 }
 
+static void
+tp_proxy_iface_destroyed_cb (DBusGProxy *dgproxy,
+                             TpProxy *self)
+{
+  _tp_proxy_name_owner_lost (self);
+}
+
 /**
  * tp_proxy_add_interface_by_id: (skip)
  * @self: the TpProxy, which must not have become #TpProxy::invalidated.
@@ -717,15 +775,12 @@ tp_proxy_add_interface_by_id (TpProxy *self,
 
   g_return_val_if_fail (tp_proxy_get_invalidated (self) == NULL, NULL);
 
-  if (iface_proxy == NULL)
-    {
-      /* we don't want to actually create it just yet - dbus-glib will
-       * helpfully wake us up on every signal, if we do. So we set a
-       * dummy value (self), and replace it with the real value in
-       * tp_proxy_get_interface_by_id */
-      g_datalist_id_set_data_full (&self->priv->interfaces, iface,
-          self, NULL);
-    }
+  /* we don't want to actually create the DBusGProxy just yet - dbus-glib
+   * will helpfully wake us up on every signal, if we do. So we just
+   * remember that we have the interface, and create it in
+   * tp_proxy_get_interface_by_id */
+  self->priv->interface_set = _tp_interface_set_add (
+      self->priv->interface_set, iface);
 
   return iface_proxy;
 }
@@ -874,16 +929,6 @@ _tp_proxy_take_and_remap_error (TpProxy *self,
     }
 }
 
-static void
-dup_quark_into_ptr_array (GQuark q,
-                          gpointer unused,
-                          gpointer user_data)
-{
-  GPtrArray *strings = user_data;
-
-  g_ptr_array_add (strings, g_strdup (g_quark_to_string (q)));
-}
-
 static void
 tp_proxy_get_property (GObject *object,
                        guint property_id,
@@ -915,11 +960,17 @@ tp_proxy_get_property (GObject *object,
       break;
     case PROP_INTERFACES:
         {
-          GPtrArray *strings = g_ptr_array_new ();
+          GArray *quarks = _tp_interface_set_dup_quarks (
+              self->priv->interface_set);
+          GPtrArray *strings = g_ptr_array_sized_new (quarks->len + 1);
+          guint i;
+
+          for (i = 0; i < quarks->len; i++)
+            g_ptr_array_add (strings, g_strdup (g_quark_to_string (
+                    g_array_index (quarks, GQuark, i))));
 
-          g_datalist_foreach (&self->priv->interfaces,
-              dup_quark_into_ptr_array, strings);
           g_ptr_array_add (strings, NULL);
+          g_array_unref (quarks);
           g_value_take_boxed (value, g_ptr_array_free (strings, FALSE));
         }
       break;
@@ -1008,6 +1059,9 @@ tp_proxy_init (TpProxy *self)
       TpProxyPrivate);
 
   self->priv->prepare_requests = g_queue_new ();
+  self->priv->ready = g_queue_new ();
+  self->priv->startable = g_queue_new ();
+  self->priv->interface_set = _tp_interface_set_empty ();
 }
 
 static GQuark
@@ -1023,12 +1077,194 @@ interface_added_cb_quark (void)
   return q;
 }
 
+static gboolean
+feature_graph_visit (FeatureGraph *graph,
+    guint i,
+    guint8 *marks)
+{
+  const GQuark *depends_on = graph->features[i]->depends_on;
+  guint j;
+
+  /* 0: not visited yet, 1: being visited, 2: done */
+  if (marks[i] == 2)
+    return TRUE;
+
+  if (marks[i] == 1)
+    {
+      CRITICAL ("feature %s depends on itself",
+          g_quark_to_string (graph->features[i]->name));
+      return FALSE;
+    }
+
+  marks[i] = 1;
+
+  for (j = 0; depends_on != NULL && depends_on[j] != 0; j++)
+    {
+      guint dep = GPOINTER_TO_UINT (g_hash_table_lookup (graph->index,
+            GUINT_TO_POINTER (depends_on[j])));
+
+      /* Unknown dependencies just fail to prepare */
+      if (dep != 0 && !feature_graph_visit (graph, dep - 1, marks))
+        return FALSE;
+    }
+
+  marks[i] = 2;
+  return TRUE;
+}
+
+static FeatureGraph *
+feature_graph_get (GType type)
+{
+  static GQuark quark = 0;
+  FeatureGraph *graph;
+  GPtrArray *features;
+  guint8 *marks;
+  GType proxy_type = TP_TYPE_PROXY;
+  GType t;
+  guint i;
+
+  if (G_UNLIKELY (quark == 0))
+    quark = g_quark_from_static_string ("tp-proxy-feature-graph");
+
+  graph = g_type_get_qdata (type, quark);
+
+  if (G_LIKELY (graph != NULL))
+    return graph;
+
+  graph = g_slice_new0 (FeatureGraph);
+  graph->index = g_hash_table_new (NULL, NULL);
+  features = g_ptr_array_new ();
+
+  /* we stop at proxy_type since we know that TpProxy has no features */
+  for (t = type; t != proxy_type; t = g_type_parent (t))
+    {
+      TpProxyClass *cls = g_type_class_ref (t);
+      const TpProxyFeature *list = NULL;
+
+      if (cls->list_features != NULL)
+        list = cls->list_features (cls);
+
+      for (i = 0; list != NULL && list[i].name != 0; i++)
+        {
+          /* A subclass which inherits list_features() lists the same
+           * features again; if a subclass redefines a feature, its
+           * definition wins. */
+          if (g_hash_table_lookup (graph->index,
+                GUINT_TO_POINTER (list[i].name)) != NULL)
+            continue;
+
+          g_ptr_array_add (features, (gpointer) (list + i));
+          g_hash_table_insert (graph->index, GUINT_TO_POINTER (list[i].name),
+              GUINT_TO_POINTER (features->len));
+        }
+
+      g_type_class_unref (cls);
+    }
+
+  graph->n_features = features->len;
+  graph->features = (const TpProxyFeature **) g_ptr_array_free (features,
+      FALSE);
+
+  marks = g_new0 (guint8, graph->n_features);
+
+  for (i = 0; i < graph->n_features; i++)
+    {
+      if (!feature_graph_visit (graph, i, marks))
+        break;
+    }
+
+  g_free (marks);
+
+  graph->dependents = g_new0 (GArray *, graph->n_features);
+
+  for (i = 0; i < graph->n_features; i++)
+    {
+      const GQuark *depends_on = graph->features[i]->depends_on;
+      guint j;
+
+      for (j = 0; depends_on != NULL && depends_on[j] != 0; j++)
+        {
+          guint dep = GPOINTER_TO_UINT (g_hash_table_lookup (graph->index,
+                GUINT_TO_POINTER (depends_on[j])));
+
+          /* Unknown dependencies are always INVALID, which is final, so
+           * they never hold anything up */
+          if (dep == 0)
+            continue;
+
+          if (graph->dependents[dep - 1] == NULL)
+            graph->dependents[dep - 1] = g_array_new (FALSE, FALSE,
+                sizeof (guint));
+
+          g_array_append_val (graph->dependents[dep - 1], i);
+        }
+    }
+
+  /* Classes are never unloaded, so neither is this */
+  g_type_set_qdata (type, quark, graph);
+  return graph;
+}
+
+static FeatureData *
+tp_proxy_get_feature_data (TpProxy *self,
+    GQuark feature)
+{
+  guint i;
+
+  if (self->priv->graph == NULL)
+    return NULL;
+
+  i = GPOINTER_TO_UINT (g_hash_table_lookup (self->priv->graph->index,
+        GUINT_TO_POINTER (feature)));
+
+  if (i == 0)
+    return NULL;
+
+  return self->priv->feature_data + i - 1;
+}
+
 static FeatureState
 tp_proxy_get_feature_state (TpProxy *self,
     GQuark feature)
 {
-  return GPOINTER_TO_INT (g_datalist_id_get_data (&self->priv->features,
-        feature));
+  FeatureData *data = tp_proxy_get_feature_data (self, feature);
+
+  if (data == NULL)
+    return FEATURE_STATE_INVALID;
+
+  return data->state;
+}
+
+static gboolean
+feature_state_is_final (FeatureState state)
+{
+  switch (state)
+    {
+      case FEATURE_STATE_INVALID:
+      case FEATURE_STATE_FAILED:
+      case FEATURE_STATE_MISSING_IFACE:
+      case FEATURE_STATE_READY:
+        return TRUE;
+
+      default:
+        return FALSE;
+    }
+}
+
+/* If @feature is WANTED and nothing it depends on is still to finish,
+ * queue it to be looked at by tp_proxy_start_wanted_features() */
+static void
+tp_proxy_maybe_queue_startable (TpProxy *self,
+    GQuark feature,
+    FeatureData *data)
+{
+  if (data->state != FEATURE_STATE_WANTED ||
+      data->n_unfinished_depends > 0 ||
+      data->startable)
+    return;
+
+  data->startable = TRUE;
+  g_queue_push_tail (self->priv->startable, GUINT_TO_POINTER (feature));
 }
 
 static void
@@ -1036,8 +1272,131 @@ tp_proxy_set_feature_state (TpProxy *self,
     GQuark feature,
     FeatureState state)
 {
-  g_datalist_id_set_data (&self->priv->features, feature,
-      GINT_TO_POINTER (state));
+  FeatureData *data = tp_proxy_get_feature_data (self, feature);
+  GArray *dependents;
+  gboolean was_final;
+  GSList *l;
+  guint i;
+
+  g_return_if_fail (data != NULL);
+
+  was_final = feature_state_is_final (data->state);
+  data->state = state;
+
+  tp_proxy_maybe_queue_startable (self, feature, data);
+
+  if (was_final == feature_state_is_final (state))
+    return;
+
+  /* Features can go back from final states to be retried, so keep count
+   * both ways */
+  dependents = self->priv->graph->dependents[data - self->priv->feature_data];
+
+  for (i = 0; dependents != NULL && i < dependents->len; i++)
+    {
+      guint j = g_array_index (dependents, guint, i);
+      FeatureData *dependent = self->priv->feature_data + j;
+
+      if (was_final)
+        {
+          dependent->n_unfinished_depends++;
+          continue;
+        }
+
+      g_assert (dependent->n_unfinished_depends > 0);
+      dependent->n_unfinished_depends--;
+      tp_proxy_maybe_queue_startable (self,
+          self->priv->graph->features[j]->name, dependent);
+    }
+
+  if (was_final)
+    return;
+
+  /* Count it off for every request that was waiting for it, in the order
+   * they were made */
+  data->waiting = g_slist_reverse (data->waiting);
+
+  for (l = data->waiting; l != NULL; l = l->next)
+    {
+      TpProxyPrepareRequest *req = l->data;
+
+      g_assert (req->n_pending > 0);
+      req->n_pending--;
+
+      if (req->n_pending == 0 && !req->core)
+        g_queue_push_tail (self->priv->ready, req);
+    }
+
+  g_slist_free (data->waiting);
+  data->waiting = NULL;
+}
+
+static TpProxyPrepareRequest *
+tp_proxy_prepare_request_new (TpProxy *self,
+    GSimpleAsyncResult *result,
+    const GQuark *features)
+{
+  TpProxyPrepareRequest *req = g_slice_new0 (TpProxyPrepareRequest);
+  guint i;
+
+  if (result != NULL)
+    req->result = g_object_ref (result);
+
+  req->features = _tp_quark_array_copy (features);
+  g_assert (req->features != NULL);
+
+  for (i = 0; i < req->features->len; i++)
+    {
+      GQuark feature = g_array_index (req->features, GQuark, i);
+      FeatureData *data = tp_proxy_get_feature_data (self, feature);
+
+      /* Unknown features, features which have already finished and
+       * features that were asked for twice don't hold the request up */
+      if (data == NULL ||
+          feature_state_is_final (data->state) ||
+          (data->waiting != NULL && data->waiting->data == req))
+        continue;
+
+      data->waiting = g_slist_prepend (data->waiting, req);
+      req->n_pending++;
+
+      /* It might have been passed over while nobody was waiting for it */
+      tp_proxy_maybe_queue_startable (self, feature, data);
+    }
+
+  return req;
+}
+
+static void
+tp_proxy_prepare_request_finish (TpProxy *self,
+    TpProxyPrepareRequest *req,
+    const GError *error)
+{
+  guint i;
+
+  DEBUG ("%p", req);
+
+  /* If it's finishing early, stop waiting for the rest */
+  for (i = 0; req->n_pending > 0 && i < req->features->len; i++)
+    {
+      FeatureData *data = tp_proxy_get_feature_data (self,
+          g_array_index (req->features, GQuark, i));
+
+      if (data != NULL)
+        data->waiting = g_slist_remove (data->waiting, req);
+    }
+
+  if (req->result != NULL)
+    {
+      if (error != NULL)
+        g_simple_async_result_set_from_error (req->result, error);
+
+      g_simple_async_result_complete_in_idle (req->result);
+      g_object_unref (req->result);
+    }
+
+  g_array_unref (req->features);
+  g_slice_free (TpProxyPrepareRequest, req);
 }
 
 static void
@@ -1068,16 +1427,41 @@ tp_proxy_constructor (GType type,
   TpProxyInterfaceAddLink *iter;
   GType proxy_parent_type = G_TYPE_FROM_CLASS (tp_proxy_parent_class);
   GType ancestor_type;
+  guint i;
 
   _tp_register_dbus_glib_marshallers ();
 
+  self->priv->graph = feature_graph_get (type);
+  self->priv->feature_data = g_new0 (FeatureData,
+      self->priv->graph->n_features);
+
+  for (i = 0; i < self->priv->graph->n_features; i++)
+    {
+      self->priv->feature_data[i].state = FEATURE_STATE_UNWANTED;
+      self->priv->feature_data[i].prepare_time = -1;
+    }
+
+  /* Every feature starts off UNWANTED, so none of anyone's dependencies
+   * have finished */
+  for (i = 0; i < self->priv->graph->n_features; i++)
+    {
+      GArray *dependents = self->priv->graph->dependents[i];
+      guint j;
+
+      for (j = 0; dependents != NULL && j < dependents->len; j++)
+        {
+          guint dependent = g_array_index (dependents, guint, j);
+
+          self->priv->feature_data[dependent].n_unfinished_depends++;
+        }
+    }
+
   for (ancestor_type = type;
        ancestor_type != proxy_parent_type && ancestor_type != 0;
        ancestor_type = g_type_parent (ancestor_type))
     {
       TpProxyClass *ancestor = g_type_class_peek (ancestor_type);
       const TpProxyFeature *features;
-      guint i;
       GArray *core_features;
 
       for (iter = g_type_get_qdata (ancestor_type,
@@ -1101,9 +1485,6 @@ tp_proxy_constructor (GType type,
         {
           assert_feature_validity (self, &features[i]);
 
-          tp_proxy_set_feature_state (self, features[i].name,
-              FEATURE_STATE_UNWANTED);
-
           if (features[i].core)
             {
               g_array_append_val (core_features, features[i].name);
@@ -1114,11 +1495,12 @@ tp_proxy_constructor (GType type,
         {
           TpProxyPrepareRequest *req;
 
-          req = tp_proxy_prepare_request_new (NULL,
+          req = tp_proxy_prepare_request_new (self, NULL,
               (const GQuark *) core_features->data);
           req->core = TRUE;
 
           g_queue_push_head (self->priv->prepare_requests, req);
+          req->link = self->priv->prepare_requests->head;
 
           DEBUG ("%p: request %p represents core features on %s", self, req,
               g_type_name (ancestor_type));
@@ -1185,8 +1567,7 @@ tp_proxy_finalize (GObject *object)
 
   DEBUG ("%p", self);
 
-  if (self->priv->features != NULL)
-    g_datalist_clear (&self->priv->features);
+  tp_clear_pointer (&self->priv->feature_data, g_free);
 
   g_assert (self->invalidated != NULL);
   g_error_free (self->invalidated);
@@ -1194,6 +1575,8 @@ tp_proxy_finalize (GObject *object)
   /* invalidation ensures that these have gone away */
   g_assert_cmpuint (g_queue_get_length (self->priv->prepare_requests), ==, 0);
   tp_clear_pointer (&self->priv->prepare_requests, g_queue_free);
+  tp_clear_pointer (&self->priv->ready, g_queue_free);
+  tp_clear_pointer (&self->priv->startable, g_queue_free);
 
   g_free (self->bus_name);
   g_free (self->object_path);
@@ -1655,39 +2038,19 @@ static const TpProxyFeature *
 tp_proxy_subclass_get_feature (GType type,
     GQuark feature)
 {
-  GType proxy_type = TP_TYPE_PROXY;
-
-  g_return_val_if_fail (g_type_is_a (type, proxy_type), NULL);
-
-  /* we stop at proxy_type since we know that TpProxy has no features */
-  for ( ; type != proxy_type; type = g_type_parent (type))
-    {
-      guint i;
-      TpProxyClass *cls = g_type_class_ref (type);
-      const TpProxyFeature *features;
-
-      if (cls->list_features == NULL)
-        goto cont;
-
-      features = cls->list_features (cls);
+  FeatureGraph *graph;
+  guint i;
 
-      if (features == NULL)
-        goto cont;
+  g_return_val_if_fail (g_type_is_a (type, TP_TYPE_PROXY), NULL);
 
-      for (i = 0; features[i].name != 0; i++)
-        {
-          if (features[i].name == feature)
-            {
-              g_type_class_unref (cls);
-              return features + i;
-            }
-        }
+  graph = feature_graph_get (type);
+  i = GPOINTER_TO_UINT (g_hash_table_lookup (graph->index,
+        GUINT_TO_POINTER (feature)));
 
-cont:
-      g_type_class_unref (cls);
-    }
+  if (i == 0)
+    return NULL;
 
-  return FALSE;
+  return graph->features[i - 1];
 }
 
 /**
@@ -1948,6 +2311,7 @@ tp_proxy_prepare_async (gpointer self,
 {
   TpProxy *proxy = self;
   GSimpleAsyncResult *result = NULL;
+  TpProxyPrepareRequest *req;
   guint i;
 
   g_return_if_fail (TP_IS_PROXY (self));
@@ -2009,8 +2373,13 @@ tp_proxy_prepare_async (gpointer self,
       goto finally;
     }
 
-  g_queue_push_tail (proxy->priv->prepare_requests,
-      tp_proxy_prepare_request_new (result, features));
+  req = tp_proxy_prepare_request_new (proxy, result, features);
+  g_queue_push_tail (proxy->priv->prepare_requests, req);
+  req->link = proxy->priv->prepare_requests->tail;
+
+  if (req->n_pending == 0)
+    g_queue_push_tail (proxy->priv->ready, req);
+
   tp_proxy_poll_features (proxy, NULL);
 
 finally:
@@ -2086,112 +2455,157 @@ prepare_feature (TpProxy *self,
       (gpointer) feature);
 }
 
-static gboolean
-core_prepared (TpProxy *self)
+/* If @feature is wanted (or, for the core request, just asked for) and its
+ * interfaces and dependencies allow, start preparing it */
+static void
+tp_proxy_maybe_start_feature (TpProxy *self,
+    GQuark feature,
+    gboolean core)
 {
-  /* All the core features have been prepared if the head of the
-   * prepare_requests queue is NOT a core feature */
-  TpProxyPrepareRequest *req = g_queue_peek_head (self->priv->prepare_requests);
+  FeatureData *data = tp_proxy_get_feature_data (self, feature);
+  gboolean failed;
 
-  if (req == NULL)
-    return TRUE;
+  if (data == NULL)
+    return;
+
+  switch (data->state)
+    {
+      case FEATURE_STATE_UNWANTED:
+        /* this can only happen in the special pseudo-request for the
+         * core features, which blocks everything: treat it as WANTED */
+        if (!core)
+          return;
+
+        break;
+
+      case FEATURE_STATE_WANTED:
+        /* if every request that wanted it has gone away, so can we */
+        if (data->waiting == NULL)
+          return;
 
-  return !req->core;
+        break;
+
+      default:
+        /* it's underway or finished */
+        return;
+    }
+
+  /* Check if we have the required interfaces. We can't do that
+   * in tp_proxy_prepare_async() as CORE have to be prepared */
+  if (!check_feature_interfaces (self, feature))
+    {
+      if (TP_IS_CONNECTION (self) &&
+          tp_connection_get_status ((TpConnection *) self, NULL)
+          != TP_CONNECTION_STATUS_CONNECTED)
+        {
+          /* Give a chance to retry preparing the feature once
+           * the Connection is connected as it may still gain
+           * the interface. */
+          tp_proxy_set_feature_state (self, feature,
+              FEATURE_STATE_MISSING_IFACE);
+        }
+      else
+        {
+          tp_proxy_set_feature_state (self, feature, FEATURE_STATE_FAILED);
+        }
+
+      return;
+    }
+
+  if (check_depends_ready (self, feature, FALSE, &failed))
+    {
+      /* We can prepare it now */
+      DEBUG ("%p: calling callback for %s", self,
+          g_quark_to_string (feature));
+
+      tp_proxy_set_feature_state (self, feature, FEATURE_STATE_TRYING);
+      data->prepare_started = g_get_monotonic_time ();
+
+      prepare_feature (self, tp_proxy_subclass_get_feature (
+            G_OBJECT_TYPE (self), feature));
+    }
+  else if (failed)
+    {
+      tp_proxy_set_feature_state (self, feature, FEATURE_STATE_FAILED);
+    }
+  /* else we have to wait until the deps finish their preparation. */
 }
 
-/* Returns %TRUE if all the features requested in @req have complete their
- * preparation */
-static gboolean
-request_is_complete (TpProxy *self,
-    TpProxyPrepareRequest *req)
+/* Start preparing whichever features can be. Until the core features are
+ * prepared, that means only those of the core request at the head of the
+ * queue; after that, the wanted features whose dependencies have all
+ * finished since we last looked. */
+static void
+tp_proxy_start_wanted_features (TpProxy *self)
 {
-  guint i;
-  gboolean complete = TRUE;
+  TpProxyPrepareRequest *head = g_queue_peek_head (
+      self->priv->prepare_requests);
+  gpointer feature;
 
-  for (i = 0; i < req->features->len; i++)
+  if (head != NULL && head->core)
     {
-      GQuark feature = g_array_index (req->features, GQuark, i);
-      FeatureState state = tp_proxy_get_feature_state (self, feature);
-      const TpProxyFeature *feat_struct = tp_proxy_subclass_get_feature (
-          G_OBJECT_TYPE (self), feature);
+      /* Preparing a feature can finish synchronously and poll the features
+       * again, finishing the request under our feet; so work from our own
+       * reference to its features */
+      GArray *features = g_array_ref (head->features);
+      guint i;
 
-      switch (state)
-        {
-          case FEATURE_STATE_UNWANTED:
-            /* this can only happen in the special pseudo-request for the
-             * core features, which blocks everything */
-            g_assert (req->core);
-            complete = FALSE;
+      for (i = 0; i < features->len; i++)
+        tp_proxy_maybe_start_feature (self,
+            g_array_index (features, GQuark, i), TRUE);
 
-            /* fall through to treat it as WANTED */
-          case FEATURE_STATE_WANTED:
-            if (core_prepared (self) ||
-                req->core)
-              {
-                gboolean failed;
-
-                /* Check if we have the required interfaces. We can't do that
-                 * in tp_proxy_prepare_async() as CORE have to be prepared */
-                if (!check_feature_interfaces (self, feature))
-                  {
-                    if (TP_IS_CONNECTION (self) &&
-                        tp_connection_get_status ((TpConnection *) self, NULL)
-                        != TP_CONNECTION_STATUS_CONNECTED)
-                      {
-                        /* Give a chance to retry preparing the feature once
-                         * the Connection is connected as it may still gain
-                         * the interface. */
-                        tp_proxy_set_feature_state (self, feature,
-                            FEATURE_STATE_MISSING_IFACE);
-                      }
-                    else
-                      {
-                        tp_proxy_set_feature_state (self, feature,
-                            FEATURE_STATE_FAILED);
-                      }
-                    continue;
-                  }
-
-                if (check_depends_ready (self, feature, FALSE, &failed))
-                  {
-                    /* We can prepare it now */
-                    DEBUG ("%p: calling callback for %s", self,
-                        g_quark_to_string (feature));
-
-                    tp_proxy_set_feature_state (self, feature,
-                        FEATURE_STATE_TRYING);
-
-                    prepare_feature (self, feat_struct);
-                    complete = FALSE;
-                  }
-                else if (failed)
-                  {
-                    tp_proxy_set_feature_state (self, feature,
-                        FEATURE_STATE_FAILED);
-                  }
-                else
-                  {
-                    /* We have to wait until the deps finish their
-                     * preparation. */
-                    complete = FALSE;
-                  }
-              }
-            break;
+      g_array_unref (features);
+      return;
+    }
 
-          case FEATURE_STATE_TRYING:
-            complete = FALSE;
-            break;
+  /* Popping one at a time keeps this right if a feature finishes
+   * synchronously and more are queued, or taken, by a nested poll */
+  while (self->invalidated == NULL &&
+      (feature = g_queue_pop_head (self->priv->startable)) != NULL)
+    {
+      FeatureData *data = tp_proxy_get_feature_data (self,
+          GPOINTER_TO_UINT (feature));
 
-          case FEATURE_STATE_INVALID:
-          case FEATURE_STATE_FAILED:
-          case FEATURE_STATE_MISSING_IFACE:
-          case FEATURE_STATE_READY:
-            /* nothing more to do */
-            break;
+      data->startable = FALSE;
+      tp_proxy_maybe_start_feature (self, GPOINTER_TO_UINT (feature), FALSE);
+    }
+}
+
+/* Finish every request which isn't waiting for any more features, and
+ * return how many of those were core requests */
+static guint
+tp_proxy_finish_prepared_requests (TpProxy *self)
+{
+  TpProxyPrepareRequest *req;
+  guint core_finished = 0;
+
+  /* Core features have to be prepared first, in superclass-to-subclass
+   * order. The next core feature to be prepared, if any, is always at the
+   * head of prepare_requests, and nothing behind it can finish before it
+   * does. */
+  while ((req = g_queue_peek_head (self->priv->prepare_requests)) != NULL &&
+      req->core)
+    {
+      if (req->n_pending > 0)
+        {
+          DEBUG ("%p: core features not ready yet", self);
+          return core_finished;
         }
+
+      DEBUG ("%p: core request %p prepared", self, req);
+      g_queue_pop_head (self->priv->prepare_requests);
+      core_finished++;
+      tp_proxy_prepare_request_finish (self, req, NULL);
+    }
+
+  while ((req = g_queue_pop_head (self->priv->ready)) != NULL)
+    {
+      DEBUG ("%p: request %p prepared", self, req);
+      g_queue_delete_link (self->priv->prepare_requests, req->link);
+      tp_proxy_prepare_request_finish (self, req, NULL);
     }
 
-  return complete;
+  return core_finished;
 }
 
 static void
@@ -2202,10 +2616,11 @@ finish_all_requests (TpProxy *self,
   GQueue *tmp = g_queue_copy (self->priv->prepare_requests);
 
   g_queue_clear (self->priv->prepare_requests);
+  g_queue_clear (self->priv->ready);
 
   for (iter = tmp->head; iter != NULL; iter = g_list_next (iter))
     {
-      tp_proxy_prepare_request_finish (iter->data, error);
+      tp_proxy_prepare_request_finish (self, iter->data, error);
     }
 
   g_queue_free (tmp);
@@ -2216,10 +2631,16 @@ finish_all_requests (TpProxy *self,
  * @self: a proxy
  * @error: if not %NULL, fail all feature requests with this error
  *
- * For each feature in state WANTED, if its dependencies have been satisfied,
- * call the callback and advance it to state TRYING.
+ * For each feature in state WANTED whose dependencies have all finished
+ * since it was last looked at, if they were satisfied, call the callback and
+ * advance it to state TRYING. Other features aren't looked at: as each one
+ * finishes, only the features for which it was the last dependency are
+ * queued to be started.
  *
- * For each feature request, see if it's finished yet.
+ * Finish each feature request which is no longer waiting for any features.
+ * Requests don't need to be looked at feature by feature for that: each one
+ * counts down as the features it is waiting for finish preparing, and is
+ * queued to be finished when it reaches 0.
  *
  * Called every time the set of prepared/failed features changes,
  * when a temporary error causes introspection to fail, and when
@@ -2232,20 +2653,14 @@ tp_proxy_poll_features (TpProxy *self,
     const GError *error)
 {
   const gchar *error_source = "temporarily failed";
-  GList *iter;
-  GList *next;
 
   if (g_queue_get_length (self->priv->prepare_requests) == 0)
     return;
 
   g_object_ref (self);
 
-  for (iter = self->priv->prepare_requests->head; iter != NULL; iter = next)
+  while (TRUE)
     {
-      TpProxyPrepareRequest *req = iter->data;
-      TpProxyPrepareRequest *head = g_queue_peek_head (
-          self->priv->prepare_requests);
-
       if (error == NULL)
         {
           error_source = "invalidated";
@@ -2260,25 +2675,16 @@ tp_proxy_poll_features (TpProxy *self,
           break;
         }
 
-      next = iter->next;
-
-      /* Core features have to be prepared first, in superclass-to-subclass
-       * order. The next core feature to be prepared, if any, is always at the
-       * head of prepare_requests. */
-      if (!core_prepared (self) &&
-          req != head)
-        {
-          DEBUG ("%p: core features not ready yet, nothing prepared", self);
-          continue;
-        }
+      tp_proxy_start_wanted_features (self);
 
-      if (request_is_complete (self, req))
-        {
-          DEBUG ("%p: request %p prepared", self, req);
-          g_queue_delete_link (self->priv->prepare_requests, iter);
+      /* that might have invalidated us */
+      if (self->invalidated != NULL)
+        continue;
 
-          tp_proxy_prepare_request_finish (req, NULL);
-        }
+      /* When a core request finishes, the next one's features, or everyone
+       * else's, can be started */
+      if (tp_proxy_finish_prepared_requests (self) == 0)
+        break;
     }
 
   g_object_unref (self);
@@ -2310,14 +2716,66 @@ _tp_proxy_set_feature_prepared (TpProxy *self,
     GQuark feature,
     gboolean succeeded)
 {
+  FeatureData *data;
+
   g_return_if_fail (TP_IS_PROXY (self));
-  g_return_if_fail (tp_proxy_get_feature_state (self, feature) !=
-      FEATURE_STATE_INVALID);
+
+  data = tp_proxy_get_feature_data (self, feature);
+  g_return_if_fail (data != NULL);
+
+  if (data->prepare_started != 0)
+    {
+      data->prepare_time = g_get_monotonic_time () - data->prepare_started;
+      data->prepare_started = 0;
+
+      DEBUG ("%p: %s %s after %" G_GINT64_FORMAT " us", self,
+          g_quark_to_string (feature), succeeded ? "prepared" : "failed",
+          data->prepare_time);
+    }
+
   tp_proxy_set_feature_state (self, feature,
       succeeded ? FEATURE_STATE_READY : FEATURE_STATE_FAILED);
   tp_proxy_poll_features (self, NULL);
 }
 
+/*
+ * _tp_proxy_get_feature_prepare_time:
+ * @self: a proxy
+ * @feature: a feature made available by @self's class
+ *
+ * Returns: how long the last attempt to prepare @feature took, in
+ *  microseconds, or -1 if @feature has never been prepared through its
+ *  #TpProxyFeature.prepare_async function
+ */
+gint64
+_tp_proxy_get_feature_prepare_time (TpProxy *self,
+    GQuark feature)
+{
+  FeatureData *data;
+
+  g_return_val_if_fail (TP_IS_PROXY (self), -1);
+
+  data = tp_proxy_get_feature_data (self, feature);
+  g_return_val_if_fail (data != NULL, -1);
+
+  return data->prepare_time;
+}
+
+/*
+ * _tp_proxy_get_feature_graph:
+ * @self: a proxy
+ *
+ * Returns: an opaque pointer to the feature graph shared by every instance
+ *  of @self's class, for use in tests
+ */
+gconstpointer
+_tp_proxy_get_feature_graph (TpProxy *self)
+{
+  g_return_val_if_fail (TP_IS_PROXY (self), NULL);
+
+  return self->priv->graph;
+}
+
 /*
  * _tp_proxy_set_features_failed:
  * @self: a proxy
@@ -2371,12 +2829,11 @@ prepare_before_signalling_connected_cb (GObject *source,
   check_announce_connected (self, FALSE);
 }
 
-static void foreach_feature (GQuark name,
-    gpointer data,
-    gpointer user_data)
+static void
+foreach_feature (TpProxy *self,
+    GQuark name)
 {
-  FeatureState state = GPOINTER_TO_INT (data);
-  TpProxy *self = user_data;
+  FeatureState state = tp_proxy_get_feature_state (self, name);
 
   if (state == FEATURE_STATE_MISSING_IFACE)
     {
@@ -2419,6 +2876,8 @@ _tp_proxy_will_announce_connected_async (TpProxy *self,
     GAsyncReadyCallback callback,
     gpointer user_data)
 {
+  guint i;
+
   g_assert (TP_IS_CONNECTION (self));
   g_assert (self->priv->will_announce_connected_result == NULL);
 
@@ -2426,7 +2885,8 @@ _tp_proxy_will_announce_connected_async (TpProxy *self,
       (GObject *) self, callback, user_data,
       _tp_proxy_will_announce_connected_async);
 
-  g_datalist_foreach (&self->priv->features, foreach_feature, self);
+  for (i = 0; i < self->priv->graph->n_features; i++)
+    foreach_feature (self, self->priv->graph->features[i]->name);
 
   check_announce_connected (self, TRUE);
 }
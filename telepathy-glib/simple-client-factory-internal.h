@@ -29,6 +29,21 @@ G_BEGIN_DECLS
 void _tp_simple_client_factory_insert_proxy (TpSimpleClientFactory *self,
     gpointer proxy);
 
+void _tp_simple_client_factory_proxy_invalidated (TpSimpleClientFactory *self,
+    TpProxy *proxy);
+
+void _tp_simple_client_factory_update_snapshot (TpSimpleClientFactory *self,
+    const gchar *object_path,
+    const GHashTable *properties);
+GHashTable *_tp_simple_client_factory_dup_snapshot (
+    TpSimpleClientFactory *self,
+    const gchar *object_path);
+void _tp_simple_client_factory_forget_snapshot (TpSimpleClientFactory *self,
+    const gchar *object_path);
+
+gboolean _tp_simple_client_factory_is_compatible (TpSimpleClientFactory *self,
+    TpSimpleClientFactory *other);
+
 TpChannelRequest *_tp_simple_client_factory_ensure_channel_request (
     TpSimpleClientFactory *self,
     const gchar *object_path,
@@ -126,11 +126,39 @@
 #include "telepathy-glib/simple-client-factory-internal.h"
 #include "telepathy-glib/util-internal.h"
 
+/* Proxies are cached separately by kind, so that a busy observer's channels
+ * don't slow down looking up its accounts and connections */
+typedef enum {
+    CACHE_ACCOUNT,
+    CACHE_CONNECTION,
+    CACHE_CHANNEL,
+    /* account manager, channel requests, dispatch operations */
+    CACHE_OTHER,
+    N_CACHES
+} CacheKind;
+
 struct _TpSimpleClientFactoryPrivate
 {
   TpDBusDaemon *dbus;
-  /* Owned object-path -> weakref to TpProxy */
-  GHashTable *proxy_cache;
+  /* Owned object-path -> weakref to TpProxy, one table per CacheKind */
+  GHashTable *proxy_cache[N_CACHES];
+  /* Owned object-path -> owned a{sv}: the last properties we saw for an
+   * object whose proxy may since have been disposed */
+  GHashTable *snapshots;
+  /* DeadChannels for channels that were invalidated other than by being
+   * unreferenced, most recent first; owned by dead_channels_index.
+   * Empty unless max_dead_channels is set. */
+  GQueue dead_channels;
+  /* Owned DeadChannel -> borrowed GList link in dead_channels */
+  GHashTable *dead_channels_index;
+  guint max_dead_channels;
+  /* Connection object path borrowed from the value -> owned
+   * DeadChannelWatch, for each connection with entries in dead_channels
+   * whose NewChannels signal we are watching */
+  GHashTable *dead_channel_watches;
+  guint cache_hits;
+  guint cache_misses;
+  guint stale_rejections;
   GArray *desired_account_features;
   GArray *desired_connection_features;
   GArray *desired_channel_features;
@@ -145,6 +173,287 @@ enum
 
 G_DEFINE_TYPE (TpSimpleClientFactory, tp_simple_client_factory, G_TYPE_OBJECT)
 
+static CacheKind
+cache_kind_for_proxy (gpointer proxy)
+{
+  if (TP_IS_CHANNEL (proxy))
+    return CACHE_CHANNEL;
+  else if (TP_IS_CONNECTION (proxy))
+    return CACHE_CONNECTION;
+  else if (TP_IS_ACCOUNT (proxy))
+    return CACHE_ACCOUNT;
+
+  return CACHE_OTHER;
+}
+
+/* Channel object paths can be reused, both within a connection (for
+ * channels with a well-known name, like contact lists or password
+ * channels) and by a later connection at the same path, so we remember
+ * which connection a dead channel belonged to */
+typedef struct {
+    gchar *connection_path;
+    gchar *channel_path;
+} DeadChannel;
+
+static guint
+dead_channel_hash (gconstpointer p)
+{
+  const DeadChannel *dead = p;
+
+  return g_str_hash (dead->connection_path) * 33 +
+      g_str_hash (dead->channel_path);
+}
+
+static gboolean
+dead_channel_equal (gconstpointer a,
+    gconstpointer b)
+{
+  const DeadChannel *left = a;
+  const DeadChannel *right = b;
+
+  return (!tp_strdiff (left->connection_path, right->connection_path) &&
+      !tp_strdiff (left->channel_path, right->channel_path));
+}
+
+static void
+dead_channel_free (gpointer p)
+{
+  DeadChannel *dead = p;
+
+  g_free (dead->connection_path);
+  g_free (dead->channel_path);
+  g_slice_free (DeadChannel, dead);
+}
+
+/* The NewChannels signal connection itself is disconnected when the
+ * connection is invalidated or we are finalized; this is just so we know
+ * when the connection goes away without being invalidated */
+typedef struct {
+    TpSimpleClientFactory *self;
+    gchar *connection_path;
+    /* weak ref; NULL once it has been finalized */
+    TpConnection *connection;
+} DeadChannelWatch;
+
+static void dead_channel_watch_connection_gone_cb (gpointer data,
+    GObject *where_the_object_was);
+
+static void
+dead_channel_watch_free (gpointer p)
+{
+  DeadChannelWatch *watch = p;
+
+  if (watch->connection != NULL)
+    g_object_weak_unref ((GObject *) watch->connection,
+        dead_channel_watch_connection_gone_cb, watch);
+
+  g_free (watch->connection_path);
+  g_slice_free (DeadChannelWatch, watch);
+}
+
+static void
+forget_dead_channel_link (TpSimpleClientFactory *self,
+    GList *link)
+{
+  g_queue_unlink (&self->priv->dead_channels, link);
+  /* frees the DeadChannel */
+  g_hash_table_remove (self->priv->dead_channels_index, link->data);
+  g_list_free_1 (link);
+}
+
+static void
+forget_dead_channel (TpSimpleClientFactory *self,
+    const gchar *connection_path,
+    const gchar *channel_path)
+{
+  DeadChannel key;
+  GList *link;
+
+  key.connection_path = (gchar *) connection_path;
+  key.channel_path = (gchar *) channel_path;
+  link = g_hash_table_lookup (self->priv->dead_channels_index, &key);
+
+  if (link != NULL)
+    {
+      DEBUG ("%s has been announced again", channel_path);
+      forget_dead_channel_link (self, link);
+    }
+}
+
+static void
+forget_dead_channels_of_connection (TpSimpleClientFactory *self,
+    const gchar *connection_path)
+{
+  GList *link = self->priv->dead_channels.head;
+
+  while (link != NULL)
+    {
+      GList *next = link->next;
+      DeadChannel *dead = link->data;
+
+      if (!tp_strdiff (dead->connection_path, connection_path))
+        forget_dead_channel_link (self, link);
+
+      link = next;
+    }
+
+  /* the signal connection dies with the proxy, if it hasn't already */
+  g_hash_table_remove (self->priv->dead_channel_watches, connection_path);
+}
+
+static void
+dead_channel_watch_connection_gone_cb (gpointer data,
+    GObject *where_the_object_was)
+{
+  DeadChannelWatch *watch = data;
+
+  /* the connection was disposed without being invalidated; a new one at
+   * the same path needs watching again, so treat it as gone */
+  watch->connection = NULL;
+  forget_dead_channels_of_connection (watch->self, watch->connection_path);
+}
+
+static void
+dead_channels_new_channels_cb (TpConnection *connection,
+    const GPtrArray *channels,
+    gpointer user_data,
+    GObject *weak_object)
+{
+  TpSimpleClientFactory *self = (TpSimpleClientFactory *) weak_object;
+  const gchar *connection_path = tp_proxy_get_object_path (connection);
+  guint i;
+
+  /* the channel has been reopened at the same path, so dispatches for it
+   * are no longer stale */
+  for (i = 0; i < channels->len; i++)
+    {
+      GValueArray *va = g_ptr_array_index (channels, i);
+
+      forget_dead_channel (self, connection_path,
+          g_value_get_boxed (va->values + 0));
+    }
+}
+
+static void
+watch_for_reopened_channels (TpSimpleClientFactory *self,
+    TpConnection *connection)
+{
+  const gchar *connection_path = tp_proxy_get_object_path (connection);
+  TpProxySignalConnection *sc;
+  DeadChannelWatch *watch;
+  GError *error = NULL;
+
+  if (g_hash_table_lookup (self->priv->dead_channel_watches,
+        connection_path) != NULL)
+    return;
+
+  sc = tp_cli_connection_interface_requests_connect_to_new_channels (
+      connection, dead_channels_new_channels_cb, NULL, NULL,
+      (GObject *) self, &error);
+
+  if (sc == NULL)
+    {
+      /* we'll still forget its channels when the connection goes away */
+      DEBUG ("can't watch %s for new channels: %s", connection_path,
+          error->message);
+      g_clear_error (&error);
+      return;
+    }
+
+  watch = g_slice_new (DeadChannelWatch);
+  watch->self = self;
+  watch->connection_path = g_strdup (connection_path);
+  watch->connection = connection;
+  g_object_weak_ref ((GObject *) connection,
+      dead_channel_watch_connection_gone_cb, watch);
+
+  g_hash_table_insert (self->priv->dead_channel_watches,
+      watch->connection_path, watch);
+}
+
+static void
+trim_dead_channels (TpSimpleClientFactory *self)
+{
+  while (self->priv->dead_channels.length > self->priv->max_dead_channels)
+    forget_dead_channel_link (self, self->priv->dead_channels.tail);
+}
+
+static void
+remember_dead_channel (TpSimpleClientFactory *self,
+    TpChannel *channel)
+{
+  TpConnection *connection = tp_channel_get_connection (channel);
+  DeadChannel key = { NULL, NULL };
+  DeadChannel *dead;
+  GList *link;
+
+  if (self->priv->max_dead_channels == 0 || connection == NULL)
+    return;
+
+  key.connection_path = (gchar *) tp_proxy_get_object_path (connection);
+  key.channel_path = (gchar *) tp_proxy_get_object_path (channel);
+  link = g_hash_table_lookup (self->priv->dead_channels_index, &key);
+
+  if (link != NULL)
+    {
+      g_queue_unlink (&self->priv->dead_channels, link);
+      g_queue_push_head_link (&self->priv->dead_channels, link);
+      return;
+    }
+
+  dead = g_slice_new (DeadChannel);
+  dead->connection_path = g_strdup (key.connection_path);
+  dead->channel_path = g_strdup (key.channel_path);
+
+  g_queue_push_head (&self->priv->dead_channels, dead);
+  g_hash_table_insert (self->priv->dead_channels_index, dead,
+      self->priv->dead_channels.head);
+  trim_dead_channels (self);
+
+  watch_for_reopened_channels (self, connection);
+}
+
+static void
+uncache_proxy (TpSimpleClientFactory *self,
+    TpProxy *proxy)
+{
+  const GError *error = tp_proxy_get_invalidated (proxy);
+  CacheKind kind = cache_kind_for_proxy (proxy);
+  GHashTable *cache = self->priv->proxy_cache[kind];
+  const gchar *object_path = tp_proxy_get_object_path (proxy);
+
+  /* another proxy for the same path may have been cached since this one
+   * was created; leave it alone */
+  if (g_hash_table_lookup (cache, object_path) == proxy)
+    g_hash_table_remove (cache, object_path);
+
+  if (kind == CACHE_CHANNEL && error != NULL
+      && !g_error_matches (error, TP_DBUS_ERRORS,
+        TP_DBUS_ERROR_PROXY_UNREFERENCED))
+    remember_dead_channel (self, (TpChannel *) proxy);
+
+  /* once the connection has gone, we can't see its channels being
+   * reopened, and a new connection at the same path may well reuse them */
+  if (kind == CACHE_CONNECTION)
+    forget_dead_channels_of_connection (self, object_path);
+}
+
+/*
+ * _tp_simple_client_factory_proxy_invalidated:
+ * @self: a factory
+ * @proxy: a proxy whose #TpProxy:factory is @self, which is about to emit
+ *  #TpProxy::invalidated
+ *
+ * Called by #TpProxy for every proxy belonging to @self, so that
+ * the cache doesn't need a signal connection per proxy.
+ */
+void
+_tp_simple_client_factory_proxy_invalidated (TpSimpleClientFactory *self,
+    TpProxy *proxy)
+{
+  uncache_proxy (self, proxy);
+}
+
 static void
 proxy_invalidated_cb (TpProxy *proxy,
     guint domain,
@@ -152,8 +461,7 @@ proxy_invalidated_cb (TpProxy *proxy,
     gchar *message,
     TpSimpleClientFactory *self)
 {
-  g_hash_table_remove (self->priv->proxy_cache,
-      tp_proxy_get_object_path (proxy));
+  uncache_proxy (self, proxy);
 }
 
 static void
@@ -163,32 +471,121 @@ insert_proxy (TpSimpleClientFactory *self,
   if (proxy == NULL)
     return;
 
-  g_hash_table_insert (self->priv->proxy_cache,
+  g_hash_table_insert (self->priv->proxy_cache[cache_kind_for_proxy (proxy)],
       (gpointer) tp_proxy_get_object_path (proxy), proxy);
 
-  /* This assume that invalidated signal is emitted from TpProxy dispose. May
-   * change in a future API break? */
-  tp_g_signal_connect_object (proxy, "invalidated",
-      G_CALLBACK (proxy_invalidated_cb), self, 0);
+  /* Proxies that know they belong to us tell us when they're invalidated,
+   * which relies on the invalidated signal being emitted from TpProxy
+   * dispose. A subclass's create_* method might have given us a proxy
+   * with some other factory, so watch those the hard way. */
+  if (tp_proxy_get_factory (proxy) != self)
+    tp_g_signal_connect_object (proxy, "invalidated",
+        G_CALLBACK (proxy_invalidated_cb), self, 0);
 }
 
 static gpointer
 lookup_proxy (TpSimpleClientFactory *self,
+    CacheKind kind,
     const gchar *object_path)
 {
-  return g_hash_table_lookup (self->priv->proxy_cache, object_path);
+  gpointer proxy = g_hash_table_lookup (self->priv->proxy_cache[kind],
+      object_path);
+
+  if (proxy != NULL)
+    self->priv->cache_hits++;
+  else
+    self->priv->cache_misses++;
+
+  return proxy;
 }
 
 void
 _tp_simple_client_factory_insert_proxy (TpSimpleClientFactory *self,
     gpointer proxy)
 {
-  g_return_if_fail (lookup_proxy (self,
+  g_return_if_fail (g_hash_table_lookup (
+      self->priv->proxy_cache[cache_kind_for_proxy (proxy)],
       tp_proxy_get_object_path (proxy)) == NULL);
 
   insert_proxy (self, proxy);
 }
 
+/*
+ * _tp_simple_client_factory_update_snapshot:
+ * @self: a factory
+ * @object_path: the object path of a proxy created by @self
+ * @properties: (element-type utf8 GObject.Value): properties of that object,
+ *  as returned by GetAll or announced in a change signal
+ *
+ * Merge @properties into the snapshot kept for @object_path, creating it if
+ * necessary. The snapshot outlives the proxy, so that a new proxy for the
+ * same object can be made ready without waiting for GetAll.
+ */
+void
+_tp_simple_client_factory_update_snapshot (TpSimpleClientFactory *self,
+    const gchar *object_path,
+    const GHashTable *properties)
+{
+  GHashTable *snapshot;
+
+  g_return_if_fail (TP_IS_SIMPLE_CLIENT_FACTORY (self));
+  g_return_if_fail (object_path != NULL);
+
+  snapshot = g_hash_table_lookup (self->priv->snapshots, object_path);
+
+  if (snapshot == NULL)
+    {
+      snapshot = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+          (GDestroyNotify) tp_g_value_slice_free);
+      g_hash_table_insert (self->priv->snapshots, g_strdup (object_path),
+          snapshot);
+    }
+
+  tp_g_hash_table_update (snapshot, (GHashTable *) properties,
+      (GBoxedCopyFunc) g_strdup, (GBoxedCopyFunc) tp_g_value_slice_dup);
+}
+
+/*
+ * _tp_simple_client_factory_dup_snapshot:
+ * @self: a factory
+ * @object_path: an object path
+ *
+ * Returns: (transfer full): the properties last seen for @object_path,
+ *  or %NULL if there is no snapshot
+ */
+GHashTable *
+_tp_simple_client_factory_dup_snapshot (TpSimpleClientFactory *self,
+    const gchar *object_path)
+{
+  GHashTable *snapshot;
+
+  g_return_val_if_fail (TP_IS_SIMPLE_CLIENT_FACTORY (self), NULL);
+
+  snapshot = g_hash_table_lookup (self->priv->snapshots, object_path);
+
+  if (snapshot == NULL)
+    return NULL;
+
+  return g_hash_table_ref (snapshot);
+}
+
+/*
+ * _tp_simple_client_factory_forget_snapshot:
+ * @self: a factory
+ * @object_path: an object path
+ *
+ * Discard the snapshot for @object_path, if any; for instance because the
+ * object has gone away.
+ */
+void
+_tp_simple_client_factory_forget_snapshot (TpSimpleClientFactory *self,
+    const gchar *object_path)
+{
+  g_return_if_fail (TP_IS_SIMPLE_CLIENT_FACTORY (self));
+
+  g_hash_table_remove (self->priv->snapshots, object_path);
+}
+
 static TpAccount *
 create_account_impl (TpSimpleClientFactory *self,
     const gchar *object_path,
@@ -321,9 +718,22 @@ static void
 tp_simple_client_factory_finalize (GObject *object)
 {
   TpSimpleClientFactory *self = (TpSimpleClientFactory *) object;
+  CacheKind kind;
+
+  DEBUG ("%p: %u cache hits, %u misses, %u stale channels rejected", self,
+      self->priv->cache_hits, self->priv->cache_misses,
+      self->priv->stale_rejections);
 
   g_clear_object (&self->priv->dbus);
-  tp_clear_pointer (&self->priv->proxy_cache, g_hash_table_unref);
+
+  for (kind = 0; kind < N_CACHES; kind++)
+    tp_clear_pointer (&self->priv->proxy_cache[kind], g_hash_table_unref);
+
+  self->priv->max_dead_channels = 0;
+  trim_dead_channels (self);
+  tp_clear_pointer (&self->priv->dead_channels_index, g_hash_table_unref);
+  tp_clear_pointer (&self->priv->dead_channel_watches, g_hash_table_unref);
+  tp_clear_pointer (&self->priv->snapshots, g_hash_table_unref);
   tp_clear_pointer (&self->priv->desired_account_features, g_array_unref);
   tp_clear_pointer (&self->priv->desired_connection_features, g_array_unref);
   tp_clear_pointer (&self->priv->desired_channel_features, g_array_unref);
@@ -336,11 +746,22 @@ static void
 tp_simple_client_factory_init (TpSimpleClientFactory *self)
 {
   GQuark feature;
+  CacheKind kind;
 
   self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, TP_TYPE_SIMPLE_CLIENT_FACTORY,
       TpSimpleClientFactoryPrivate);
 
-  self->priv->proxy_cache = g_hash_table_new (g_str_hash, g_str_equal);
+  for (kind = 0; kind < N_CACHES; kind++)
+    self->priv->proxy_cache[kind] = g_hash_table_new (g_str_hash,
+        g_str_equal);
+
+  g_queue_init (&self->priv->dead_channels);
+  self->priv->dead_channels_index = g_hash_table_new_full (dead_channel_hash,
+      dead_channel_equal, dead_channel_free, NULL);
+  self->priv->dead_channel_watches = g_hash_table_new_full (g_str_hash,
+      g_str_equal, NULL, dead_channel_watch_free);
+  self->priv->snapshots = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, (GDestroyNotify) g_hash_table_unref);
 
   self->priv->desired_account_features = g_array_new (TRUE, FALSE,
       sizeof (GQuark));
@@ -434,6 +855,77 @@ tp_simple_client_factory_get_dbus_daemon (TpSimpleClientFactory *self)
   return self->priv->dbus;
 }
 
+/**
+ * tp_simple_client_factory_set_invalidated_cache_size:
+ * @self: a #TpSimpleClientFactory object
+ * @size: the number of invalidated channels to remember, or 0 to disable
+ *
+ * Make @self remember the @size channels that were most recently closed
+ * or otherwise invalidated (not counting channels that were merely
+ * unreferenced). While a channel is remembered,
+ * tp_simple_client_factory_ensure_channel() fails with
+ * %TP_DBUS_ERROR_OBJECT_REMOVED instead of creating a new proxy for it
+ * on the same connection, so that a long-running observer or handler
+ * doesn't waste time preparing channels from dispatches that have
+ * already gone stale.
+ *
+ * Some connection managers reuse channel object paths, so a channel is
+ * forgotten as soon as its connection announces a new channel at the same
+ * path with the NewChannels signal, or when its #TpConnection is
+ * invalidated. Connections and accounts are never remembered, because
+ * they may legitimately reappear at the same object path.
+ *
+ * The default is 0, which remembers nothing.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_simple_client_factory_set_invalidated_cache_size (
+    TpSimpleClientFactory *self,
+    guint size)
+{
+  g_return_if_fail (TP_IS_SIMPLE_CLIENT_FACTORY (self));
+
+  self->priv->max_dead_channels = size;
+  trim_dead_channels (self);
+}
+
+/**
+ * tp_simple_client_factory_get_cache_stats:
+ * @self: a #TpSimpleClientFactory object
+ * @hits: (out) (allow-none): used to return the number of times an
+ *  <function>ensure</function> function found an existing proxy, or %NULL
+ * @misses: (out) (allow-none): used to return the number of times an
+ *  <function>ensure</function> function did not find an existing proxy,
+ *  or %NULL
+ * @stale: (out) (allow-none): used to return the number of times
+ *  tp_simple_client_factory_ensure_channel() refused to create a proxy for
+ *  an invalidated channel (see
+ *  tp_simple_client_factory_set_invalidated_cache_size()), or %NULL
+ *
+ * Return statistics about the proxies cached by @self, for instance to
+ * tune an application's use of the factory.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_simple_client_factory_get_cache_stats (TpSimpleClientFactory *self,
+    guint *hits,
+    guint *misses,
+    guint *stale)
+{
+  g_return_if_fail (TP_IS_SIMPLE_CLIENT_FACTORY (self));
+
+  if (hits != NULL)
+    *hits = self->priv->cache_hits;
+
+  if (misses != NULL)
+    *misses = self->priv->cache_misses;
+
+  if (stale != NULL)
+    *stale = self->priv->stale_rejections;
+}
+
 /**
  * tp_simple_client_factory_ensure_account:
  * @self: a #TpSimpleClientFactory object
@@ -450,6 +942,11 @@ tp_simple_client_factory_get_dbus_daemon (TpSimpleClientFactory *self)
  * is responsible for calling tp_proxy_prepare_async() with the desired
  * features (as given by tp_simple_client_factory_dup_account_features()).
  *
+ * If this factory previously created a proxy for the same account, the
+ * properties it saw are remembered, and a new #TpAccount has
+ * %TP_ACCOUNT_FEATURE_CORE prepared immediately; it re-reads the account's
+ * properties in the background, and signals any changes in the usual way.
+ *
  * This function is rather low-level. tp_account_manager_dup_valid_accounts()
  * and #TpAccountManager::validity-changed are more appropriate for most
  * applications.
@@ -470,7 +967,7 @@ tp_simple_client_factory_ensure_account (TpSimpleClientFactory *self,
   g_return_val_if_fail (TP_IS_SIMPLE_CLIENT_FACTORY (self), NULL);
   g_return_val_if_fail (g_variant_is_object_path (object_path), NULL);
 
-  account = lookup_proxy (self, object_path);
+  account = lookup_proxy (self, CACHE_ACCOUNT, object_path);
   if (account != NULL)
     return g_object_ref (account);
 
@@ -598,7 +1095,7 @@ tp_simple_client_factory_ensure_connection (TpSimpleClientFactory *self,
   g_return_val_if_fail (TP_IS_SIMPLE_CLIENT_FACTORY (self), NULL);
   g_return_val_if_fail (g_variant_is_object_path (object_path), NULL);
 
-  connection = lookup_proxy (self, object_path);
+  connection = lookup_proxy (self, CACHE_CONNECTION, object_path);
   if (connection != NULL)
     return g_object_ref (connection);
 
@@ -708,6 +1205,11 @@ tp_simple_client_factory_add_connection_features_varargs (
  * caller is responsible for calling tp_proxy_prepare_async() with the desired
  * features (as given by tp_simple_client_factory_dup_channel_features()).
  *
+ * If @immutable_properties include all the properties of the Channel
+ * interface (as found in the NewChannels signal, or passed to observers,
+ * approvers and handlers), they are trusted, and %TP_CHANNEL_FEATURE_CORE can
+ * be prepared without any D-Bus round-trips to the channel.
+ *
  * This function is rather low-level.
  * #TpAccountChannelRequest and #TpBaseClient are more appropriate ways
  * to obtain channels for most applications.
@@ -725,16 +1227,28 @@ tp_simple_client_factory_ensure_channel (TpSimpleClientFactory *self,
     GError **error)
 {
   TpChannel *channel;
+  DeadChannel key = { NULL, NULL };
 
   g_return_val_if_fail (TP_IS_SIMPLE_CLIENT_FACTORY (self), NULL);
   g_return_val_if_fail (TP_IS_CONNECTION (connection), NULL);
   g_return_val_if_fail (tp_proxy_get_factory (connection) == self, NULL);
   g_return_val_if_fail (g_variant_is_object_path (object_path), NULL);
 
-  channel = lookup_proxy (self, object_path);
+  channel = lookup_proxy (self, CACHE_CHANNEL, object_path);
   if (channel != NULL)
     return g_object_ref (channel);
 
+  key.connection_path = (gchar *) tp_proxy_get_object_path (connection);
+  key.channel_path = (gchar *) object_path;
+
+  if (g_hash_table_lookup (self->priv->dead_channels_index, &key) != NULL)
+    {
+      self->priv->stale_rejections++;
+      g_set_error (error, TP_DBUS_ERRORS, TP_DBUS_ERROR_OBJECT_REMOVED,
+          "Channel %s has already been closed", object_path);
+      return NULL;
+    }
+
   channel = TP_SIMPLE_CLIENT_FACTORY_GET_CLASS (self)->create_channel (self,
       connection, object_path, immutable_properties, error);
   insert_proxy (self, channel);
@@ -1188,7 +1702,7 @@ _tp_simple_client_factory_ensure_channel_request (TpSimpleClientFactory *self,
   g_return_val_if_fail (TP_IS_SIMPLE_CLIENT_FACTORY (self), NULL);
   g_return_val_if_fail (g_variant_is_object_path (object_path), NULL);
 
-  request = lookup_proxy (self, object_path);
+  request = lookup_proxy (self, CACHE_OTHER, object_path);
   if (request != NULL)
     {
       /* A common usage is request_and_handle, in that case EnsureChannel
@@ -1241,7 +1755,7 @@ _tp_simple_client_factory_ensure_channel_dispatch_operation (
   g_return_val_if_fail (TP_IS_SIMPLE_CLIENT_FACTORY (self), NULL);
   g_return_val_if_fail (g_variant_is_object_path (object_path), NULL);
 
-  dispatch = lookup_proxy (self, object_path);
+  dispatch = lookup_proxy (self, CACHE_OTHER, object_path);
   if (dispatch != NULL)
     return g_object_ref (dispatch);
 
@@ -1251,3 +1765,58 @@ _tp_simple_client_factory_ensure_channel_dispatch_operation (
 
   return dispatch;
 }
+
+/* Elements are GQuark or TpContactFeature, which are the same size */
+static gboolean
+same_features (GArray *a,
+    GArray *b)
+{
+  guint i, j;
+
+  if (a->len != b->len)
+    return FALSE;
+
+  for (i = 0; i < a->len; i++)
+    {
+      for (j = 0; j < b->len; j++)
+        {
+          if (g_array_index (a, guint, i) == g_array_index (b, guint, j))
+            break;
+        }
+
+      if (j == b->len)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*
+ * _tp_simple_client_factory_is_compatible:
+ * @self: a factory
+ * @other: another factory
+ *
+ * Returns: %TRUE if @other would make the same kinds of proxies as @self
+ *  and prepare the same features on them, so that a client using @self can
+ *  be given proxies from @other
+ */
+gboolean
+_tp_simple_client_factory_is_compatible (TpSimpleClientFactory *self,
+    TpSimpleClientFactory *other)
+{
+  g_return_val_if_fail (TP_IS_SIMPLE_CLIENT_FACTORY (self), FALSE);
+  g_return_val_if_fail (TP_IS_SIMPLE_CLIENT_FACTORY (other), FALSE);
+
+  if (self == other)
+    return TRUE;
+
+  return G_OBJECT_TYPE (self) == G_OBJECT_TYPE (other) &&
+      same_features (self->priv->desired_account_features,
+          other->priv->desired_account_features) &&
+      same_features (self->priv->desired_connection_features,
+          other->priv->desired_connection_features) &&
+      same_features (self->priv->desired_channel_features,
+          other->priv->desired_channel_features) &&
+      same_features (self->priv->desired_contact_features,
+          other->priv->desired_contact_features);
+}
@@ -113,6 +113,16 @@ _TP_AVAILABLE_IN_0_16
 TpDBusDaemon *tp_simple_client_factory_get_dbus_daemon (
     TpSimpleClientFactory *self);
 
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_simple_client_factory_set_invalidated_cache_size (
+    TpSimpleClientFactory *self,
+    guint size);
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_simple_client_factory_get_cache_stats (TpSimpleClientFactory *self,
+    guint *hits,
+    guint *misses,
+    guint *stale);
+
 /* TpAccount */
 _TP_AVAILABLE_IN_0_16
 TpAccount *tp_simple_client_factory_ensure_account (TpSimpleClientFactory *self,
@@ -0,0 +1,52 @@
+/*<private_header>*/
+/*
+ * socket-forwarder-internal.h - bridge two socket connections (internal)
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __TP_SOCKET_FORWARDER_INTERNAL_H__
+#define __TP_SOCKET_FORWARDER_INTERNAL_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TpSocketForwarder TpSocketForwarder;
+
+TpSocketForwarder *_tp_socket_forwarder_new (GSocketConnection *first,
+    GSocketConnection *second);
+
+TpSocketForwarder *_tp_socket_forwarder_ref (TpSocketForwarder *self);
+void _tp_socket_forwarder_unref (TpSocketForwarder *self);
+
+void _tp_socket_forwarder_run_async (TpSocketForwarder *self,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback,
+    gpointer user_data);
+
+gboolean _tp_socket_forwarder_run_finish (TpSocketForwarder *self,
+    GAsyncResult *result,
+    GError **error);
+
+guint64 _tp_socket_forwarder_get_bytes (TpSocketForwarder *self,
+    gboolean from_first);
+
+G_END_DECLS
+
+#endif /* __TP_SOCKET_FORWARDER_INTERNAL_H__ */
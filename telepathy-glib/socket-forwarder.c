@@ -0,0 +1,496 @@
+/*
+ * socket-forwarder.c - bridge two socket connections
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* splice(2) is a GNU extension */
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#include "telepathy-glib/socket-forwarder-internal.h"
+
+#include <telepathy-glib/util.h>
+
+#define DEBUG_FLAG TP_DEBUG_CHANNEL
+#include "telepathy-glib/debug-internal.h"
+
+#if defined(HAVE_GIO_UNIX) && defined(HAVE_SPLICE)
+# define USE_SPLICE 1
+#endif
+
+#ifdef USE_SPLICE
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* Largest number of bytes read from a socket at once, which is also as much
+ * as we hold for a direction before the other end has accepted it. */
+#define CHUNK_SIZE (64 * 1024)
+
+/* Number of chunks we move in a direction before going back to the main
+ * loop, so that a fast connection can't starve the others. */
+#define MAX_CHUNKS_PER_DISPATCH 16
+
+/* Data flows between the two connections in two independent directions.
+ * Each of them only reads from its input once the data it read previously
+ * has been written to its output, so a slow reader on one side slows the
+ * writer on the other side down through the usual socket buffers, rather
+ * than making us buffer an unbounded amount of data.
+ *
+ * Everything happens in the main context the forwarding was started from,
+ * without threads: the sockets are non-blocking, and we wait for them to be
+ * ready with GSocket sources. Where splice() is available, the data moves
+ * from one socket to the other through a pipe without being copied to
+ * userspace. */
+typedef struct
+{
+  TpSocketForwarder *forwarder;
+  GSocket *in;
+  GSocket *out;
+  GSource *source;
+
+#ifdef USE_SPLICE
+  gint pipe_fds[2];
+#endif
+  /* Used instead of the pipe when we can't splice */
+  gchar *buffer;
+  gsize offset;
+
+  /* Bytes read from @in but not written to @out yet */
+  gsize pending;
+  guint64 bytes;
+  gboolean done;
+} Direction;
+
+struct _TpSocketForwarder
+{
+  gint ref_count;
+
+  GSocketConnection *connections[2];
+  /* directions[0] goes from connections[0] to connections[1] */
+  Direction directions[2];
+
+  /* Non-NULL while running */
+  GSimpleAsyncResult *result;
+  GCancellable *cancellable;
+};
+
+static void direction_step (Direction *d);
+
+static void
+direction_use_buffer (Direction *d)
+{
+#ifdef USE_SPLICE
+  if (d->pipe_fds[0] >= 0)
+    {
+      close (d->pipe_fds[0]);
+      close (d->pipe_fds[1]);
+      d->pipe_fds[0] = d->pipe_fds[1] = -1;
+    }
+#endif
+
+  if (d->buffer == NULL)
+    d->buffer = g_malloc (CHUNK_SIZE);
+}
+
+static void
+direction_init (Direction *d,
+    TpSocketForwarder *forwarder,
+    GSocketConnection *from,
+    GSocketConnection *to)
+{
+  d->forwarder = forwarder;
+  d->in = g_socket_connection_get_socket (from);
+  d->out = g_socket_connection_get_socket (to);
+
+#ifdef USE_SPLICE
+  if (pipe (d->pipe_fds) == 0)
+    {
+      fcntl (d->pipe_fds[0], F_SETFL, O_NONBLOCK);
+      fcntl (d->pipe_fds[1], F_SETFL, O_NONBLOCK);
+      return;
+    }
+
+  DEBUG ("Failed to create pipe, copying data instead: %s",
+      g_strerror (errno));
+  d->pipe_fds[0] = d->pipe_fds[1] = -1;
+#endif
+
+  direction_use_buffer (d);
+}
+
+static void
+direction_stop (Direction *d)
+{
+  if (d->source != NULL)
+    {
+      g_source_destroy (d->source);
+      tp_clear_pointer (&d->source, g_source_unref);
+    }
+}
+
+static void
+direction_clear (Direction *d)
+{
+  direction_stop (d);
+
+#ifdef USE_SPLICE
+  if (d->pipe_fds[0] >= 0)
+    {
+      close (d->pipe_fds[0]);
+      close (d->pipe_fds[1]);
+    }
+#endif
+
+  g_free (d->buffer);
+}
+
+#ifdef USE_SPLICE
+static gssize
+splice_nonblocking (gint in_fd,
+    gint out_fd,
+    gsize len,
+    GError **error)
+{
+  gssize n;
+
+  /* Like libdbus, we assume SIGPIPE is ignored: splice() has no equivalent
+   * of MSG_NOSIGNAL. */
+  do
+    n = splice (in_fd, NULL, out_fd, NULL, len,
+        SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  while (n < 0 && errno == EINTR);
+
+  if (n < 0)
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+        "Error splicing data: %s", g_strerror (errno));
+
+  return n;
+}
+#endif
+
+/* Returns the number of bytes now pending, 0 at end of stream, or -1 on
+ * error (which is G_IO_ERROR_WOULD_BLOCK if @in isn't ready) */
+static gssize
+direction_read (Direction *d,
+    GError **error)
+{
+#ifdef USE_SPLICE
+  if (d->buffer == NULL)
+    {
+      gssize n;
+      GError *e = NULL;
+
+      n = splice_nonblocking (g_socket_get_fd (d->in), d->pipe_fds[1],
+          CHUNK_SIZE, &e);
+
+      if (n >= 0)
+        return n;
+
+      if (d->bytes == 0 &&
+          (g_error_matches (e, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT) ||
+           g_error_matches (e, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED)))
+        {
+          DEBUG ("Can't splice these sockets, copying data instead: %s",
+              e->message);
+          g_error_free (e);
+          direction_use_buffer (d);
+          return direction_read (d, error);
+        }
+
+      g_propagate_error (error, e);
+      return -1;
+    }
+#endif
+
+  d->offset = 0;
+  return g_socket_receive_with_blocking (d->in, d->buffer, CHUNK_SIZE, FALSE,
+      NULL, error);
+}
+
+/* Returns the number of pending bytes written, or -1 on error */
+static gssize
+direction_write (Direction *d,
+    GError **error)
+{
+#ifdef USE_SPLICE
+  if (d->buffer == NULL)
+    return splice_nonblocking (d->pipe_fds[0], g_socket_get_fd (d->out),
+        d->pending, error);
+#endif
+
+  return g_socket_send_with_blocking (d->out, d->buffer + d->offset,
+      d->pending, FALSE, NULL, error);
+}
+
+static void
+forwarder_complete (TpSocketForwarder *self,
+    GError *error)
+{
+  GSimpleAsyncResult *result = self->result;
+  guint i;
+
+  if (result == NULL)
+    return;
+
+  self->result = NULL;
+
+  for (i = 0; i < 2; i++)
+    direction_stop (&self->directions[i]);
+
+  DEBUG ("Forwarding %s after %" G_GUINT64_FORMAT " and %" G_GUINT64_FORMAT
+      " bytes", error == NULL ? "done" : error->message,
+      self->directions[0].bytes, self->directions[1].bytes);
+
+  for (i = 0; i < 2; i++)
+    g_io_stream_close (G_IO_STREAM (self->connections[i]), NULL, NULL);
+
+  if (error != NULL)
+    g_simple_async_result_take_error (result, error);
+
+  g_simple_async_result_complete_in_idle (result);
+  g_object_unref (result);
+  tp_clear_object (&self->cancellable);
+
+  /* Drop the ref taken when we started running */
+  _tp_socket_forwarder_unref (self);
+}
+
+static gboolean
+direction_ready_cb (GSocket *sock,
+    GIOCondition condition,
+    gpointer user_data)
+{
+  Direction *d = user_data;
+
+  /* The main context holds its own ref while dispatching */
+  tp_clear_pointer (&d->source, g_source_unref);
+
+  _tp_socket_forwarder_ref (d->forwarder);
+  direction_step (d);
+  _tp_socket_forwarder_unref (d->forwarder);
+
+  return FALSE;
+}
+
+static void
+direction_wait (Direction *d,
+    GIOCondition condition)
+{
+  g_assert (d->source == NULL);
+
+  d->source = g_socket_create_source (condition == G_IO_IN ? d->in : d->out,
+      condition, d->forwarder->cancellable);
+  g_source_set_callback (d->source, (GSourceFunc) direction_ready_cb, d,
+      NULL);
+  g_source_attach (d->source, g_main_context_get_thread_default ());
+}
+
+static void
+direction_step (Direction *d)
+{
+  TpSocketForwarder *self = d->forwarder;
+  GError *error = NULL;
+  guint chunks;
+
+  if (self->result == NULL || d->done)
+    return;
+
+  for (chunks = 0; chunks < MAX_CHUNKS_PER_DISPATCH; chunks++)
+    {
+      gssize n;
+
+      if (g_cancellable_set_error_if_cancelled (self->cancellable, &error))
+        goto fail;
+
+      if (d->pending > 0)
+        {
+          n = direction_write (d, &error);
+
+          if (n < 0)
+            {
+              if (!g_error_matches (error, G_IO_ERROR,
+                      G_IO_ERROR_WOULD_BLOCK))
+                goto fail;
+
+              g_clear_error (&error);
+              direction_wait (d, G_IO_OUT);
+              return;
+            }
+
+          d->pending -= n;
+          d->offset += n;
+          d->bytes += n;
+          continue;
+        }
+
+      n = direction_read (d, &error);
+
+      if (n < 0)
+        {
+          if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+            goto fail;
+
+          g_clear_error (&error);
+          direction_wait (d, G_IO_IN);
+          return;
+        }
+
+      if (n == 0)
+        {
+          /* Pass the end of stream on, but keep the other direction going */
+          g_socket_shutdown (d->out, FALSE, TRUE, NULL);
+          d->done = TRUE;
+
+          if (self->directions[0].done && self->directions[1].done)
+            forwarder_complete (self, NULL);
+
+          return;
+        }
+
+      d->pending = n;
+    }
+
+  /* Let other sources run; we'll be dispatched again straight away if the
+   * socket is still ready */
+  direction_wait (d, d->pending > 0 ? G_IO_OUT : G_IO_IN);
+  return;
+
+fail:
+  forwarder_complete (self, error);
+}
+
+/*
+ * _tp_socket_forwarder_new:
+ * @first: a #GSocketConnection
+ * @second: another #GSocketConnection
+ *
+ * Returns: (transfer full): a new forwarder moving data between @first and
+ *  @second once _tp_socket_forwarder_run_async() has been called
+ */
+TpSocketForwarder *
+_tp_socket_forwarder_new (GSocketConnection *first,
+    GSocketConnection *second)
+{
+  TpSocketForwarder *self;
+
+  g_return_val_if_fail (G_IS_SOCKET_CONNECTION (first), NULL);
+  g_return_val_if_fail (G_IS_SOCKET_CONNECTION (second), NULL);
+
+  self = g_slice_new0 (TpSocketForwarder);
+  self->ref_count = 1;
+  self->connections[0] = g_object_ref (first);
+  self->connections[1] = g_object_ref (second);
+
+  direction_init (&self->directions[0], self, first, second);
+  direction_init (&self->directions[1], self, second, first);
+
+  return self;
+}
+
+TpSocketForwarder *
+_tp_socket_forwarder_ref (TpSocketForwarder *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+
+  self->ref_count++;
+  return self;
+}
+
+void
+_tp_socket_forwarder_unref (TpSocketForwarder *self)
+{
+  guint i;
+
+  g_return_if_fail (self != NULL);
+
+  if (--self->ref_count > 0)
+    return;
+
+  /* Running holds a ref */
+  g_assert (self->result == NULL);
+
+  for (i = 0; i < 2; i++)
+    {
+      direction_clear (&self->directions[i]);
+      g_object_unref (self->connections[i]);
+    }
+
+  g_slice_free (TpSocketForwarder, self);
+}
+
+/*
+ * _tp_socket_forwarder_run_async:
+ * @self: a #TpSocketForwarder
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore
+ * @callback: a #GAsyncReadyCallback
+ * @user_data: user data passed to @callback
+ *
+ * Forward data between the two connections in both directions, from the
+ * thread-default main context, until both of them have reached the end of
+ * their stream or an error occurs. The connections are closed when this
+ * finishes.
+ */
+void
+_tp_socket_forwarder_run_async (TpSocketForwarder *self,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (self->result == NULL);
+
+  self->result = g_simple_async_result_new (NULL, callback, user_data,
+      _tp_socket_forwarder_run_async);
+
+  if (cancellable != NULL)
+    self->cancellable = g_object_ref (cancellable);
+
+  /* Dropped in forwarder_complete() */
+  _tp_socket_forwarder_ref (self);
+
+  direction_step (&self->directions[0]);
+  direction_step (&self->directions[1]);
+}
+
+gboolean
+_tp_socket_forwarder_run_finish (TpSocketForwarder *self,
+    GAsyncResult *result,
+    GError **error)
+{
+  _tp_implement_finish_void (NULL, _tp_socket_forwarder_run_async);
+}
+
+/*
+ * _tp_socket_forwarder_get_bytes:
+ * @self: a #TpSocketForwarder
+ * @from_first: whether to count the data going from the first connection to
+ *  the second one, rather than the opposite
+ *
+ * Returns: the number of bytes forwarded so far in this direction
+ */
+guint64
+_tp_socket_forwarder_get_bytes (TpSocketForwarder *self,
+    gboolean from_first)
+{
+  g_return_val_if_fail (self != NULL, 0);
+
+  return self->directions[from_first ? 0 : 1].bytes;
+}
@@ -0,0 +1,44 @@
+/*<private_header>*/
+/*
+ * splice-internal.h - zero-copy stream splicing (internal)
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __TP_SPLICE_INTERNAL_H__
+#define __TP_SPLICE_INTERNAL_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+void _tp_splice_async (GOutputStream *target,
+    GInputStream *source,
+    GOutputStreamSpliceFlags flags,
+    gint io_priority,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback,
+    gpointer user_data);
+
+gssize _tp_splice_finish (GOutputStream *target,
+    GAsyncResult *result,
+    GError **error);
+
+G_END_DECLS
+
+#endif /* __TP_SPLICE_INTERNAL_H__ */
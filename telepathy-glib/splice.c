@@ -0,0 +1,444 @@
+/*
+ * splice.c - zero-copy stream splicing
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* splice(2) and F_SETPIPE_SZ are GNU extensions */
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#include "telepathy-glib/splice-internal.h"
+
+#define DEBUG_FLAG TP_DEBUG_CHANNEL
+#include "telepathy-glib/debug-internal.h"
+
+#if defined(HAVE_GIO_UNIX) && defined(HAVE_SPLICE) && defined(HAVE_SENDFILE) \
+    && defined(HAVE_SYS_SENDFILE_H)
+# define USE_ZERO_COPY 1
+#endif
+
+#ifdef USE_ZERO_COPY
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+
+#include <gio/gfiledescriptorbased.h>
+#endif
+
+/* Largest number of bytes moved by a single sendfile() or splice() call,
+ * and the pipe buffer size we ask the kernel for. */
+#define CHUNK_SIZE (1024 * 1024)
+
+typedef struct {
+    GInputStream *source;
+    GOutputStreamSpliceFlags flags;
+    gssize bytes;
+} SpliceData;
+
+static void
+splice_data_free (SpliceData *data)
+{
+  g_object_unref (data->source);
+  g_slice_free (SpliceData, data);
+}
+
+#ifdef USE_ZERO_COPY
+
+static gint
+stream_get_fd (gpointer stream)
+{
+  /* Local files and GSocketConnection streams both implement this on Unix */
+  if (!G_IS_FILE_DESCRIPTOR_BASED (stream))
+    return -1;
+
+  return g_file_descriptor_based_get_fd (G_FILE_DESCRIPTOR_BASED (stream));
+}
+
+/* Wait until @fd is ready for @events, or @cancellable is triggered.
+ * The sockets given to us by the file transfer and tube code are
+ * non-blocking, so this is how we block in the worker thread. */
+static gboolean
+wait_for_fd (gint fd,
+    gushort events,
+    GCancellable *cancellable,
+    GError **error)
+{
+  GPollFD fds[2];
+  guint n_fds = 1;
+  gint ret;
+
+  fds[0].fd = fd;
+  fds[0].events = events | G_IO_HUP | G_IO_ERR;
+  fds[0].revents = 0;
+
+  if (g_cancellable_make_pollfd (cancellable, &fds[1]))
+    n_fds++;
+
+  do
+    ret = g_poll (fds, n_fds, -1);
+  while (ret < 0 && errno == EINTR);
+
+  if (n_fds > 1)
+    g_cancellable_release_fd (cancellable);
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    return FALSE;
+
+  if (ret < 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+          "Error waiting for file descriptor: %s", g_strerror (errno));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Returns TRUE and sets *handled to FALSE if zero-copy is not possible
+ * before anything has been moved, so that the caller can fall back. */
+static gboolean
+splice_errno_to_error (gint err,
+    gssize moved,
+    gboolean *handled,
+    GError **error)
+{
+  if (moved == 0 && (err == EINVAL || err == ENOSYS || err == EOPNOTSUPP))
+    {
+      *handled = FALSE;
+      return TRUE;
+    }
+
+  g_set_error (error, G_IO_ERROR, g_io_error_from_errno (err),
+      "Error splicing data: %s", g_strerror (err));
+  return FALSE;
+}
+
+static gboolean
+splice_sendfile (gint in_fd,
+    gint out_fd,
+    gssize *bytes,
+    gboolean *handled,
+    GCancellable *cancellable,
+    GError **error)
+{
+  while (TRUE)
+    {
+      gssize n;
+
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        return FALSE;
+
+      /* A NULL offset uses and updates the file position, so this respects
+       * any seek done on the GFileInputStream beforehand */
+      n = sendfile (out_fd, in_fd, NULL, CHUNK_SIZE);
+
+      if (n == 0)
+        return TRUE;
+
+      if (n > 0)
+        {
+          *bytes += n;
+          continue;
+        }
+
+      if (errno == EINTR)
+        continue;
+
+      if (errno == EAGAIN)
+        {
+          if (!wait_for_fd (out_fd, G_IO_OUT, cancellable, error))
+            return FALSE;
+
+          continue;
+        }
+
+      return splice_errno_to_error (errno, *bytes, handled, error);
+    }
+}
+
+static gboolean
+splice_through_pipe (gint in_fd,
+    gint out_fd,
+    gssize *bytes,
+    gboolean *handled,
+    GCancellable *cancellable,
+    GError **error)
+{
+  gint pipe_fds[2];
+  gboolean ret = FALSE;
+
+  if (pipe (pipe_fds) != 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+          "Failed to create pipe: %s", g_strerror (errno));
+      return FALSE;
+    }
+
+#ifdef F_SETPIPE_SZ
+  /* Not fatal: we just move less data per system call */
+  if (fcntl (pipe_fds[1], F_SETPIPE_SZ, CHUNK_SIZE) < 0)
+    DEBUG ("Failed to enlarge pipe buffer: %s", g_strerror (errno));
+#endif
+
+  while (TRUE)
+    {
+      gssize in_pipe;
+
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        goto out;
+
+      in_pipe = splice (in_fd, NULL, pipe_fds[1], NULL, CHUNK_SIZE,
+          SPLICE_F_MOVE | SPLICE_F_MORE);
+
+      if (in_pipe == 0)
+        break;
+
+      if (in_pipe < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          if (errno == EAGAIN)
+            {
+              if (!wait_for_fd (in_fd, G_IO_IN, cancellable, error))
+                goto out;
+
+              continue;
+            }
+
+          ret = splice_errno_to_error (errno, *bytes, handled, error);
+          goto out;
+        }
+
+      /* Drain the pipe completely before reading more, so we never have to
+       * handle data left over in it at EOF */
+      while (in_pipe > 0)
+        {
+          gssize out;
+
+          out = splice (pipe_fds[0], NULL, out_fd, NULL, in_pipe,
+              SPLICE_F_MOVE | SPLICE_F_MORE);
+
+          if (out > 0)
+            {
+              in_pipe -= out;
+              *bytes += out;
+              continue;
+            }
+
+          if (out < 0 && errno == EINTR)
+            continue;
+
+          if (out < 0 && errno == EAGAIN)
+            {
+              if (!wait_for_fd (out_fd, G_IO_OUT, cancellable, error))
+                goto out;
+
+              continue;
+            }
+
+          /* The data is already out of @in_fd, so there's no falling back
+           * from here. */
+          g_set_error (error, G_IO_ERROR,
+              out < 0 ? g_io_error_from_errno (errno) : G_IO_ERROR_FAILED,
+              "Error splicing data: %s",
+              out < 0 ? g_strerror (errno) : "short write");
+          goto out;
+        }
+    }
+
+  ret = TRUE;
+
+out:
+  close (pipe_fds[0]);
+  close (pipe_fds[1]);
+  return ret;
+}
+
+/* Returns TRUE and sets *handled to TRUE on success; returns TRUE and sets
+ * *handled to FALSE if the streams can't be spliced without copying. */
+static gboolean
+splice_zero_copy (GOutputStream *target,
+    GInputStream *source,
+    gssize *bytes,
+    gboolean *handled,
+    GCancellable *cancellable,
+    GError **error)
+{
+  gint in_fd, out_fd;
+  struct stat st;
+
+  /* Note that, like libdbus, we assume SIGPIPE is ignored: sendfile() and
+   * splice() have no equivalent of MSG_NOSIGNAL. */
+
+  *handled = FALSE;
+
+  in_fd = stream_get_fd (source);
+  out_fd = stream_get_fd (target);
+
+  if (in_fd < 0 || out_fd < 0)
+    return TRUE;
+
+  if (fstat (in_fd, &st) != 0)
+    return TRUE;
+
+  *handled = TRUE;
+
+  /* sendfile() needs an mmap-able source, i.e. a regular file; anything
+   * else (including sockets) can be moved through a pipe with splice() */
+  if (S_ISREG (st.st_mode))
+    {
+      DEBUG ("Sending file with sendfile()");
+      return splice_sendfile (in_fd, out_fd, bytes, handled, cancellable,
+          error);
+    }
+
+  /* splice() refuses to write to files opened with O_APPEND, and we only
+   * find out once the data has already been read from @in_fd */
+  if (fcntl (out_fd, F_GETFL) & O_APPEND)
+    {
+      *handled = FALSE;
+      return TRUE;
+    }
+
+  DEBUG ("Receiving data with splice()");
+  return splice_through_pipe (in_fd, out_fd, bytes, handled, cancellable,
+      error);
+}
+
+#endif /* USE_ZERO_COPY */
+
+static void
+splice_thread (GSimpleAsyncResult *result,
+    GObject *object,
+    GCancellable *cancellable)
+{
+  GOutputStream *target = G_OUTPUT_STREAM (object);
+  SpliceData *data = g_simple_async_result_get_op_res_gpointer (result);
+  GError *error = NULL;
+  gboolean handled = FALSE;
+
+#ifdef USE_ZERO_COPY
+  if (!splice_zero_copy (target, data->source, &data->bytes, &handled,
+          cancellable, &error))
+    g_simple_async_result_take_error (result, error);
+#endif
+
+  if (!handled)
+    {
+      DEBUG ("Can't splice without copying, using GIO");
+
+      /* We're in a thread, so blocking here is fine */
+      data->bytes = g_output_stream_splice (target, data->source,
+          data->flags, cancellable, &error);
+
+      if (data->bytes < 0)
+        g_simple_async_result_take_error (result, error);
+
+      /* g_output_stream_splice() already closed the streams */
+      return;
+    }
+
+  /* Close the streams even on error, as g_output_stream_splice() does */
+  if (data->flags & G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE)
+    g_input_stream_close (data->source, cancellable, NULL);
+
+  if (data->flags & G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET)
+    g_output_stream_close (target, cancellable, NULL);
+}
+
+/*
+ * _tp_splice_async:
+ * @target: a #GOutputStream
+ * @source: a #GInputStream
+ * @flags: a set of #GOutputStreamSpliceFlags
+ * @io_priority: the I/O priority of the request
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore
+ * @callback: a #GAsyncReadyCallback
+ * @user_data: user data passed to @callback
+ *
+ * Like g_output_stream_splice_async(), but the data never goes through a
+ * userspace buffer when both @source and @target are backed by file
+ * descriptors (local files and sockets): a regular file is sent with
+ * sendfile(), and anything else is moved through a pipe with splice().
+ * This all happens in a worker thread, so the main loop is not woken up
+ * for each chunk. Other streams fall back to g_output_stream_splice().
+ */
+void
+_tp_splice_async (GOutputStream *target,
+    GInputStream *source,
+    GOutputStreamSpliceFlags flags,
+    gint io_priority,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  GSimpleAsyncResult *result;
+  SpliceData *data;
+
+  g_return_if_fail (G_IS_OUTPUT_STREAM (target));
+  g_return_if_fail (G_IS_INPUT_STREAM (source));
+
+  result = g_simple_async_result_new (G_OBJECT (target), callback, user_data,
+      _tp_splice_async);
+
+  data = g_slice_new0 (SpliceData);
+  data->source = g_object_ref (source);
+  data->flags = flags;
+
+  g_simple_async_result_set_op_res_gpointer (result, data,
+      (GDestroyNotify) splice_data_free);
+
+  g_simple_async_result_run_in_thread (result, splice_thread, io_priority,
+      cancellable);
+
+  g_object_unref (result);
+}
+
+/*
+ * _tp_splice_finish:
+ * @target: a #GOutputStream
+ * @result: a #GAsyncResult
+ * @error: a #GError to fill
+ *
+ * Finishes a call to _tp_splice_async().
+ *
+ * Returns: the number of bytes spliced, or -1 on error
+ */
+gssize
+_tp_splice_finish (GOutputStream *target,
+    GAsyncResult *result,
+    GError **error)
+{
+  GSimpleAsyncResult *simple = (GSimpleAsyncResult *) result;
+  SpliceData *data;
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return -1;
+
+  g_return_val_if_fail (g_simple_async_result_is_valid (result,
+          G_OBJECT (target), _tp_splice_async), -1);
+
+  data = g_simple_async_result_get_op_res_gpointer (simple);
+
+  return data->bytes;
+}
@@ -26,6 +26,10 @@
  * #TpStreamTubeChannel is a sub-class of #TpChannel providing convenient API
  * to offer and accept a stream tube.
  *
+ * Services which just want to make a local socket available through a tube
+ * can use tp_stream_tube_channel_forward_to_address_async() rather than
+ * copying data to and from each #TpStreamTubeConnection themselves.
+ *
  * Since: 0.13.2
  */
 
@@ -56,6 +60,7 @@
 #include <telepathy-glib/gtypes.h>
 #include <telepathy-glib/interfaces.h>
 #include <telepathy-glib/proxy-subclass.h>
+#include <telepathy-glib/socket-forwarder-internal.h>
 #include <telepathy-glib/stream-tube-connection-internal.h>
 #include <telepathy-glib/util-internal.h>
 #include <telepathy-glib/util.h>
@@ -81,21 +86,18 @@ G_DEFINE_TYPE (TpStreamTubeChannel, tp_stream_tube_channel, TP_TYPE_CHANNEL)
 typedef struct
 {
   TpHandle handle;
-  GValue *param;
   guint connection_id;
   gboolean rejected;
 } SigWaitingConn;
 
 static SigWaitingConn *
 sig_waiting_conn_new (TpHandle handle,
-    const GValue *param,
     guint connection_id,
     gboolean rejected)
 {
   SigWaitingConn *ret = g_slice_new0 (SigWaitingConn);
 
   ret->handle = handle;
-  ret->param = tp_g_value_slice_dup (param);
   ret->connection_id = connection_id;
   ret->rejected = rejected;
   return ret;
@@ -106,36 +108,66 @@ sig_waiting_conn_free (SigWaitingConn *sig)
 {
   g_assert (sig != NULL);
 
-  tp_g_value_slice_free (sig->param);
   g_slice_free (SigWaitingConn, sig);
 }
 
-typedef struct
+static void
+sig_waiting_conn_queue_free (GQueue *queue)
 {
-  GSocketConnection *conn;
-  /* Used only with TP_SOCKET_ACCESS_CONTROL_CREDENTIALS to store the byte
-   * read with the credentials. */
-  guchar byte;
-} ConnWaitingSig;
+  g_queue_free_full (queue, (GDestroyNotify) sig_waiting_conn_free);
+}
 
-static ConnWaitingSig *
-conn_waiting_sig_new (GSocketConnection *conn,
-    guchar byte)
+static void
+conn_waiting_sig_queue_free (GQueue *queue)
 {
-  ConnWaitingSig *ret = g_slice_new0 (ConnWaitingSig);
-
-  ret->conn = g_object_ref (conn);
-  ret->byte = byte;
-  return ret;
+  g_queue_free_full (queue, g_object_unref);
 }
 
+/* Add @item to the queue of things waiting for @key in @index */
 static void
-conn_waiting_sig_free (ConnWaitingSig *c)
+waiting_index_push (GHashTable *index,
+    guint key,
+    gpointer item)
 {
-  g_assert (c != NULL);
+  GQueue *queue = g_hash_table_lookup (index, GUINT_TO_POINTER (key));
 
-  g_object_unref (c->conn);
-  g_slice_free (ConnWaitingSig, c);
+  if (queue == NULL)
+    {
+      queue = g_queue_new ();
+      g_hash_table_insert (index, GUINT_TO_POINTER (key), queue);
+    }
+
+  g_queue_push_tail (queue, item);
+}
+
+/* Remove and return the oldest thing waiting for @key in @index, or %NULL */
+static gpointer
+waiting_index_pop (GHashTable *index,
+    guint key)
+{
+  GQueue *queue = g_hash_table_lookup (index, GUINT_TO_POINTER (key));
+  gpointer item;
+
+  if (queue == NULL)
+    return NULL;
+
+  item = g_queue_pop_head (queue);
+
+  if (g_queue_is_empty (queue))
+    g_hash_table_remove (index, GUINT_TO_POINTER (key));
+
+  return item;
+}
+
+static GQuark
+connection_id_quark (void)
+{
+  static GQuark q = 0;
+
+  if (G_UNLIKELY (q == 0))
+    q = g_quark_from_static_string ("tp-stream-tube-connection-id");
+
+  return q;
 }
 
 struct _TpStreamTubeChannelPrivate
@@ -146,12 +178,18 @@ struct _TpStreamTubeChannelPrivate
   GSocketService *service;
   GSocketAddress *address;
   gchar *unix_tmpdir;
+  /* Connections and NewRemoteConnection signals waiting for each other are
+   * indexed by the key used to match them (see sig_get_key() and
+   * conn_get_key()), so matching doesn't depend on how many are pending.
+   * Entries sharing a key are matched in the order they arrived. */
   /* GSocketConnection we have accepted but are still waiting a
-   * NewRemoteConnection to identify them. Owned ConnWaitingSig. */
-  GSList *conn_waiting_sig;
+   * NewRemoteConnection to identify them.
+   * (guint) key => owned GQueue of owned GSocketConnection */
+  GHashTable *conn_waiting_sig;
   /* NewRemoteConnection signals we have received but didn't accept their TCP
-   * connection yet. Owned SigWaitingConn. */
-  GSList *sig_waiting_conn;
+   * connection yet.
+   * (guint) key => owned GQueue of owned SigWaitingConn */
+  GHashTable *sig_waiting_conn;
 
   /* Accepting side */
   GSocket *client_socket;
@@ -174,6 +212,18 @@ struct _TpStreamTubeChannelPrivate
 
   /* (guint) connection ID => weakly reffed TpStreamTubeConnection */
   GHashTable *tube_connections;
+
+  /* Set while forwarding incoming connections */
+  GSocketConnectable *forward_address;
+  GSocketClient *forward_client;
+  /* Cancelled when we stop forwarding */
+  GCancellable *forward_cancellable;
+  GSimpleAsyncResult *forward_result;
+  GCancellable *forward_user_cancellable;
+  gulong forward_cancelled_id;
+  /* The main context forwarding was started from */
+  GMainContext *forward_context;
+  gulong forward_invalidated_id;
 };
 
 enum
@@ -191,24 +241,17 @@ enum /* signals */
 
 static guint _signals[LAST_SIGNAL] = { 0, };
 
+static void forward_stop (TpStreamTubeChannel *self, const GError *error);
+
 static void
 remote_connection_destroyed_cb (gpointer user_data,
     GObject *conn)
 {
   /* The GSocketConnection has been destroyed, removing it from the hash */
   TpStreamTubeChannel *self = user_data;
-  GHashTableIter iter;
-  gpointer value;
+  gpointer id = g_object_get_qdata (conn, connection_id_quark ());
 
-  g_hash_table_iter_init (&iter, self->priv->tube_connections);
-  while (g_hash_table_iter_next (&iter, NULL, &value))
-    {
-      if (value == conn)
-        {
-          g_hash_table_iter_remove (&iter);
-          break;
-        }
-    }
+  g_hash_table_remove (self->priv->tube_connections, id);
 }
 
 static void
@@ -226,13 +269,12 @@ tp_stream_tube_channel_dispose (GObject *obj)
   tp_clear_object (&self->priv->result);
   tp_clear_pointer (&self->priv->parameters, g_hash_table_unref);
 
-  g_slist_foreach (self->priv->conn_waiting_sig, (GFunc) conn_waiting_sig_free,
-      NULL);
-  tp_clear_pointer (&self->priv->conn_waiting_sig, g_slist_free);
+  /* forward_result keeps us alive while forwarding, so we can only get here
+   * with it set through g_object_run_dispose(); chaining up invalidates us,
+   * which stops forwarding then */
 
-  g_slist_foreach (self->priv->sig_waiting_conn, (GFunc) sig_waiting_conn_free,
-      NULL);
-  tp_clear_pointer (&self->priv->sig_waiting_conn, g_slist_free);
+  g_hash_table_remove_all (self->priv->conn_waiting_sig);
+  g_hash_table_remove_all (self->priv->sig_waiting_conn);
 
   if (self->priv->tube_connections != NULL)
     {
@@ -253,7 +295,10 @@ tp_stream_tube_channel_dispose (GObject *obj)
     {
 #ifdef HAVE_GIO_UNIX
       /* check if we need to remove the temporary file we created */
-      if (G_IS_UNIX_SOCKET_ADDRESS (self->priv->address))
+      if (G_IS_UNIX_SOCKET_ADDRESS (self->priv->address) &&
+          g_unix_socket_address_get_address_type (
+            G_UNIX_SOCKET_ADDRESS (self->priv->address)) ==
+          G_UNIX_SOCKET_ADDRESS_PATH)
         {
           const gchar *path;
 
@@ -281,6 +326,17 @@ tp_stream_tube_channel_dispose (GObject *obj)
   G_OBJECT_CLASS (tp_stream_tube_channel_parent_class)->dispose (obj);
 }
 
+static void
+tp_stream_tube_channel_finalize (GObject *obj)
+{
+  TpStreamTubeChannel *self = (TpStreamTubeChannel *) obj;
+
+  g_hash_table_unref (self->priv->conn_waiting_sig);
+  g_hash_table_unref (self->priv->sig_waiting_conn);
+
+  G_OBJECT_CLASS (tp_stream_tube_channel_parent_class)->finalize (obj);
+}
+
 static void
 tp_stream_tube_channel_get_property (GObject *object,
     guint property_id,
@@ -425,6 +481,7 @@ tp_stream_tube_channel_class_init (TpStreamTubeChannelClass *klass)
   gobject_class->constructed = tp_stream_tube_channel_constructed;
   gobject_class->get_property = tp_stream_tube_channel_get_property;
   gobject_class->dispose = tp_stream_tube_channel_dispose;
+  gobject_class->finalize = tp_stream_tube_channel_finalize;
 
   /**
    * TpStreamTubeChannel:service:
@@ -503,6 +560,11 @@ tp_stream_tube_channel_init (TpStreamTubeChannel *self)
       TpStreamTubeChannelPrivate);
 
   self->priv->tube_connections = g_hash_table_new (NULL, NULL);
+
+  self->priv->conn_waiting_sig = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) conn_waiting_sig_queue_free);
+  self->priv->sig_waiting_conn = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) sig_waiting_conn_queue_free);
 }
 
 
@@ -629,6 +691,8 @@ new_local_connection_identified (TpStreamTubeChannel *self,
 
   tube_conn = _tp_stream_tube_connection_new (conn, self);
 
+  g_object_set_qdata (G_OBJECT (tube_conn), connection_id_quark (),
+      GUINT_TO_POINTER (connection_id));
   g_hash_table_insert (self->priv->tube_connections,
       GUINT_TO_POINTER (connection_id), tube_conn);
 
@@ -977,6 +1041,87 @@ tp_stream_tube_channel_accept_finish (TpStreamTubeChannel *self,
       tp_stream_tube_channel_accept_async, g_object_ref)
 }
 
+static void
+forward_done_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  TpStreamTubeConnection *tube_conn = user_data;
+  TpSocketForwarder *forwarder = _tp_stream_tube_connection_get_forwarder (
+      tube_conn);
+  GError *error = NULL;
+
+  if (!_tp_socket_forwarder_run_finish (forwarder, result, &error))
+    {
+      DEBUG ("Forwarding stopped: %s", error->message);
+      g_error_free (error);
+    }
+
+  DEBUG ("Forwarded %" G_GUINT64_FORMAT " bytes from the contact and %"
+      G_GUINT64_FORMAT " bytes to them",
+      tp_stream_tube_connection_get_bytes_received (tube_conn),
+      tp_stream_tube_connection_get_bytes_sent (tube_conn));
+
+  g_object_unref (tube_conn);
+}
+
+static void
+forward_connected_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  TpStreamTubeConnection *tube_conn = user_data;
+  TpStreamTubeChannel *self = tp_stream_tube_connection_get_channel (
+      tube_conn);
+  GSocketConnection *tube_socket =
+    tp_stream_tube_connection_get_socket_connection (tube_conn);
+  GSocketConnection *local;
+  TpSocketForwarder *forwarder;
+  GError *error = NULL;
+
+  local = g_socket_client_connect_finish (G_SOCKET_CLIENT (source), result,
+      &error);
+
+  if (local == NULL || self->priv->forward_cancellable == NULL)
+    {
+      DEBUG ("Can't forward connection: %s",
+          error != NULL ? error->message : "no longer forwarding");
+
+      g_clear_error (&error);
+      tp_clear_object (&local);
+      g_io_stream_close (G_IO_STREAM (tube_socket), NULL, NULL);
+      g_object_unref (tube_conn);
+      return;
+    }
+
+  forwarder = _tp_socket_forwarder_new (tube_socket, local);
+  _tp_stream_tube_connection_set_forwarder (tube_conn, forwarder);
+
+  /* Pass our ref on tube_conn to the callback */
+  _tp_socket_forwarder_run_async (forwarder,
+      self->priv->forward_cancellable, forward_done_cb, tube_conn);
+
+  _tp_socket_forwarder_unref (forwarder);
+  g_object_unref (local);
+}
+
+/* Tell the user about a new connection on the tube we offered */
+static void
+announce_incoming (TpStreamTubeChannel *self,
+    TpStreamTubeConnection *tube_conn)
+{
+  if (self->priv->forward_address != NULL)
+    {
+      DEBUG ("Forwarding new connection");
+
+      g_socket_client_connect_async (self->priv->forward_client,
+          self->priv->forward_address, self->priv->forward_cancellable,
+          forward_connected_cb, g_object_ref (tube_conn));
+    }
+
+  g_signal_emit (self, _signals[INCOMING], 0, tube_conn);
+}
+
 static void
 _new_remote_connection_with_contact (TpConnection *conn,
     guint n_contacts,
@@ -1010,64 +1155,75 @@ _new_remote_connection_with_contact (TpConnection *conn,
   DEBUG ("Accepting incoming GIOStream from %s",
       tp_contact_get_identifier (contact));
 
-  g_signal_emit (self, _signals[INCOMING], 0, tube_conn);
+  announce_incoming (self, tube_conn);
 
   /* anyone receiving the signal is required to hold their own reference */
 }
 
-static gboolean
-sig_match_conn (TpStreamTubeChannel *self,
-    SigWaitingConn *sig,
-    ConnWaitingSig *c)
+/* The key identifying the connection announced by a NewRemoteConnection
+ * signal: the port it comes from with TP_SOCKET_ACCESS_CONTROL_PORT, or the
+ * byte sent with the credentials with TP_SOCKET_ACCESS_CONTROL_CREDENTIALS.
+ * We can't tell connections apart with other access controls, so they all
+ * share the same key. */
+static guint
+sig_get_key (TpStreamTubeChannel *self,
+    const GValue *param)
 {
   if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_PORT)
     {
-      /* Use the port to identify the connection */
       guint port;
+
+      dbus_g_type_struct_get (param, 1, &port, G_MAXINT);
+      return port;
+    }
+  else if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_CREDENTIALS)
+    {
+      return g_value_get_uchar (param);
+    }
+
+  return 0;
+}
+
+/* Same as sig_get_key() but for an accepted connection; returns FALSE if the
+ * connection can't be identified */
+static gboolean
+conn_get_key (TpStreamTubeChannel *self,
+    GSocketConnection *conn,
+    guchar byte,
+    guint *key)
+{
+  if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_PORT)
+    {
       GSocketAddress *address;
       GError *error = NULL;
 
-      address = g_socket_connection_get_remote_address (c->conn, &error);
+      address = g_socket_connection_get_remote_address (conn, &error);
       if (address == NULL)
         {
-          DEBUG ("Failed to get connection address: %s", error->message);
+          WARNING ("Failed to get connection address: %s", error->message);
 
           g_error_free (error);
           return FALSE;
         }
 
-      dbus_g_type_struct_get (sig->param, 1, &port, G_MAXINT);
-
-      if (port == g_inet_socket_address_get_port (
-            G_INET_SOCKET_ADDRESS (address)))
-        {
-          DEBUG ("Identified connection %u using port %u",
-              port, sig->connection_id);
-
-          g_object_unref (address);
-          return TRUE;
-        }
+      *key = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (address));
 
       g_object_unref (address);
     }
   else if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_CREDENTIALS)
     {
-      guchar byte;
-
-      byte = g_value_get_uchar (sig->param);
-
-      return byte == c->byte;
+      *key = byte;
     }
   else
     {
       DEBUG ("Can't properly identify connection as we are using "
-          "access control %u. Assume it's the head of the list",
+          "access control %u. Assume it's the oldest one",
           self->priv->access_control);
 
-      return TRUE;
+      *key = 0;
     }
 
-  return FALSE;
+  return TRUE;
 }
 
 static gboolean
@@ -1101,6 +1257,8 @@ connection_identified (TpStreamTubeChannel *self,
 
   tube_conn = _tp_stream_tube_connection_new (conn, self);
 
+  g_object_set_qdata (G_OBJECT (tube_conn), connection_id_quark (),
+      GUINT_TO_POINTER (connection_id));
   g_hash_table_insert (self->priv->tube_connections,
       GUINT_TO_POINTER (connection_id), tube_conn);
 
@@ -1130,7 +1288,7 @@ connection_identified (TpStreamTubeChannel *self,
     }
   else
     {
-      g_signal_emit (self, _signals[INCOMING], 0, tube_conn);
+      announce_incoming (self, tube_conn);
 
       g_object_unref (tube_conn);
     }
@@ -1173,9 +1331,8 @@ _new_remote_connection (TpChannel *channel,
     GObject *obj)
 {
   TpStreamTubeChannel *self = (TpStreamTubeChannel *) obj;
-  GSList *l;
-  ConnWaitingSig *found_conn = NULL;
-  SigWaitingConn *sig;
+  GSocketConnection *found_conn;
+  guint key;
   TpHandle chan_handle;
   TpHandleType handle_type;
   gboolean rejected = FALSE;
@@ -1191,40 +1348,29 @@ _new_remote_connection (TpChannel *channel,
       rejected = TRUE;
     }
 
-  sig = sig_waiting_conn_new (handle, param, connection_id, rejected);
-
-  for (l = self->priv->conn_waiting_sig; l != NULL && found_conn == NULL;
-      l = g_slist_next (l))
-    {
-      ConnWaitingSig *conn = l->data;
-
-      if (sig_match_conn (self, sig, conn))
-        found_conn = conn;
-
-    }
+  key = sig_get_key (self, param);
 
+  found_conn = waiting_index_pop (self->priv->conn_waiting_sig, key);
   if (found_conn == NULL)
     {
       DEBUG ("Didn't find any connection for %u. Waiting for more",
           connection_id);
 
-      /* Pass ownership of sig to the list */
-      self->priv->sig_waiting_conn = g_slist_append (
-          self->priv->sig_waiting_conn, sig);
+      /* Pass ownership of the sig to the index */
+      waiting_index_push (self->priv->sig_waiting_conn, key,
+          sig_waiting_conn_new (handle, connection_id, rejected));
       return;
     }
 
   /* We found a connection */
-  self->priv->conn_waiting_sig = g_slist_remove (
-      self->priv->conn_waiting_sig, found_conn);
+  DEBUG ("Identified connection %u using key %u", connection_id, key);
 
   if (rejected)
-    connection_rejected (self, found_conn->conn, handle, connection_id);
+    connection_rejected (self, found_conn, handle, connection_id);
   else
-    connection_identified (self, found_conn->conn, handle, connection_id);
+    connection_identified (self, found_conn, handle, connection_id);
 
-  sig_waiting_conn_free (sig);
-  conn_waiting_sig_free (found_conn);
+  g_object_unref (found_conn);
 }
 
 static void
@@ -1298,48 +1444,35 @@ finally:
     tp_g_value_slice_free (addressv);
 }
 
-static SigWaitingConn *
-find_sig_for_conn (TpStreamTubeChannel *self,
-    ConnWaitingSig *c)
-{
-  GSList *l;
-
-  for (l = self->priv->sig_waiting_conn; l != NULL; l = g_slist_next (l))
-    {
-      SigWaitingConn *sig = l->data;
-
-      if (sig_match_conn (self, sig, c))
-        return sig;
-    }
-
-  return NULL;
-}
-
 static void
 credentials_received (TpStreamTubeChannel *self,
     GSocketConnection *conn,
     guchar byte)
 {
   SigWaitingConn *sig;
-  ConnWaitingSig *c;
+  guint key;
 
-  c = conn_waiting_sig_new (conn, byte);
+  if (!conn_get_key (self, conn, byte, &key))
+    {
+      /* We'd never be able to match it with a NewRemoteConnection
+       * signal, so don't leave the client hanging */
+      g_io_stream_close_async (G_IO_STREAM (conn), G_PRIORITY_DEFAULT, NULL,
+          stream_tube_connection_closed_cb, self);
+      return;
+    }
 
-  sig = find_sig_for_conn (self, c);
+  sig = waiting_index_pop (self->priv->sig_waiting_conn, key);
   if (sig == NULL)
     {
       DEBUG ("Can't identify the connection, wait for NewRemoteConnection sig");
 
-      /* Pass ownership to the list */
-      self->priv->conn_waiting_sig = g_slist_append (
-          self->priv->conn_waiting_sig, c);
-
+      waiting_index_push (self->priv->conn_waiting_sig, key,
+          g_object_ref (conn));
       return;
     }
 
   /* Connection has been identified */
-  self->priv->sig_waiting_conn = g_slist_remove (self->priv->sig_waiting_conn,
-      sig);
+  DEBUG ("Identified connection %u using key %u", sig->connection_id, key);
 
   if (sig->rejected)
     connection_rejected (self, conn, sig->handle, sig->connection_id);
@@ -1347,7 +1480,6 @@ credentials_received (TpStreamTubeChannel *self,
     connection_identified (self, conn, sig->handle, sig->connection_id);
 
   sig_waiting_conn_free (sig);
-  conn_waiting_sig_free (c);
 }
 
 #ifdef HAVE_GIO_UNIX
@@ -1473,6 +1605,26 @@ tp_stream_tube_channel_offer_async (TpStreamTubeChannel *self,
 #ifdef HAVE_GIO_UNIX
       case TP_SOCKET_ADDRESS_TYPE_UNIX:
         {
+          /* We check the credentials of everyone connecting, so if the CM
+           * can do that on an abstract socket we don't need a temporary
+           * directory to keep other users out */
+          if (self->priv->access_control ==
+                TP_SOCKET_ACCESS_CONTROL_CREDENTIALS &&
+              _tp_supports_socket_type (supported_sockets,
+                TP_SOCKET_ADDRESS_TYPE_ABSTRACT_UNIX,
+                TP_SOCKET_ACCESS_CONTROL_CREDENTIALS))
+            {
+              self->priv->address = _tp_create_abstract_unix_socket (
+                  self->priv->service, &error);
+
+              if (self->priv->address != NULL)
+                break;
+
+              DEBUG ("Failed to listen on an abstract socket: %s",
+                  error->message);
+              g_clear_error (&error);
+            }
+
           self->priv->address = _tp_create_temp_unix_socket (
               self->priv->service, &self->priv->unix_tmpdir, &error);
 
@@ -1553,6 +1705,202 @@ tp_stream_tube_channel_offer_finish (TpStreamTubeChannel *self,
   _tp_implement_finish_void (self, tp_stream_tube_channel_offer_async)
 }
 
+static void
+forward_stop (TpStreamTubeChannel *self,
+    const GError *error)
+{
+  GSimpleAsyncResult *result = self->priv->forward_result;
+
+  if (result == NULL)
+    return;
+
+  self->priv->forward_result = NULL;
+
+  /* This waits for forward_cancelled_cb() if another thread is running it;
+   * that only schedules forward_cancelled_idle_cb() and returns, so it can't
+   * be waiting for us */
+  if (self->priv->forward_cancelled_id != 0)
+    {
+      g_cancellable_disconnect (self->priv->forward_user_cancellable,
+          self->priv->forward_cancelled_id);
+      self->priv->forward_cancelled_id = 0;
+    }
+
+  g_signal_handler_disconnect (self, self->priv->forward_invalidated_id);
+  self->priv->forward_invalidated_id = 0;
+
+  /* This closes the connections we are forwarding */
+  g_cancellable_cancel (self->priv->forward_cancellable);
+
+  tp_clear_object (&self->priv->forward_cancellable);
+  tp_clear_object (&self->priv->forward_user_cancellable);
+  tp_clear_object (&self->priv->forward_client);
+  tp_clear_object (&self->priv->forward_address);
+  tp_clear_pointer (&self->priv->forward_context, g_main_context_unref);
+
+  if (error != NULL)
+    g_simple_async_result_set_from_error (result, error);
+
+  g_simple_async_result_complete_in_idle (result);
+  g_object_unref (result);
+}
+
+static gboolean
+forward_cancelled_idle_cb (gpointer user_data)
+{
+  TpStreamTubeChannel *self = user_data;
+  GError error = { G_IO_ERROR, G_IO_ERROR_CANCELLED,
+      "Forwarding has been cancelled" };
+
+  /* Forwarding may have stopped for another reason in the meantime; it
+   * can't have been restarted with the same, already cancelled,
+   * cancellable */
+  if (self->priv->forward_result != NULL &&
+      g_cancellable_is_cancelled (self->priv->forward_user_cancellable))
+    {
+      DEBUG ("Stop forwarding connections: cancelled");
+      forward_stop (self, &error);
+    }
+
+  return FALSE;
+}
+
+static void
+forward_cancelled_cb (GCancellable *cancellable,
+    TpStreamTubeChannel *self)
+{
+  GSource *source;
+
+  /* This can be called from any thread, so all we do is get back to the
+   * main context forwarding runs in. forward_stop() disconnects this handler
+   * before forward_result stops keeping us alive, so we are still alive to
+   * be reffed here. */
+  source = g_idle_source_new ();
+  g_source_set_callback (source, forward_cancelled_idle_cb,
+      g_object_ref (self), g_object_unref);
+  g_source_attach (source, self->priv->forward_context);
+  g_source_unref (source);
+}
+
+static void
+forward_invalidated_cb (TpProxy *proxy,
+    guint domain,
+    gint code,
+    gchar *message,
+    gpointer user_data)
+{
+  TpStreamTubeChannel *self = (TpStreamTubeChannel *) proxy;
+
+  DEBUG ("Stop forwarding connections: channel invalidated");
+  forward_stop (self, NULL);
+}
+
+/**
+ * tp_stream_tube_channel_forward_to_address_async:
+ * @self: an outgoing #TpStreamTubeChannel
+ * @address: the local address to forward connections to
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore
+ * @callback: a callback to call when forwarding stops
+ * @user_data: data to pass to @callback
+ *
+ * Connect each new connection made by a contact to the tube we offered to
+ * @address, and forward data between them in both directions until either
+ * side closes it. This is typically used to make a local service available
+ * through a tube without implementing the copying in the service itself.
+ *
+ * The data is moved from the main context this function is called from,
+ * without going through userspace where splice() is available, and without
+ * reading more from a side than the other side has accepted.
+ *
+ * This can be called before or after tp_stream_tube_channel_offer_async();
+ * connections announced before it was called are not forwarded. The
+ * #TpStreamTubeChannel::incoming signal is still emitted for forwarded
+ * connections, so that their contact and
+ * tp_stream_tube_connection_get_bytes_received() can be tracked, but their
+ * #TpStreamTubeConnection:socket-connection must not be used.
+ *
+ * Forwarding carries on until the channel is invalidated, at which point
+ * @callback is called. If @cancellable is cancelled, @callback is called
+ * with %G_IO_ERROR_CANCELLED and the connections being forwarded are closed.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_stream_tube_channel_forward_to_address_async (TpStreamTubeChannel *self,
+    GSocketConnectable *address,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  GError *error = NULL;
+
+  g_return_if_fail (TP_IS_STREAM_TUBE_CHANNEL (self));
+  g_return_if_fail (G_IS_SOCKET_CONNECTABLE (address));
+  g_return_if_fail (tp_channel_get_requested (TP_CHANNEL (self)));
+
+  if (self->priv->forward_result != NULL)
+    {
+      g_simple_async_report_error_in_idle (G_OBJECT (self), callback,
+          user_data, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
+          "Connections are already being forwarded");
+      return;
+    }
+
+  if (tp_proxy_get_invalidated (self) != NULL)
+    {
+      g_simple_async_report_gerror_in_idle (G_OBJECT (self), callback,
+          user_data, tp_proxy_get_invalidated (self));
+      return;
+    }
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, &error))
+    {
+      g_simple_async_report_take_gerror_in_idle (G_OBJECT (self), callback,
+          user_data, error);
+      return;
+    }
+
+  self->priv->forward_result = g_simple_async_result_new (G_OBJECT (self),
+      callback, user_data, tp_stream_tube_channel_forward_to_address_async);
+
+  self->priv->forward_address = g_object_ref (address);
+  self->priv->forward_client = g_socket_client_new ();
+  self->priv->forward_cancellable = g_cancellable_new ();
+  self->priv->forward_context = g_main_context_ref_thread_default ();
+
+  if (cancellable != NULL)
+    {
+      self->priv->forward_user_cancellable = g_object_ref (cancellable);
+      self->priv->forward_cancelled_id = g_cancellable_connect (cancellable,
+          G_CALLBACK (forward_cancelled_cb), self, NULL);
+    }
+
+  self->priv->forward_invalidated_id = g_signal_connect (self, "invalidated",
+      G_CALLBACK (forward_invalidated_cb), NULL);
+}
+
+/**
+ * tp_stream_tube_channel_forward_to_address_finish:
+ * @self: a #TpStreamTubeChannel
+ * @result: a #GAsyncResult
+ * @error: a #GError to fill
+ *
+ * Finishes forwarding the connections of an outgoing stream tube.
+ *
+ * Returns: %TRUE if forwarding stopped because the channel was invalidated;
+ *  %FALSE if it was cancelled or couldn't be started
+ *
+ * Since: 0.UNRELEASED
+ */
+gboolean
+tp_stream_tube_channel_forward_to_address_finish (TpStreamTubeChannel *self,
+    GAsyncResult *result,
+    GError **error)
+{
+  _tp_implement_finish_void (self,
+      tp_stream_tube_channel_forward_to_address_async)
+}
+
 /**
  * tp_stream_tube_channel_get_service:
  * @self: a #TpStreamTubeChannel
@@ -26,6 +26,7 @@
 #define __TP_STREAM_TUBE_CHANNEL_H__
 
 #include <telepathy-glib/channel.h>
+#include <telepathy-glib/defs.h>
 
 G_BEGIN_DECLS
 
@@ -95,6 +96,20 @@ gboolean tp_stream_tube_channel_offer_finish (TpStreamTubeChannel *self,
     GAsyncResult *result,
     GError **error);
 
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_stream_tube_channel_forward_to_address_async (
+    TpStreamTubeChannel *self,
+    GSocketConnectable *address,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback,
+    gpointer user_data);
+
+_TP_AVAILABLE_IN_UNRELEASED
+gboolean tp_stream_tube_channel_forward_to_address_finish (
+    TpStreamTubeChannel *self,
+    GAsyncResult *result,
+    GError **error);
+
 G_END_DECLS
 
 #endif
@@ -26,6 +26,7 @@
 #include <gio/gio.h>
 
 #include "stream-tube-connection.h"
+#include "socket-forwarder-internal.h"
 
 G_BEGIN_DECLS
 
@@ -46,6 +47,11 @@ void _tp_stream_tube_connection_set_contact (TpStreamTubeConnection *self,
 void _tp_stream_tube_connection_fire_closed (TpStreamTubeConnection *self,
     GError *error);
 
+void _tp_stream_tube_connection_set_forwarder (TpStreamTubeConnection *self,
+    TpSocketForwarder *forwarder);
+TpSocketForwarder *_tp_stream_tube_connection_get_forwarder (
+    TpStreamTubeConnection *self);
+
 G_END_DECLS
 
 #endif
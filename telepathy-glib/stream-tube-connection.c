@@ -50,6 +50,7 @@
 #include "telepathy-glib/stream-tube-connection.h"
 
 #include <telepathy-glib/util.h>
+#include <telepathy-glib/socket-forwarder-internal.h>
 
 #define DEBUG_FLAG TP_DEBUG_CHANNEL
 #include "telepathy-glib/debug-internal.h"
@@ -84,6 +85,8 @@ struct _TpStreamTubeConnectionPrivate
    * on us */
   TpStreamTubeChannel *channel;
   TpContact *contact;
+  /* Set if the channel is forwarding this connection */
+  TpSocketForwarder *forwarder;
 };
 
 static void
@@ -103,6 +106,7 @@ tp_stream_tube_connection_dispose (GObject *object)
   tp_clear_object (&self->priv->socket_connection);
   tp_clear_object (&self->priv->channel);
   tp_clear_object (&self->priv->contact);
+  tp_clear_pointer (&self->priv->forwarder, _tp_socket_forwarder_unref);
 
   if (dispose != NULL)
     dispose (object);
@@ -333,3 +337,66 @@ _tp_stream_tube_connection_fire_closed (TpStreamTubeConnection *self,
 {
   g_signal_emit (self, _signals[CLOSED], 0, error);
 }
+
+void
+_tp_stream_tube_connection_set_forwarder (TpStreamTubeConnection *self,
+    TpSocketForwarder *forwarder)
+{
+  g_assert (self->priv->forwarder == NULL);
+
+  self->priv->forwarder = _tp_socket_forwarder_ref (forwarder);
+}
+
+TpSocketForwarder *
+_tp_stream_tube_connection_get_forwarder (TpStreamTubeConnection *self)
+{
+  return self->priv->forwarder;
+}
+
+/**
+ * tp_stream_tube_connection_get_bytes_received:
+ * @self: a #TpStreamTubeConnection
+ *
+ * If the channel is forwarding this connection (see
+ * tp_stream_tube_channel_forward_to_address_async()), return the number of
+ * bytes received from the contact and passed on to the local address so far.
+ *
+ * Returns: the number of bytes forwarded from the contact, or 0 if this
+ *  connection isn't being forwarded
+ *
+ * Since: 0.UNRELEASED
+ */
+guint64
+tp_stream_tube_connection_get_bytes_received (TpStreamTubeConnection *self)
+{
+  g_return_val_if_fail (TP_IS_STREAM_TUBE_CONNECTION (self), 0);
+
+  if (self->priv->forwarder == NULL)
+    return 0;
+
+  return _tp_socket_forwarder_get_bytes (self->priv->forwarder, TRUE);
+}
+
+/**
+ * tp_stream_tube_connection_get_bytes_sent:
+ * @self: a #TpStreamTubeConnection
+ *
+ * If the channel is forwarding this connection (see
+ * tp_stream_tube_channel_forward_to_address_async()), return the number of
+ * bytes read from the local address and sent to the contact so far.
+ *
+ * Returns: the number of bytes forwarded to the contact, or 0 if this
+ *  connection isn't being forwarded
+ *
+ * Since: 0.UNRELEASED
+ */
+guint64
+tp_stream_tube_connection_get_bytes_sent (TpStreamTubeConnection *self)
+{
+  g_return_val_if_fail (TP_IS_STREAM_TUBE_CONNECTION (self), 0);
+
+  if (self->priv->forwarder == NULL)
+    return 0;
+
+  return _tp_socket_forwarder_get_bytes (self->priv->forwarder, FALSE);
+}
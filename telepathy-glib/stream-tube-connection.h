@@ -65,6 +65,14 @@ TpStreamTubeChannel * tp_stream_tube_connection_get_channel (
 TpContact * tp_stream_tube_connection_get_contact (
     TpStreamTubeConnection *self);
 
+_TP_AVAILABLE_IN_UNRELEASED
+guint64 tp_stream_tube_connection_get_bytes_received (
+    TpStreamTubeConnection *self);
+
+_TP_AVAILABLE_IN_UNRELEASED
+guint64 tp_stream_tube_connection_get_bytes_sent (
+    TpStreamTubeConnection *self);
+
 G_END_DECLS
 
 #endif
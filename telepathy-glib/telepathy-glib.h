@@ -96,6 +96,7 @@
 #include <telepathy-glib/message-mixin.h>
 #include <telepathy-glib/observe-channels-context.h>
 #include <telepathy-glib/presence-mixin.h>
+#include <telepathy-glib/progress-throttle.h>
 #include <telepathy-glib/protocol.h>
 #include <telepathy-glib/proxy.h>
 #include <telepathy-glib/room-info.h>
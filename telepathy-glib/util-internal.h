@@ -41,6 +41,8 @@ void _tp_quark_array_merge_valist (GArray *array,
 GSocketAddress * _tp_create_temp_unix_socket (GSocketService *service,
     gchar **tmpdir,
     GError **error);
+GSocketAddress * _tp_create_abstract_unix_socket (GSocketService *service,
+    GError **error);
 #endif /* HAVE_GIO_UNIX */
 
 GList * _tp_create_channel_request_list (TpSimpleClientFactory *factory,
@@ -88,6 +90,10 @@ const gchar *_tp_enum_to_nick_nonnull (GType enum_type, gint value);
 gboolean _tp_bind_connection_status_to_boolean (GBinding *binding,
     const GValue *src_value, GValue *dest_value, gpointer user_data);
 
+gboolean _tp_supports_socket_type (GHashTable *supported_sockets,
+    TpSocketAddressType address_type,
+    TpSocketAccessControl access_control);
+
 gboolean _tp_set_socket_address_type_and_access_control_type (
     GHashTable *supported_sockets,
     TpSocketAddressType *address_type,
@@ -96,6 +102,7 @@ gboolean _tp_set_socket_address_type_and_access_control_type (
 
 GSocket * _tp_create_client_socket (TpSocketAddressType socket_type,
     GError **error);
+GSocket * _tp_dup_spare_client_socket (TpSocketAddressType socket_type);
 
 gboolean _tp_contacts_to_handles (TpConnection *connection,
     guint n_contacts,
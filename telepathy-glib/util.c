@@ -1613,6 +1613,56 @@ _tp_create_temp_unix_socket (GSocketService *service,
 
   return address;
 }
+
+/* Listen on a randomly-named socket in the abstract namespace, which needs
+ * no temporary directory, and disappears when @service is closed. Anyone
+ * can connect to such a socket, so only use it if every connection will have
+ * its credentials checked. */
+GSocketAddress *
+_tp_create_abstract_unix_socket (GSocketService *service,
+    GError **error)
+{
+  guint attempt;
+
+  if (!g_unix_socket_address_abstract_names_supported ())
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+          "Abstract Unix sockets are not supported");
+      return NULL;
+    }
+
+  for (attempt = 0; attempt < 3; attempt++)
+    {
+      GSocketAddress *address;
+      gchar *name;
+      GError *e = NULL;
+
+      name = g_strdup_printf ("tp-glib-socket.%08x%08x", g_random_int (),
+          g_random_int ());
+      address = g_unix_socket_address_new_with_type (name, -1,
+          G_UNIX_SOCKET_ADDRESS_ABSTRACT);
+      g_free (name);
+
+      if (g_socket_listener_add_address (G_SOCKET_LISTENER (service),
+            address, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT,
+            NULL, NULL, &e))
+        return address;
+
+      g_object_unref (address);
+
+      if (!g_error_matches (e, G_IO_ERROR, G_IO_ERROR_ADDRESS_IN_USE))
+        {
+          g_propagate_error (error, e);
+          return NULL;
+        }
+
+      g_clear_error (&e);
+    }
+
+  g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_ADDRESS_IN_USE,
+      "Unable to find a free abstract socket name");
+  return NULL;
+}
 #endif /* HAVE_GIO_UNIX */
 
 GList *
@@ -1941,6 +1991,28 @@ _tp_determine_access_control_type (GHashTable *supported_sockets,
   return TRUE;
 }
 
+gboolean
+_tp_supports_socket_type (GHashTable *supported_sockets,
+    TpSocketAddressType address_type,
+    TpSocketAccessControl access_control)
+{
+  GArray *arr;
+  guint i;
+
+  arr = g_hash_table_lookup (supported_sockets,
+      GUINT_TO_POINTER (address_type));
+  if (arr == NULL)
+    return FALSE;
+
+  for (i = 0; i < arr->len; i++)
+    {
+      if (g_array_index (arr, TpSocketAccessControl, i) == access_control)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
 gboolean
 _tp_set_socket_address_type_and_access_control_type (
     GHashTable *supported_sockets,
@@ -1959,8 +2031,47 @@ _tp_set_socket_address_type_and_access_control_type (
       *address_type, access_control, error);
 }
 
-GSocket *
-_tp_create_client_socket (TpSocketAddressType socket_type,
+/* Spare client sockets, see tp_set_client_socket_pool_size() */
+G_LOCK_DEFINE_STATIC (client_socket_pool);
+static guint client_socket_pool_size = 0;
+static GQueue client_socket_pool[TP_NUM_SOCKET_ADDRESS_TYPES];
+static gboolean client_socket_pool_wanted[TP_NUM_SOCKET_ADDRESS_TYPES];
+static gboolean client_socket_pool_refilling = FALSE;
+
+/* The wildcard addresses client sockets are bound to; created once */
+static GSocketAddress *any_ipv4_address = NULL;
+static GSocketAddress *any_ipv6_address = NULL;
+
+static GSocketAddress *
+dup_any_address (GSocketFamily family)
+{
+  GSocketAddress **addr;
+  GSocketAddress *ret;
+
+  if (family == G_SOCKET_FAMILY_IPV4)
+    addr = &any_ipv4_address;
+  else
+    addr = &any_ipv6_address;
+
+  G_LOCK (client_socket_pool);
+
+  if (*addr == NULL)
+    {
+      GInetAddress *tmp = g_inet_address_new_any (family);
+
+      *addr = g_inet_socket_address_new (tmp, 0);
+      g_object_unref (tmp);
+    }
+
+  ret = g_object_ref (*addr);
+
+  G_UNLOCK (client_socket_pool);
+
+  return ret;
+}
+
+static GSocket *
+create_client_socket (TpSocketAddressType socket_type,
     GError **error)
 {
   GSocket *client_socket;
@@ -2002,22 +2113,167 @@ _tp_create_client_socket (TpSocketAddressType socket_type,
        * of the socket and pass it to the CM when using
        * TP_SOCKET_ACCESS_CONTROL_PORT. */
       GSocketAddress *local_address;
-      GInetAddress *tmp;
       gboolean success;
 
-      tmp = g_inet_address_new_any (family);
-      local_address = g_inet_socket_address_new (tmp, 0);
+      local_address = dup_any_address (family);
 
       success = g_socket_bind (client_socket, local_address,
           TRUE, error);
 
-      g_object_unref (tmp);
       g_object_unref (local_address);
 
       if (!success)
-        return NULL;
+        {
+          g_object_unref (client_socket);
+          return NULL;
+        }
+    }
+
+  return client_socket;
+}
+
+static gboolean
+refill_client_socket_pool (gpointer unused)
+{
+  guint i;
+
+  G_LOCK (client_socket_pool);
+  client_socket_pool_refilling = FALSE;
+  G_UNLOCK (client_socket_pool);
+
+  for (i = 0; i < TP_NUM_SOCKET_ADDRESS_TYPES; i++)
+    {
+      while (TRUE)
+        {
+          GSocket *client_socket;
+          gboolean needed;
+          GError *error = NULL;
+
+          G_LOCK (client_socket_pool);
+          needed = client_socket_pool_wanted[i] &&
+              client_socket_pool[i].length < client_socket_pool_size;
+          G_UNLOCK (client_socket_pool);
+
+          if (!needed)
+            break;
+
+          client_socket = create_client_socket (i, &error);
+          if (client_socket == NULL)
+            {
+              DEBUG ("Failed to create spare socket: %s", error->message);
+              g_error_free (error);
+              break;
+            }
+
+          G_LOCK (client_socket_pool);
+          g_queue_push_tail (&client_socket_pool[i], client_socket);
+          G_UNLOCK (client_socket_pool);
+        }
     }
 
+  return FALSE;
+}
+
+/**
+ * tp_set_client_socket_pool_size:
+ * @n_sockets: the number of spare sockets to keep for each address type,
+ *  or 0 to disable the pool
+ *
+ * Keep @n_sockets sockets ready to connect to connection managers, for each
+ * socket address type that has been used, so that accepting a file transfer
+ * or a stream tube doesn't have to create and bind one first. The pool is
+ * refilled at low priority in the global default #GMainContext (as
+ * g_idle_add() would do), whichever thread took a socket from it.
+ *
+ * This is only worthwhile for processes accepting many file transfers or
+ * stream tubes in quick succession; by default, no sockets are kept.
+ *
+ * Since: 0.UNRELEASED
+ */
+void
+tp_set_client_socket_pool_size (guint n_sockets)
+{
+  GQueue spares = G_QUEUE_INIT;
+  guint i;
+
+  G_LOCK (client_socket_pool);
+
+  client_socket_pool_size = n_sockets;
+
+  for (i = 0; i < TP_NUM_SOCKET_ADDRESS_TYPES; i++)
+    {
+      while (client_socket_pool[i].length > n_sockets)
+        g_queue_push_tail (&spares,
+            g_queue_pop_tail (&client_socket_pool[i]));
+    }
+
+  G_UNLOCK (client_socket_pool);
+
+  g_queue_foreach (&spares, (GFunc) g_object_unref, NULL);
+  g_queue_clear (&spares);
+}
+
+GSocket *
+_tp_create_client_socket (TpSocketAddressType socket_type,
+    GError **error)
+{
+  GSocket *client_socket = NULL;
+  gboolean refill = FALSE;
+
+  g_return_val_if_fail (socket_type < TP_NUM_SOCKET_ADDRESS_TYPES, NULL);
+
+  G_LOCK (client_socket_pool);
+
+  if (client_socket_pool_size > 0)
+    {
+      client_socket = g_queue_pop_head (&client_socket_pool[socket_type]);
+      client_socket_pool_wanted[socket_type] = TRUE;
+
+      if (!client_socket_pool_refilling)
+        {
+          client_socket_pool_refilling = TRUE;
+          refill = TRUE;
+        }
+    }
+
+  G_UNLOCK (client_socket_pool);
+
+  if (refill)
+    {
+      GSource *source = g_idle_source_new ();
+
+      g_source_set_priority (source, G_PRIORITY_LOW);
+      g_source_set_callback (source, refill_client_socket_pool, NULL, NULL);
+      /* the global default context, like g_idle_add(): a thread-default
+       * context might never be iterated again, and then nobody's pool
+       * would be refilled */
+      g_source_attach (source, NULL);
+      g_source_unref (source);
+    }
+
+  if (client_socket != NULL)
+    return client_socket;
+
+  return create_client_socket (socket_type, error);
+}
+
+/* Returns a new ref to the spare socket that _tp_create_client_socket()
+ * would use next, or %NULL; only for the regression tests */
+GSocket *
+_tp_dup_spare_client_socket (TpSocketAddressType socket_type)
+{
+  GSocket *client_socket;
+
+  g_return_val_if_fail (socket_type < TP_NUM_SOCKET_ADDRESS_TYPES, NULL);
+
+  G_LOCK (client_socket_pool);
+  client_socket = g_queue_peek_head (&client_socket_pool[socket_type]);
+
+  if (client_socket != NULL)
+    g_object_ref (client_socket);
+
+  G_UNLOCK (client_socket_pool);
+
   return client_socket;
 }
 
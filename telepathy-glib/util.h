@@ -181,6 +181,9 @@ gboolean tp_user_action_time_should_present (gint64 user_action_time,
 /* See https://bugzilla.gnome.org/show_bug.cgi?id=610969 for glib inclusion */
 gchar *tp_utf8_make_valid (const gchar *name);
 
+_TP_AVAILABLE_IN_UNRELEASED
+void tp_set_client_socket_pool_size (guint n_sockets);
+
 G_END_DECLS
 
 #undef  __TP_IN_UTIL_H__
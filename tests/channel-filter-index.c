@@ -0,0 +1,318 @@
+#include "config.h"
+
+#include <glib.h>
+
+#include "telepathy-glib/channel-filter-index-internal.h"
+
+#include <telepathy-glib/dbus.h>
+#include <telepathy-glib/debug.h>
+#include <telepathy-glib/enums.h>
+#include <telepathy-glib/interfaces.h>
+#include <telepathy-glib/util.h>
+
+#include "tests/lib/util.h"
+
+#define N_BENCHMARK_FILTERS 1000
+#define N_BENCHMARK_LOOKUPS 10000
+
+typedef struct {
+    TpChannelFilterIndex *index;
+} Test;
+
+static void
+setup (Test *test,
+    gconstpointer data)
+{
+  tp_debug_set_flags ("all");
+
+  test->index = _tp_channel_filter_index_new ();
+}
+
+static void
+teardown (Test *test,
+    gconstpointer data)
+{
+  _tp_channel_filter_index_unref (test->index);
+}
+
+static void
+take_filter (Test *test,
+    GHashTable *filter,
+    const gchar *name)
+{
+  _tp_channel_filter_index_add (test->index, filter, (gpointer) name);
+  g_hash_table_unref (filter);
+}
+
+static const gchar *
+match (Test *test,
+    GHashTable *properties)
+{
+  gpointer data = NULL;
+
+  if (!_tp_channel_filter_index_match (test->index, properties, &data))
+    data = NULL;
+
+  g_hash_table_unref (properties);
+  return data;
+}
+
+static void
+test_match (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  /* An incoming text channel from a contact */
+  take_filter (test, tp_asv_new (
+        TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+          TP_IFACE_CHANNEL_TYPE_TEXT,
+        TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+          TP_HANDLE_TYPE_CONTACT,
+        TP_PROP_CHANNEL_REQUESTED, G_TYPE_BOOLEAN, FALSE,
+        NULL),
+      "incoming-text");
+  /* Any text channel with a room */
+  take_filter (test, tp_asv_new (
+        TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+          TP_IFACE_CHANNEL_TYPE_TEXT,
+        TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+          TP_HANDLE_TYPE_ROOM,
+        NULL),
+      "chatroom");
+  /* Any file transfer, whatever the handle type */
+  take_filter (test, tp_asv_new (
+        TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+          TP_IFACE_CHANNEL_TYPE_FILE_TRANSFER,
+        NULL),
+      "file-transfer");
+  /* Anything with a contact, added after "incoming-text" */
+  take_filter (test, tp_asv_new (
+        TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+          TP_HANDLE_TYPE_CONTACT,
+        NULL),
+      "contact");
+
+  g_assert_cmpuint (_tp_channel_filter_index_get_size (test->index), ==, 4);
+
+  /* earliest match wins, even though "contact" matches too */
+  g_assert_cmpstr (match (test, tp_asv_new (
+          TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+            TP_IFACE_CHANNEL_TYPE_TEXT,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+            TP_HANDLE_TYPE_CONTACT,
+          TP_PROP_CHANNEL_REQUESTED, G_TYPE_BOOLEAN, FALSE,
+          TP_PROP_CHANNEL_TARGET_ID, G_TYPE_STRING, "alice",
+          NULL)), ==, "incoming-text");
+
+  /* an outgoing text channel only matches the wildcard */
+  g_assert_cmpstr (match (test, tp_asv_new (
+          TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+            TP_IFACE_CHANNEL_TYPE_TEXT,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+            TP_HANDLE_TYPE_CONTACT,
+          TP_PROP_CHANNEL_REQUESTED, G_TYPE_BOOLEAN, TRUE,
+          NULL)), ==, "contact");
+
+  /* integers of different types are compared by value */
+  g_assert_cmpstr (match (test, tp_asv_new (
+          TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+            TP_IFACE_CHANNEL_TYPE_TEXT,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_INT,
+            TP_HANDLE_TYPE_ROOM,
+          NULL)), ==, "chatroom");
+
+  g_assert_cmpstr (match (test, tp_asv_new (
+          TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+            TP_IFACE_CHANNEL_TYPE_FILE_TRANSFER,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+            TP_HANDLE_TYPE_ROOM,
+          NULL)), ==, "file-transfer");
+
+  /* no ChannelType at all */
+  g_assert_cmpstr (match (test, tp_asv_new (
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+            TP_HANDLE_TYPE_CONTACT,
+          NULL)), ==, "contact");
+
+  g_assert_cmpstr (match (test, tp_asv_new (
+          TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+            TP_IFACE_CHANNEL_TYPE_CALL,
+          TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+            TP_HANDLE_TYPE_ROOM,
+          NULL)), ==, NULL);
+}
+
+static void
+test_lookup_exact (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  const GPtrArray *found;
+
+  take_filter (test, tp_asv_new (
+        TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+          TP_IFACE_CHANNEL_TYPE_CONTACT_SEARCH,
+        NULL),
+      "search");
+  take_filter (test, tp_asv_new (
+        TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+          TP_IFACE_CHANNEL_TYPE_TEXT,
+        TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+          TP_HANDLE_TYPE_CONTACT,
+        NULL),
+      "text");
+  take_filter (test, tp_asv_new (
+        TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+          TP_IFACE_CHANNEL_TYPE_TEXT,
+        TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+          TP_HANDLE_TYPE_CONTACT,
+        TP_PROP_CHANNEL_INTERFACE_SMS_SMS_CHANNEL, G_TYPE_BOOLEAN, TRUE,
+        NULL),
+      "sms");
+
+  found = _tp_channel_filter_index_lookup_exact (test->index,
+      TP_IFACE_CHANNEL_TYPE_TEXT, TRUE, TP_HANDLE_TYPE_CONTACT);
+  g_assert (found != NULL);
+  g_assert_cmpuint (found->len, ==, 2);
+  g_assert_cmpstr (g_ptr_array_index (found, 0), ==, "text");
+  g_assert_cmpstr (g_ptr_array_index (found, 1), ==, "sms");
+
+  /* filters without a handle type are not wildcards here */
+  found = _tp_channel_filter_index_lookup_exact (test->index,
+      TP_IFACE_CHANNEL_TYPE_CONTACT_SEARCH, TRUE, TP_HANDLE_TYPE_NONE);
+  g_assert (found == NULL);
+
+  found = _tp_channel_filter_index_lookup_exact (test->index,
+      TP_IFACE_CHANNEL_TYPE_CONTACT_SEARCH, FALSE, 0);
+  g_assert (found != NULL);
+  g_assert_cmpuint (found->len, ==, 1);
+  g_assert_cmpstr (g_ptr_array_index (found, 0), ==, "search");
+}
+
+/* Filters like those of an Observer which wants to see (say) channels to
+ * and from each of a large number of contacts */
+static GPtrArray *
+make_benchmark_filters (void)
+{
+  static const gchar * const types[] = { TP_IFACE_CHANNEL_TYPE_TEXT,
+      TP_IFACE_CHANNEL_TYPE_CALL, TP_IFACE_CHANNEL_TYPE_FILE_TRANSFER,
+      TP_IFACE_CHANNEL_TYPE_STREAM_TUBE, TP_IFACE_CHANNEL_TYPE_DBUS_TUBE };
+  GPtrArray *filters = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) g_hash_table_unref);
+  guint i;
+
+  for (i = 0; i < N_BENCHMARK_FILTERS; i++)
+    {
+      gchar *id = g_strdup_printf ("contact%u@example.com", i);
+
+      g_ptr_array_add (filters, tp_asv_new (
+            TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+              types[i % G_N_ELEMENTS (types)],
+            TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT,
+              (i % 2 == 0) ? TP_HANDLE_TYPE_CONTACT : TP_HANDLE_TYPE_ROOM,
+            TP_PROP_CHANNEL_TARGET_ID, G_TYPE_STRING, id,
+            NULL));
+      g_free (id);
+    }
+
+  return filters;
+}
+
+static gboolean
+linear_match (GPtrArray *filters,
+    GHashTable *properties)
+{
+  guint i;
+
+  for (i = 0; i < filters->len; i++)
+    {
+      GHashTable *filter = g_ptr_array_index (filters, i);
+      GHashTableIter iter;
+      gpointer k, v;
+      gboolean ok = TRUE;
+
+      g_hash_table_iter_init (&iter, filter);
+
+      while (ok && g_hash_table_iter_next (&iter, &k, &v))
+        {
+          const GValue *value = g_hash_table_lookup (properties, k);
+
+          if (value == NULL || G_VALUE_TYPE (value) != G_VALUE_TYPE (v))
+            ok = FALSE;
+          else if (G_VALUE_HOLDS_STRING (v))
+            ok = !tp_strdiff (g_value_get_string (v),
+                g_value_get_string (value));
+          else
+            ok = (g_value_get_uint (v) == g_value_get_uint (value));
+        }
+
+      if (ok)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+test_benchmark (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GPtrArray *filters = make_benchmark_filters ();
+  GHashTable *properties;
+  gdouble linear, indexed;
+  guint i;
+
+  for (i = 0; i < filters->len; i++)
+    _tp_channel_filter_index_add (test->index,
+        g_ptr_array_index (filters, i), NULL);
+
+  /* the last text channel added, which a linear search finds late */
+  properties = tp_asv_new (
+      TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING, TP_IFACE_CHANNEL_TYPE_TEXT,
+      TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT, TP_HANDLE_TYPE_CONTACT,
+      TP_PROP_CHANNEL_TARGET_ID, G_TYPE_STRING, "contact990@example.com",
+      TP_PROP_CHANNEL_REQUESTED, G_TYPE_BOOLEAN, FALSE,
+      NULL);
+
+  g_assert (linear_match (filters, properties));
+  g_assert (_tp_channel_filter_index_match (test->index, properties, NULL));
+
+  g_test_timer_start ();
+
+  for (i = 0; i < N_BENCHMARK_LOOKUPS; i++)
+    linear_match (filters, properties);
+
+  linear = g_test_timer_elapsed ();
+
+  g_test_timer_start ();
+
+  for (i = 0; i < N_BENCHMARK_LOOKUPS; i++)
+    _tp_channel_filter_index_match (test->index, properties, NULL);
+
+  indexed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (indexed,
+      "%u lookups among %u filters: %f s indexed, %f s linear",
+      N_BENCHMARK_LOOKUPS, N_BENCHMARK_FILTERS, indexed, linear);
+
+  g_hash_table_unref (properties);
+  g_ptr_array_unref (filters);
+}
+
+int
+main (int argc,
+    char **argv)
+{
+#define TEST_PREFIX "/channel-filter-index/"
+
+  g_test_init (&argc, &argv, NULL);
+  g_test_bug_base ("http://bugs.freedesktop.org/show_bug.cgi?id=");
+
+  g_test_add (TEST_PREFIX "match", Test, NULL, setup, test_match, teardown);
+  g_test_add (TEST_PREFIX "lookup-exact", Test, NULL, setup,
+      test_lookup_exact, teardown);
+
+  if (g_test_perf ())
+    g_test_add (TEST_PREFIX "benchmark", Test, NULL, setup, test_benchmark,
+        teardown);
+
+  return g_test_run ();
+}
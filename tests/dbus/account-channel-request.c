@@ -1094,6 +1094,121 @@ test_forget_cancel_after_create (Test *test,
   g_assert_error (test->error, TP_ERROR, TP_ERROR_CANCELLED);
 }
 
+static void
+local_handler_handle_channels (TpSimpleHandler *handler,
+    TpAccount *account,
+    TpConnection *connection,
+    GList *channels,
+    GList *requests_satisfied,
+    gint64 user_action_time,
+    TpHandleChannelsContext *context,
+    gpointer user_data)
+{
+  Test *test = user_data;
+  TpChannel *channel;
+
+  g_assert_cmpuint (g_list_length (channels), ==, 1);
+  channel = channels->data;
+
+  /* The account, connection and channel all come from the same factory */
+  g_assert (tp_proxy_get_factory (account) == tp_proxy_get_factory (channel));
+  g_assert (tp_proxy_get_factory (connection) ==
+      tp_proxy_get_factory (channel));
+
+  g_assert (test->channel == NULL);
+  test->channel = g_object_ref (channel);
+
+  tp_handle_channels_context_accept (context);
+}
+
+/* The preferred handler lives in this process, but was made with its own
+ * factory, @handler_factory: if that makes the same proxies as the
+ * requester's, it should be given the requester's proxies rather than
+ * making its own */
+static void
+local_handler (Test *test,
+    TpSimpleClientFactory *handler_factory,
+    gboolean shared)
+{
+  TpSimpleClientFactory *factory;
+  TpAccount *account;
+  TpBaseClient *handler;
+  TpAccountChannelRequest *req;
+
+  factory = tp_simple_client_factory_new (test->dbus);
+  account = tp_simple_client_factory_ensure_account (factory, ACCOUNT_PATH,
+      NULL, &test->error);
+  g_assert_no_error (test->error);
+
+  handler = tp_simple_handler_new_with_factory (handler_factory, TRUE, FALSE,
+      "LocalHandler", FALSE, local_handler_handle_channels, test, NULL);
+  tp_base_client_take_handler_filter (handler, tp_asv_new (NULL, NULL));
+  tp_base_client_register (handler, &test->error);
+  g_assert_no_error (test->error);
+
+  req = tp_account_channel_request_new_vardict (account,
+      floating_request (), 0);
+
+  tp_account_channel_request_create_channel_async (req,
+      tp_base_client_get_bus_name (handler), NULL, create_cb, test);
+
+  g_object_unref (req);
+
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert (test->channel != NULL);
+
+  if (shared)
+    g_assert (tp_proxy_get_factory (test->channel) == factory);
+  else
+    g_assert (tp_proxy_get_factory (test->channel) == handler_factory);
+
+  tp_base_client_unregister (handler);
+  g_object_unref (handler);
+  g_object_unref (account);
+  g_object_unref (factory);
+}
+
+static void
+test_local_handler (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpSimpleClientFactory *handler_factory;
+
+  handler_factory = tp_simple_client_factory_new (test->dbus);
+  local_handler (test, handler_factory, TRUE);
+  g_object_unref (handler_factory);
+}
+
+/* A handler made with a different kind of factory expects its own kinds of
+ * proxies, so it must not be given the requester's */
+static void
+test_local_handler_automatic (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpSimpleClientFactory *handler_factory;
+
+  handler_factory = (TpSimpleClientFactory *)
+      tp_automatic_client_factory_new (test->dbus);
+  local_handler (test, handler_factory, FALSE);
+  g_object_unref (handler_factory);
+}
+
+/* Likewise if it wants more features prepared than the requester does */
+static void
+test_local_handler_features (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpSimpleClientFactory *handler_factory;
+
+  handler_factory = tp_simple_client_factory_new (test->dbus);
+  tp_simple_client_factory_add_channel_features_varargs (handler_factory,
+      TP_CHANNEL_FEATURE_GROUP, 0);
+  local_handler (test, handler_factory, FALSE);
+  g_object_unref (handler_factory);
+}
+
 /* Request and observe tests */
 static void
 create_and_observe_cb (GObject *source,
@@ -1473,6 +1588,14 @@ main (int argc,
   g_test_add ("/account-channels/request-forget/after-create", Test, NULL,
       setup, test_forget_cancel_after_create, teardown);
 
+  /* Handler in the same process as the request */
+  g_test_add ("/account-channels/local-handler/same-factory", Test, NULL,
+      setup, test_local_handler, teardown);
+  g_test_add ("/account-channels/local-handler/automatic-factory", Test,
+      NULL, setup, test_local_handler_automatic, teardown);
+  g_test_add ("/account-channels/local-handler/different-features", Test,
+      NULL, setup, test_local_handler_features, teardown);
+
   /* Request and observe tests */
   g_test_add ("/account-channels/request-observe/create-success", Test, NULL,
       setup, test_observe_create_success, teardown);
@@ -489,6 +489,52 @@ test_prepare_success (Test *test,
   g_assert_cmpstr (cstrv[1], ==, NULL);
 }
 
+static void
+test_prepare_cached (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GQuark account_features[] = { TP_ACCOUNT_FEATURE_CORE, 0 };
+  TpSimpleClientFactory *factory;
+
+  factory = tp_simple_client_factory_new (test->dbus);
+
+  test->account = tp_simple_client_factory_ensure_account (factory,
+      ACCOUNT_PATH, NULL, &test->error);
+  g_assert_no_error (test->error);
+
+  tp_proxy_prepare_async (test->account, account_features,
+      account_prepare_cb, test);
+  g_main_loop_run (test->mainloop);
+
+  g_assert (tp_proxy_is_prepared (test->account, TP_ACCOUNT_FEATURE_CORE));
+  g_assert (tp_account_is_enabled (test->account));
+
+  tp_tests_proxy_run_until_dbus_queue_processed (test->account);
+  g_clear_object (&test->account);
+
+  /* this happens while nobody is looking */
+  tp_tests_simple_account_set_enabled (test->account_service, FALSE);
+
+  /* a new proxy is ready straight away, from what the old one knew... */
+  test->account = tp_simple_client_factory_ensure_account (factory,
+      ACCOUNT_PATH, NULL, &test->error);
+  g_assert_no_error (test->error);
+
+  g_assert (tp_proxy_is_prepared (test->account, TP_ACCOUNT_FEATURE_CORE));
+  g_assert_cmpstr (tp_account_get_display_name (test->account), ==,
+      "Fake Account");
+  g_assert (tp_account_is_enabled (test->account));
+
+  /* ... and catches up with what it missed as an ordinary change */
+  test_set_up_account_notify (test);
+  tp_tests_proxy_run_until_dbus_queue_processed (test->account);
+
+  g_assert (!tp_account_is_enabled (test->account));
+  g_assert_cmpuint (test_get_times_notified (test, "enabled"), ==, 1);
+
+  g_object_unref (factory);
+}
+
 static void
 test_storage (Test *test,
     gconstpointer mode)
@@ -986,6 +1032,9 @@ main (int argc,
   g_test_add ("/account/prepare/success", Test, NULL, setup_service,
               test_prepare_success, teardown_service);
 
+  g_test_add ("/account/prepare/cached", Test, NULL, setup_service,
+              test_prepare_cached, teardown_service);
+
   g_test_add ("/account/connection", Test, NULL, setup_service,
               test_connection, teardown_service);
 
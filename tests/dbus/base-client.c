@@ -14,6 +14,7 @@
 #include <telepathy-glib/account-manager.h>
 #include <telepathy-glib/add-dispatch-operation-context-internal.h>
 #include <telepathy-glib/base-client.h>
+#include <telepathy-glib/base-client-internal.h>
 #include <telepathy-glib/client.h>
 #include <telepathy-glib/debug.h>
 #include <telepathy-glib/defs.h>
@@ -58,6 +59,9 @@ typedef struct {
 
     GPtrArray *delegated;
     GHashTable *not_delegated;
+
+    /* object paths, in the order observed-channel-prepared saw them */
+    GPtrArray *observed_prepared;
 } Test;
 
 #define ACCOUNT_PATH TP_ACCOUNT_OBJECT_PATH_BASE "what/ev/er"
@@ -271,6 +275,7 @@ teardown (Test *test,
 
   tp_clear_pointer (&test->delegated, g_ptr_array_unref);
   tp_clear_pointer (&test->not_delegated, g_hash_table_unref);
+  tp_clear_pointer (&test->observed_prepared, g_ptr_array_unref);
 }
 
 /* Test Basis */
@@ -603,6 +608,189 @@ test_observer (Test *test,
   g_hash_table_unref (info);
 }
 
+static TpChannel *
+create_text_channel (Test *test,
+    const gchar *suffix,
+    const gchar *id,
+    TpTestsTextChannelNull **service)
+{
+  TpHandleRepoIface *contact_repo;
+  TpHandle handle;
+  TpChannel *channel;
+  gchar *chan_path;
+
+  chan_path = g_strdup_printf ("%s/%s",
+      tp_proxy_get_object_path (test->connection), suffix);
+
+  contact_repo = tp_base_connection_get_handles (test->base_connection,
+      TP_HANDLE_TYPE_CONTACT);
+  handle = tp_handle_ensure (contact_repo, id, NULL, &test->error);
+  g_assert_no_error (test->error);
+
+  *service = TP_TESTS_TEXT_CHANNEL_NULL (
+      tp_tests_object_new_static_class (
+        TP_TESTS_TYPE_TEXT_CHANNEL_NULL,
+        "connection", test->base_connection,
+        "object-path", chan_path,
+        "handle", handle,
+        NULL));
+
+  /* We don't prepare this, so its immutable properties are incomplete and
+   * the observer has to introspect it over D-Bus */
+  channel = tp_channel_new (test->connection, chan_path, NULL,
+      TP_HANDLE_TYPE_CONTACT, handle, &test->error);
+  g_assert_no_error (test->error);
+
+  tp_handle_unref (contact_repo, handle);
+  g_free (chan_path);
+  return channel;
+}
+
+static void
+observed_channel_prepared_cb (TpBaseClient *client,
+    TpAccount *account,
+    TpConnection *connection,
+    TpChannel *channel,
+    gpointer user_data)
+{
+  Test *test = user_data;
+
+  g_assert (account == test->account);
+  g_assert (connection == test->connection);
+  g_assert (tp_proxy_is_prepared (channel, TP_CHANNEL_FEATURE_CORE));
+
+  g_ptr_array_add (test->observed_prepared,
+      g_strdup (tp_proxy_get_object_path (channel)));
+
+  test->wait--;
+  if (test->wait == 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+test_observer_channel_prepared (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpTestsTextChannelNull *service_3, *service_4;
+  TpChannel *chan_3, *chan_4;
+  TpChannel *all[4];
+  GPtrArray *channels, *channels_2, *requests_satisified;
+  GPtrArray *prepared, *first_seen;
+  GHashTable *info;
+  TpPreparePipeline *pipeline;
+  guint coalesced, queued, peak;
+  guint i, j;
+
+  tp_base_client_take_observer_filter (test->base_client, tp_asv_new (
+      TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING, TP_IFACE_CHANNEL_TYPE_TEXT,
+      NULL));
+
+  tp_base_client_set_max_concurrent_preparations (test->base_client, 2);
+
+  test->observed_prepared = g_ptr_array_new_with_free_func (g_free);
+  g_signal_connect (test->base_client, "observed-channel-prepared",
+      G_CALLBACK (observed_channel_prepared_cb), test);
+
+  tp_base_client_register (test->base_client, &test->error);
+  g_assert_no_error (test->error);
+
+  chan_3 = create_text_channel (test, "Channel3", "carol", &service_3);
+  chan_4 = create_text_channel (test, "Channel4", "dave", &service_4);
+  all[0] = test->text_chan;
+  all[1] = test->text_chan_2;
+  all[2] = chan_3;
+  all[3] = chan_4;
+
+  /* Two overlapping contexts, with more channels than the limit */
+  channels = g_ptr_array_sized_new (3);
+  add_channel_to_ptr_array (channels, all[0]);
+  add_channel_to_ptr_array (channels, all[1]);
+  add_channel_to_ptr_array (channels, all[2]);
+
+  channels_2 = g_ptr_array_sized_new (3);
+  add_channel_to_ptr_array (channels_2, all[1]);
+  add_channel_to_ptr_array (channels_2, all[2]);
+  add_channel_to_ptr_array (channels_2, all[3]);
+
+  requests_satisified = g_ptr_array_sized_new (0);
+  info = tp_asv_new (NULL, NULL);
+
+  tp_proxy_add_interface_by_id (TP_PROXY (test->client),
+      TP_IFACE_QUARK_CLIENT_OBSERVER);
+
+  /* Both calls reach the observer before any channel's introspection
+   * replies do, because messages from one connection arrive in order */
+  tp_cli_client_observer_call_observe_channels (test->client, -1,
+      tp_proxy_get_object_path (test->account),
+      tp_proxy_get_object_path (test->connection),
+      channels, "/", requests_satisified, info,
+      no_return_cb, test, NULL, NULL);
+  tp_cli_client_observer_call_observe_channels (test->client, -1,
+      tp_proxy_get_object_path (test->account),
+      tp_proxy_get_object_path (test->connection),
+      channels_2, "/", requests_satisified, info,
+      no_return_cb, test, NULL, NULL);
+
+  /* once per channel per context, once per reply */
+  test->wait += 6 + 2;
+  while (test->wait > 0)
+    g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert (test->simple_client->observe_ctx != NULL);
+
+  prepared = test->observed_prepared;
+  g_assert_cmpuint (prepared->len, ==, 6);
+
+  /* The limit was reached, so c3 and c4 were queued; c2 and c3 were each
+   * prepared once for both contexts */
+  pipeline = _tp_base_client_get_prepare_pipeline (test->base_client);
+  _tp_prepare_pipeline_get_stats (pipeline, &coalesced, &queued, &peak);
+  g_assert_cmpuint (peak, ==, 2);
+  g_assert_cmpuint (queued, ==, 2);
+  g_assert_cmpuint (coalesced, >=, 2);
+
+  /* Channels became ready in the order they were first asked for */
+  first_seen = g_ptr_array_new ();
+
+  for (i = 0; i < prepared->len; i++)
+    {
+      const gchar *path = g_ptr_array_index (prepared, i);
+      gboolean seen = FALSE;
+
+      for (j = 0; j < first_seen->len; j++)
+        {
+          if (!tp_strdiff (g_ptr_array_index (first_seen, j), path))
+            seen = TRUE;
+        }
+
+      if (!seen)
+        g_ptr_array_add (first_seen, (gpointer) path);
+    }
+
+  g_assert_cmpuint (first_seen->len, ==, 4);
+
+  for (i = 0; i < 4; i++)
+    g_assert_cmpstr (g_ptr_array_index (first_seen, i), ==,
+        tp_proxy_get_object_path (all[i]));
+
+  g_ptr_array_unref (first_seen);
+
+  teardown_run_close_channel (test, chan_3);
+  teardown_run_close_channel (test, chan_4);
+  g_object_unref (chan_3);
+  g_object_unref (chan_4);
+  g_object_unref (service_3);
+  g_object_unref (service_4);
+
+  g_ptr_array_foreach (channels, free_channel_details, NULL);
+  g_ptr_array_unref (channels);
+  g_ptr_array_foreach (channels_2, free_channel_details, NULL);
+  g_ptr_array_unref (channels_2);
+  g_ptr_array_unref (requests_satisified);
+  g_hash_table_unref (info);
+}
+
 /* Test Approver */
 static void
 get_approver_prop_cb (TpProxy *proxy,
@@ -1441,9 +1629,12 @@ delegated_channels_cb (TpBaseClient *client,
     g_main_loop_quit (test->mainloop);
 }
 
+/* If @local_handler_type is not NULL, the preferred handler is a client in
+ * this process which handles channels of that type */
 static void
 delegate_to_preferred_handler (Test *test,
-    gboolean supported)
+    gboolean supported,
+    const gchar *local_handler_type)
 {
   GPtrArray *channels;
   GPtrArray *requests_satisified;
@@ -1452,9 +1643,30 @@ delegate_to_preferred_handler (Test *test,
   GHashTable *info;
   TpTestsSimpleChannelRequest *cr;
   GHashTable *hints;
+  TpBaseClient *local_handler = NULL;
+  const gchar *preferred_handler = PREFERRED_HANDLER_NAME;
+  gboolean delegated = supported;
 
   tp_base_client_be_a_handler (test->base_client);
 
+  if (local_handler_type != NULL)
+    {
+      local_handler = TP_BASE_CLIENT (tp_tests_simple_client_new (test->dbus,
+            "Badger", FALSE));
+
+      tp_base_client_take_handler_filter (local_handler, tp_asv_new (
+            TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING, local_handler_type,
+            NULL));
+      tp_base_client_register (local_handler, &test->error);
+      g_assert_no_error (test->error);
+
+      preferred_handler = tp_base_client_get_bus_name (local_handler);
+
+      /* We only give the channels to it if it would take them */
+      if (tp_strdiff (local_handler_type, TP_IFACE_CHANNEL_TYPE_TEXT))
+        delegated = FALSE;
+    }
+
   if (supported)
     {
       tp_base_client_set_delegated_channels_callback (test->base_client,
@@ -1501,7 +1713,7 @@ delegate_to_preferred_handler (Test *test,
 
   cr = tp_tests_simple_channel_request_new ("/CR",
       TP_TESTS_SIMPLE_CONNECTION (test->base_connection), ACCOUNT_PATH,
-      TP_USER_ACTION_TIME_CURRENT_TIME, PREFERRED_HANDLER_NAME,
+      TP_USER_ACTION_TIME_CURRENT_TIME, preferred_handler,
       requests, hints);
 
   g_ptr_array_add (requests_satisified, "/CR");
@@ -1526,13 +1738,13 @@ delegate_to_preferred_handler (Test *test,
 
   /* If we support the DelegateToPreferredHandler hint, we wait for
    * delegated_channels_cb to be called */
-  if (supported)
+  if (delegated)
     test->wait++;
 
   g_main_loop_run (test->mainloop);
   g_assert_no_error (test->error);
 
-  if (supported)
+  if (delegated)
     {
       /* We are not handling the channels any more */
       g_assert (!tp_base_client_is_handling_channel (test->base_client,
@@ -1551,6 +1763,12 @@ delegate_to_preferred_handler (Test *test,
 
   tp_base_client_unregister (test->base_client);
 
+  if (local_handler != NULL)
+    {
+      tp_base_client_unregister (local_handler);
+      g_object_unref (local_handler);
+    }
+
   g_object_unref (cr);
   g_ptr_array_foreach (channels, free_channel_details, NULL);
   g_ptr_array_unref (channels);
@@ -1565,14 +1783,29 @@ static void
 test_delegate_to_preferred_handler_not_supported (Test *test,
     gconstpointer data G_GNUC_UNUSED)
 {
-  delegate_to_preferred_handler (test, FALSE);
+  delegate_to_preferred_handler (test, FALSE, NULL);
 }
 
 static void
 test_delegate_to_preferred_handler_supported (Test *test,
     gconstpointer data G_GNUC_UNUSED)
 {
-  delegate_to_preferred_handler (test, TRUE);
+  delegate_to_preferred_handler (test, TRUE, NULL);
+}
+
+static void
+test_delegate_to_preferred_handler_local (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  delegate_to_preferred_handler (test, TRUE, TP_IFACE_CHANNEL_TYPE_TEXT);
+}
+
+static void
+test_delegate_to_preferred_handler_local_no_match (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  delegate_to_preferred_handler (test, TRUE,
+      TP_IFACE_CHANNEL_TYPE_STREAM_TUBE);
 }
 
 int
@@ -1588,6 +1821,8 @@ main (int argc,
       teardown);
   g_test_add ("/base-client/observer", Test, NULL, setup, test_observer,
       teardown);
+  g_test_add ("/base-client/observer/channel-prepared", Test, NULL, setup,
+      test_observer_channel_prepared, teardown);
   g_test_add ("/base-client/approver", Test, NULL, setup, test_approver,
       teardown);
   g_test_add ("/base-client/handler", Test, NULL, setup, test_handler,
@@ -1604,6 +1839,10 @@ main (int argc,
       setup, test_delegate_to_preferred_handler_not_supported, teardown);
   g_test_add ("/cd/delegate-to-preferred-handler/supported", Test, NULL,
       setup, test_delegate_to_preferred_handler_supported, teardown);
+  g_test_add ("/cd/delegate-to-preferred-handler/local", Test, NULL,
+      setup, test_delegate_to_preferred_handler_local, teardown);
+  g_test_add ("/cd/delegate-to-preferred-handler/local-no-match", Test, NULL,
+      setup, test_delegate_to_preferred_handler_local_no_match, teardown);
 
   return tp_tests_run_with_bus ();
 }
@@ -55,6 +55,9 @@ typedef struct
   GArray *contacts;
 
   TpCallContent *added_content;
+
+  guint n_candidate_batches;
+  guint n_candidates_signalled;
 } Test;
 
 static void
@@ -1043,6 +1046,178 @@ test_dtmf (Test *test,
   g_assert_no_error (test->error);
 }
 
+static void
+stream_method_cb (TpCallStream *stream,
+    const GError *error,
+    gpointer user_data,
+    GObject *weak_object G_GNUC_UNUSED)
+{
+  Test *test = user_data;
+
+  g_assert_no_error (error);
+
+  test->wait_count--;
+  if (test->wait_count <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+local_candidates_added_cb (TpCallStream *stream,
+    const GPtrArray *candidates,
+    gpointer user_data,
+    GObject *weak_object G_GNUC_UNUSED)
+{
+  Test *test = user_data;
+
+  test->n_candidate_batches++;
+  test->n_candidates_signalled += candidates->len;
+}
+
+static void
+get_local_candidates_cb (TpProxy *proxy,
+    const GValue *value,
+    const GError *error,
+    gpointer user_data,
+    GObject *weak_object G_GNUC_UNUSED)
+{
+  Test *test = user_data;
+  GPtrArray *candidates;
+
+  g_assert_no_error (error);
+  g_assert (G_VALUE_HOLDS (value, TP_ARRAY_TYPE_CANDIDATE_LIST));
+  candidates = g_value_get_boxed (value);
+  g_assert_cmpuint (candidates->len, ==, 5);
+
+  g_main_loop_quit (test->mainloop);
+}
+
+static void
+add_one_candidate (Test *test,
+    TpCallStream *stream,
+    guint port)
+{
+  GHashTable *info = g_hash_table_new (g_str_hash, g_str_equal);
+  GPtrArray *candidates = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) tp_value_array_free);
+
+  g_ptr_array_add (candidates, tp_value_array_build (4,
+        G_TYPE_UINT, TP_STREAM_COMPONENT_DATA,
+        G_TYPE_STRING, "192.0.2.1",
+        G_TYPE_UINT, port,
+        TP_HASH_TYPE_CANDIDATE_INFO, info,
+        G_TYPE_INVALID));
+
+  tp_cli_call_stream_interface_media_call_add_candidates (stream, -1,
+      candidates, stream_method_cb, test, NULL, NULL);
+  test->wait_count++;
+
+  g_ptr_array_unref (candidates);
+  g_hash_table_unref (info);
+}
+
+static void
+test_candidates (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GPtrArray *contents;
+  GPtrArray *streams;
+  TpCallStream *stream;
+  TpBaseMediaCallStream *service_stream;
+  GPtrArray *candidates;
+
+  outgoing_call (test, "candidates-badger", TRUE, FALSE);
+  run_until_accepted (test);
+  run_until_active (test);
+
+  contents = tp_call_channel_get_contents (test->call_chan);
+  g_assert_cmpuint (contents->len, ==, 1);
+  streams = tp_call_content_get_streams (g_ptr_array_index (contents, 0));
+  g_assert_cmpuint (streams->len, ==, 1);
+  stream = g_ptr_array_index (streams, 0);
+
+  service_stream = (TpBaseMediaCallStream *) dbus_g_connection_lookup_g_object (
+      tp_proxy_get_dbus_connection (stream), tp_proxy_get_object_path (stream));
+  g_assert (TP_IS_BASE_MEDIA_CALL_STREAM (service_stream));
+
+  tp_cli_call_stream_interface_media_connect_to_local_candidates_added (
+      stream, local_candidates_added_cb, test, NULL, NULL, NULL);
+
+  /* Hold the initial candidates back until they have all been gathered */
+  g_object_set (service_stream,
+      "local-candidates-batch-interval", G_MAXUINT,
+      NULL);
+
+  test->wait_count = 0;
+  add_one_candidate (test, stream, 1000);
+  add_one_candidate (test, stream, 1001);
+  add_one_candidate (test, stream, 1002);
+  g_main_loop_run (test->mainloop);
+  tp_tests_proxy_run_until_dbus_queue_processed (test->conn);
+
+  g_assert_cmpuint (test->n_candidate_batches, ==, 0);
+  g_assert_cmpuint (tp_base_media_call_stream_get_local_candidates (
+        service_stream)->len, ==, 3);
+
+  test->wait_count = 1;
+  tp_cli_call_stream_interface_media_call_finish_initial_candidates (stream,
+      -1, stream_method_cb, test, NULL, NULL);
+  g_main_loop_run (test->mainloop);
+  tp_tests_proxy_run_until_dbus_queue_processed (test->conn);
+
+  g_assert_cmpuint (test->n_candidate_batches, ==, 1);
+  g_assert_cmpuint (test->n_candidates_signalled, ==, 3);
+
+  /* Now trickle some more, with a window long enough that it won't expire
+   * during the test: reading the property must flush them */
+  g_object_set (service_stream,
+      "local-candidates-batch-interval", 100000,
+      NULL);
+
+  test->wait_count = 0;
+  add_one_candidate (test, stream, 1003);
+  add_one_candidate (test, stream, 1004);
+  g_main_loop_run (test->mainloop);
+  tp_tests_proxy_run_until_dbus_queue_processed (test->conn);
+
+  g_assert_cmpuint (test->n_candidate_batches, ==, 1);
+
+  tp_cli_dbus_properties_call_get (stream, -1,
+      TP_IFACE_CALL_STREAM_INTERFACE_MEDIA, "LocalCandidates",
+      get_local_candidates_cb, test, NULL, NULL);
+  g_main_loop_run (test->mainloop);
+  tp_tests_proxy_run_until_dbus_queue_processed (test->conn);
+
+  /* the batch that was being held back was signalled */
+  g_assert_cmpuint (test->n_candidate_batches, ==, 2);
+  g_assert_cmpuint (test->n_candidates_signalled, ==, 5);
+
+  test->wait_count = 0;
+  add_one_candidate (test, stream, 1005);
+  add_one_candidate (test, stream, 1006);
+  g_main_loop_run (test->mainloop);
+  tp_tests_proxy_run_until_dbus_queue_processed (test->conn);
+
+  /* reading the GObject property sees the held-back candidates, but
+   * doesn't signal them */
+  g_object_get (service_stream,
+      "local-candidates", &candidates,
+      NULL);
+  g_assert_cmpuint (candidates->len, ==, 7);
+  g_ptr_array_unref (candidates);
+  tp_tests_proxy_run_until_dbus_queue_processed (test->conn);
+  g_assert_cmpuint (test->n_candidate_batches, ==, 2);
+
+  /* shortening the interval reschedules the pending batch */
+  g_object_set (service_stream,
+      "local-candidates-batch-interval", 10,
+      NULL);
+
+  while (test->n_candidate_batches < 3)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (test->n_candidates_signalled, ==, 7);
+}
+
 static void
 teardown (Test *test,
           gconstpointer data G_GNUC_UNUSED)
@@ -1090,6 +1265,8 @@ main (int argc,
       teardown);
   g_test_add ("/call/dtmf", Test, NULL, setup, test_dtmf,
       teardown);
+  g_test_add ("/call/candidates", Test, NULL, setup, test_candidates,
+      teardown);
 
   return tp_tests_run_with_bus ();
 }
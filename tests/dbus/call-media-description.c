@@ -0,0 +1,197 @@
+/* Tests for TpCallContentMediaDescription
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * Copying and distribution of this file, with or without modification,
+ * are permitted in any medium without royalty provided the copyright
+ * notice and this notice are preserved.
+ */
+
+#include "config.h"
+
+#include <telepathy-glib/telepathy-glib.h>
+#include <telepathy-glib/telepathy-glib-dbus.h>
+
+#include "telepathy-glib/base-call-internal.h"
+
+#include "tests/lib/util.h"
+
+typedef struct {
+  TpDBusDaemon *dbus;
+  TpCallContentMediaDescription *md;
+  TpCallContentMediaDescription *copy;
+} Test;
+
+static void
+setup (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GHashTable *parameters;
+
+  test->dbus = tp_tests_dbus_daemon_dup_or_die ();
+
+  test->md = tp_call_content_media_description_new (test->dbus,
+      "/MediaDescription/0", 42, TRUE, FALSE);
+
+  parameters = g_hash_table_new (g_str_hash, g_str_equal);
+  g_hash_table_insert (parameters, "mode", "20");
+
+  tp_call_content_media_description_append_codec (test->md, 0, "PCMU",
+      8000, 1, FALSE, NULL);
+  tp_call_content_media_description_append_codec (test->md, 98, "iLBC",
+      8000, 1, FALSE, parameters);
+  g_hash_table_unref (parameters);
+
+  tp_call_content_media_description_add_ssrc (test->md, 42, 1234);
+  tp_call_content_media_description_add_rtp_header_extension (test->md, 1,
+      TP_MEDIA_STREAM_DIRECTION_BIDIRECTIONAL,
+      "urn:ietf:params:rtp-hdrext:toffset", "");
+  tp_call_content_media_description_add_rtcp_feedback_message (test->md, 98,
+      "nack", "pli", "");
+
+  test->copy = NULL;
+}
+
+static void
+teardown (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  g_clear_object (&test->md);
+  g_clear_object (&test->copy);
+  g_clear_object (&test->dbus);
+}
+
+static guint
+count_codecs (TpCallContentMediaDescription *md)
+{
+  GPtrArray *codecs;
+  guint n;
+
+  g_object_get (md,
+      "codecs", &codecs,
+      NULL);
+  n = codecs->len;
+  g_boxed_free (TP_ARRAY_TYPE_CODEC_LIST, codecs);
+  return n;
+}
+
+static void
+test_properties (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GHashTable *properties, *again;
+  GPtrArray *codecs;
+  GHashTable *ssrcs, *feedback_messages;
+  GArray *contact_ssrcs;
+  guint identifier, clock_rate, channels;
+  gchar *name;
+  gboolean updated;
+  GHashTable *parameters;
+
+  properties = _tp_call_content_media_description_dup_properties (test->md);
+
+  codecs = tp_asv_get_boxed (properties,
+      TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_CODECS,
+      TP_ARRAY_TYPE_CODEC_LIST);
+  g_assert (codecs != NULL);
+  g_assert_cmpuint (codecs->len, ==, 2);
+
+  tp_value_array_unpack (g_ptr_array_index (codecs, 1), 6,
+      &identifier, &name, &clock_rate, &channels, &updated, &parameters);
+  g_assert_cmpuint (identifier, ==, 98);
+  g_assert_cmpstr (name, ==, "iLBC");
+  g_assert_cmpuint (clock_rate, ==, 8000);
+  g_assert_cmpuint (channels, ==, 1);
+  g_assert (!updated);
+  g_assert_cmpstr (g_hash_table_lookup (parameters, "mode"), ==, "20");
+
+  ssrcs = tp_asv_get_boxed (properties,
+      TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_SSRCS,
+      TP_HASH_TYPE_CONTACT_SSRCS_MAP);
+  g_assert (ssrcs != NULL);
+  contact_ssrcs = g_hash_table_lookup (ssrcs, GUINT_TO_POINTER (42));
+  g_assert (contact_ssrcs != NULL);
+  g_assert_cmpuint (contact_ssrcs->len, ==, 1);
+  g_assert_cmpuint (g_array_index (contact_ssrcs, guint, 0), ==, 1234);
+
+  /* until the media description changes, it's the same hash table */
+  again = _tp_call_content_media_description_dup_properties (test->md);
+  g_assert (again == properties);
+  g_hash_table_unref (again);
+
+  tp_call_content_media_description_add_ssrc (test->md, 42, 5678);
+  again = _tp_call_content_media_description_dup_properties (test->md);
+  g_assert (again != properties);
+  g_hash_table_unref (again);
+
+  /* the old one is unchanged */
+  g_assert_cmpuint (contact_ssrcs->len, ==, 1);
+  g_hash_table_unref (properties);
+
+  g_object_get (test->md,
+      "feedback-messages", &feedback_messages,
+      NULL);
+  g_assert_cmpuint (g_hash_table_size (feedback_messages), ==, 1);
+  g_assert (g_hash_table_lookup (feedback_messages,
+        GUINT_TO_POINTER (98)) != NULL);
+  g_boxed_free (TP_HASH_TYPE_RTCP_FEEDBACK_MESSAGE_MAP, feedback_messages);
+}
+
+static void
+test_new_from (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GPtrArray *header_extensions;
+  GHashTable *properties;
+
+  test->copy = tp_call_content_media_description_new_from (test->md,
+      "/MediaDescription/1", FALSE, TRUE);
+
+  g_assert_cmpuint (
+      tp_call_content_media_description_get_remote_contact (test->copy),
+      ==, 42);
+  g_assert_cmpuint (count_codecs (test->copy), ==, 2);
+
+  g_object_get (test->copy,
+      "header-extensions", &header_extensions,
+      NULL);
+  g_assert_cmpuint (header_extensions->len, ==, 1);
+  g_boxed_free (TP_ARRAY_TYPE_RTP_HEADER_EXTENSIONS_LIST, header_extensions);
+
+  properties = _tp_call_content_media_description_dup_properties (
+      test->copy);
+  g_assert (tp_strv_contains (tp_asv_get_strv (properties,
+          TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_INTERFACES),
+        TP_IFACE_CALL_CONTENT_MEDIA_DESCRIPTION_INTERFACE_RTCP_FEEDBACK));
+  g_assert (!tp_asv_get_boolean (properties,
+        TP_PROP_CALL_CONTENT_MEDIA_DESCRIPTION_HAS_REMOTE_INFORMATION, NULL));
+  g_hash_table_unref (properties);
+
+  /* modifying either one doesn't affect the other */
+  tp_call_content_media_description_append_codec (test->copy, 8, "PCMA",
+      8000, 1, FALSE, NULL);
+  g_assert_cmpuint (count_codecs (test->copy), ==, 3);
+  g_assert_cmpuint (count_codecs (test->md), ==, 2);
+
+  tp_call_content_media_description_append_codec (test->md, 9, "G722",
+      8000, 1, FALSE, NULL);
+  tp_call_content_media_description_append_codec (test->md, 13, "CN",
+      8000, 1, FALSE, NULL);
+  g_assert_cmpuint (count_codecs (test->copy), ==, 3);
+  g_assert_cmpuint (count_codecs (test->md), ==, 4);
+}
+
+int
+main (int argc,
+    char **argv)
+{
+  tp_tests_init (&argc, &argv);
+  g_test_bug_base ("http://bugs.freedesktop.org/show_bug.cgi?id=");
+
+  g_test_add ("/call-media-description/properties", Test, NULL, setup,
+      test_properties, teardown);
+  g_test_add ("/call-media-description/new-from", Test, NULL, setup,
+      test_new_from, teardown);
+
+  return tp_tests_run_with_bus ();
+}
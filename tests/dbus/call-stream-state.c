@@ -0,0 +1,335 @@
+/* Tests for the state TpBaseCallStream and TpBaseMediaCallStream keep
+ * about their remote members and endpoints
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * Copying and distribution of this file, with or without modification,
+ * are permitted in any medium without royalty provided the copyright
+ * notice and this notice are preserved.
+ */
+
+#include "config.h"
+
+#include <telepathy-glib/telepathy-glib.h>
+#include <telepathy-glib/telepathy-glib-dbus.h>
+
+#include "telepathy-glib/base-call-internal.h"
+
+#include "tests/lib/simple-conn.h"
+#include "tests/lib/util.h"
+
+/* The smallest possible concrete TpBaseMediaCallStream */
+typedef TpBaseMediaCallStream TestStream;
+typedef TpBaseMediaCallStreamClass TestStreamClass;
+
+static GType test_stream_get_type (void);
+
+G_DEFINE_TYPE (TestStream, test_stream, TP_TYPE_BASE_MEDIA_CALL_STREAM)
+
+static void
+test_stream_init (TestStream *self)
+{
+}
+
+static void
+test_stream_class_init (TestStreamClass *cls)
+{
+}
+
+typedef struct {
+    GMainLoop *mainloop;
+    TpDBusDaemon *dbus;
+
+    TpBaseConnection *base_connection;
+    TpConnection *connection;
+    TpHandleRepoIface *contact_repo;
+
+    TpBaseMediaCallStream *stream;
+    gchar *stream_path;
+
+    GError *error /* initialized where needed */;
+    gint wait;
+} Test;
+
+static void
+setup (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  test->mainloop = g_main_loop_new (NULL, FALSE);
+  test->dbus = tp_tests_dbus_daemon_dup_or_die ();
+
+  test->error = NULL;
+
+  tp_tests_create_and_connect_conn (TP_TESTS_TYPE_SIMPLE_CONNECTION,
+      "me@test.com", &test->base_connection, &test->connection);
+
+  test->contact_repo = tp_base_connection_get_handles (test->base_connection,
+      TP_HANDLE_TYPE_CONTACT);
+
+  test->stream_path = g_strdup_printf ("%s/Stream",
+      tp_proxy_get_object_path (test->connection));
+  test->stream = g_object_new (test_stream_get_type (),
+      "connection", test->base_connection,
+      "object-path", test->stream_path,
+      NULL);
+}
+
+static void
+teardown (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  g_clear_error (&test->error);
+
+  g_clear_object (&test->stream);
+  g_free (test->stream_path);
+
+  tp_tests_connection_assert_disconnect_succeeds (test->connection);
+  g_clear_object (&test->connection);
+  g_clear_object (&test->base_connection);
+
+  g_clear_object (&test->dbus);
+  g_main_loop_unref (test->mainloop);
+  test->mainloop = NULL;
+}
+
+static TpHandle
+ensure_contact (Test *test,
+    const gchar *id)
+{
+  TpHandle handle = tp_handle_ensure (test->contact_repo, id, NULL,
+      &test->error);
+
+  g_assert_no_error (test->error);
+  g_assert (handle != 0);
+  return handle;
+}
+
+static void
+update_member (Test *test,
+    TpHandle contact,
+    TpSendingState state)
+{
+  tp_base_call_stream_update_remote_sending_state (
+      (TpBaseCallStream *) test->stream, contact, state, 0,
+      TP_CALL_STATE_CHANGE_REASON_PROGRESS_MADE, "", "");
+}
+
+static gboolean
+remove_member (Test *test,
+    TpHandle contact)
+{
+  return tp_base_call_stream_remove_member ((TpBaseCallStream *) test->stream,
+      contact, 0, TP_CALL_STATE_CHANGE_REASON_PROGRESS_MADE, "", "");
+}
+
+static gboolean
+has_remote_senders (Test *test)
+{
+  return _tp_base_call_stream_has_remote_senders (
+      (TpBaseCallStream *) test->stream);
+}
+
+static void
+test_remote_senders (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpHandle alice = ensure_contact (test, "alice");
+  TpHandle bob = ensure_contact (test, "bob");
+
+  g_assert (!has_remote_senders (test));
+
+  /* members that aren't sending don't count */
+  update_member (test, alice, TP_SENDING_STATE_NONE);
+  update_member (test, bob, TP_SENDING_STATE_PENDING_STOP_SENDING);
+  g_assert (!has_remote_senders (test));
+
+  update_member (test, alice, TP_SENDING_STATE_SENDING);
+  g_assert (has_remote_senders (test));
+
+  /* sending or about to be sending both count, so alice going from one to
+   * the other changes nothing */
+  update_member (test, bob, TP_SENDING_STATE_PENDING_SEND);
+  update_member (test, alice, TP_SENDING_STATE_PENDING_SEND);
+  update_member (test, alice, TP_SENDING_STATE_PENDING_SEND);
+  g_assert (has_remote_senders (test));
+
+  update_member (test, alice, TP_SENDING_STATE_PENDING_STOP_SENDING);
+  g_assert (has_remote_senders (test));
+
+  /* removing the last sender stops it counting */
+  g_assert (remove_member (test, bob));
+  g_assert (!has_remote_senders (test));
+
+  /* removing a member that isn't sending, or isn't a member, changes
+   * nothing */
+  update_member (test, bob, TP_SENDING_STATE_SENDING);
+  g_assert (remove_member (test, alice));
+  g_assert (!remove_member (test, alice));
+  g_assert (has_remote_senders (test));
+
+  update_member (test, bob, TP_SENDING_STATE_NONE);
+  g_assert (!has_remote_senders (test));
+
+  /* a member that was removed while sending can come back */
+  update_member (test, bob, TP_SENDING_STATE_SENDING);
+  g_assert (remove_member (test, bob));
+  g_assert (!has_remote_senders (test));
+  update_member (test, bob, TP_SENDING_STATE_SENDING);
+  g_assert (has_remote_senders (test));
+}
+
+static TpCallStreamEndpoint *
+add_endpoint (Test *test,
+    const gchar *name)
+{
+  gchar *path = g_strdup_printf ("%s/%s", test->stream_path, name);
+  TpCallStreamEndpoint *endpoint;
+
+  endpoint = tp_call_stream_endpoint_new (test->dbus, path,
+      TP_STREAM_TRANSPORT_TYPE_RAW_UDP, FALSE);
+  tp_base_media_call_stream_add_endpoint (test->stream, endpoint);
+
+  g_free (path);
+  return endpoint;
+}
+
+static void
+set_endpoint_state_cb (TpProxy *proxy,
+    const GError *error,
+    gpointer user_data,
+    GObject *weak_object G_GNUC_UNUSED)
+{
+  Test *test = user_data;
+
+  g_assert_no_error (error);
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+/* Endpoint state is only ever changed by the streaming implementation,
+ * over D-Bus */
+static void
+set_endpoint_state (Test *test,
+    TpCallStreamEndpoint *endpoint,
+    TpStreamComponent component,
+    TpStreamEndpointState state)
+{
+  TpProxy *proxy;
+
+  proxy = g_object_new (TP_TYPE_PROXY,
+      "dbus-daemon", test->dbus,
+      "bus-name", tp_dbus_daemon_get_unique_name (test->dbus),
+      "object-path", tp_call_stream_endpoint_get_object_path (endpoint),
+      NULL);
+  tp_proxy_add_interface_by_id (proxy, TP_IFACE_QUARK_CALL_STREAM_ENDPOINT);
+
+  test->wait = 1;
+  tp_cli_call_stream_endpoint_call_set_endpoint_state (proxy, -1,
+      component, state, set_endpoint_state_cb, test, NULL, NULL);
+  g_main_loop_run (test->mainloop);
+
+  g_assert_cmpuint (tp_call_stream_endpoint_get_state (endpoint, component),
+      ==, state);
+
+  g_object_unref (proxy);
+}
+
+static gboolean
+has_connected_endpoint (Test *test)
+{
+  return _tp_base_media_call_stream_has_connected_endpoint (test->stream);
+}
+
+static void
+test_connected_endpoints (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpCallStreamEndpoint *first, *second, *third;
+
+  g_assert (!has_connected_endpoint (test));
+
+  first = add_endpoint (test, "Endpoint1");
+  second = add_endpoint (test, "Endpoint2");
+  g_assert (!has_connected_endpoint (test));
+
+  /* only the data component counts */
+  set_endpoint_state (test, first, TP_STREAM_COMPONENT_CONTROL,
+      TP_STREAM_ENDPOINT_STATE_FULLY_CONNECTED);
+  g_assert (!has_connected_endpoint (test));
+
+  set_endpoint_state (test, first, TP_STREAM_COMPONENT_DATA,
+      TP_STREAM_ENDPOINT_STATE_CONNECTING);
+  g_assert (!has_connected_endpoint (test));
+
+  set_endpoint_state (test, first, TP_STREAM_COMPONENT_DATA,
+      TP_STREAM_ENDPOINT_STATE_PROVISIONALLY_CONNECTED);
+  g_assert (has_connected_endpoint (test));
+
+  /* going from one connected state to the other, or to the same state,
+   * doesn't count it twice */
+  set_endpoint_state (test, first, TP_STREAM_COMPONENT_DATA,
+      TP_STREAM_ENDPOINT_STATE_FULLY_CONNECTED);
+  set_endpoint_state (test, first, TP_STREAM_COMPONENT_DATA,
+      TP_STREAM_ENDPOINT_STATE_FULLY_CONNECTED);
+  g_assert (has_connected_endpoint (test));
+
+  set_endpoint_state (test, second, TP_STREAM_COMPONENT_DATA,
+      TP_STREAM_ENDPOINT_STATE_FULLY_CONNECTED);
+  set_endpoint_state (test, first, TP_STREAM_COMPONENT_DATA,
+      TP_STREAM_ENDPOINT_STATE_EXHAUSTED_CANDIDATES);
+  g_assert (has_connected_endpoint (test));
+
+  set_endpoint_state (test, second, TP_STREAM_COMPONENT_DATA,
+      TP_STREAM_ENDPOINT_STATE_FAILED);
+  g_assert (!has_connected_endpoint (test));
+
+  /* removing the only connected endpoint stops it counting... */
+  set_endpoint_state (test, second, TP_STREAM_COMPONENT_DATA,
+      TP_STREAM_ENDPOINT_STATE_FULLY_CONNECTED);
+  g_assert (has_connected_endpoint (test));
+  tp_base_media_call_stream_remove_endpoint (test->stream, second);
+  g_assert (!has_connected_endpoint (test));
+  g_assert_cmpuint (g_list_length (
+        tp_base_media_call_stream_get_endpoints (test->stream)), ==, 1);
+
+  /* ... and it's ignored after that */
+  set_endpoint_state (test, second, TP_STREAM_COMPONENT_DATA,
+      TP_STREAM_ENDPOINT_STATE_FAILED);
+  set_endpoint_state (test, second, TP_STREAM_COMPONENT_DATA,
+      TP_STREAM_ENDPOINT_STATE_FULLY_CONNECTED);
+  g_assert (!has_connected_endpoint (test));
+
+  /* removing a disconnected endpoint leaves a connected one counted */
+  third = add_endpoint (test, "Endpoint3");
+  set_endpoint_state (test, third, TP_STREAM_COMPONENT_DATA,
+      TP_STREAM_ENDPOINT_STATE_PROVISIONALLY_CONNECTED);
+  tp_base_media_call_stream_remove_endpoint (test->stream, first);
+  g_assert (has_connected_endpoint (test));
+  g_assert (tp_base_media_call_stream_get_endpoints (test->stream)->data ==
+      third);
+
+  tp_base_media_call_stream_remove_endpoint (test->stream, third);
+  g_assert (!has_connected_endpoint (test));
+  g_assert (tp_base_media_call_stream_get_endpoints (test->stream) == NULL);
+
+  g_object_unref (first);
+  g_object_unref (second);
+  g_object_unref (third);
+}
+
+int
+main (int argc,
+    char **argv)
+{
+  tp_tests_init (&argc, &argv);
+  g_test_bug_base ("http://bugs.freedesktop.org/show_bug.cgi?id=");
+
+  g_test_add ("/call-stream-state/remote-senders", Test, NULL, setup,
+      test_remote_senders, teardown);
+  g_test_add ("/call-stream-state/connected-endpoints", Test, NULL, setup,
+      test_connected_endpoints, teardown);
+
+  return tp_tests_run_with_bus ();
+}
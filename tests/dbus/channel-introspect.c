@@ -448,6 +448,58 @@ main (int argc,
   g_object_unref (chan);
   chan = NULL;
 
+  g_message ("Channel becomes ready without any D-Bus calls (immutable "
+      "properties passed to the factory)");
+
+  tp_tests_proxy_run_until_dbus_queue_processed (conn);
+
+  TP_TESTS_TEXT_CHANNEL_NULL (service_props_chan)->get_handle_called = 0;
+  TP_TESTS_TEXT_CHANNEL_NULL (service_props_chan)->get_interfaces_called = 0;
+  TP_TESTS_TEXT_CHANNEL_NULL (service_props_chan)->get_channel_type_called = 0;
+
+  g_hash_table_remove_all (TP_TESTS_PROPS_TEXT_CHANNEL (service_props_chan)
+      ->dbus_property_interfaces_retrieved);
+
+  asv = tp_asv_new (
+      TP_PROP_CHANNEL_CHANNEL_TYPE, G_TYPE_STRING,
+          TP_IFACE_CHANNEL_TYPE_TEXT,
+      TP_PROP_CHANNEL_TARGET_HANDLE_TYPE, G_TYPE_UINT, TP_HANDLE_TYPE_CONTACT,
+      TP_PROP_CHANNEL_TARGET_HANDLE, G_TYPE_UINT, handle,
+      TP_PROP_CHANNEL_TARGET_ID, G_TYPE_STRING, IDENTIFIER,
+      TP_PROP_CHANNEL_INITIATOR_HANDLE, G_TYPE_UINT, handle,
+      TP_PROP_CHANNEL_INITIATOR_ID, G_TYPE_STRING, IDENTIFIER,
+      TP_PROP_CHANNEL_INTERFACES, G_TYPE_STRV, NULL,
+      TP_PROP_CHANNEL_REQUESTED, G_TYPE_BOOLEAN, FALSE,
+      NULL);
+
+  chan = tp_simple_client_factory_ensure_channel (tp_proxy_get_factory (conn),
+      conn, props_chan_path, asv, &error);
+  g_assert_no_error (error);
+
+  g_hash_table_unref (asv);
+  asv = NULL;
+
+  /* the connection is already prepared, so there is nothing to wait for */
+  g_assert (tp_proxy_is_prepared (chan, TP_CHANNEL_FEATURE_CORE));
+
+  MYASSERT (tp_channel_run_until_ready (chan, &error, NULL), "");
+  g_assert_no_error (error);
+  g_assert_cmpuint (g_hash_table_size (
+      service_props_chan->dbus_property_interfaces_retrieved), ==, 0);
+  g_assert_cmpuint (
+      TP_TESTS_TEXT_CHANNEL_NULL (service_props_chan)->get_handle_called, ==, 0);
+  g_assert_cmpuint (
+      TP_TESTS_TEXT_CHANNEL_NULL (service_props_chan)->get_channel_type_called,
+      ==, 0);
+  g_assert_cmpuint (
+      TP_TESTS_TEXT_CHANNEL_NULL (service_props_chan)->get_interfaces_called,
+      ==, 0);
+
+  assert_chan_sane (chan, handle, FALSE, handle, IDENTIFIER);
+
+  g_object_unref (chan);
+  chan = NULL;
+
   g_message ("Group channel becomes ready while we wait (preloading immutable "
       "properties)");
 
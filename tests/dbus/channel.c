@@ -14,6 +14,7 @@
 #include <string.h>
 
 #include <telepathy-glib/telepathy-glib.h>
+#include <telepathy-glib/telepathy-glib-dbus.h>
 
 #include "tests/lib/util.h"
 #include "tests/lib/contacts-conn.h"
@@ -412,6 +413,134 @@ test_close_room (Test *test,
   check_not_removed (test->chan_room_service);
 }
 
+static void
+test_factory_cache (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpSimpleClientFactory *factory = tp_proxy_get_factory (test->connection);
+  const gchar *path = tp_proxy_get_object_path (test->channel_contact);
+  GHashTable *props;
+  TpChannel *chan, *chan2;
+  guint hits0, misses0, stale0, hits, misses, stale;
+
+  tp_simple_client_factory_set_invalidated_cache_size (factory, 4);
+  tp_simple_client_factory_get_cache_stats (factory, &hits0, &misses0,
+      &stale0);
+
+  props = tp_tests_text_channel_get_props (test->chan_contact_service);
+
+  /* the first time, a new proxy is made... */
+  chan = tp_simple_client_factory_ensure_channel (factory, test->connection,
+      path, props, &test->error);
+  g_assert_no_error (test->error);
+  g_assert (chan != NULL);
+
+  /* ... and then it's reused */
+  chan2 = tp_simple_client_factory_ensure_channel (factory, test->connection,
+      path, props, &test->error);
+  g_assert_no_error (test->error);
+  g_assert (chan2 == chan);
+  g_object_unref (chan2);
+
+  tp_simple_client_factory_get_cache_stats (factory, &hits, &misses, NULL);
+  g_assert_cmpuint (hits, ==, hits0 + 1);
+  g_assert_cmpuint (misses, ==, misses0 + 1);
+
+  tp_channel_close_async (chan, channel_close_cb, test);
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert (tp_proxy_get_invalidated (chan) != NULL);
+  g_object_unref (chan);
+
+  /* the channel has gone away, so the factory won't bring it back */
+  chan = tp_simple_client_factory_ensure_channel (factory, test->connection,
+      path, props, &test->error);
+  g_assert_error (test->error, TP_DBUS_ERRORS, TP_DBUS_ERROR_OBJECT_REMOVED);
+  g_assert (chan == NULL);
+  g_clear_error (&test->error);
+
+  tp_simple_client_factory_get_cache_stats (factory, NULL, NULL, &stale);
+  g_assert_cmpuint (stale, ==, stale0 + 1);
+
+  /* unless we stop remembering it */
+  tp_simple_client_factory_set_invalidated_cache_size (factory, 0);
+
+  chan = tp_simple_client_factory_ensure_channel (factory, test->connection,
+      path, props, &test->error);
+  g_assert_no_error (test->error);
+  g_assert (chan != NULL);
+  g_object_unref (chan);
+
+  g_hash_table_unref (props);
+}
+
+static void
+test_factory_cache_reopen (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpSimpleClientFactory *factory = tp_proxy_get_factory (test->connection);
+  gchar *path = g_strdup (tp_proxy_get_object_path (test->channel_contact));
+  TpTestsTextChannelNull *reopened;
+  TpHandle handle;
+  GHashTable *props;
+  GPtrArray *details;
+  TpChannel *chan;
+
+  tp_simple_client_factory_set_invalidated_cache_size (factory, 4);
+
+  props = tp_tests_text_channel_get_props (test->chan_contact_service);
+  chan = tp_simple_client_factory_ensure_channel (factory, test->connection,
+      path, props, &test->error);
+  g_assert_no_error (test->error);
+
+  tp_channel_close_async (chan, channel_close_cb, test);
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_object_unref (chan);
+
+  chan = tp_simple_client_factory_ensure_channel (factory, test->connection,
+      path, props, &test->error);
+  g_assert_error (test->error, TP_DBUS_ERRORS, TP_DBUS_ERROR_OBJECT_REMOVED);
+  g_assert (chan == NULL);
+  g_clear_error (&test->error);
+
+  /* The CM opens a new channel at the same path, as some CMs do for
+   * contact lists and password channels */
+  g_object_get (test->chan_contact_service,
+      "handle", &handle,
+      NULL);
+  reopened = tp_tests_object_new_static_class (
+      TP_TESTS_TYPE_TEXT_CHANNEL_NULL,
+      "connection", test->base_connection,
+      "handle", handle,
+      "object-path", path,
+      NULL);
+  g_object_unref (test->chan_contact_service);
+  test->chan_contact_service = reopened;
+
+  details = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) tp_value_array_free);
+  g_ptr_array_add (details, tp_value_array_build (2,
+        DBUS_TYPE_G_OBJECT_PATH, path,
+        TP_HASH_TYPE_QUALIFIED_PROPERTY_VALUE_MAP, props,
+        G_TYPE_INVALID));
+  tp_svc_connection_interface_requests_emit_new_channels (
+      test->base_connection, details);
+  g_ptr_array_unref (details);
+  tp_tests_proxy_run_until_dbus_queue_processed (test->connection);
+
+  /* the factory has seen it being announced, so it's no longer stale */
+  chan = tp_simple_client_factory_ensure_channel (factory, test->connection,
+      path, props, &test->error);
+  g_assert_no_error (test->error);
+  g_assert (chan != NULL);
+  g_assert (tp_proxy_get_invalidated (chan) == NULL);
+  g_object_unref (chan);
+
+  g_hash_table_unref (props);
+  g_free (path);
+}
+
 static void
 channel_destroy_cb (GObject *source,
     GAsyncResult *result,
@@ -663,6 +792,58 @@ test_contacts (Test *test,
   g_assert_cmpstr (tp_contact_get_alias (contact), ==, alias2);
 }
 
+static void
+test_immutable_properties (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GVariant *vardict, *again;
+  gboolean requested;
+  guint initiator_handle;
+  const gchar *initiator_id;
+
+  g_object_get (test->chan_contact_service,
+      "requested", &requested,
+      "initiator-handle", &initiator_handle,
+      NULL);
+
+  /* the well-known properties are available straight away, without
+   * preparing anything */
+  g_assert_cmpstr (tp_channel_get_channel_type (test->channel_contact), ==,
+      TP_IFACE_CHANNEL_TYPE_TEXT);
+  g_assert_cmpstr (tp_channel_get_identifier (test->channel_contact), ==,
+      "bob");
+  g_assert_cmpint (tp_channel_get_requested (test->channel_contact), ==,
+      requested);
+  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  g_assert_cmpuint (tp_channel_get_initiator_handle (test->channel_contact),
+      ==, initiator_handle);
+  initiator_id = tp_channel_get_initiator_identifier (test->channel_contact);
+  G_GNUC_END_IGNORE_DEPRECATIONS
+  g_assert (initiator_id != NULL);
+
+  vardict = tp_channel_dup_immutable_properties (test->channel_contact);
+  g_assert_cmpstr (tp_vardict_get_string (vardict,
+        TP_PROP_CHANNEL_CHANNEL_TYPE), ==, TP_IFACE_CHANNEL_TYPE_TEXT);
+  g_assert_cmpstr (tp_vardict_get_string (vardict,
+        TP_PROP_CHANNEL_INITIATOR_ID), ==, initiator_id);
+  g_assert_cmpint (tp_vardict_get_boolean (vardict,
+        TP_PROP_CHANNEL_REQUESTED, NULL), ==, requested);
+
+  /* asking again without anything having changed gives the same variant */
+  again = tp_channel_dup_immutable_properties (test->channel_contact);
+  g_assert (again == vardict);
+  g_variant_unref (again);
+
+  tp_tests_proxy_run_until_prepared (test->channel_contact, NULL);
+
+  /* we already knew everything, so preparing doesn't change anything */
+  again = tp_channel_dup_immutable_properties (test->channel_contact);
+  g_assert (g_variant_equal (again, vardict));
+  g_variant_unref (again);
+
+  g_variant_unref (vardict);
+}
+
 int
 main (int argc,
       char **argv)
@@ -693,6 +874,12 @@ main (int argc,
   g_test_add ("/channel/close/room", Test, NULL, setup,
       test_close_room, teardown);
 
+  g_test_add ("/channel/factory-cache", Test, NULL, setup,
+      test_factory_cache, teardown);
+
+  g_test_add ("/channel/factory-cache/reopen", Test, NULL, setup,
+      test_factory_cache_reopen, teardown);
+
   g_test_add ("/channel/destroy", Test, NULL, setup,
       test_destroy, teardown);
 
@@ -707,5 +894,8 @@ main (int argc,
   g_test_add ("/channel/contacts", Test, NULL, setup,
       test_contacts, teardown);
 
+  g_test_add ("/channel/immutable-properties", Test, NULL, setup,
+      test_immutable_properties, teardown);
+
   return tp_tests_run_with_bus ();
 }
@@ -10,8 +10,14 @@
 
 #include "config.h"
 
+#include <glib/gstdio.h>
+
 #include <telepathy-glib/telepathy-glib.h>
 
+#include <dbus/dbus.h>
+#include <dbus/dbus-glib.h>
+#include <dbus/dbus-glib-lowlevel.h>
+
 #include "tests/lib/echo-cm.h"
 #include "tests/lib/util.h"
 
@@ -28,6 +34,7 @@ typedef struct {
     TpTestsEchoConnectionManager parent;
     guint drop_name_on_get;
     gboolean implement_properties;
+    guint get_all_calls;
 } MyConnectionManager;
 typedef TpTestsEchoConnectionManagerClass MyConnectionManagerClass;
 
@@ -40,6 +47,15 @@ typedef struct {
     TpConnectionManager *echo;
     TpConnectionManager *spurious;
     GError *error /* initialized where needed */;
+
+    /* a CM implemented by hand on a private connection, for tests that
+     * need to hold on to method calls */
+    DBusConnection *private_conn;
+    /* bus names it owns */
+    GPtrArray *private_names;
+    gboolean stall_get_all;
+    /* method calls that we haven't replied to yet */
+    GPtrArray *stalled_calls;
 } Test;
 
 static void my_properties_iface_init (gpointer iface);
@@ -80,6 +96,8 @@ my_get_all (TpSvcDBusProperties *iface,
 {
   MyConnectionManager *cm = (MyConnectionManager *) iface;
 
+  cm->get_all_calls++;
+
   /* If necessary, emulate the CM exiting and coming back. */
   if (cm->drop_name_on_get)
     {
@@ -147,12 +165,40 @@ setup (Test *test,
   g_assert (ok);
 
   test->cm = NULL;
+  test->private_conn = NULL;
+  test->private_names = g_ptr_array_new_with_free_func (g_free);
+  test->stall_get_all = FALSE;
+  test->stalled_calls = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) dbus_message_unref);
+}
+
+static void
+close_private_conn (Test *test)
+{
+  guint i;
+
+  /* release the names synchronously, so that later tests won't find
+   * them while the dbus-daemon notices that we have gone */
+  for (i = 0; i < test->private_names->len; i++)
+    dbus_bus_release_name (test->private_conn,
+        g_ptr_array_index (test->private_names, i), NULL);
+
+  g_ptr_array_set_size (test->private_names, 0);
+
+  dbus_connection_close (test->private_conn);
+  dbus_connection_unref (test->private_conn);
+  test->private_conn = NULL;
 }
 
 static void
 teardown (Test *test,
           gconstpointer data)
 {
+  if (test->private_conn != NULL)
+    close_private_conn (test);
+
+  tp_clear_pointer (&test->stalled_calls, g_ptr_array_unref);
+  tp_clear_pointer (&test->private_names, g_ptr_array_unref);
   g_clear_object (&test->service_cm);
   g_clear_object (&test->dbus);
   g_clear_object (&test->cm);
@@ -381,6 +427,65 @@ test_file_got_info (Test *test,
   g_assert (test->cm->protocols[2] == NULL);
 }
 
+static void
+read_test_manager_file (Test *test)
+{
+  GError *error = NULL;
+  gulong id;
+  const TpConnectionManagerProtocol *protocol;
+
+  g_clear_object (&test->cm);
+  test->cm = tp_connection_manager_new (test->dbus, "test_manager_file",
+      NULL, &error);
+  g_assert (TP_IS_CONNECTION_MANAGER (test->cm));
+  g_assert_no_error (error);
+
+  id = g_signal_connect (test->cm, "got-info",
+      G_CALLBACK (on_got_info_expect_file), test);
+  g_main_loop_run (test->mainloop);
+  g_signal_handler_disconnect (test->cm, id);
+
+  g_assert_cmpuint (test->cm->info_source, ==, TP_CM_INFO_SOURCE_FILE);
+  g_assert (test->cm->protocols != NULL);
+  g_assert (test->cm->protocols[0] != NULL);
+  g_assert (test->cm->protocols[1] != NULL);
+  g_assert (test->cm->protocols[2] != NULL);
+  g_assert (test->cm->protocols[3] == NULL);
+
+  protocol = tp_connection_manager_get_protocol (test->cm, "foo");
+  g_assert_cmpstr (protocol->params[0].name, ==, "account");
+  g_assert_cmpstr (g_value_get_string (&protocol->params[0].default_value),
+      ==, "foo@default");
+  g_assert_cmpstr (protocol->params[3].name, ==, "port");
+  g_assert_cmpuint (g_value_get_uint (&protocol->params[3].default_value),
+      ==, 1234);
+}
+
+static void
+test_file_cached (Test *test,
+    gconstpointer data)
+{
+  gchar *cache = g_build_filename (g_get_user_cache_dir (), "telepathy",
+      "managers", "test_manager_file.cache", NULL);
+  GError *error = NULL;
+
+  g_unlink (cache);
+
+  /* the first time, we parse the .manager file and save the result */
+  read_test_manager_file (test);
+  g_assert (g_file_test (cache, G_FILE_TEST_IS_REGULAR));
+
+  /* the second time, we use what we saved, and get the same answers */
+  read_test_manager_file (test);
+
+  /* if the cache is garbage, we just parse the .manager file again */
+  g_file_set_contents (cache, "this is not a cache", -1, &error);
+  g_assert_no_error (error);
+  read_test_manager_file (test);
+
+  g_free (cache);
+}
+
 static void
 test_complex_file_got_info (Test *test,
                             gconstpointer data)
@@ -1031,6 +1136,142 @@ test_dbus_ready (Test *test,
   g_list_free_full (l, g_object_unref);
 }
 
+/* The hand-made CM on the private connection has no Protocols property,
+ * lists protocols a, b and c, and never replies to GetParameters (or to
+ * GetAll, if stall_get_all is set) until the test does. */
+static DBusHandlerResult
+private_cm_filter (DBusConnection *conn,
+    DBusMessage *message,
+    void *user_data)
+{
+  Test *test = user_data;
+  DBusMessage *reply;
+
+  if (dbus_message_is_method_call (message, TP_IFACE_DBUS_PROPERTIES,
+        "GetAll"))
+    {
+      if (test->stall_get_all)
+        {
+          g_ptr_array_add (test->stalled_calls, dbus_message_ref (message));
+          return DBUS_HANDLER_RESULT_HANDLED;
+        }
+
+      reply = dbus_message_new_error (message, DBUS_ERROR_UNKNOWN_METHOD,
+          "This CM predates D-Bus properties");
+    }
+  else if (dbus_message_is_method_call (message, TP_IFACE_CONNECTION_MANAGER,
+        "ListProtocols"))
+    {
+      const gchar *protocols[] = { "a", "b", "c" };
+      const gchar **p = protocols;
+
+      reply = dbus_message_new_method_return (message);
+      g_assert (dbus_message_append_args (reply,
+            DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &p, G_N_ELEMENTS (protocols),
+            DBUS_TYPE_INVALID));
+    }
+  else if (dbus_message_is_method_call (message, TP_IFACE_CONNECTION_MANAGER,
+        "GetParameters"))
+    {
+      g_ptr_array_add (test->stalled_calls, dbus_message_ref (message));
+      return DBUS_HANDLER_RESULT_HANDLED;
+    }
+  else
+    {
+      return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+  g_assert (reply != NULL);
+  g_assert (dbus_connection_send (conn, reply, NULL));
+  dbus_message_unref (reply);
+  return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+static void
+start_private_cm (Test *test,
+    const gchar * const *names)
+{
+  DBusError error;
+
+  dbus_error_init (&error);
+  test->private_conn = dbus_bus_get_private (DBUS_BUS_STARTER, NULL);
+  g_assert (test->private_conn != NULL);
+  dbus_connection_setup_with_g_main (test->private_conn, NULL);
+  dbus_connection_set_exit_on_disconnect (test->private_conn, FALSE);
+  g_assert (dbus_connection_add_filter (test->private_conn, private_cm_filter,
+        test, NULL));
+
+  for (; *names != NULL; names++)
+    {
+      gchar *bus_name = g_strconcat (TP_CM_BUS_NAME_BASE, *names, NULL);
+
+      g_assert_cmpint (dbus_bus_request_name (test->private_conn, bus_name,
+            DBUS_NAME_FLAG_DO_NOT_QUEUE, &error), ==,
+          DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER);
+      g_assert (!dbus_error_is_set (&error));
+      g_ptr_array_add (test->private_names, bus_name);
+    }
+}
+
+static void
+wait_for_stalled_calls (Test *test,
+    guint n)
+{
+  while (test->stalled_calls->len < n)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (test->stalled_calls->len, ==, n);
+}
+
+static void
+test_dbus_fallback_pipelined (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  const gchar * const names[] = { "pipelined", NULL };
+  GAsyncResult *res = NULL;
+  guint i;
+
+  start_private_cm (test, names);
+
+  test->cm = tp_connection_manager_new (test->dbus, "pipelined", NULL,
+      &test->error);
+  g_assert_no_error (test->error);
+  tp_proxy_prepare_async (test->cm, NULL, tp_tests_result_ready_cb, &res);
+
+  /* all three GetParameters calls are outstanding at the same time: we
+   * don't reply to any of them until they have all arrived */
+  wait_for_stalled_calls (test, 3);
+  g_assert (res == NULL);
+
+  for (i = 0; i < test->stalled_calls->len; i++)
+    {
+      DBusMessage *reply = dbus_message_new_method_return (
+          g_ptr_array_index (test->stalled_calls, i));
+      DBusMessageIter iter, sub;
+
+      g_assert (reply != NULL);
+      dbus_message_iter_init_append (reply, &iter);
+      g_assert (dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+            "(susv)", &sub));
+      g_assert (dbus_message_iter_close_container (&iter, &sub));
+      g_assert (dbus_connection_send (test->private_conn, reply, NULL));
+      dbus_message_unref (reply);
+    }
+
+  g_ptr_array_set_size (test->stalled_calls, 0);
+
+  tp_tests_run_until_result (&res);
+  g_assert (tp_proxy_prepare_finish (test->cm, res, &test->error));
+  g_assert_no_error (test->error);
+  g_object_unref (res);
+
+  g_assert_cmpuint (tp_connection_manager_get_info_source (test->cm), ==,
+      TP_CM_INFO_SOURCE_LIVE);
+  g_assert (tp_connection_manager_has_protocol (test->cm, "a"));
+  g_assert (tp_connection_manager_has_protocol (test->cm, "b"));
+  g_assert (tp_connection_manager_has_protocol (test->cm, "c"));
+}
+
 static void
 on_listed_connection_managers (TpConnectionManager * const * cms,
                                gsize n_cms,
@@ -1120,6 +1361,71 @@ test_list (Test *test,
   g_assert (tp_connection_manager_has_protocol (test->spurious, "normal"));
 }
 
+static void
+test_list_stalled (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  const gchar * const names[] = { "stalled0", "stalled1", "stalled2",
+      "stalled3", "stalled4", NULL };
+  GAsyncResult *res = NULL;
+  GList *cms, *l;
+
+  test->stall_get_all = TRUE;
+  start_private_cm (test, names);
+
+  tp_list_connection_managers_async (test->dbus, tp_tests_result_ready_cb,
+      &res);
+
+  /* Four of the stalled CMs are being introspected, and the fifth waits
+   * for one of them to finish. The echo CM, which needed introspecting
+   * too, wasn't held up behind them; nor was the spurious CM, which only
+   * needs its .manager file. */
+  wait_for_stalled_calls (test, 4);
+  tp_tests_proxy_run_until_dbus_queue_processed (test->dbus);
+  g_assert_cmpuint (test->stalled_calls->len, ==, 4);
+  g_assert_cmpuint (test->service_cm->get_all_calls, ==, 1);
+  g_assert (res == NULL);
+
+  /* When the stalled CMs go away, introspecting them fails and the listing
+   * finishes */
+  close_private_conn (test);
+
+  tp_tests_run_until_result (&res);
+  cms = tp_list_connection_managers_finish (res, &test->error);
+  g_assert_no_error (test->error);
+  g_assert_cmpuint (g_list_length (cms), ==, 7);
+
+  for (l = cms; l != NULL; l = l->next)
+    {
+      TpConnectionManager *cm = l->data;
+      const gchar *name = tp_connection_manager_get_name (cm);
+
+      if (!tp_strdiff (name, "example_echo"))
+        {
+          g_assert (tp_proxy_is_prepared (cm,
+                TP_CONNECTION_MANAGER_FEATURE_CORE));
+          g_assert_cmpuint (tp_connection_manager_get_info_source (cm), ==,
+              TP_CM_INFO_SOURCE_LIVE);
+        }
+      else if (!tp_strdiff (name, "spurious"))
+        {
+          g_assert (tp_proxy_is_prepared (cm,
+                TP_CONNECTION_MANAGER_FEATURE_CORE));
+          g_assert_cmpuint (tp_connection_manager_get_info_source (cm), ==,
+              TP_CM_INFO_SOURCE_FILE);
+        }
+      else
+        {
+          g_assert (g_str_has_prefix (name, "stalled"));
+          g_assert (!tp_proxy_is_prepared (cm,
+                TP_CONNECTION_MANAGER_FEATURE_CORE));
+        }
+    }
+
+  g_list_free_full (cms, g_object_unref);
+  g_object_unref (res);
+}
+
 int
 main (int argc,
       char **argv)
@@ -1146,6 +1452,8 @@ main (int argc,
       setup, test_file_ready, teardown);
   g_test_add ("/cm/file/cwr", Test, GINT_TO_POINTER (USE_CWR),
       setup, test_file_ready, teardown);
+  g_test_add ("/cm/file/cached", Test, NULL, setup, test_file_cached,
+      teardown);
   g_test_add ("/cm/file/complex", Test, GINT_TO_POINTER (0), setup,
       test_complex_file_ready, teardown);
   g_test_add ("/cm/file/complex/cwr", Test, GINT_TO_POINTER (USE_CWR), setup,
@@ -1170,6 +1478,8 @@ main (int argc,
   g_test_add ("/cm/dbus-fallback/activate/cwr", Test,
       GINT_TO_POINTER (NO_PROPERTIES | ACTIVATE_CM | USE_CWR),
       setup, test_dbus_ready, teardown);
+  g_test_add ("/cm/dbus-fallback/pipelined", Test, NULL, setup,
+      test_dbus_fallback_pipelined, teardown);
 
   g_test_add ("/cm/dbus/dies", Test,
       GINT_TO_POINTER (DROP_NAME_ON_GET),
@@ -1189,6 +1499,8 @@ main (int argc,
       setup, test_list, teardown);
   g_test_add ("/cm/list/old", Test, GINT_TO_POINTER (USE_OLD_LIST),
       setup, test_list, teardown);
+  g_test_add ("/cm/list/stalled", Test, NULL, setup, test_list_stalled,
+      teardown);
 
   return tp_tests_run_with_bus ();
 }
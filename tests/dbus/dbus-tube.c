@@ -11,6 +11,10 @@
 
 #include <string.h>
 
+#ifdef HAVE_GIO_UNIX
+#include <gio/gunixfdlist.h>
+#endif
+
 #include <telepathy-glib/dbus-tube-channel.h>
 #include <telepathy-glib/debug.h>
 #include <telepathy-glib/defs.h>
@@ -38,6 +42,16 @@ typedef struct {
     GDBusConnection *cm_conn;
     GVariant *call_result;
 
+    /* Consume() calls */
+    GBytes *payload;
+    gboolean use_fd_list;
+    gboolean same_host;
+    guint to_send;
+    /* how many payloads were sent as a memfd rather than copied */
+    guint n_memfd;
+    guint in_flight;
+    guint64 received;
+
     GError *error /* initialized where needed */;
     gint wait;
 } Test;
@@ -76,6 +90,7 @@ teardown (Test *test,
   g_clear_object (&test->tube_conn);
   g_clear_object (&test->cm_conn);
   tp_clear_pointer (&test->call_result, g_variant_unref);
+  tp_clear_pointer (&test->payload, g_bytes_unref);
 }
 
 static void
@@ -463,6 +478,297 @@ test_accept (Test *test,
   use_tube (test, test->cm_conn, test->tube_conn);
 }
 
+static guint32
+checksum_bytes (GBytes *bytes)
+{
+  const guint8 *data;
+  gsize size, i;
+  guint32 sum = 0;
+
+  data = g_bytes_get_data (bytes, &size);
+
+  for (i = 0; i < size; i++)
+    sum = sum * 31 + data[i];
+
+  return sum;
+}
+
+static void
+handle_consume_call (GDBusConnection *connection,
+    const gchar *sender,
+    const gchar *object_path,
+    const gchar *interface_name,
+    const gchar *method_name,
+    GVariant *parameters,
+    GDBusMethodInvocation *invocation,
+    gpointer user_data)
+{
+  GDBusMessage *message = g_dbus_method_invocation_get_message (invocation);
+  GVariant *payload;
+  GBytes *bytes;
+  GError *error = NULL;
+
+  g_assert_cmpstr (method_name, ==, "Consume");
+
+  g_variant_get (parameters, "(@v)", &payload);
+  bytes = tp_dbus_tube_payload_dup_bytes (payload,
+      g_dbus_message_get_unix_fd_list (message), &error);
+  g_assert_no_error (error);
+
+  g_dbus_method_invocation_return_value (invocation,
+      g_variant_new ("(tu)", (guint64) g_bytes_get_size (bytes),
+        checksum_bytes (bytes)));
+
+  g_bytes_unref (bytes);
+  g_variant_unref (payload);
+}
+
+static void
+register_consumer (GDBusConnection *connection)
+{
+  GDBusNodeInfo *introspection_data;
+  guint registration_id;
+  static const GDBusInterfaceVTable interface_vtable =
+  {
+    handle_consume_call,
+    NULL,
+    NULL,
+  };
+  static const gchar introspection_xml[] =
+    "<node>"
+    "  <interface name='org.Example.Consumer'>"
+    "    <method name='Consume'>"
+    "      <arg type='v' name='payload' direction='in'/>"
+    "      <arg type='t' name='size' direction='out'/>"
+    "      <arg type='u' name='checksum' direction='out'/>"
+    "    </method>"
+    "  </interface>"
+    "</node>";
+
+  introspection_data = g_dbus_node_info_new_for_xml (introspection_xml, NULL);
+  g_assert (introspection_data != NULL);
+
+  registration_id = g_dbus_connection_register_object (connection,
+      "/org/Example/Consumer", introspection_data->interfaces[0],
+      &interface_vtable, NULL, NULL, NULL);
+  g_assert (registration_id > 0);
+
+  g_dbus_node_info_unref (introspection_data);
+}
+
+static GBytes *
+new_payload (gsize size)
+{
+  guint8 *data = g_malloc (size);
+  gsize i;
+
+  for (i = 0; i < size; i++)
+    data[i] = i * 7;
+
+  return g_bytes_new_take (data, size);
+}
+
+static void send_payloads (Test *test);
+
+static void
+consume_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+  GVariant *ret;
+  guint64 size;
+  guint32 checksum;
+
+  ret = g_dbus_connection_call_with_unix_fd_list_finish (
+      G_DBUS_CONNECTION (source), NULL, result, &test->error);
+  g_assert_no_error (test->error);
+
+  g_variant_get (ret, "(tu)", &size, &checksum);
+  g_assert_cmpuint (size, ==, g_bytes_get_size (test->payload));
+  g_assert_cmpuint (checksum, ==, checksum_bytes (test->payload));
+  g_variant_unref (ret);
+
+  test->received += size;
+  test->in_flight--;
+
+  send_payloads (test);
+
+  if (test->in_flight == 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+/* Keep a bounded number of calls in flight so we measure the tube rather
+ * than how fast GDBus can queue messages */
+#define CONSUME_WINDOW 64
+
+static void
+send_payloads (Test *test)
+{
+  while (test->to_send > 0 && test->in_flight < CONSUME_WINDOW)
+    {
+      GUnixFDList *fd_list = NULL;
+      GVariant *payload, *inner;
+
+#ifdef HAVE_GIO_UNIX
+      if (test->use_fd_list)
+        fd_list = g_unix_fd_list_new ();
+#endif
+
+      payload = tp_dbus_tube_payload_new (test->tube_conn, test->payload,
+          test->same_host, fd_list);
+
+      inner = g_variant_get_variant (payload);
+
+      if (g_variant_is_of_type (inner, G_VARIANT_TYPE_HANDLE))
+        test->n_memfd++;
+      else
+        g_assert (g_variant_is_of_type (inner, G_VARIANT_TYPE_BYTESTRING));
+
+      g_variant_unref (inner);
+
+#ifdef HAVE_GIO_UNIX
+      /* The payload may have been copied inline after all */
+      if (fd_list != NULL && g_unix_fd_list_get_length (fd_list) == 0)
+        g_clear_object (&fd_list);
+#endif
+
+      g_dbus_connection_call_with_unix_fd_list (test->tube_conn, NULL,
+          "/org/Example/Consumer", "org.Example.Consumer", "Consume",
+          g_variant_new_tuple (&payload, 1), G_VARIANT_TYPE ("(tu)"),
+          G_DBUS_CALL_FLAGS_NONE, -1, fd_list, NULL, consume_cb, test);
+
+      tp_clear_object (&fd_list);
+      test->to_send--;
+      test->in_flight++;
+    }
+}
+
+static void
+consume_payloads (Test *test,
+    gsize size,
+    guint n_payloads,
+    gboolean use_fd_list,
+    gboolean same_host)
+{
+  tp_clear_pointer (&test->payload, g_bytes_unref);
+  test->payload = new_payload (size);
+  test->use_fd_list = use_fd_list;
+  test->same_host = same_host;
+  test->to_send = n_payloads;
+  test->received = 0;
+  test->n_memfd = 0;
+
+  send_payloads (test);
+  g_main_loop_run (test->mainloop);
+
+  g_assert_cmpuint (test->received, ==, (guint64) size * n_payloads);
+}
+
+static void
+offer_tube (Test *test,
+    guint socket_buffer_size)
+{
+  create_tube_service (test, TRUE, TRUE);
+  tp_tests_dbus_tube_channel_set_open_mode (test->tube_chan_service,
+      TP_TESTS_DBUS_TUBE_CHANNEL_OPEN_FIRST);
+
+  g_signal_connect (test->tube_chan_service, "new-connection",
+      G_CALLBACK (new_connection_cb), test);
+
+  if (socket_buffer_size != 0)
+    tp_dbus_tube_channel_set_socket_buffer_size (test->tube,
+        socket_buffer_size);
+
+  tp_dbus_tube_channel_offer_async (test->tube, NULL, tube_offer_cb, test);
+
+  test->wait = 2;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  register_consumer (test->cm_conn);
+}
+
+static void
+test_payload (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  offer_tube (test, 256 * 1024);
+
+  /* Small payloads are always inline. Either way the other side must see
+   * the same bytes. */
+  consume_payloads (test, 100, 3, TRUE, TRUE);
+  g_assert_cmpuint (test->n_memfd, ==, 0);
+
+  /* Large ones are passed as a memfd where possible, but only if the
+   * caller says the tube isn't relayed off this host: we are the CM here */
+  consume_payloads (test, 1024 * 1024, 3, TRUE, TRUE);
+#if defined(HAVE_GIO_UNIX) && defined(HAVE_MEMFD_CREATE)
+  g_assert_cmpuint (test->n_memfd, ==, 3);
+#else
+  g_assert_cmpuint (test->n_memfd, ==, 0);
+#endif
+
+  /* ... which is off by default ... */
+  consume_payloads (test, 1024 * 1024, 3, TRUE, FALSE);
+  g_assert_cmpuint (test->n_memfd, ==, 0);
+
+  /* ... and needs somewhere to put the fd */
+  consume_payloads (test, 1024 * 1024, 3, FALSE, TRUE);
+  g_assert_cmpuint (test->n_memfd, ==, 0);
+}
+
+typedef struct {
+    const gchar *name;
+    gsize payload_size;
+    guint socket_buffer_size;
+    gboolean use_fd_list;
+} BenchmarkContext;
+
+static const BenchmarkContext benchmark_contexts[] = {
+  { "small", 64, 0, FALSE },
+  { "small/buffered", 64, 1024 * 1024, FALSE },
+  { "large", 1024 * 1024, 0, FALSE },
+  { "large/buffered", 1024 * 1024, 1024 * 1024, FALSE },
+#ifdef HAVE_GIO_UNIX
+  { "large/memfd", 1024 * 1024, 0, TRUE },
+#endif
+};
+
+/* Small messages are dominated by per-message costs, so there's no point
+ * sending TP_TESTS_BENCHMARK_VOLUME worth of them */
+#define BENCHMARK_MAX_MESSAGES 20000
+
+static void
+test_benchmark (Test *test,
+    gconstpointer data)
+{
+  const BenchmarkContext *ctx = data;
+  guint n_payloads;
+  TpTestsBenchmark *bench;
+  gdouble elapsed;
+  gint64 start;
+
+  n_payloads = MIN (tp_tests_benchmark_get_volume () / ctx->payload_size,
+      BENCHMARK_MAX_MESSAGES);
+  n_payloads = MAX (n_payloads, 1);
+
+  offer_tube (test, ctx->socket_buffer_size);
+
+  start = g_get_monotonic_time ();
+  bench = tp_tests_benchmark_start ();
+
+  consume_payloads (test, ctx->payload_size, n_payloads, ctx->use_fd_list,
+      ctx->use_fd_list);
+
+  elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+  tp_tests_benchmark_stop (bench, test->received);
+
+  g_test_maximized_result (n_payloads / elapsed,
+      "%u %" G_GSIZE_FORMAT "-byte messages in %.3fs", n_payloads,
+      ctx->payload_size, elapsed);
+}
+
 static void
 test_accept_invalidated_before_open (Test *test,
     gconstpointer data G_GNUC_UNUSED)
@@ -513,6 +819,23 @@ main (int argc,
       setup, test_accept, teardown);
   g_test_add ("/dbus-tube/accept-invalidated-before-open", Test, NULL,
       setup, test_accept_invalidated_before_open, teardown);
+  g_test_add ("/dbus-tube/payload", Test, NULL, setup, test_payload,
+      teardown);
+
+  if (g_test_perf ())
+    {
+      guint i;
+
+      for (i = 0; i < G_N_ELEMENTS (benchmark_contexts); i++)
+        {
+          gchar *path = g_strdup_printf ("/dbus-tube/benchmark/%s",
+              benchmark_contexts[i].name);
+
+          g_test_add (path, Test, &benchmark_contexts[i], setup,
+              test_benchmark, teardown);
+          g_free (path);
+        }
+    }
 
   return tp_tests_run_with_bus ();
 }
@@ -11,6 +11,7 @@
 #include "config.h"
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <string.h>
 
 #include <telepathy-glib/file-transfer-channel.h>
@@ -24,6 +25,12 @@
 #include "tests/lib/file-transfer-chan.h"
 #include "tests/lib/stream-tube-chan.h"
 
+#ifdef HAVE_GIO_UNIX
+#include <gio/gunixcredentialsmessage.h>
+#endif
+
+#define BENCHMARK_FILE "/tmp/file-transfer-benchmark"
+
 typedef struct {
     TpSocketAddressType address_type;
     TpSocketAccessControl access_control;
@@ -40,6 +47,18 @@ TestContext contexts[] = {
   { TP_NUM_SOCKET_ADDRESS_TYPES, TP_NUM_SOCKET_ACCESS_CONTROLS }
 };
 
+/* The benchmarks are only run with "-m perf" */
+TestContext benchmark_contexts[] = {
+#ifdef HAVE_GIO_UNIX
+  { TP_SOCKET_ADDRESS_TYPE_UNIX, TP_SOCKET_ACCESS_CONTROL_LOCALHOST },
+  { TP_SOCKET_ADDRESS_TYPE_UNIX, TP_SOCKET_ACCESS_CONTROL_CREDENTIALS },
+#endif
+  { TP_SOCKET_ADDRESS_TYPE_IPV4, TP_SOCKET_ACCESS_CONTROL_LOCALHOST },
+  { TP_SOCKET_ADDRESS_TYPE_IPV4, TP_SOCKET_ACCESS_CONTROL_PORT },
+
+  { TP_NUM_SOCKET_ADDRESS_TYPES, TP_NUM_SOCKET_ACCESS_CONTROLS }
+};
+
 typedef struct {
     GMainLoop *mainloop;
     TpDBusDaemon *dbus;
@@ -54,6 +73,12 @@ typedef struct {
     TpConnection *connection;
     TpFileTransferChannel *channel;
     GIOStream *cm_stream;
+    guint64 received;
+    /* what the CM has read from cm_stream, for read_all_async() */
+    GString *contents;
+    gchar buffer[4096];
+    guint progress_notifies;
+    guint64 last_progress;
 
     GError *error /* initialized where needed */;
     gint wait;
@@ -74,6 +99,16 @@ state_notify_cb (GObject *source,
     g_main_loop_quit (test->mainloop);
 }
 
+static void
+progress_notify_cb (GObject *source,
+    GParamSpec *pspec,
+    Test *test)
+{
+  test->progress_notifies++;
+  test->last_progress = tp_file_transfer_channel_get_transferred_bytes (
+      test->channel);
+}
+
 static void
 channel_prepared_cb (GObject *source,
     GAsyncResult *result,
@@ -120,9 +155,87 @@ file_accept_cb (GObject *source,
     g_main_loop_quit (test->mainloop);
 }
 
+static void
+file_resume_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+  DEBUG ("file_resume_cb reached");
+
+  tp_file_transfer_channel_resume_file_finish (
+      TP_FILE_TRANSFER_CHANNEL (source), result, &test->error);
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+incoming_connection_cb (TpTestsFileTransferChannel *chan,
+    GIOStream *stream,
+    Test *test)
+{
+  tp_clear_object (&test->cm_stream);
+  test->cm_stream = g_object_ref (stream);
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+pump_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+
+  test->received = tp_tests_stream_pump_finish (G_IO_STREAM (source),
+      result, &test->error);
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+read_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+  gssize count;
+
+  count = g_input_stream_read_finish (G_INPUT_STREAM (source), result,
+      &test->error);
+
+  if (count > 0)
+    {
+      g_string_append_len (test->contents, test->buffer, count);
+      g_input_stream_read_async (G_INPUT_STREAM (source), test->buffer,
+          sizeof (test->buffer), G_PRIORITY_DEFAULT, NULL, read_cb, test);
+      return;
+    }
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
 
 /* Internal functions */
 
+/* Read everything from @stream until EOF into test->contents */
+static void
+read_all_async (Test *test,
+    GIOStream *stream)
+{
+  test->contents = g_string_new ("");
+  g_input_stream_read_async (g_io_stream_get_input_stream (stream),
+      test->buffer, sizeof (test->buffer), G_PRIORITY_DEFAULT, NULL,
+      read_cb, test);
+}
+
 static void
 destroy_socket_control_list (gpointer data)
 {
@@ -258,6 +371,9 @@ teardown (Test *test,
   tp_clear_object (&test->chan_service);
   tp_clear_object (&test->cm_stream);
 
+  if (test->contents != NULL)
+    g_string_free (test->contents, TRUE);
+
   tp_tests_connection_assert_disconnect_succeeds (test->connection);
   g_object_unref (test->connection);
   g_object_unref (test->base_connection);
@@ -339,6 +455,23 @@ run_file_transfer_test (const char *test_path,
     }
 }
 
+static void
+run_file_transfer_benchmark (const char *test_path,
+    TestFunc ftest)
+{
+  guint i;
+
+  for (i = 0; benchmark_contexts[i].address_type != TP_NUM_SOCKET_ADDRESS_TYPES;
+      i++)
+    {
+      gchar *path = test_context_to_str (&benchmark_contexts[i], test_path);
+
+      g_test_add (path, Test, GUINT_TO_POINTER (i), setup, ftest, teardown);
+
+      g_free (path);
+    }
+}
+
 
 /* Tests */
 
@@ -485,6 +618,141 @@ test_provide_success (Test *test,
   g_assert (test->cm_stream != NULL);
 }
 
+/* The receiver asks to start part of the way through, for instance to
+ * resume a transfer: only the rest of the file is sent */
+static void
+test_provide_initial_offset (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GFile *file;
+
+  create_file_transfer_channel (test, TRUE, TP_SOCKET_ADDRESS_TYPE_UNIX,
+      TP_SOCKET_ACCESS_CONTROL_LOCALHOST);
+
+  g_file_set_contents ("/tmp/file-transfer-offset", "0123456789", -1, NULL);
+  file = g_file_new_for_path ("/tmp/file-transfer-offset");
+
+  g_signal_connect (test->chan_service, "incoming-connection",
+      G_CALLBACK (incoming_connection_cb), test);
+
+  tp_file_transfer_channel_provide_file_async (test->channel,
+      file, file_provide_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  /* the transfer doesn't open until a while after ProvideFile returns */
+  tp_tests_file_transfer_channel_define_initial_offset (test->chan_service,
+      4);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert (test->cm_stream != NULL);
+  g_assert_cmpuint (
+      tp_file_transfer_channel_get_state (test->channel, NULL), ==,
+      TP_FILE_TRANSFER_STATE_OPEN);
+
+  read_all_async (test, test->cm_stream);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert_cmpstr (test->contents->str, ==, "456789");
+
+  g_assert (tp_proxy_get_invalidated (test->channel) == NULL);
+
+  g_file_delete (file, NULL, NULL);
+  g_object_unref (file);
+}
+
+/* With Credentials access control, we send the CM the byte we gave it in
+ * ProvideFile along with our credentials; the service checks that it
+ * matches */
+static void
+test_provide_credentials (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+#ifdef HAVE_GIO_UNIX
+  GFile *file;
+
+  if (!g_unix_credentials_message_is_supported ())
+    {
+      g_message ("skipped: credentials-passing not supported here");
+      return;
+    }
+
+  create_file_transfer_channel (test, TRUE, TP_SOCKET_ADDRESS_TYPE_UNIX,
+      TP_SOCKET_ACCESS_CONTROL_CREDENTIALS);
+
+  g_file_set_contents ("/tmp/file-transfer-credentials", "0123456789", -1,
+      NULL);
+  file = g_file_new_for_path ("/tmp/file-transfer-credentials");
+
+  g_signal_connect (test->chan_service, "incoming-connection",
+      G_CALLBACK (incoming_connection_cb), test);
+
+  tp_file_transfer_channel_provide_file_async (test->channel,
+      file, file_provide_cb, test);
+
+  /* ProvideFile returns, then we connect once the transfer is open */
+  test->wait = 2;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert (test->cm_stream != NULL);
+
+  read_all_async (test, test->cm_stream);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert_cmpstr (test->contents->str, ==, "0123456789");
+
+  g_file_delete (file, NULL, NULL);
+  g_object_unref (file);
+#else
+  g_message ("skipped: no credentials-passing without GIO Unix support");
+#endif
+}
+
+/* The same when receiving a file: the byte given to AcceptFile is the one
+ * the service checks when we connect */
+static void
+test_accept_credentials (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+#ifdef HAVE_GIO_UNIX
+  GFile *file;
+
+  if (!g_unix_credentials_message_is_supported ())
+    {
+      g_message ("skipped: credentials-passing not supported here");
+      return;
+    }
+
+  create_file_transfer_channel (test, FALSE, TP_SOCKET_ADDRESS_TYPE_UNIX,
+      TP_SOCKET_ACCESS_CONTROL_CREDENTIALS);
+
+  g_signal_connect (test->chan_service, "incoming-connection",
+      G_CALLBACK (incoming_connection_cb), test);
+
+  file = g_file_new_for_uri ("file:///tmp/file-transfer");
+  tp_file_transfer_channel_accept_file_async (test->channel,
+      file, 0, file_accept_cb, test);
+
+  /* AcceptFile returns, then we connect once the transfer is open */
+  test->wait = 2;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert (test->cm_stream != NULL);
+
+  g_object_unref (file);
+#else
+  g_message ("skipped: no credentials-passing without GIO Unix support");
+#endif
+}
+
 static void
 test_cancel_transfer (Test *test,
     gconstpointer data G_GNUC_UNUSED)
@@ -580,6 +848,267 @@ test_accept_outgoing (Test *test, gconstpointer data G_GNUC_UNUSED)
   g_assert_error (test->error, TP_ERROR, TP_ERROR_INVALID_ARGUMENT);
 }
 
+static void
+resume_and_open (Test *test,
+    GFile *file)
+{
+  TpFileTransferStateChangeReason reason;
+
+  create_file_transfer_channel (test, FALSE, TP_SOCKET_ADDRESS_TYPE_UNIX,
+      TP_SOCKET_ACCESS_CONTROL_LOCALHOST);
+
+  tp_file_transfer_channel_resume_file_async (test->channel,
+      file, file_resume_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert_cmpuint (tp_file_transfer_channel_get_state (test->channel, &reason),
+      ==, TP_FILE_TRANSFER_STATE_ACCEPTED);
+
+  g_signal_connect (test->channel, "notify::state",
+      G_CALLBACK (state_notify_cb), test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert_cmpuint (tp_file_transfer_channel_get_state (test->channel, &reason),
+      ==, TP_FILE_TRANSFER_STATE_OPEN);
+}
+
+static void
+test_resume_partial (Test *test, gconstpointer data G_GNUC_UNUSED)
+{
+  GFile *file;
+  guint64 offset;
+  gchar *contents;
+
+  /* A previous transfer was interrupted after 4 bytes */
+  g_file_set_contents ("/tmp/file-transfer-resume", "half", -1, NULL);
+
+  file = g_file_new_for_path ("/tmp/file-transfer-resume");
+  resume_and_open (test, file);
+
+  g_object_get (test->channel,
+      "initial-offset", &offset,
+      NULL);
+  g_assert_cmpuint (offset, ==, 4);
+
+  /* What we already had has been kept */
+  g_assert (g_file_get_contents ("/tmp/file-transfer-resume", &contents,
+        NULL, NULL));
+  g_assert_cmpstr (contents, ==, "half");
+
+  g_free (contents);
+  g_object_unref (file);
+}
+
+static void
+test_resume_missing (Test *test, gconstpointer data G_GNUC_UNUSED)
+{
+  GFile *file;
+  guint64 offset;
+
+  g_unlink ("/tmp/file-transfer-resume");
+
+  file = g_file_new_for_path ("/tmp/file-transfer-resume");
+  resume_and_open (test, file);
+
+  g_object_get (test->channel,
+      "initial-offset", &offset,
+      NULL);
+  g_assert_cmpuint (offset, ==, 0);
+
+  g_assert (g_file_test ("/tmp/file-transfer-resume", G_FILE_TEST_EXISTS));
+
+  g_object_unref (file);
+}
+
+static gboolean
+benchmark_context_supported (TestContext *ctx)
+{
+#ifdef HAVE_GIO_UNIX
+  if (ctx->access_control == TP_SOCKET_ACCESS_CONTROL_CREDENTIALS &&
+      !g_unix_credentials_message_is_supported ())
+    {
+      g_message ("skipped: credentials-passing not supported here");
+      return FALSE;
+    }
+#endif
+
+  return TRUE;
+}
+
+/* Measure how fast we send a file: the CM just reads everything */
+/* Report 100 small steps of progress, then complete the transfer */
+static void
+run_progress_steps (Test *test)
+{
+  TpFileTransferStateChangeReason reason;
+  guint i;
+
+  g_signal_connect (test->channel, "notify::transferred-bytes",
+      G_CALLBACK (progress_notify_cb), test);
+  g_signal_connect (test->channel, "notify::state",
+      G_CALLBACK (state_notify_cb), test);
+
+  for (i = 1; i <= 100; i++)
+    tp_tests_file_transfer_channel_report_progress (test->chan_service,
+        i * 90);
+
+  tp_tests_file_transfer_channel_complete (test->chan_service);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+
+  g_assert_cmpuint (tp_file_transfer_channel_get_state (test->channel,
+        &reason), ==, TP_FILE_TRANSFER_STATE_COMPLETED);
+}
+
+static void
+test_progress_client (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  create_file_transfer_channel (test, FALSE, TP_SOCKET_ADDRESS_TYPE_UNIX,
+      TP_SOCKET_ACCESS_CONTROL_LOCALHOST);
+
+  tp_file_transfer_channel_set_progress_thresholds (test->channel, 60000, 0);
+
+  run_progress_steps (test);
+
+  /* The first step is notified straight away; the rest are held back until
+   * the transfer completes, when the exact total is notified */
+  g_assert_cmpuint (test->progress_notifies, ==, 2);
+  g_assert_cmpuint (test->last_progress, ==, 9000);
+}
+
+static void
+test_progress_service (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  create_file_transfer_channel (test, FALSE, TP_SOCKET_ADDRESS_TYPE_UNIX,
+      TP_SOCKET_ACCESS_CONTROL_LOCALHOST);
+
+  tp_tests_file_transfer_channel_set_progress_thresholds (test->chan_service,
+      60000, 0);
+
+  run_progress_steps (test);
+
+  /* This time it's the CM which only emitted TransferredBytesChanged twice */
+  g_assert_cmpuint (test->progress_notifies, ==, 2);
+  g_assert_cmpuint (test->last_progress, ==, 9000);
+}
+
+static void
+test_benchmark_provide (Test *test,
+    gconstpointer data)
+{
+  TestContext *ctx = &benchmark_contexts[GPOINTER_TO_UINT (data)];
+  guint64 volume = tp_tests_benchmark_get_volume ();
+  TpTestsBenchmark *bench;
+  GFile *file;
+  GFileOutputStream *out;
+
+  if (!benchmark_context_supported (ctx))
+    return;
+
+  create_file_transfer_channel (test, TRUE, ctx->address_type,
+      ctx->access_control);
+
+  /* A sparse file, so that we measure the socket side rather than the
+   * disk */
+  file = g_file_new_for_path (BENCHMARK_FILE);
+  out = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL,
+      &test->error);
+  g_assert_no_error (test->error);
+  g_seekable_truncate (G_SEEKABLE (out), volume, NULL, &test->error);
+  g_assert_no_error (test->error);
+  g_output_stream_close (G_OUTPUT_STREAM (out), NULL, &test->error);
+  g_assert_no_error (test->error);
+  g_object_unref (out);
+
+  g_signal_connect (test->chan_service, "incoming-connection",
+      G_CALLBACK (incoming_connection_cb), test);
+
+  tp_file_transfer_channel_provide_file_async (test->channel,
+      file, file_provide_cb, test);
+
+  /* ProvideFile returns, then we connect once the transfer is open */
+  test->wait = 2;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert (test->cm_stream != NULL);
+
+  bench = tp_tests_benchmark_start ();
+
+  tp_tests_stream_pump_async (test->cm_stream, 0, pump_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+
+  tp_tests_benchmark_stop (bench, volume);
+
+  g_assert_no_error (test->error);
+  g_assert_cmpuint (test->received, ==, volume);
+
+  g_file_delete (file, NULL, NULL);
+  g_object_unref (file);
+}
+
+/* Measure how fast we receive a file: the CM writes as fast as it can */
+static void
+test_benchmark_accept (Test *test,
+    gconstpointer data)
+{
+  TestContext *ctx = &benchmark_contexts[GPOINTER_TO_UINT (data)];
+  guint64 volume = tp_tests_benchmark_get_volume ();
+  TpTestsBenchmark *bench;
+  GFile *file;
+  GFileInfo *info;
+
+  if (!benchmark_context_supported (ctx))
+    return;
+
+  create_file_transfer_channel (test, FALSE, ctx->address_type,
+      ctx->access_control);
+
+  g_signal_connect (test->chan_service, "incoming-connection",
+      G_CALLBACK (incoming_connection_cb), test);
+
+  file = g_file_new_for_path (BENCHMARK_FILE);
+  tp_file_transfer_channel_accept_file_async (test->channel,
+      file, 0, file_accept_cb, test);
+
+  test->wait = 2;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert (test->cm_stream != NULL);
+
+  bench = tp_tests_benchmark_start ();
+
+  /* We get EOF once the file has been written and closed */
+  tp_tests_stream_pump_async (test->cm_stream, volume, pump_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+
+  tp_tests_benchmark_stop (bench, volume);
+
+  g_assert_no_error (test->error);
+  g_assert_cmpuint (test->received, ==, 0);
+
+  info = g_file_query_info (file, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+      G_FILE_QUERY_INFO_NONE, NULL, &test->error);
+  g_assert_no_error (test->error);
+  g_assert_cmpuint (g_file_info_get_size (info), ==, volume);
+
+  g_object_unref (info);
+  g_file_delete (file, NULL, NULL);
+  g_object_unref (file);
+}
+
 int
 main (int argc,
       char **argv)
@@ -610,8 +1139,30 @@ main (int argc,
       test_accept_twice, teardown);
   g_test_add ("/file-transfer-channel/accept/outgoing", Test, NULL, setup,
       test_accept_outgoing, teardown);
+  g_test_add ("/file-transfer-channel/resume/partial", Test, NULL, setup,
+      test_resume_partial, teardown);
+  g_test_add ("/file-transfer-channel/resume/missing", Test, NULL, setup,
+      test_resume_missing, teardown);
+  g_test_add ("/file-transfer-channel/provide/initial-offset", Test, NULL,
+      setup, test_provide_initial_offset, teardown);
+  g_test_add ("/file-transfer-channel/provide/credentials", Test, NULL,
+      setup, test_provide_credentials, teardown);
+  g_test_add ("/file-transfer-channel/accept/credentials", Test, NULL,
+      setup, test_accept_credentials, teardown);
   g_test_add ("/file-transfer-channel/provide/cancel", Test, NULL, setup,
       test_cancel_transfer, teardown);
+  g_test_add ("/file-transfer-channel/progress/client", Test, NULL, setup,
+      test_progress_client, teardown);
+  g_test_add ("/file-transfer-channel/progress/service", Test, NULL, setup,
+      test_progress_service, teardown);
+
+  if (g_test_perf ())
+    {
+      run_file_transfer_benchmark ("/file-transfer-channel/benchmark/provide",
+          test_benchmark_provide);
+      run_file_transfer_benchmark ("/file-transfer-channel/benchmark/accept",
+          test_benchmark_accept);
+    }
 
   return tp_tests_run_with_bus ();
 }
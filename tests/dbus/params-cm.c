@@ -205,6 +205,64 @@ test_defaults (Test *test,
   g_hash_table_unref (parameters);
 }
 
+static void
+test_defaults_reused (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GHashTable *parameters;
+  TpTestsCMParams *params;
+  guint i;
+
+  parameters = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+      (GDestroyNotify) tp_g_value_slice_free);
+  g_hash_table_insert (parameters, "a-boolean",
+      tp_g_value_slice_new_boolean (FALSE));
+
+  /* The defaults are computed once per protocol and copied into each
+   * request, so overriding one, or the CM freeing its copy, must not
+   * affect later requests. */
+  for (i = 0; i < 3; i++)
+    {
+      if (i == 1)
+        {
+          g_hash_table_insert (parameters, "a-string",
+              tp_g_value_slice_new_static_string ("not the default"));
+          g_hash_table_insert (parameters, "a-int16",
+              tp_g_value_slice_new_int (23));
+        }
+      else if (i == 2)
+        {
+          g_hash_table_remove (parameters, "a-string");
+          g_hash_table_remove (parameters, "a-int16");
+        }
+
+      tp_cli_connection_manager_run_request_connection (test->cm, -1,
+          "example", parameters, NULL, NULL, &test->error, NULL);
+      g_assert (test->error != NULL);
+      g_assert_cmpint (test->error->code, ==, TP_ERROR_NOT_IMPLEMENTED);
+      g_clear_error (&test->error);
+
+      params = tp_tests_param_connection_manager_steal_params_last_conn ();
+      g_assert (params->would_have_been_freed);
+
+      if (i == 1)
+        {
+          g_assert_cmpstr (params->a_string, ==, "not the default");
+          g_assert_cmpint (params->a_int16, ==, 23);
+        }
+      else
+        {
+          g_assert_cmpstr (params->a_string, ==, "the default string");
+          g_assert_cmpint (params->a_int16, ==, 42);
+        }
+
+      g_assert_cmpint (params->a_int32, ==, 42);
+      tp_tests_param_connection_manager_free_params (params);
+    }
+
+  g_hash_table_unref (parameters);
+}
+
 static void
 test_missing_required (Test *test,
     gconstpointer data G_GNUC_UNUSED)
@@ -350,6 +408,8 @@ main (int argc,
       teardown);
   g_test_add ("/params-cm/defaults", Test, NULL, setup, test_defaults,
       teardown);
+  g_test_add ("/params-cm/defaults-reused", Test, NULL, setup,
+      test_defaults_reused, teardown);
   g_test_add ("/params-cm/fail-filter", Test, NULL, setup, test_fail_filter,
       teardown);
   g_test_add ("/params-cm/missing-required", Test, NULL, setup,
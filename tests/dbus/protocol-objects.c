@@ -18,6 +18,7 @@
 #include "examples/cm/echo-message-parts/connection-manager.h"
 #include "examples/cm/echo-message-parts/chan.h"
 #include "examples/cm/echo-message-parts/conn.h"
+#include "examples/cm/echo-message-parts/protocol.h"
 
 #include "tests/lib/util.h"
 
@@ -323,6 +324,75 @@ test_protocols_property (Test *test,
   g_assert_cmpuint (arr->len, >=, 1);
 }
 
+static void
+test_protocol_properties_cached (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpBaseProtocol *protocol;
+  GHashTable *first, *second;
+  GHashTable *properties = NULL;
+  GHashTable *protocols;
+  GHashTable *pp;
+
+  protocol = g_object_new (EXAMPLE_TYPE_ECHO_2_PROTOCOL,
+      "name", "example",
+      NULL);
+
+  /* each caller gets its own copy, which it may modify without affecting
+   * anyone else; as documented, tp_asv_set_*() must not be used on it */
+  first = tp_base_protocol_get_immutable_properties (protocol);
+  g_assert_cmpstr (tp_asv_get_string (first, TP_PROP_PROTOCOL_ENGLISH_NAME),
+      ==, "Echo II example");
+  g_hash_table_insert (first, g_strdup (TP_PROP_PROTOCOL_ENGLISH_NAME),
+      tp_g_value_slice_new_static_string ("Mangled"));
+  g_hash_table_remove (first, TP_PROP_PROTOCOL_ICON);
+
+  second = tp_base_protocol_get_immutable_properties (protocol);
+  g_assert (second != first);
+  g_assert_cmpstr (tp_asv_get_string (second, TP_PROP_PROTOCOL_ENGLISH_NAME),
+      ==, "Echo II example");
+  g_assert_cmpstr (tp_asv_get_string (second, TP_PROP_PROTOCOL_ICON), ==,
+      "im-icq");
+  g_assert (tp_asv_get_boxed (second, TP_PROP_PROTOCOL_PARAMETERS,
+        TP_ARRAY_TYPE_PARAM_SPEC_LIST) != NULL);
+
+  g_hash_table_unref (first);
+  g_hash_table_unref (second);
+  g_object_unref (protocol);
+
+  /* the CM's Protocols property is built from the cache: each protocol's
+   * table is the same one every time, not rebuilt */
+  g_object_get (test->service_cm,
+      "protocols", &first,
+      NULL);
+  g_object_get (test->service_cm,
+      "protocols", &second,
+      NULL);
+  g_assert (first != second);
+  g_assert (g_hash_table_lookup (first, "example") != NULL);
+  g_assert (g_hash_table_lookup (first, "example") ==
+      g_hash_table_lookup (second, "example"));
+  g_hash_table_unref (first);
+  g_hash_table_unref (second);
+
+  /* ... and is still right when read over D-Bus */
+  tp_cli_dbus_properties_run_get_all (test->cm, -1,
+      TP_IFACE_CONNECTION_MANAGER, &properties, &test->error, NULL);
+  g_assert_no_error (test->error);
+
+  protocols = tp_asv_get_boxed (properties, "Protocols",
+      TP_HASH_TYPE_PROTOCOL_PROPERTIES_MAP);
+  g_assert (protocols != NULL);
+  pp = g_hash_table_lookup (protocols, "example");
+  g_assert (pp != NULL);
+  g_assert_cmpstr (tp_asv_get_string (pp, TP_PROP_PROTOCOL_ENGLISH_NAME), ==,
+      "Echo II example");
+  g_assert_cmpstr (tp_asv_get_string (pp, TP_PROP_PROTOCOL_ICON), ==,
+      "im-icq");
+
+  g_hash_table_unref (properties);
+}
+
 static void
 test_protocols_property_old (Test *test,
     gconstpointer data G_GNUC_UNUSED)
@@ -702,6 +772,31 @@ test_id (Test *test,
   g_clear_object (&result);
   g_clear_error (&test->error);
 
+  /* wrong type */
+  tp_protocol_identify_account_async (test->protocol,
+      g_variant_new_parsed ("{ 'account': <42> }"),
+      NULL, tp_tests_result_ready_cb, &result);
+  tp_tests_run_until_result (&result);
+  s = tp_protocol_identify_account_finish (test->protocol, result,
+      &test->error);
+  g_assert_error (test->error, TP_ERROR, TP_ERROR_INVALID_ARGUMENT);
+  g_assert_cmpstr (s, ==, NULL);
+  g_clear_object (&result);
+  g_clear_error (&test->error);
+
+  /* the parameters are only checked against the compiled specs, so a
+   * valid request after some invalid ones still works */
+  tp_protocol_identify_account_async (test->protocol,
+      g_variant_new_parsed ("{ 'account': <'World'> }"),
+      NULL, tp_tests_result_ready_cb, &result);
+  tp_tests_run_until_result (&result);
+  s = tp_protocol_identify_account_finish (test->protocol, result,
+      &test->error);
+  g_assert_no_error (test->error);
+  g_assert_cmpstr (s, ==, "world");
+  g_clear_object (&result);
+  g_free (s);
+
   tp_protocol_identify_account_async (test->protocol,
       g_variant_new_parsed ("@a{sv} {}"),
       NULL, tp_tests_result_ready_cb, &result);
@@ -740,6 +835,8 @@ main (int argc,
       setup, test_protocol_addressing_properties, teardown);
   g_test_add ("/protocol-objects/protocols-property", Test, NULL, setup,
       test_protocols_property, teardown);
+  g_test_add ("/protocol-objects/protocol-properties-cached", Test, NULL,
+      setup, test_protocol_properties_cached, teardown);
   g_test_add ("/protocol-objects/protocols-property-old", Test, NULL, setup,
       test_protocols_property_old, teardown);
   g_test_add ("/protocol-objects/object", Test, NULL, setup,
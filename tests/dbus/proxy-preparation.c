@@ -10,6 +10,7 @@
 #include "config.h"
 
 #include <telepathy-glib/telepathy-glib.h>
+#include <telepathy-glib/proxy-internal.h>
 
 #include "tests/lib/util.h"
 #include "tests/lib/simple-account.h"
@@ -148,6 +149,58 @@ test_depends (Test *test,
         TP_TESTS_MY_CONN_PROXY_FEATURE_A));
   g_assert (tp_proxy_is_prepared (test->my_conn,
         TP_TESTS_MY_CONN_PROXY_FEATURE_B));
+
+  /* Each of them was timed; features nobody asked for were not */
+  g_assert_cmpint (_tp_proxy_get_feature_prepare_time (
+        (TpProxy *) test->my_conn, TP_TESTS_MY_CONN_PROXY_FEATURE_A), >=, 0);
+  g_assert_cmpint (_tp_proxy_get_feature_prepare_time (
+        (TpProxy *) test->my_conn, TP_TESTS_MY_CONN_PROXY_FEATURE_B), >=, 0);
+  g_assert_cmpint (_tp_proxy_get_feature_prepare_time (
+        (TpProxy *) test->my_conn, TP_TESTS_MY_CONN_PROXY_FEATURE_FAIL), ==,
+      -1);
+}
+
+/* Lots of requests waiting for the same features, some of them more than
+ * once, all finish as those features do */
+static void
+test_many_requests (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GQuark a[] = { TP_TESTS_MY_CONN_PROXY_FEATURE_A, 0 };
+  GQuark b_and_fail[] = { TP_TESTS_MY_CONN_PROXY_FEATURE_B,
+      TP_TESTS_MY_CONN_PROXY_FEATURE_FAIL, 0 };
+  GQuark twice[] = { TP_TESTS_MY_CONN_PROXY_FEATURE_A,
+      TP_TESTS_MY_CONN_PROXY_FEATURE_B, TP_TESTS_MY_CONN_PROXY_FEATURE_A, 0 };
+  /* NULL means just the core features */
+  const GQuark *requests[] = { a, b_and_fail, twice, NULL };
+  guint i;
+
+  test->wait = 0;
+
+  for (i = 0; i < 30; i++)
+    {
+      tp_proxy_prepare_async (test->my_conn,
+          requests[i % G_N_ELEMENTS (requests)], prepare_cb, test);
+      test->wait++;
+    }
+
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert_cmpint (test->wait, ==, 0);
+
+  g_assert (tp_proxy_is_prepared (test->my_conn,
+        TP_TESTS_MY_CONN_PROXY_FEATURE_A));
+  g_assert (tp_proxy_is_prepared (test->my_conn,
+        TP_TESTS_MY_CONN_PROXY_FEATURE_B));
+  g_assert (!tp_proxy_is_prepared (test->my_conn,
+        TP_TESTS_MY_CONN_PROXY_FEATURE_FAIL));
+
+  /* A request for features which have already finished, one way or
+   * another, has nothing to wait for */
+  tp_proxy_prepare_async (test->my_conn, b_and_fail, prepare_cb, test);
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
 }
 
 static void
@@ -405,6 +458,39 @@ test_interface_later (Test *test,
         TP_TESTS_MY_CONN_PROXY_FEATURE_INTERFACE_LATER));
 }
 
+static void
+test_feature_graph_shared (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  TpTestsMyConnProxy *other;
+  GQuark features[] = { TP_TESTS_MY_CONN_PROXY_FEATURE_CORE, 0 };
+  gconstpointer graph;
+
+  graph = _tp_proxy_get_feature_graph ((TpProxy *) test->my_conn);
+  g_assert (graph != NULL);
+
+  /* A second proxy of the same class reuses the graph built for the first
+   * one, rather than building (and leaking) a new one */
+  other = g_object_new (TP_TESTS_TYPE_MY_CONN_PROXY,
+      "dbus-daemon", test->dbus,
+      "bus-name", tp_proxy_get_bus_name (test->connection),
+      "object-path", tp_proxy_get_object_path (test->connection),
+      NULL);
+
+  g_assert (_tp_proxy_get_feature_graph ((TpProxy *) other) == graph);
+
+  /* Looking features up while preparing doesn't replace it either */
+  tp_proxy_prepare_async (other, features, prepare_cb, test);
+
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_assert (_tp_proxy_get_feature_graph ((TpProxy *) other) == graph);
+  g_assert (_tp_proxy_get_feature_graph ((TpProxy *) test->my_conn) == graph);
+
+  g_object_unref (other);
+}
+
 int
 main (int argc,
       char **argv)
@@ -418,6 +504,8 @@ main (int argc,
       test_prepare_core, teardown);
   g_test_add ("/proxy-preparation/depends", Test, NULL, setup,
       test_depends, teardown);
+  g_test_add ("/proxy-preparation/many-requests", Test, NULL, setup,
+      test_many_requests, teardown);
   g_test_add ("/proxy-preparation/wrong-iface", Test, NULL, setup,
       test_wrong_iface, teardown);
   g_test_add ("/proxy-preparation/bad-dep", Test, NULL, setup,
@@ -434,6 +522,8 @@ main (int argc,
       test_before_connected, teardown);
   g_test_add ("/proxy-preparation/interface-later", Test, NULL, setup,
       test_interface_later, teardown);
+  g_test_add ("/proxy-preparation/feature-graph-shared", Test, NULL, setup,
+      test_feature_graph_shared, teardown);
 
   return tp_tests_run_with_bus ();
 }
@@ -0,0 +1,273 @@
+/* Tests for TpProxy signal connections
+ *
+ * Copyright (C) 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * Copying and distribution of this file, with or without modification,
+ * are permitted in any medium without royalty provided the copyright
+ * notice and this notice are preserved.
+ */
+
+#include "config.h"
+
+#include <telepathy-glib/telepathy-glib.h>
+#include <telepathy-glib/telepathy-glib-dbus.h>
+
+#include <dbus/dbus.h>
+#include <dbus/dbus-glib.h>
+#include <dbus/dbus-glib-lowlevel.h>
+
+#include "tests/lib/util.h"
+
+#define WELL_KNOWN_NAME "com.example.ProxySignals"
+#define OBJECT_PATH "/com/example/ProxySignals"
+
+typedef struct {
+    GMainLoop *mainloop;
+    TpDBusDaemon *dbus;
+
+    /* the "service": we send signals from here by hand */
+    DBusGConnection *private_conn;
+    TpDBusDaemon *private_dbus;
+
+    TpProxy *proxy;
+    TpProxySignalConnection *sc;
+
+    guint changed;
+    GError *error /* initialized where needed */;
+} Test;
+
+static void
+setup (Test *test,
+       gconstpointer data)
+{
+  DBusConnection *libdbus;
+
+  tp_debug_set_flags ("all");
+
+  test->mainloop = g_main_loop_new (NULL, FALSE);
+  test->dbus = tp_tests_dbus_daemon_dup_or_die ();
+
+  libdbus = dbus_bus_get_private (DBUS_BUS_STARTER, NULL);
+  g_assert (libdbus != NULL);
+  dbus_connection_setup_with_g_main (libdbus, NULL);
+  dbus_connection_set_exit_on_disconnect (libdbus, FALSE);
+  test->private_conn = dbus_connection_get_g_connection (libdbus);
+  /* transfer ref */
+  dbus_g_connection_ref (test->private_conn);
+  dbus_connection_unref (libdbus);
+  g_assert (test->private_conn != NULL);
+  test->private_dbus = tp_dbus_daemon_new (test->private_conn);
+  g_assert (test->private_dbus != NULL);
+
+  test->proxy = NULL;
+  test->sc = NULL;
+  test->changed = 0;
+  test->error = NULL;
+}
+
+static void
+close_private_conn (Test *test)
+{
+  dbus_connection_close (dbus_g_connection_get_connection (
+        test->private_conn));
+  dbus_g_connection_unref (test->private_conn);
+  test->private_conn = NULL;
+}
+
+static void
+teardown (Test *test,
+          gconstpointer data)
+{
+  if (test->sc != NULL)
+    tp_proxy_signal_connection_disconnect (test->sc);
+
+  tp_clear_object (&test->proxy);
+  tp_clear_object (&test->private_dbus);
+
+  if (test->private_conn != NULL)
+    close_private_conn (test);
+
+  /* make sure any pending things have happened */
+  tp_tests_proxy_run_until_dbus_queue_processed (test->dbus);
+
+  tp_clear_object (&test->dbus);
+  g_main_loop_unref (test->mainloop);
+  test->mainloop = NULL;
+}
+
+static void
+properties_changed_cb (TpProxy *proxy,
+    const gchar *interface_name,
+    GHashTable *changed_properties,
+    const gchar **invalidated_properties,
+    gpointer user_data,
+    GObject *weak_object)
+{
+  Test *test = user_data;
+
+  g_assert (proxy == test->proxy);
+  g_assert_cmpstr (interface_name, ==, "com.example.Interface");
+  g_assert_cmpuint (g_hash_table_size (changed_properties), ==, 0);
+  g_assert (invalidated_properties != NULL);
+  g_assert (invalidated_properties[0] == NULL);
+
+  test->changed++;
+}
+
+static void
+make_proxy (Test *test,
+    const gchar *bus_name)
+{
+  test->proxy = TP_PROXY (tp_tests_object_new_static_class (TP_TYPE_PROXY,
+      "dbus-daemon", test->dbus,
+      "bus-name", bus_name,
+      "object-path", OBJECT_PATH,
+      NULL));
+
+  /* connect to a signal without ever calling a method, so the proxy never
+   * needs a DBusGProxy */
+  test->sc = tp_cli_dbus_properties_connect_to_properties_changed (
+      test->proxy, properties_changed_cb, test, NULL, NULL, &test->error);
+  g_assert_no_error (test->error);
+  g_assert (test->sc != NULL);
+
+  /* make sure the match rules have been added */
+  tp_tests_proxy_run_until_dbus_queue_processed (test->dbus);
+}
+
+/* Send PropertiesChanged from the "service", with either the right
+ * arguments or a single uint32 */
+static void
+emit_properties_changed (Test *test,
+    gboolean well_formed)
+{
+  DBusConnection *libdbus = dbus_g_connection_get_connection (
+      test->private_conn);
+  DBusMessage *message;
+  DBusMessageIter iter, sub;
+
+  message = dbus_message_new_signal (OBJECT_PATH, TP_IFACE_DBUS_PROPERTIES,
+      "PropertiesChanged");
+  g_assert (message != NULL);
+  dbus_message_iter_init_append (message, &iter);
+
+  if (well_formed)
+    {
+      const gchar *iface = "com.example.Interface";
+
+      g_assert (dbus_message_iter_append_basic (&iter, DBUS_TYPE_STRING,
+            &iface));
+      g_assert (dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+            "{sv}", &sub));
+      g_assert (dbus_message_iter_close_container (&iter, &sub));
+      g_assert (dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+            "s", &sub));
+      g_assert (dbus_message_iter_close_container (&iter, &sub));
+    }
+  else
+    {
+      dbus_uint32_t u = 42;
+
+      g_assert (dbus_message_iter_append_basic (&iter, DBUS_TYPE_UINT32, &u));
+    }
+
+  g_assert (dbus_connection_send (libdbus, message, NULL));
+  dbus_connection_flush (libdbus);
+  dbus_message_unref (message);
+}
+
+static void
+wait_for_changed (Test *test,
+    guint n)
+{
+  while (test->changed < n)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (test->changed, ==, n);
+}
+
+static void
+test_unique_name (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  make_proxy (test, tp_dbus_daemon_get_unique_name (test->private_dbus));
+
+  emit_properties_changed (test, TRUE);
+  wait_for_changed (test, 1);
+
+  emit_properties_changed (test, TRUE);
+  wait_for_changed (test, 2);
+}
+
+static void
+test_unexpected_args (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  make_proxy (test, tp_dbus_daemon_get_unique_name (test->private_dbus));
+
+  /* A signal with the wrong arguments is dropped, but doesn't break the
+   * signal connection: messages from one connection arrive in order, so
+   * once we've seen the second signal, we'd have seen the first */
+  emit_properties_changed (test, FALSE);
+  emit_properties_changed (test, TRUE);
+  wait_for_changed (test, 1);
+  tp_tests_proxy_run_until_dbus_queue_processed (test->dbus);
+  g_assert_cmpuint (test->changed, ==, 1);
+  g_assert (tp_proxy_get_invalidated (test->proxy) == NULL);
+}
+
+static void
+test_service_exit (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  make_proxy (test, tp_dbus_daemon_get_unique_name (test->private_dbus));
+  g_assert (tp_proxy_get_invalidated (test->proxy) == NULL);
+
+  close_private_conn (test);
+
+  while (tp_proxy_get_invalidated (test->proxy) == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_error (tp_proxy_get_invalidated (test->proxy), TP_DBUS_ERRORS,
+      TP_DBUS_ERROR_NAME_OWNER_LOST);
+
+  /* the signal connection went away with the proxy */
+  test->sc = NULL;
+  g_assert_cmpuint (test->changed, ==, 0);
+}
+
+static void
+test_well_known_name (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  g_assert (tp_dbus_daemon_request_name (test->private_dbus,
+        WELL_KNOWN_NAME, FALSE, &test->error));
+  g_assert_no_error (test->error);
+
+  /* this goes through dbus-glib, which tracks the owner for us */
+  make_proxy (test, WELL_KNOWN_NAME);
+
+  emit_properties_changed (test, TRUE);
+  wait_for_changed (test, 1);
+
+  tp_dbus_daemon_release_name (test->private_dbus, WELL_KNOWN_NAME, NULL);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  tp_tests_init (&argc, &argv);
+  g_test_bug_base ("http://bugs.freedesktop.org/show_bug.cgi?id=");
+
+  g_test_add ("/proxy-signals/unique-name", Test, NULL, setup,
+      test_unique_name, teardown);
+  g_test_add ("/proxy-signals/unexpected-args", Test, NULL, setup,
+      test_unexpected_args, teardown);
+  g_test_add ("/proxy-signals/service-exit", Test, NULL, setup,
+      test_service_exit, teardown);
+  g_test_add ("/proxy-signals/well-known-name", Test, NULL, setup,
+      test_well_known_name, teardown);
+
+  return tp_tests_run_with_bus ();
+}
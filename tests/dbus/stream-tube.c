@@ -9,12 +9,14 @@
 
 #include "config.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <telepathy-glib/stream-tube-channel.h>
 #include <telepathy-glib/debug.h>
 #include <telepathy-glib/defs.h>
 #include <telepathy-glib/dbus.h>
+#include <telepathy-glib/util-internal.h>
 
 #include "tests/lib/util.h"
 #include "tests/lib/simple-conn.h"
@@ -23,6 +25,7 @@
 #ifdef HAVE_GIO_UNIX
 #include <gio/gio.h>
 #include <gio/gunixcredentialsmessage.h>
+#include <gio/gunixsocketaddress.h>
 #endif
 
 #define BUFFER_SIZE 128
@@ -74,6 +77,16 @@ typedef struct {
     TpStreamTubeConnection *tube_conn;
     GIOStream *cm_stream;
 
+    /* The local service connections are forwarded to */
+    GIOStream *local_stream;
+
+    /* Used by the benchmark */
+    guint64 received;
+
+    /* Used by the stress test */
+    GPtrArray *tube_conns;
+    GPtrArray *cm_streams;
+
     GError *error /* initialized where needed */;
     gint wait;
 } Test;
@@ -106,6 +119,9 @@ teardown (Test *test,
   tp_clear_object (&test->tube);
   tp_clear_object (&test->tube_conn);
   tp_clear_object (&test->cm_stream);
+  tp_clear_object (&test->local_stream);
+  tp_clear_pointer (&test->tube_conns, g_ptr_array_unref);
+  tp_clear_pointer (&test->cm_streams, g_ptr_array_unref);
 
   tp_tests_connection_assert_disconnect_succeeds (test->connection);
   g_object_unref (test->connection);
@@ -138,16 +154,14 @@ create_supported_socket_types_hash (TpSocketAddressType address_type,
 }
 
 static void
-create_tube_service (Test *test,
+create_tube_service_with_sockets (Test *test,
     gboolean requested,
-    TpSocketAddressType address_type,
-    TpSocketAccessControl access_control,
+    GHashTable *sockets,
     gboolean contact)
 {
   gchar *chan_path;
   TpHandle handle, alf_handle;
   GHashTable *props;
-  GHashTable *sockets;
   GType type;
 
   tp_clear_object (&test->tube_chan_service);
@@ -181,8 +195,6 @@ create_tube_service (Test *test,
   alf_handle = tp_handle_ensure (test->contact_repo, "alf", NULL, &test->error);
   g_assert_no_error (test->error);
 
-  sockets = create_supported_socket_types_hash (address_type, access_control);
-
   test->tube_chan_service = g_object_new (
       type,
       "connection", test->base_connection,
@@ -203,7 +215,6 @@ create_tube_service (Test *test,
 
   g_free (chan_path);
   g_hash_table_unref (props);
-  g_hash_table_unref (sockets);
 
   if (contact)
     tp_handle_unref (test->contact_repo, handle);
@@ -211,6 +222,20 @@ create_tube_service (Test *test,
     tp_handle_unref (test->room_repo, handle);
 }
 
+static void
+create_tube_service (Test *test,
+    gboolean requested,
+    TpSocketAddressType address_type,
+    TpSocketAccessControl access_control,
+    gboolean contact)
+{
+  GHashTable *sockets;
+
+  sockets = create_supported_socket_types_hash (address_type, access_control);
+  create_tube_service_with_sockets (test, requested, sockets, contact);
+  g_hash_table_unref (sockets);
+}
+
 /* Test Basis */
 
 static void
@@ -500,6 +525,46 @@ test_accept_success (Test *test,
   g_assert_error (test->error, TP_ERROR, TP_ERROR_DISCONNECTED);
 }
 
+static void
+test_accept_pooled (Test *test,
+    gconstpointer data)
+{
+  /* The first tube we accept uses a new socket, and leaves spare ones for
+   * later tubes */
+  guint i = GPOINTER_TO_UINT (data);
+  GSocket *spare;
+  GSocketConnection *conn;
+
+  tp_set_client_socket_pool_size (2);
+
+  test_accept_success (test, data);
+  g_clear_error (&test->error);
+
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+
+  spare = _tp_dup_spare_client_socket (contexts[i].address_type);
+
+  /* skipped, as in test_accept_success() */
+  if (test->tube_conn == NULL)
+    {
+      g_assert (spare == NULL);
+      tp_set_client_socket_pool_size (0);
+      return;
+    }
+
+  g_assert (spare != NULL);
+
+  test_accept_success (test, data);
+
+  /* the second tube is connected through the spare socket */
+  conn = tp_stream_tube_connection_get_socket_connection (test->tube_conn);
+  g_assert (g_socket_connection_get_socket (conn) == spare);
+  g_object_unref (spare);
+
+  tp_set_client_socket_pool_size (0);
+}
+
 static void
 tube_offer_cb (GObject *source,
     GAsyncResult *result,
@@ -761,6 +826,28 @@ run_tube_test (const char *test_path,
     }
 }
 
+/* The data path doesn't depend on who the tube is with, and IPv6 behaves
+ * like IPv4, so only benchmark the Unix and IPv4 contact tubes */
+static void
+run_tube_benchmark (const char *test_path,
+    TestFunc ftest)
+{
+  guint i;
+
+  for (i = 0; contexts[i].address_type != TP_NUM_SOCKET_ADDRESS_TYPES; i++)
+    {
+      gchar *path;
+
+      if (!contexts[i].contact ||
+          contexts[i].address_type == TP_SOCKET_ADDRESS_TYPE_IPV6)
+        continue;
+
+      path = test_context_to_str (&contexts[i], test_path);
+      g_test_add (path, Test, GUINT_TO_POINTER (i), setup, ftest, teardown);
+      g_free (path);
+    }
+}
+
 static void
 wait_tube_conn (Test *test,
     GIOStream **alice_stream,
@@ -903,6 +990,179 @@ test_offer_race (Test *test,
   g_object_unref (bob_cm_stream);
 }
 
+static void
+stress_socket_connected (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+  GSocketConnection *conn;
+
+  conn = g_socket_client_connect_finish (G_SOCKET_CLIENT (source), result,
+      &test->error);
+  g_assert_no_error (test->error);
+
+  g_ptr_array_add (test->cm_streams, conn);
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+stress_incoming_cb (TpStreamTubeChannel *tube,
+    TpStreamTubeConnection *tube_conn,
+    Test *test)
+{
+  g_ptr_array_add (test->tube_conns, g_object_ref (tube_conn));
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static guint16
+get_port (GSocketConnection *conn,
+    gboolean local)
+{
+  GSocketAddress *address;
+  guint16 port;
+  GError *error = NULL;
+
+  if (local)
+    address = g_socket_connection_get_local_address (conn, &error);
+  else
+    address = g_socket_connection_get_remote_address (conn, &error);
+
+  g_assert_no_error (error);
+
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (address));
+  g_object_unref (address);
+  return port;
+}
+
+#define STRESS_CONNECTIONS 200
+
+static void
+test_offer_stress (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  /* Lots of clients connect to a room tube we offered, and the CM announces
+   * them in the reverse order. */
+  guint i = GPOINTER_TO_UINT (data);
+  GSocketAddress *address;
+  GSocketClient *client;
+  TpHandle handles[STRESS_CONNECTIONS];
+  gboolean seen[STRESS_CONNECTIONS] = { FALSE, };
+  guint n;
+
+  if (contexts[i].address_type == TP_SOCKET_ADDRESS_TYPE_UNIX &&
+      contexts[i].access_control == TP_SOCKET_ACCESS_CONTROL_CREDENTIALS &&
+      !have_creds)
+    {
+      g_message ("skipped: credentials-passing not supported here");
+      return;
+    }
+
+  if (contexts[i].address_type == TP_SOCKET_ADDRESS_TYPE_IPV6 &&
+      !have_ipv6)
+    {
+      g_message ("skipped: IPv6 not supported here");
+      return;
+    }
+
+  /* Same restrictions as the race test: we need to be able to tell
+   * connections apart */
+  if (contexts[i].contact)
+    return;
+
+  if (contexts[i].access_control != TP_SOCKET_ACCESS_CONTROL_PORT &&
+      contexts[i].access_control != TP_SOCKET_ACCESS_CONTROL_CREDENTIALS)
+    return;
+
+  create_tube_service (test, TRUE, contexts[i].address_type,
+      contexts[i].access_control, contexts[i].contact);
+
+  tp_stream_tube_channel_offer_async (test->tube, NULL, tube_offer_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  test->tube_conns = g_ptr_array_new_with_free_func (g_object_unref);
+  test->cm_streams = g_ptr_array_new_with_free_func (g_object_unref);
+
+  g_signal_connect (test->tube, "incoming",
+      G_CALLBACK (stress_incoming_cb), test);
+
+  address = tp_tests_stream_tube_channel_get_server_address (
+      test->tube_chan_service);
+  g_assert (address != NULL);
+
+  client = g_socket_client_new ();
+
+  /* Connect one at a time so we don't overflow the listen backlog; they are
+   * all waiting to be identified anyway. */
+  for (n = 0; n < STRESS_CONNECTIONS; n++)
+    {
+      g_socket_client_connect_async (client, G_SOCKET_CONNECTABLE (address),
+          NULL, stress_socket_connected, test);
+
+      test->wait = 1;
+      g_main_loop_run (test->mainloop);
+    }
+
+  g_object_unref (client);
+  g_object_unref (address);
+
+  g_assert_cmpuint (test->cm_streams->len, ==, STRESS_CONNECTIONS);
+
+  for (n = STRESS_CONNECTIONS; n > 0; n--)
+    {
+      gchar *id = g_strdup_printf ("contact%u", n - 1);
+
+      handles[n - 1] = tp_handle_ensure (test->contact_repo, id, NULL, NULL);
+      g_free (id);
+
+      tp_tests_stream_tube_channel_peer_connected (test->tube_chan_service,
+          g_ptr_array_index (test->cm_streams, n - 1), handles[n - 1]);
+    }
+
+  /* Every connection is announced exactly once, with the right contact */
+  test->wait = STRESS_CONNECTIONS;
+  g_main_loop_run (test->mainloop);
+  g_assert_cmpuint (test->tube_conns->len, ==, STRESS_CONNECTIONS);
+
+  for (n = 0; n < STRESS_CONNECTIONS; n++)
+    {
+      TpStreamTubeConnection *tube_conn = g_ptr_array_index (test->tube_conns,
+          n);
+      TpContact *contact = tp_stream_tube_connection_get_contact (tube_conn);
+      guint k;
+
+      g_assert (contact != NULL);
+      g_assert (g_str_has_prefix (tp_contact_get_identifier (contact),
+            "contact"));
+
+      k = atoi (tp_contact_get_identifier (contact) + strlen ("contact"));
+      g_assert_cmpuint (k, <, STRESS_CONNECTIONS);
+      g_assert (!seen[k]);
+      seen[k] = TRUE;
+
+      /* Ports are unique so we can check the connection too. The random
+       * bytes used with credentials may collide, in which case connections
+       * are matched in order and can't be told apart. */
+      if (contexts[i].access_control == TP_SOCKET_ACCESS_CONTROL_PORT)
+        g_assert_cmpuint (
+            get_port (tp_stream_tube_connection_get_socket_connection (
+                tube_conn), FALSE), ==,
+            get_port (g_ptr_array_index (test->cm_streams, k), TRUE));
+    }
+
+  for (n = 0; n < STRESS_CONNECTIONS; n++)
+    tp_handle_unref (test->contact_repo, handles[n]);
+}
+
 static void
 read_eof_cb (GObject *source,
     GAsyncResult *result,
@@ -922,6 +1182,360 @@ read_eof_cb (GObject *source,
     g_main_loop_quit (test->mainloop);
 }
 
+static void
+forward_done_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+
+  tp_stream_tube_channel_forward_to_address_finish (
+      TP_STREAM_TUBE_CHANNEL (source), result, &test->error);
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+local_accepted_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+
+  tp_clear_object (&test->local_stream);
+
+  test->local_stream = G_IO_STREAM (g_socket_listener_accept_finish (
+        G_SOCKET_LISTENER (source), result, NULL, &test->error));
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+static void
+test_offer_forward (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  guint i = GPOINTER_TO_UINT (data);
+  GSocketListener *listener;
+  GInetAddress *loopback;
+  GSocketAddress *local_address, *forward_address, *address;
+  GSocketClient *client;
+  GCancellable *cancellable;
+  TpHandle bob_handle;
+  GInputStream *in;
+  gchar cm_buffer[BUFFER_SIZE];
+
+  if (contexts[i].address_type == TP_SOCKET_ADDRESS_TYPE_UNIX &&
+      contexts[i].access_control == TP_SOCKET_ACCESS_CONTROL_CREDENTIALS &&
+      !have_creds)
+    {
+      g_message ("skipped: credentials-passing not supported here");
+      return;
+    }
+
+  if (contexts[i].address_type == TP_SOCKET_ADDRESS_TYPE_IPV6 &&
+      !have_ipv6)
+    {
+      g_message ("skipped: IPv6 not supported here");
+      return;
+    }
+
+  /* The local service we want to make available through the tube */
+  listener = g_socket_listener_new ();
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  local_address = g_inet_socket_address_new (loopback, 0);
+
+  g_socket_listener_add_address (listener, local_address,
+      G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, NULL,
+      &forward_address, &test->error);
+  g_assert_no_error (test->error);
+
+  create_tube_service (test, TRUE, contexts[i].address_type,
+      contexts[i].access_control, contexts[i].contact);
+
+  cancellable = g_cancellable_new ();
+
+  tp_stream_tube_channel_forward_to_address_async (test->tube,
+      G_SOCKET_CONNECTABLE (forward_address), cancellable, forward_done_cb,
+      test);
+
+  tp_stream_tube_channel_offer_async (test->tube, NULL, tube_offer_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  /* A client connects to the tube... */
+  address = tp_tests_stream_tube_channel_get_server_address (
+      test->tube_chan_service);
+  g_assert (address != NULL);
+
+  client = g_socket_client_new ();
+
+  g_socket_client_connect_async (client, G_SOCKET_CONNECTABLE (address),
+      NULL, socket_connected, test);
+
+  g_object_unref (client);
+  g_object_unref (address);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert (test->cm_stream != NULL);
+
+  g_signal_connect (test->tube, "incoming",
+      G_CALLBACK (tube_incoming_cb), test);
+
+  g_socket_listener_accept_async (listener, NULL, local_accepted_cb, test);
+
+  bob_handle = tp_handle_ensure (test->contact_repo, "bob", NULL, NULL);
+
+  tp_tests_stream_tube_channel_peer_connected (test->tube_chan_service,
+      test->cm_stream, bob_handle);
+
+  /* ...the connection is still announced, and is forwarded to the local
+   * service */
+  test->wait = 2;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert (test->tube_conn != NULL);
+  g_assert (test->local_stream != NULL);
+
+  use_tube_with_streams (test, test->local_stream, test->cm_stream);
+
+  g_assert_cmpuint (tp_stream_tube_connection_get_bytes_received (
+        test->tube_conn), ==, BUFFER_SIZE);
+  g_assert_cmpuint (tp_stream_tube_connection_get_bytes_sent (
+        test->tube_conn), ==, BUFFER_SIZE);
+
+  /* Stopping forwarding closes the connection */
+  g_cancellable_cancel (cancellable);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_error (test->error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_clear_error (&test->error);
+
+  in = g_io_stream_get_input_stream (test->cm_stream);
+
+  g_input_stream_read_async (in, cm_buffer, BUFFER_SIZE,
+      G_PRIORITY_DEFAULT, NULL, read_eof_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+
+  tp_handle_unref (test->contact_repo, bob_handle);
+  g_object_unref (cancellable);
+  g_object_unref (forward_address);
+  g_object_unref (local_address);
+  g_object_unref (loopback);
+  g_object_unref (listener);
+}
+
+static void
+pump_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  Test *test = user_data;
+  guint64 received;
+
+  received = tp_tests_stream_pump_finish (G_IO_STREAM (source), result,
+      &test->error);
+  g_assert_no_error (test->error);
+
+  test->received += received;
+
+  test->wait--;
+  if (test->wait <= 0)
+    g_main_loop_quit (test->mainloop);
+}
+
+/* Measure how fast a tube connection is forwarded to a local service: the
+ * remote side writes as fast as it can, the local service just reads */
+static void
+test_benchmark_forward (Test *test,
+    gconstpointer data)
+{
+  guint i = GPOINTER_TO_UINT (data);
+  guint64 volume = tp_tests_benchmark_get_volume ();
+  TpTestsBenchmark *bench;
+  GSocketListener *listener;
+  GInetAddress *loopback;
+  GSocketAddress *local_address, *forward_address, *address;
+  GSocketClient *client;
+  GCancellable *cancellable;
+  TpHandle bob_handle;
+
+  if (contexts[i].access_control == TP_SOCKET_ACCESS_CONTROL_CREDENTIALS &&
+      !have_creds)
+    {
+      g_message ("skipped: credentials-passing not supported here");
+      return;
+    }
+
+  listener = g_socket_listener_new ();
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  local_address = g_inet_socket_address_new (loopback, 0);
+
+  g_socket_listener_add_address (listener, local_address,
+      G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, NULL,
+      &forward_address, &test->error);
+  g_assert_no_error (test->error);
+
+  create_tube_service (test, TRUE, contexts[i].address_type,
+      contexts[i].access_control, contexts[i].contact);
+
+  cancellable = g_cancellable_new ();
+
+  tp_stream_tube_channel_forward_to_address_async (test->tube,
+      G_SOCKET_CONNECTABLE (forward_address), cancellable, forward_done_cb,
+      test);
+
+  tp_stream_tube_channel_offer_async (test->tube, NULL, tube_offer_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  address = tp_tests_stream_tube_channel_get_server_address (
+      test->tube_chan_service);
+  client = g_socket_client_new ();
+
+  g_socket_client_connect_async (client, G_SOCKET_CONNECTABLE (address),
+      NULL, socket_connected, test);
+
+  g_object_unref (client);
+  g_object_unref (address);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_signal_connect (test->tube, "incoming",
+      G_CALLBACK (tube_incoming_cb), test);
+
+  g_socket_listener_accept_async (listener, NULL, local_accepted_cb, test);
+
+  bob_handle = tp_handle_ensure (test->contact_repo, "bob", NULL, NULL);
+
+  tp_tests_stream_tube_channel_peer_connected (test->tube_chan_service,
+      test->cm_stream, bob_handle);
+
+  test->wait = 2;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+  g_assert (test->local_stream != NULL);
+
+  bench = tp_tests_benchmark_start ();
+
+  tp_tests_stream_pump_async (test->cm_stream, volume, pump_cb, test);
+  tp_tests_stream_pump_async (test->local_stream, 0, pump_cb, test);
+
+  test->wait = 2;
+  g_main_loop_run (test->mainloop);
+
+  tp_tests_benchmark_stop (bench, volume);
+
+  g_assert_cmpuint (test->received, ==, volume);
+  g_assert_cmpuint (tp_stream_tube_connection_get_bytes_received (
+        test->tube_conn), ==, volume);
+
+  g_cancellable_cancel (cancellable);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_error (test->error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_clear_error (&test->error);
+
+  tp_handle_unref (test->contact_repo, bob_handle);
+  g_object_unref (cancellable);
+  g_object_unref (forward_address);
+  g_object_unref (local_address);
+  g_object_unref (loopback);
+  g_object_unref (listener);
+}
+
+#ifdef HAVE_GIO_UNIX
+/* If the CM can check credentials on abstract sockets, we use one rather
+ * than creating a temporary directory */
+static void
+test_offer_abstract (Test *test,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  GHashTable *sockets;
+  GArray *tab;
+  TpSocketAccessControl access_control;
+  GSocketAddress *address;
+  GSocketClient *client;
+  TpHandle bob_handle;
+
+  if (!have_creds)
+    {
+      g_message ("skipped: credentials-passing not supported here");
+      return;
+    }
+
+  sockets = create_supported_socket_types_hash (TP_SOCKET_ADDRESS_TYPE_UNIX,
+      TP_SOCKET_ACCESS_CONTROL_CREDENTIALS);
+
+  tab = g_array_sized_new (FALSE, FALSE, sizeof (TpSocketAccessControl), 1);
+  access_control = TP_SOCKET_ACCESS_CONTROL_CREDENTIALS;
+  g_array_append_val (tab, access_control);
+  g_hash_table_insert (sockets,
+      GUINT_TO_POINTER (TP_SOCKET_ADDRESS_TYPE_ABSTRACT_UNIX), tab);
+
+  create_tube_service_with_sockets (test, TRUE, sockets, TRUE);
+  g_hash_table_unref (sockets);
+
+  tp_stream_tube_channel_offer_async (test->tube, NULL, tube_offer_cb, test);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  address = tp_tests_stream_tube_channel_get_server_address (
+      test->tube_chan_service);
+  g_assert (G_IS_UNIX_SOCKET_ADDRESS (address));
+
+  if (g_unix_socket_address_abstract_names_supported ())
+    g_assert_cmpuint (g_unix_socket_address_get_address_type (
+          G_UNIX_SOCKET_ADDRESS (address)), ==,
+        G_UNIX_SOCKET_ADDRESS_ABSTRACT);
+
+  client = g_socket_client_new ();
+
+  g_socket_client_connect_async (client, G_SOCKET_CONNECTABLE (address),
+      NULL, socket_connected, test);
+
+  g_object_unref (client);
+  g_object_unref (address);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert_no_error (test->error);
+
+  g_signal_connect (test->tube, "incoming",
+      G_CALLBACK (tube_incoming_cb), test);
+
+  bob_handle = tp_handle_ensure (test->contact_repo, "bob", NULL, NULL);
+
+  tp_tests_stream_tube_channel_peer_connected (test->tube_chan_service,
+      test->cm_stream, bob_handle);
+
+  test->wait = 1;
+  g_main_loop_run (test->mainloop);
+  g_assert (test->tube_conn != NULL);
+
+  use_tube (test);
+
+  tp_handle_unref (test->contact_repo, bob_handle);
+}
+#endif
+
 /* We offer a contact stream tube to bob. The CM is bugged and claim that
  * another contact has connected to the tube. Tp-glib ignores it. */
 static void
@@ -1121,13 +1735,24 @@ main (int argc,
       test_accept_outgoing, teardown);
 
   run_tube_test ("/stream-tube/accept/success", test_accept_success);
+  run_tube_test ("/stream-tube/accept/pooled", test_accept_pooled);
   run_tube_test ("/stream-tube/offer/success", test_offer_success);
   run_tube_test ("/stream-tube/offer/race", test_offer_race);
+  run_tube_test ("/stream-tube/offer/stress", test_offer_stress);
+  run_tube_test ("/stream-tube/offer/forward", test_offer_forward);
 
+#ifdef HAVE_GIO_UNIX
+  g_test_add ("/stream-tube/offer/abstract", Test, NULL, setup,
+      test_offer_abstract, teardown);
+#endif
   g_test_add ("/stream-tube/offer/bad-connection/conn-first", Test, NULL, setup,
       test_offer_bad_connection_conn_first, teardown);
   g_test_add ("/stream-tube/offer/bad-connection/sig-first", Test, NULL, setup,
       test_offer_bad_connection_sig_first, teardown);
 
+  if (g_test_perf ())
+    run_tube_benchmark ("/stream-tube/benchmark/forward",
+        test_benchmark_forward);
+
   return tp_tests_run_with_bus ();
 }
@@ -293,6 +293,73 @@ test_wait (Fixture *f,
       "finished\n");
 }
 
+static void
+record_event_time_cb (TpDTMFPlayer *dtmf_player,
+    GArray *times)
+{
+  gint64 t = tp_dtmf_player_get_event_time (dtmf_player);
+
+  g_array_append_val (times, t);
+}
+
+static void
+test_concurrent (Fixture *f,
+    gconstpointer nil G_GNUC_UNUSED)
+{
+  TpDTMFPlayer *other = tp_dtmf_player_new ();
+  GArray *times = g_array_new (FALSE, FALSE, sizeof (gint64));
+  GArray *other_times = g_array_new (FALSE, FALSE, sizeof (gint64));
+  gboolean ok;
+  guint i;
+
+  g_signal_connect (f->dtmf_player, "started-tone",
+      G_CALLBACK (record_event_time_cb), times);
+  g_signal_connect (f->dtmf_player, "stopped-tone",
+      G_CALLBACK (record_event_time_cb), times);
+  g_signal_connect (other, "started-tone",
+      G_CALLBACK (record_event_time_cb), other_times);
+  g_signal_connect (other, "stopped-tone",
+      G_CALLBACK (record_event_time_cb), other_times);
+
+  ok = tp_dtmf_player_play (f->dtmf_player, "123", 50, 50, 50, &f->error);
+  g_assert_no_error (f->error);
+  g_assert (ok);
+  ok = tp_dtmf_player_play (other, "45", 50, 50, 50, &f->error);
+  g_assert_no_error (f->error);
+  g_assert (ok);
+
+  while (tp_dtmf_player_is_active (f->dtmf_player) ||
+      tp_dtmf_player_is_active (other))
+    g_main_context_iteration (NULL, TRUE);
+
+  fixture_assert_log (f,
+      "started '1'\n"
+      "stopped\n"
+      "started '2'\n"
+      "stopped\n"
+      "started '3'\n"
+      "stopped\n"
+      "finished\n");
+
+  /* Each tone and gap is timed from when the previous one was due to end,
+   * so unless the main loop was a whole tone late, there is no drift */
+  g_assert_cmpuint (times->len, ==, 6);
+
+  for (i = 1; i < times->len; i++)
+    g_assert_cmpint (g_array_index (times, gint64, i) -
+        g_array_index (times, gint64, i - 1), ==, 50000);
+
+  g_assert_cmpuint (other_times->len, ==, 4);
+
+  for (i = 1; i < other_times->len; i++)
+    g_assert_cmpint (g_array_index (other_times, gint64, i) -
+        g_array_index (other_times, gint64, i - 1), ==, 50000);
+
+  g_object_unref (other);
+  g_array_unref (times);
+  g_array_unref (other_times);
+}
+
 int
 main (int argc,
     char **argv)
@@ -313,6 +380,7 @@ main (int argc,
   FIXTURE_TEST (cancel_in_pause);
   FIXTURE_TEST (sequence);
   FIXTURE_TEST (wait);
+  FIXTURE_TEST (concurrent);
 
   return g_test_run ();
 }
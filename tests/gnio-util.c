@@ -9,7 +9,9 @@
 #include <gio/gio.h>
 
 #ifdef HAVE_GIO_UNIX
+#include <gio/gunixconnection.h>
 #include <gio/gunixsocketaddress.h>
+#include <sys/socket.h>
 #endif /* HAVE_GIO_UNIX */
 
 #include <telepathy-glib/gnio-util.h>
@@ -297,6 +299,107 @@ test_sockaddr_to_variant_abstract_unix (void)
 
   tp_g_value_slice_free (variant);
 }
+
+typedef struct {
+    GMainLoop *loop;
+    guint wait;
+    gboolean sent;
+    GCredentials *creds;
+    guchar byte;
+} CredentialsTest;
+
+static void
+credentials_sent_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  CredentialsTest *test = user_data;
+  GError *error = NULL;
+
+  test->sent = tp_unix_connection_send_credentials_with_byte_finish (
+      G_SOCKET_CONNECTION (source), result, &error);
+  g_assert_no_error (error);
+
+  if (--test->wait == 0)
+    g_main_loop_quit (test->loop);
+}
+
+static void
+credentials_received_cb (GObject *source,
+    GAsyncResult *result,
+    gpointer user_data)
+{
+  CredentialsTest *test = user_data;
+  GError *error = NULL;
+
+  test->creds = tp_unix_connection_receive_credentials_with_byte_finish (
+      G_SOCKET_CONNECTION (source), result, &test->byte, &error);
+  g_assert_no_error (error);
+
+  if (--test->wait == 0)
+    g_main_loop_quit (test->loop);
+}
+
+static GSocketConnection *
+connection_new_from_fd (int fd)
+{
+  GSocket *sock;
+  GSocketConnection *connection;
+  GError *error = NULL;
+
+  sock = g_socket_new_from_fd (fd, &error);
+  g_assert_no_error (error);
+
+  connection = g_socket_connection_factory_create_connection (sock);
+  g_assert (G_IS_UNIX_CONNECTION (connection));
+
+  g_object_unref (sock);
+  return connection;
+}
+
+static void
+test_credentials_async (void)
+{
+  CredentialsTest test = { NULL, 0, FALSE, NULL, 0 };
+  GSocketConnection *sender, *receiver;
+  GCredentials *ours;
+  int fds[2];
+
+  g_assert_cmpint (socketpair (AF_UNIX, SOCK_STREAM, 0, fds), ==, 0);
+
+  sender = connection_new_from_fd (fds[0]);
+  receiver = connection_new_from_fd (fds[1]);
+
+  test.loop = g_main_loop_new (NULL, FALSE);
+
+  /* Nothing has been sent yet, so receiving has to wait for the socket to
+   * become readable rather than blocking (or spawning a thread) */
+  tp_unix_connection_receive_credentials_with_byte_async (receiver, NULL,
+      credentials_received_cb, &test);
+  tp_unix_connection_send_credentials_with_byte_async (sender, 'X', NULL,
+      credentials_sent_cb, &test);
+  test.wait = 2;
+
+  g_main_loop_run (test.loop);
+
+  g_assert (test.sent);
+  g_assert (test.creds != NULL);
+  g_assert_cmpuint (test.byte, ==, 'X');
+
+  ours = g_credentials_new ();
+  g_assert_cmpuint (g_credentials_get_unix_user (test.creds, NULL), ==,
+      g_credentials_get_unix_user (ours, NULL));
+  g_object_unref (ours);
+
+  /* The sockets are back to their original mode */
+  g_assert (g_socket_get_blocking (g_socket_connection_get_socket (sender)));
+  g_assert (g_socket_get_blocking (g_socket_connection_get_socket (receiver)));
+
+  g_object_unref (test.creds);
+  g_object_unref (sender);
+  g_object_unref (receiver);
+  g_main_loop_unref (test.loop);
+}
 #endif /* HAVE_GIO_UNIX */
 
 int
@@ -313,6 +416,7 @@ main (int argc, char **argv)
   test_variant_to_sockaddr_abstract_unix ();
   test_sockaddr_to_variant_unix ();
   test_sockaddr_to_variant_abstract_unix ();
+  test_credentials_async ();
 #endif /* HAVE_GIO_UNIX */
 
   return 0;
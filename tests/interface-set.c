@@ -0,0 +1,109 @@
+#include "config.h"
+
+#include <glib.h>
+
+#include "telepathy-glib/interface-set-internal.h"
+
+#include <telepathy-glib/interfaces.h>
+
+#include "tests/lib/util.h"
+
+static void
+test_basics (void)
+{
+  TpInterfaceSet *empty = _tp_interface_set_empty ();
+  TpInterfaceSet *text, *text_group;
+  GQuark text_q = TP_IFACE_QUARK_CHANNEL_TYPE_TEXT;
+  GQuark group_q = TP_IFACE_QUARK_CHANNEL_INTERFACE_GROUP;
+  GArray *quarks;
+
+  g_assert (empty != NULL);
+  g_assert (_tp_interface_set_empty () == empty);
+  g_assert (!_tp_interface_set_contains (empty, text_q));
+
+  quarks = _tp_interface_set_dup_quarks (empty);
+  g_assert_cmpuint (quarks->len, ==, 0);
+  g_array_unref (quarks);
+
+  text = _tp_interface_set_add (empty, text_q);
+  g_assert (text != empty);
+  g_assert (_tp_interface_set_contains (text, text_q));
+  g_assert (!_tp_interface_set_contains (text, group_q));
+  g_assert (!_tp_interface_set_contains (empty, text_q));
+
+  /* adding something that's already there is a no-op */
+  g_assert (_tp_interface_set_add (text, text_q) == text);
+
+  text_group = _tp_interface_set_add (text, group_q);
+  g_assert (_tp_interface_set_contains (text_group, text_q));
+  g_assert (_tp_interface_set_contains (text_group, group_q));
+
+  quarks = _tp_interface_set_dup_quarks (text_group);
+  g_assert_cmpuint (quarks->len, ==, 2);
+  g_assert_cmpuint (g_array_index (quarks, GQuark, 0), ==, text_q);
+  g_assert_cmpuint (g_array_index (quarks, GQuark, 1), ==, group_q);
+  g_array_unref (quarks);
+}
+
+static void
+test_shared (void)
+{
+  TpInterfaceSet *empty = _tp_interface_set_empty ();
+  GQuark a = g_quark_from_static_string ("com.example.InterfaceSet.A");
+  GQuark b = g_quark_from_static_string ("com.example.InterfaceSet.B");
+  TpInterfaceSet *ab, *ba;
+
+  /* the same interfaces, added in either order, give the same set */
+  ab = _tp_interface_set_add (_tp_interface_set_add (empty, a), b);
+  ba = _tp_interface_set_add (_tp_interface_set_add (empty, b), a);
+  g_assert (ab == ba);
+
+  /* and building it up again gives the same set again */
+  g_assert (_tp_interface_set_add (_tp_interface_set_add (empty, a), b) ==
+      ab);
+}
+
+static void
+test_many (void)
+{
+  TpInterfaceSet *set = _tp_interface_set_empty ();
+  GArray *quarks;
+  guint i;
+
+  /* enough interfaces to need more than one word */
+  for (i = 0; i < 100; i++)
+    {
+      gchar *name = g_strdup_printf ("com.example.InterfaceSet.Many%u", i);
+
+      set = _tp_interface_set_add (set, g_quark_from_string (name));
+      g_free (name);
+    }
+
+  for (i = 0; i < 100; i++)
+    {
+      gchar *name = g_strdup_printf ("com.example.InterfaceSet.Many%u", i);
+
+      g_assert (_tp_interface_set_contains (set, g_quark_from_string (name)));
+      g_free (name);
+    }
+
+  g_assert (!_tp_interface_set_contains (set,
+        TP_IFACE_QUARK_CHANNEL_TYPE_TEXT));
+
+  quarks = _tp_interface_set_dup_quarks (set);
+  g_assert_cmpuint (quarks->len, ==, 100);
+  g_array_unref (quarks);
+}
+
+int
+main (int argc,
+    char **argv)
+{
+  tp_tests_init (&argc, &argv);
+
+  g_test_add_func ("/interface-set/basics", test_basics);
+  g_test_add_func ("/interface-set/shared", test_shared);
+  g_test_add_func ("/interface-set/many", test_many);
+
+  return g_test_run ();
+}
@@ -49,6 +49,14 @@ enum /* properties */
   N_PROPS,
 };
 
+enum /* signals */
+{
+  SIG_INCOMING_CONNECTION,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = {0, };
+
 struct _TpTestsFileTransferChannelPrivate {
     /* Exposed properties */
     gchar *content_type;
@@ -81,6 +89,7 @@ struct _TpTestsFileTransferChannelPrivate {
     TpSocketAccessControl access_control;
 
     guint timer_id;
+    TpProgressThrottle *progress;
 };
 
 static void
@@ -125,6 +134,10 @@ constructor (GType type,
   if (self->priv->available_socket_types == NULL)
     create_available_socket_types (self);
 
+  /* Report every step unless a test asks otherwise */
+  self->priv->progress = tp_progress_throttle_new_for_file_transfer (
+      TP_SVC_CHANNEL_TYPE_FILE_TRANSFER (self), 0, 0);
+
   tp_base_channel_register (TP_BASE_CHANNEL (self));
 
   return object;
@@ -141,6 +154,8 @@ dispose (GObject *object)
       self->priv->timer_id = 0;
     }
 
+  tp_clear_pointer (&self->priv->progress, tp_progress_throttle_destroy);
+
   g_free (self->priv->content_hash);
   g_free (self->priv->content_type);
   g_free (self->priv->description);
@@ -427,19 +442,26 @@ service_incoming_cb (GSocketService *service,
     }
   else if (self->priv->access_control == TP_SOCKET_ACCESS_CONTROL_PORT)
     {
-      GSocketAddress *addr;
-      guint16 port;
+      GSocketAddress *addr, *expected;
 
       addr = g_socket_connection_get_remote_address (connection, &error);
       g_assert_no_error (error);
 
-      port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr));
+      /* For file transfers, the parameter is the whole address the
+       * connection will come from */
+      expected = tp_g_socket_address_from_variant (self->priv->address_type,
+          self->priv->access_control_param, &error);
+      g_assert_no_error (error);
 
-      g_assert_cmpuint (port, ==,
-          g_value_get_uint (self->priv->access_control_param));
+      g_assert_cmpuint (
+          g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr)), ==,
+          g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (expected)));
 
+      g_object_unref (expected);
       g_object_unref (addr);
     }
+
+  g_signal_emit (self, signals[SIG_INCOMING_CONNECTION], 0, connection);
 }
 
 static void
@@ -494,8 +516,13 @@ file_transfer_provide_file (TpSvcChannelTypeFileTransfer *iface,
         goto fail;
       }
 
+  tp_g_signal_connect_object (self->priv->service, "incoming",
+      G_CALLBACK (service_incoming_cb), self, 0);
+
   self->priv->address_type = address_type;
   self->priv->access_control = access_control;
+  self->priv->access_control_param = tp_g_value_slice_dup (
+      access_control_param);
 
   DEBUG ("Waiting 500ms and setting state to OPEN");
   self->priv->timer_id = g_timeout_add (500, start_file_transfer, self);
@@ -557,10 +584,16 @@ file_transfer_accept_file (TpSvcChannelTypeFileTransfer *iface,
   tp_g_signal_connect_object (self->priv->service, "incoming",
       G_CALLBACK (service_incoming_cb), self, 0);
 
+  self->priv->address_type = address_type;
   self->priv->access_control = access_control;
   self->priv->access_control_param = tp_g_value_slice_dup (
       access_control_param);
 
+  /* We can always resume wherever the receiver wants */
+  self->priv->initial_offset = offset;
+  tp_svc_channel_type_file_transfer_emit_initial_offset_defined (self,
+      offset);
+
   DEBUG ("Setting TP_FILE_TRANSFER_STATE_ACCEPTED");
   change_state (self, TP_FILE_TRANSFER_STATE_ACCEPTED,
       TP_FILE_TRANSFER_STATE_CHANGE_REASON_REQUESTED);
@@ -594,6 +627,7 @@ tp_tests_file_transfer_channel_class_init (
       { "Date", "date", NULL },
       { "Description", "description", NULL },
       { "Filename", "filename", NULL },
+      { "InitialOffset", "initial-offset", NULL },
       { "Size", "size", NULL },
       { "State", "state", NULL },
       { "TransferredBytes", "transferred-bytes", NULL },
@@ -714,6 +748,13 @@ tp_tests_file_transfer_channel_class_init (
   g_object_class_install_property (object_class, PROP_METADATA,
       param_spec);
 
+  signals[SIG_INCOMING_CONNECTION] = g_signal_new ("incoming-connection",
+      G_OBJECT_CLASS_TYPE (klass),
+      G_SIGNAL_RUN_LAST,
+      0, NULL, NULL, NULL,
+      G_TYPE_NONE,
+      1, G_TYPE_IO_STREAM);
+
   tp_dbus_properties_mixin_implement_interface (object_class,
       TP_IFACE_QUARK_CHANNEL_TYPE_FILE_TRANSFER,
       tp_dbus_properties_mixin_getter_gobject_properties, NULL,
@@ -760,3 +801,43 @@ tp_tests_file_transfer_channel_get_server_address (
 
   return address;
 }
+
+void
+tp_tests_file_transfer_channel_set_progress_thresholds (
+    TpTestsFileTransferChannel *self,
+    guint interval_ms,
+    guint64 min_bytes)
+{
+  tp_progress_throttle_set_thresholds (self->priv->progress, interval_ms,
+      min_bytes);
+}
+
+/* Pretend that @count bytes have been transferred so far */
+void
+tp_tests_file_transfer_channel_report_progress (
+    TpTestsFileTransferChannel *self,
+    guint64 count)
+{
+  self->priv->transferred_bytes = count;
+  tp_progress_throttle_update (self->priv->progress, count);
+}
+
+/* Pretend that the receiver of an outgoing transfer wants it to start at
+ * @offset */
+void
+tp_tests_file_transfer_channel_define_initial_offset (
+    TpTestsFileTransferChannel *self,
+    guint64 offset)
+{
+  self->priv->initial_offset = offset;
+  tp_svc_channel_type_file_transfer_emit_initial_offset_defined (self,
+      offset);
+}
+
+void
+tp_tests_file_transfer_channel_complete (TpTestsFileTransferChannel *self)
+{
+  tp_progress_throttle_flush (self->priv->progress);
+  change_state (self, TP_FILE_TRANSFER_STATE_COMPLETED,
+      TP_FILE_TRANSFER_STATE_CHANGE_REASON_NONE);
+}
@@ -58,6 +58,22 @@ GHashTable * tp_tests_file_transfer_channel_get_props (
 GSocketAddress * tp_tests_file_transfer_channel_get_server_address (
         TpTestsFileTransferChannel *self);
 
+void tp_tests_file_transfer_channel_set_progress_thresholds (
+        TpTestsFileTransferChannel *self,
+        guint interval_ms,
+        guint64 min_bytes);
+
+void tp_tests_file_transfer_channel_report_progress (
+        TpTestsFileTransferChannel *self,
+        guint64 count);
+
+void tp_tests_file_transfer_channel_complete (
+        TpTestsFileTransferChannel *self);
+
+void tp_tests_file_transfer_channel_define_initial_offset (
+        TpTestsFileTransferChannel *self,
+        guint64 offset);
+
 G_END_DECLS
 
 #endif
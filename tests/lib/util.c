@@ -16,6 +16,7 @@
 
 #include <glib/gstdio.h>
 #include <string.h>
+#include <time.h>
 
 #ifdef G_OS_UNIX
 # include <unistd.h> /* for alarm() */
@@ -554,3 +555,196 @@ tp_tests_connection_run_until_contact_by_id (TpConnection *connection,
 
   return contact;
 }
+
+/* The number of bytes the benchmarks push through each channel, taken from
+ * TP_TESTS_BENCHMARK_VOLUME: a number of bytes with an optional k, M or G
+ * (decimal) suffix, such as "10G". Large volumes will probably also need
+ * TP_TESTS_NO_TIMEOUT. */
+guint64
+tp_tests_benchmark_get_volume (void)
+{
+  const gchar *str = g_getenv ("TP_TESTS_BENCHMARK_VOLUME");
+  gchar *end;
+  guint64 volume;
+
+  if (str == NULL)
+    return G_GUINT64_CONSTANT (64000000);
+
+  volume = g_ascii_strtoull (str, &end, 10);
+
+  switch (*end)
+    {
+      case 'G':
+        volume *= 1000;
+        /* fall through */
+      case 'M':
+        volume *= 1000;
+        /* fall through */
+      case 'k':
+        volume *= 1000;
+        end++;
+        break;
+
+      default:
+        break;
+    }
+
+  if (*end != '\0' || volume == 0)
+    g_error ("Invalid TP_TESTS_BENCHMARK_VOLUME: '%s'", str);
+
+  return volume;
+}
+
+struct _TpTestsBenchmark {
+    gint64 start_time;
+    clock_t start_clock;
+};
+
+static guint benchmark_polls = 0;
+
+static gint
+benchmark_poll (GPollFD *fds,
+    guint nfds,
+    gint timeout)
+{
+  benchmark_polls++;
+  return g_poll (fds, nfds, timeout);
+}
+
+/* Start measuring the wall-clock time, the CPU time used by the whole
+ * process, and how many times the default main context goes round. */
+TpTestsBenchmark *
+tp_tests_benchmark_start (void)
+{
+  TpTestsBenchmark *bench = g_slice_new0 (TpTestsBenchmark);
+
+  benchmark_polls = 0;
+  g_main_context_set_poll_func (NULL, benchmark_poll);
+
+  bench->start_clock = clock ();
+  bench->start_time = g_get_monotonic_time ();
+
+  return bench;
+}
+
+/* Stop measuring, report the results for @bytes of data and free @bench */
+void
+tp_tests_benchmark_stop (TpTestsBenchmark *bench,
+    guint64 bytes)
+{
+  gdouble elapsed, cpu;
+
+  elapsed = (g_get_monotonic_time () - bench->start_time) /
+      (gdouble) G_USEC_PER_SEC;
+  cpu = (clock () - bench->start_clock) / (gdouble) CLOCKS_PER_SEC;
+
+  g_main_context_set_poll_func (NULL, NULL);
+
+  g_test_maximized_result (bytes / 1e6 / elapsed,
+      "%" G_GUINT64_FORMAT " bytes in %.3f s: %.1f MB/s", bytes, elapsed,
+      bytes / 1e6 / elapsed);
+  g_test_minimized_result (cpu, "%.3f s of CPU time (%.0f%%)", cpu,
+      100 * cpu / elapsed);
+  g_test_minimized_result (benchmark_polls,
+      "%u main loop iterations (%.1f per MB)", benchmark_polls,
+      benchmark_polls / (bytes / 1e6));
+
+  g_slice_free (TpTestsBenchmark, bench);
+}
+
+#define PUMP_BUFFER_SIZE (64 * 1024)
+
+static void
+stream_pump_thread (GTask *task,
+    gpointer source_object,
+    gpointer task_data,
+    GCancellable *cancellable)
+{
+  GIOStream *stream = source_object;
+  guint64 *bytes_to_send = task_data;
+  GSocket *sock;
+  gchar *buffer;
+  guint64 sent = 0, received = 0;
+  gssize n;
+  GError *error = NULL;
+
+  buffer = g_malloc0 (PUMP_BUFFER_SIZE);
+  sock = g_socket_connection_get_socket (G_SOCKET_CONNECTION (stream));
+
+  while (sent < *bytes_to_send)
+    {
+      n = g_output_stream_write (g_io_stream_get_output_stream (stream),
+          buffer, MIN (PUMP_BUFFER_SIZE, *bytes_to_send - sent), NULL,
+          &error);
+      if (n < 0)
+        goto out;
+
+      sent += n;
+    }
+
+  /* Tell the other side we're done, and drain what it sends until it does
+   * the same */
+  if (!g_socket_shutdown (sock, FALSE, TRUE, &error))
+    goto out;
+
+  do
+    {
+      n = g_input_stream_read (g_io_stream_get_input_stream (stream),
+          buffer, PUMP_BUFFER_SIZE, NULL, &error);
+      if (n < 0)
+        goto out;
+
+      received += n;
+    }
+  while (n > 0);
+
+out:
+  g_free (buffer);
+
+  if (error != NULL)
+    g_task_return_error (task, error);
+  else
+    g_task_return_pointer (task, g_memdup (&received, sizeof (received)),
+        g_free);
+}
+
+/* Write @bytes_to_send bytes of zeroes to @stream, a GSocketConnection,
+ * then shut it down for writing and read everything the other side sends
+ * until it does the same. This happens in a thread with blocking I/O, so
+ * it doesn't show up in the main loop. */
+void
+tp_tests_stream_pump_async (GIOStream *stream,
+    guint64 bytes_to_send,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  GTask *task;
+
+  g_return_if_fail (G_IS_SOCKET_CONNECTION (stream));
+
+  task = g_task_new (stream, NULL, callback, user_data);
+  g_task_set_task_data (task, g_memdup (&bytes_to_send,
+        sizeof (bytes_to_send)), g_free);
+  g_task_run_in_thread (task, stream_pump_thread);
+  g_object_unref (task);
+}
+
+/* Returns the number of bytes received, or G_MAXUINT64 on error */
+guint64
+tp_tests_stream_pump_finish (GIOStream *stream,
+    GAsyncResult *result,
+    GError **error)
+{
+  guint64 *received;
+  guint64 ret;
+
+  g_return_val_if_fail (g_task_is_valid (result, stream), G_MAXUINT64);
+
+  received = g_task_propagate_pointer (G_TASK (result), error);
+  if (received == NULL)
+    return G_MAXUINT64;
+
+  ret = *received;
+  g_free (received);
+  return ret;
+}
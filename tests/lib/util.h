@@ -83,4 +83,20 @@ TpContact *tp_tests_connection_run_until_contact_by_id (
     guint n_features,
     const TpContactFeature *features);
 
+guint64 tp_tests_benchmark_get_volume (void);
+
+typedef struct _TpTestsBenchmark TpTestsBenchmark;
+
+TpTestsBenchmark *tp_tests_benchmark_start (void);
+void tp_tests_benchmark_stop (TpTestsBenchmark *bench,
+    guint64 bytes);
+
+void tp_tests_stream_pump_async (GIOStream *stream,
+    guint64 bytes_to_send,
+    GAsyncReadyCallback callback,
+    gpointer user_data);
+guint64 tp_tests_stream_pump_finish (GIOStream *stream,
+    GAsyncResult *result,
+    GError **error);
+
 #endif /* #ifndef __TP_TESTS_LIB_UTIL_H__ */
@@ -0,0 +1,202 @@
+/* Tests for TpProgressThrottle
+ *
+ * Copyright © 2014 Collabora Ltd. <http://www.collabora.co.uk/>
+ *
+ * Copying and distribution of this file, with or without modification,
+ * are permitted in any medium without royalty provided the copyright
+ * notice and this notice are preserved.
+ */
+
+#include "config.h"
+
+#include <telepathy-glib/progress-throttle.h>
+#include <telepathy-glib/util.h>
+
+#include "tests/lib/util.h"
+
+typedef struct {
+    TpProgressThrottle *throttle;
+    GArray *reported;
+} Fixture;
+
+static void
+report_cb (guint64 value,
+    gpointer user_data)
+{
+  Fixture *f = user_data;
+
+  g_array_append_val (f->reported, value);
+}
+
+static void
+setup (Fixture *f,
+    gconstpointer data)
+{
+  f->reported = g_array_new (FALSE, FALSE, sizeof (guint64));
+}
+
+static void
+teardown (Fixture *f,
+    gconstpointer data)
+{
+  tp_clear_pointer (&f->throttle, tp_progress_throttle_destroy);
+  g_array_unref (f->reported);
+}
+
+static void
+wait_for_reports (Fixture *f,
+    guint n)
+{
+  while (f->reported->len < n)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (f->reported->len, ==, n);
+}
+
+static gboolean
+quit_cb (gpointer user_data)
+{
+  *(gboolean *) user_data = TRUE;
+  return FALSE;
+}
+
+/* Run the main loop for a while, so any timeout the throttle has set would
+ * have fired */
+static void
+run_for (guint ms)
+{
+  gboolean done = FALSE;
+
+  g_timeout_add (ms, quit_cb, &done);
+
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static guint64
+reported (Fixture *f,
+    guint i)
+{
+  return g_array_index (f->reported, guint64, i);
+}
+
+static void
+test_interval (Fixture *f,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  f->throttle = tp_progress_throttle_new (50, 100, report_cb, f);
+
+  /* the first value is always reported */
+  tp_progress_throttle_update (f->throttle, 0);
+  g_assert_cmpuint (f->reported->len, ==, 1);
+  g_assert_cmpuint (reported (f, 0), ==, 0);
+
+  /* a big enough step within the interval is held back until the interval
+   * has passed, and then the latest value is reported */
+  tp_progress_throttle_update (f->throttle, 100);
+  tp_progress_throttle_update (f->throttle, 120);
+  g_assert_cmpuint (f->reported->len, ==, 1);
+  wait_for_reports (f, 2);
+  g_assert_cmpuint (reported (f, 1), ==, 120);
+
+  /* once the interval has passed, a big enough step is reported at once */
+  run_for (60);
+  tp_progress_throttle_update (f->throttle, 300);
+  g_assert_cmpuint (f->reported->len, ==, 3);
+  g_assert_cmpuint (reported (f, 2), ==, 300);
+}
+
+static void
+test_step (Fixture *f,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  f->throttle = tp_progress_throttle_new (50, 100, report_cb, f);
+
+  tp_progress_throttle_update (f->throttle, 0);
+  g_assert_cmpuint (f->reported->len, ==, 1);
+
+  /* small steps are held back even when the interval has passed... */
+  tp_progress_throttle_update (f->throttle, 10);
+  tp_progress_throttle_update (f->throttle, 20);
+  run_for (120);
+  tp_progress_throttle_update (f->throttle, 30);
+  run_for (120);
+  g_assert_cmpuint (f->reported->len, ==, 1);
+
+  /* ... until they add up to the minimum step */
+  tp_progress_throttle_update (f->throttle, 100);
+  g_assert_cmpuint (f->reported->len, ==, 2);
+  g_assert_cmpuint (reported (f, 1), ==, 100);
+
+  /* going backwards is always worth reporting */
+  run_for (60);
+  tp_progress_throttle_update (f->throttle, 50);
+  g_assert_cmpuint (f->reported->len, ==, 3);
+  g_assert_cmpuint (reported (f, 2), ==, 50);
+}
+
+static void
+test_step_only (Fixture *f,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  /* with no interval, only the step matters */
+  f->throttle = tp_progress_throttle_new (0, 100, report_cb, f);
+
+  tp_progress_throttle_update (f->throttle, 0);
+  g_assert_cmpuint (f->reported->len, ==, 1);
+
+  tp_progress_throttle_update (f->throttle, 50);
+  tp_progress_throttle_update (f->throttle, 99);
+  run_for (10);
+  g_assert_cmpuint (f->reported->len, ==, 1);
+
+  tp_progress_throttle_update (f->throttle, 100);
+  g_assert_cmpuint (f->reported->len, ==, 2);
+  g_assert_cmpuint (reported (f, 1), ==, 100);
+
+  tp_progress_throttle_update (f->throttle, 150);
+  run_for (10);
+  g_assert_cmpuint (f->reported->len, ==, 2);
+
+  /* the final value is reported however small the last step */
+  tp_progress_throttle_flush (f->throttle);
+  g_assert_cmpuint (f->reported->len, ==, 3);
+  g_assert_cmpuint (reported (f, 2), ==, 150);
+}
+
+static void
+test_flush (Fixture *f,
+    gconstpointer data G_GNUC_UNUSED)
+{
+  f->throttle = tp_progress_throttle_new (50, 1000000, report_cb, f);
+
+  tp_progress_throttle_update (f->throttle, 0);
+  tp_progress_throttle_update (f->throttle, 10);
+  g_assert_cmpuint (f->reported->len, ==, 1);
+
+  tp_progress_throttle_flush (f->throttle);
+  g_assert_cmpuint (f->reported->len, ==, 2);
+  g_assert_cmpuint (reported (f, 1), ==, 10);
+
+  /* nothing new: flushing doesn't repeat the last value */
+  tp_progress_throttle_flush (f->throttle);
+  g_assert_cmpuint (f->reported->len, ==, 2);
+}
+
+int
+main (int argc,
+    char **argv)
+{
+  tp_tests_init (&argc, &argv);
+
+  g_test_add ("/progress-throttle/interval", Fixture, NULL, setup,
+      test_interval, teardown);
+  g_test_add ("/progress-throttle/step", Fixture, NULL, setup,
+      test_step, teardown);
+  g_test_add ("/progress-throttle/step-only", Fixture, NULL, setup,
+      test_step_only, teardown);
+  g_test_add ("/progress-throttle/flush", Fixture, NULL, setup,
+      test_flush, teardown);
+
+  return g_test_run ();
+}